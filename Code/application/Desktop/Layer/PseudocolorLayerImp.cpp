@@ -197,7 +197,7 @@ void drawPseudocolorMarkers(T* pData, int stopColumn, int stopRow, int visStartC
 
 void PseudocolorLayerImp::draw()
 {
-   RasterElement* pRasterElement = dynamic_cast<RasterElement*>(getDataElement());
+   const RasterElement* pRasterElement = dynamic_cast<const RasterElement*>(getDataElement());
    if (pRasterElement != NULL)
    {
       if (canRenderAsImage())
@@ -215,7 +215,7 @@ void PseudocolorLayerImp::draw()
          int columns = 0;
          int rows = 0;
          EncodingType eType;
-         void* pData = NULL;
+         const void* pData = NULL;
 
          const RasterDataDescriptor* pDescriptor =
             dynamic_cast<const RasterDataDescriptor*>(pRasterElement->getDataDescriptor());
@@ -7,6 +7,7 @@
  * http://www.gnu.org/licenses/lgpl.html
  */
 
+#include <QtCore/QTimer>
 #include <QtGui/QAction>
 #include <QtGui/QApplication>
 #include <QtGui/QInputDialog>
@@ -61,6 +62,9 @@ XERCES_CPP_NAMESPACE_USE
 namespace
 {
    const string shortcutContext = "Layer/Raster";
+
+   // Interval in milliseconds at which to check for tiles generated in the background
+   const int TILE_REFRESH_INTERVAL = 50;
 }
 
 RasterLayerImp::RasterLayerImp(const string& id, const string& layerName, DataElement* pElement) :
@@ -68,6 +72,7 @@ RasterLayerImp::RasterLayerImp(const string& id, const string& layerName, DataEl
    mpImage(NULL),
    mUseGpuImage(false),
    mbRegenerate(true),
+   mTileRefreshPending(false),
    meDisplayMode(GRAYSCALE_MODE),
    mEnableFastContrastStretch(true),
    mlstGrayStretchValues(2),
@@ -259,21 +264,27 @@ void RasterLayerImp::elementModifiedBlue(Subject& subject, const string& signal,
 void RasterLayerImp::elementDeletedGray(Subject& subject, const string& signal, const boost::any& data)
 {
    setDisplayedBand(GRAY, DimensionDescriptor());
+
+   // The image's tile and overview threads read from the element, so stop them before it is destroyed
+   setImage(NULL);
 }
 
 void RasterLayerImp::elementDeletedRed(Subject& subject, const string& signal, const boost::any& data)
 {
    setDisplayedBand(RED, DimensionDescriptor());
+   setImage(NULL);
 }
 
 void RasterLayerImp::elementDeletedGreen(Subject& subject, const string& signal, const boost::any& data)
 {
    setDisplayedBand(GREEN, DimensionDescriptor());
+   setImage(NULL);
 }
 
 void RasterLayerImp::elementDeletedBlue(Subject& subject, const string& signal, const boost::any& data)
 {
    setDisplayedBand(BLUE, DimensionDescriptor());
+   setImage(NULL);
 }
 
 void RasterLayerImp::fullImageRegenGray(Subject& subject, const std::string& signal, const boost::any& v)
@@ -433,6 +444,13 @@ void RasterLayerImp::draw()
       {
          applyFastContrastStretch();
       }
+
+      // Draw again once the tiles which are not ready have been generated
+      if (mTileRefreshPending == false && mpImage->isGeneratingTiles() == true)
+      {
+         mTileRefreshPending = true;
+         QTimer::singleShot(TILE_REFRESH_INTERVAL, this, SLOT(refreshGeneratedTiles()));
+      }
    }
 
    // Draw the pixel values
@@ -3262,6 +3280,31 @@ void RasterLayerImp::generateImage()
    setImage(pImage);
 }
 
+void RasterLayerImp::refreshGeneratedTiles()
+{
+   mTileRefreshPending = false;
+   if (mpImage == NULL)
+   {
+      return;
+   }
+
+   if (mpImage->hasGeneratedTiles() == true)
+   {
+      ViewImp* pView = dynamic_cast<ViewImp*>(getView());
+      if (pView != NULL)
+      {
+         pView->refresh();
+         return;
+      }
+   }
+
+   if (mpImage->isGeneratingTiles() == true)
+   {
+      mTileRefreshPending = true;
+      QTimer::singleShot(TILE_REFRESH_INTERVAL, this, SLOT(refreshGeneratedTiles()));
+   }
+}
+
 void RasterLayerImp::generateFullImage()
 {
    Image* pImage = getImage();
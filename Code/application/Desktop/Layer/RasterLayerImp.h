@@ -212,11 +212,13 @@ protected slots:
    void updateDisplayModeAction(const DisplayMode& displayMode);
    void changeStretch(QAction* pAction);
    void displayAs(QAction* pAction);
+   void refreshGeneratedTiles();
 
 private:
    Image* mpImage;
    bool mUseGpuImage;
    bool mbRegenerate;
+   bool mTileRefreshPending;
 
    DisplayMode meDisplayMode;
    ComplexComponent mComplexComponent;
@@ -244,7 +244,7 @@ void ThresholdLayerImp::draw()
    {
       int columns = 0;
       int rows = 0;
-      void* pData = NULL;
+      const void* pData = NULL;
       EncodingType eType;
       vector<int> badValues;
 
@@ -257,7 +257,7 @@ void ThresholdLayerImp::draw()
          eType = pDescriptor->getDataType();
       }
 
-      RasterElement* pRasterElement = dynamic_cast<RasterElement*>(pElement);
+      const RasterElement* pRasterElement = dynamic_cast<const RasterElement*>(pElement);
       if (pRasterElement != NULL)
       {
          Statistics* pStatistics = pRasterElement->getStatistics();
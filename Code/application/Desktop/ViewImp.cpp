@@ -22,6 +22,7 @@
 #include "FontImp.h"
 #include "GeocoordLinkFunctor.h"
 #include "glCommon.h"
+#include "Image.h"
 #include "ImageResolutionWidget.h"
 #include "MouseModeImp.h"
 #include "PropertiesView.h"
@@ -724,6 +725,9 @@ QImage ViewImp::getCurrentImage()
 
 bool ViewImp::getCurrentImage(QImage &image)
 {
+   // Draw complete tiles instead of placeholders for the tiles being generated in the background
+   Image::SynchronousTileUpdates synchronousTileUpdates;
+
    if (QGLFramebufferObject::hasOpenGLFramebufferObjects())
    {
       int curWidth = width();
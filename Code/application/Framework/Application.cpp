@@ -62,6 +62,9 @@ Application::Application(QCoreApplication& app) :
 
 Application::~Application()
 {
+   // Join the shared threads before any plug-in module which queued tasks is unloaded
+   UtilityServicesImp::instance()->stopThreadPool();
+
    InstallerServicesImp::destroy();
    PlugInManagerServicesImp::destroy();
    AnimationServicesImp::destroy();
@@ -114,6 +117,9 @@ int Application::run(int argc, char** argv)
       }
    }
 
+   // Create the thread pool shared by all modules now that the thread count is known
+   UtilityServicesImp::instance()->startThreadPool(ConfigurationSettings::getSettingThreadCount());
+
    // Build the plug-in list from the plug-in directory
    string plugPath = pSettings->getPlugInPath();
 
@@ -7,8 +7,12 @@
  * http://www.gnu.org/licenses/lgpl.html
  */
 
+#include <algorithm>
+#include <deque>
 #include <limits>
+#include <list>
 #include <math.h>
+#include <set>
 
 #include "AppVerify.h"
 #include "DataAccessorImpl.h"
@@ -17,10 +21,12 @@
 #include "MathUtil.h"
 #include "ModelServices.h"
 #include "MultiThreadedAlgorithm.h"
+#include "OverviewPyramid.h"
 #include "RasterElement.h"
 #include "RasterDataDescriptor.h"
 #include "Statistics.h"
 #include "switchOnEncoding.h"
+#include "ThreadPool.h"
 #include "Tile.h"
 #include "UtilityServicesImp.h"
 
@@ -30,6 +36,712 @@ using namespace mta;
 vector<ColorType> Image::sDefaultColorMap;
 unsigned int Image::TileSet::sNextId = 0;
 
+class SetTileTexture : public mta::ThreadCommand
+{
+public:
+   SetTileTexture(Tile* pTile, unsigned char* pData, unsigned int zoomIndex) :
+      mpTile(pTile), mpData(pData), mZoomIndex(zoomIndex) {}
+   void run()
+   {
+      if (mpTile != NULL)
+      {
+         mpTile->setupTexture(mZoomIndex, mpData);
+      }
+   }
+
+private:
+   Tile* mpTile;
+   unsigned char* mpData;
+   unsigned int mZoomIndex;
+};
+
+// Scratch buffers used to stretch one row of a tile.  Each thread has its own.
+struct StretchedRow
+{
+   vector<double> mRaw;
+   vector<unsigned int> mValues;
+   vector<unsigned char> mAlpha;    // 0 for bad values, 0xff otherwise
+};
+
+// Converts the raw values of one displayed channel into texture values.
+//
+// Integer data of one or two bytes is stretched through a table with an entry for every
+// possible raw value, so each pixel costs a single lookup regardless of the stretch type.
+// Other data is stretched a row at a time, with a branch-free loop for linear stretches.
+// The tables are built once per update and are shared by all of the tile threads.
+class ChannelStretch
+{
+public:
+   ChannelStretch() :
+      mpInfo(NULL),
+      mMaxValue(255.0),
+      mTableOffset(0)
+   {
+   }
+
+   void initialize(Image::ImageData& info, vector<double>& stretchPoints, unsigned int color, int maxValue,
+      const vector<int>& badValues)
+   {
+      bool prepared = Image::prepareScale(info, stretchPoints, mScaleData, color, maxValue);
+      mpInfo = &info;
+      mType = info.mRawType[color];
+      mMaxValue = maxValue + 1.0;
+      mBadValues = badValues;
+      if (prepared == false)
+      {
+         return;
+      }
+
+      int tableSize = 0;
+      switch (mType)
+      {
+      case INT1SBYTE:
+         mTableOffset = 128;
+         tableSize = 256;
+         break;
+      case INT1UBYTE:
+         mTableOffset = 0;
+         tableSize = 256;
+         break;
+      case INT2SBYTES:
+         mTableOffset = 32768;
+         tableSize = 65536;
+         break;
+      case INT2UBYTES:
+         mTableOffset = 0;
+         tableSize = 65536;
+         break;
+      default:
+         return;
+      }
+
+      mTable.resize(tableSize);
+      for (int i = 0; i < tableSize; ++i)
+      {
+         mTable[i] = Image::scale(i - mTableOffset, mScaleData, *mpInfo, mMaxValue);
+      }
+
+      if (mBadValues.empty() == false)
+      {
+         mBadTable.resize(tableSize);
+         for (int i = 0; i < tableSize; ++i)
+         {
+            mBadTable[i] = binary_search(mBadValues.begin(), mBadValues.end(), i - mTableOffset) ? 0 : 0xff;
+         }
+      }
+   }
+
+   bool hasBadValues() const
+   {
+      return mBadValues.empty() == false;
+   }
+
+   // Stretches every reductionFactor'th column of the accessor's current row.
+   // This moves the accessor's column, so the caller must advance with nextRow().
+   void stretchRow(DataAccessor& da, unsigned int count, int reductionFactor, ComplexComponent component,
+      StretchedRow& row) const
+   {
+      // The distance moved by nextColumn() includes any interleaved bands
+      char* pFirst = static_cast<char*>(da->getColumn());
+      da->nextColumn(reductionFactor);
+      ptrdiff_t stride = static_cast<char*>(da->getColumn()) - pFirst;
+
+      stretchRow(pFirst, stride, count, component, row);
+   }
+
+   // Stretches count values which are stride bytes apart
+   void stretchRow(const void* pFirst, ptrdiff_t stride, unsigned int count, ComplexComponent component,
+      StretchedRow& row) const
+   {
+      if (row.mValues.size() < count)
+      {
+         row.mRaw.resize(count);
+         row.mValues.resize(count);
+         row.mAlpha.resize(count);
+      }
+
+      switchOnComplexEncoding(mType, stretchValues, pFirst, stride, count, component, row);
+   }
+
+private:
+   template <class T>
+   void stretchValues(const T* pSource, ptrdiff_t stride, unsigned int count, ComplexComponent component,
+      StretchedRow& row) const
+   {
+      stride /= sizeof(T);
+      unsigned int* pValues = &row.mValues[0];
+      unsigned char* pAlpha = &row.mAlpha[0];
+
+      if (mTable.empty() == false)
+      {
+         const unsigned int* pTable = &mTable[0];
+         for (unsigned int i = 0; i < count; ++i)
+         {
+            pValues[i] = pTable[static_cast<int>(ModelServices::getDataValue(pSource[i * stride], component)) +
+               mTableOffset];
+         }
+
+         if (mBadTable.empty() == false)
+         {
+            const unsigned char* pBadTable = &mBadTable[0];
+            for (unsigned int i = 0; i < count; ++i)
+            {
+               pAlpha[i] = pBadTable[static_cast<int>(ModelServices::getDataValue(pSource[i * stride], component)) +
+                  mTableOffset];
+            }
+         }
+
+         return;
+      }
+
+      double* pRaw = &row.mRaw[0];
+      for (unsigned int i = 0; i < count; ++i)
+      {
+         pRaw[i] = ModelServices::getDataValue(pSource[i * stride], component);
+      }
+
+      if (mScaleData.type == LINEAR)
+      {
+         const double offset = mScaleData.offset;
+         const double gain = mScaleData.gain;
+         const double maxValue = mMaxValue - 0.001;
+         for (unsigned int i = 0; i < count; ++i)
+         {
+            double value = (pRaw[i] - offset) * gain;
+            value = (value > 0.0) ? value : 0.0;
+            value = (value < maxValue) ? value : maxValue;
+            pValues[i] = static_cast<unsigned int>(static_cast<int>(value));
+         }
+      }
+      else
+      {
+         for (unsigned int i = 0; i < count; ++i)
+         {
+            pValues[i] = Image::scale(pRaw[i], mScaleData, *mpInfo, mMaxValue);
+         }
+      }
+
+      if (mBadValues.empty() == false)
+      {
+         for (unsigned int i = 0; i < count; ++i)
+         {
+            pAlpha[i] = binary_search(mBadValues.begin(), mBadValues.end(), roundDouble(pRaw[i])) ? 0 : 0xff;
+         }
+      }
+   }
+
+   const Image::ImageData* mpInfo;
+   EncodingType mType;
+   ScaleStruct mScaleData;
+   double mMaxValue;
+   vector<int> mBadValues;
+   vector<unsigned int> mTable;
+   vector<unsigned char> mBadTable;
+   int mTableOffset;
+};
+
+// Reads the rows of one tile at a reduction factor.  The rows are read from an overview level
+// when the channel's pyramid is ready, and from the raster element otherwise.
+class TileRows
+{
+public:
+   TileRows(DataAccessor da, int reductionFactor) :
+      mDa(da),
+      mReductionFactor(reductionFactor),
+      mpOverview(NULL),
+      mRow(0),
+      mColumn(0)
+   {
+   }
+
+   TileRows(const OverviewPyramid* pOverview, Tile* pTile, int reductionFactor) :
+      mDa(NULL, NULL),
+      mReductionFactor(reductionFactor),
+      mpOverview(pOverview),
+      mRow(static_cast<unsigned int>(pTile->getPos().mY) / reductionFactor),
+      mColumn(static_cast<unsigned int>(pTile->getPos().mX) / reductionFactor)
+   {
+   }
+
+   bool isValid() const
+   {
+      if (mpOverview != NULL)
+      {
+         return mpOverview->getRow(mReductionFactor, mRow) != NULL;
+      }
+
+      return mDa.isValid();
+   }
+
+   void stretchRow(const ChannelStretch& stretch, unsigned int count, ComplexComponent component,
+      StretchedRow& row)
+   {
+      if (mpOverview != NULL)
+      {
+         ptrdiff_t stride = mpOverview->getBytesPerElement();
+         const char* pRow = static_cast<const char*>(mpOverview->getRow(mReductionFactor, mRow));
+         stretch.stretchRow(pRow + mColumn * stride, stride, count, component, row);
+      }
+      else
+      {
+         stretch.stretchRow(mDa, count, mReductionFactor, component, row);
+      }
+   }
+
+   void nextRow()
+   {
+      if (mpOverview != NULL)
+      {
+         ++mRow;
+      }
+      else
+      {
+         mDa->nextRow(mReductionFactor);
+      }
+   }
+
+private:
+   DataAccessor mDa;
+   int mReductionFactor;
+   const OverviewPyramid* mpOverview;
+   unsigned int mRow;
+   unsigned int mColumn;
+};
+
+// Converts the raw data of one tile into texture data.  This only reads the image data,
+// so it can be used from any thread while the stretches are unchanged.
+class TileGenerator
+{
+public:
+   TileGenerator(const Image::ImageData& info, const vector<ChannelStretch>& stretches) :
+      mInfo(info),
+      mStretches(stretches)
+   {
+   }
+
+   bool generate(Tile* pTile, unsigned int zoomIndex, vector<unsigned char>& texData)
+   {
+      VERIFY(pTile != NULL);
+
+      int reductionFactor = Tile::computeReductionFactor(zoomIndex);
+      if (mInfo.mKey.mStretchPoints2.size() == 0) // grayscale or colormap
+      {
+         VERIFY(mStretches.size() == 1);
+         if (mInfo.mKey.mColorMap.size() == 0)
+         {
+            return createGrayscale(pTile, reductionFactor, texData);
+         }
+
+         return createColormap(pTile, reductionFactor, texData);
+      }
+
+      // rgb
+      VERIFY(mStretches.size() == 3);
+      resizeTexture(reductionFactor, 3, texData);
+      return createRgb(pTile, reductionFactor, 0, mInfo.mKey.mBand1, texData) &&
+         createRgb(pTile, reductionFactor, 1, mInfo.mKey.mBand2, texData) &&
+         createRgb(pTile, reductionFactor, 2, mInfo.mKey.mBand3, texData);
+   }
+
+private:
+   const Image::ImageData& mInfo;
+   const vector<ChannelStretch>& mStretches;
+   StretchedRow mRow;
+
+   void resizeTexture(int reductionFactor, int channels, vector<unsigned char>& texData) const
+   {
+      texData.resize((mInfo.mTileSizeX / reductionFactor) * (mInfo.mTileSizeY / reductionFactor) * channels);
+   }
+
+   TileRows getTileRows(Tile* pTile, int reductionFactor, unsigned int channel, DimensionDescriptor band) const
+   {
+      const OverviewPyramid* pOverview = mInfo.mpOverviews[channel];
+      if (reductionFactor > 1 && pOverview != NULL && pOverview->getBand() == band && pOverview->isReady())
+      {
+         return TileRows(pOverview, pTile, reductionFactor);
+      }
+
+      return TileRows(getTileAccessor(pTile, channel, band), reductionFactor);
+   }
+
+   DataAccessor getTileAccessor(Tile* pTile, unsigned int channel, DimensionDescriptor band) const
+   {
+      RasterElement* pRasterElement = mInfo.mKey.mpRasterElement[channel];
+      VERIFYRV(pRasterElement != NULL, DataAccessor(NULL, NULL));
+      RasterDataDescriptor* pRasterDescriptor =
+         dynamic_cast<RasterDataDescriptor*>(pRasterElement->getDataDescriptor());
+      VERIFYRV(pRasterDescriptor != NULL, DataAccessor(NULL, NULL));
+      VERIFYRV(band.isValid(), DataAccessor(NULL, NULL));
+
+      unsigned int posX = pTile->getPos().mX;
+      unsigned int posY = pTile->getPos().mY;
+      unsigned int geomSizeX = pTile->getGeomSize().mX;
+      unsigned int geomSizeY = pTile->getGeomSize().mY;
+
+      FactoryResource<DataRequest> pRequest;
+      pRequest->setRows(pRasterDescriptor->getActiveRow(posY),
+         pRasterDescriptor->getActiveRow(posY + geomSizeY - 1), geomSizeY);
+      pRequest->setColumns(pRasterDescriptor->getActiveColumn(posX),
+         pRasterDescriptor->getActiveColumn(posX + geomSizeX - 1), geomSizeX);
+      pRequest->setBands(band, band, 1);
+
+      return pRasterElement->getDataAccessor(pRequest.release());
+   }
+
+   // grayscale, channel specifies the band to display
+   bool createGrayscale(Tile* pTile, int reductionFactor, vector<unsigned char>& texData)
+   {
+      const ChannelStretch& stretch = mStretches[0];
+      int channels = (mInfo.mFormat == GL_LUMINANCE_ALPHA ? 2 : 1);
+      bool hasBadValues = stretch.hasBadValues();
+      resizeTexture(reductionFactor, channels, texData);
+
+      TileRows tileRows = getTileRows(pTile, reductionFactor, 0, mInfo.mKey.mBand1);
+      if (!tileRows.isValid())
+      {
+         return false;
+      }
+
+      unsigned int columns = (pTile->getGeomSize().mX + reductionFactor - 1) / reductionFactor;
+      unsigned int rows = (pTile->getGeomSize().mY + reductionFactor - 1) / reductionFactor;
+      unsigned int rowPitch = mInfo.mTileSizeX / reductionFactor * channels;
+
+      for (unsigned int y1 = 0; y1 < rows; ++y1)
+      {
+         VERIFY(tileRows.isValid());
+         tileRows.stretchRow(stretch, columns, mInfo.mKey.mComponent, mRow);
+
+         unsigned char* pTarget = &texData[y1 * rowPitch];
+         const unsigned int* pValues = &mRow.mValues[0];
+         if (channels == 1)
+         {
+            for (unsigned int x1 = 0; x1 < columns; ++x1)
+            {
+               pTarget[x1] = static_cast<unsigned char>(pValues[x1]);
+            }
+         }
+         else
+         {
+            const unsigned char* pAlpha = &mRow.mAlpha[0];
+            for (unsigned int x1 = 0; x1 < columns; ++x1)
+            {
+               pTarget[2 * x1] = static_cast<unsigned char>(pValues[x1]);
+               pTarget[2 * x1 + 1] = (hasBadValues ? pAlpha[x1] : 0xff);
+            }
+         }
+
+         tileRows.nextRow();
+      }
+
+      return true;
+   }
+
+   // Colormap
+   bool createColormap(Tile* pTile, int reductionFactor, vector<unsigned char>& texData)
+   {
+      const ChannelStretch& stretch = mStretches[0];
+      const vector<ColorType>& colorMap = mInfo.mKey.mColorMap;
+      bool hasBadValues = stretch.hasBadValues();
+      int channels = (mInfo.mFormat == GL_RGBA ? 4 : 3);
+      resizeTexture(reductionFactor, channels, texData);
+
+      TileRows tileRows = getTileRows(pTile, reductionFactor, 0, mInfo.mKey.mBand1);
+      if (!tileRows.isValid())
+      {
+         return false;
+      }
+
+      unsigned int columns = (pTile->getGeomSize().mX + reductionFactor - 1) / reductionFactor;
+      unsigned int rows = (pTile->getGeomSize().mY + reductionFactor - 1) / reductionFactor;
+      unsigned int rowPitch = mInfo.mTileSizeX / reductionFactor * channels;
+
+      for (unsigned int y1 = 0; y1 < rows; ++y1)
+      {
+         VERIFY(tileRows.isValid());
+         tileRows.stretchRow(stretch, columns, mInfo.mKey.mComponent, mRow);
+
+         unsigned char* pTarget = &texData[y1 * rowPitch];
+         const unsigned int* pValues = &mRow.mValues[0];
+         const unsigned char* pAlpha = &mRow.mAlpha[0];
+         for (unsigned int x1 = 0; x1 < columns; ++x1, pTarget += channels)
+         {
+            const ColorType& color = colorMap[pValues[x1]];
+            pTarget[0] = color.mRed;
+            pTarget[1] = color.mGreen;
+            pTarget[2] = color.mBlue;
+            if (channels == 4)
+            {
+               pTarget[3] = ((hasBadValues && pAlpha[x1] == 0) ? 0 : color.mAlpha);
+            }
+         }
+
+         tileRows.nextRow();
+      }
+
+      return true;
+   }
+
+   // RGB: channel1=red, channel2=green, channel3=blue band
+   bool createRgb(Tile* pTile, int reductionFactor, unsigned int channel, DimensionDescriptor band,
+      vector<unsigned char>& texData)
+   {
+      unsigned int columns = (pTile->getGeomSize().mX + reductionFactor - 1) / reductionFactor;
+      unsigned int rows = (pTile->getGeomSize().mY + reductionFactor - 1) / reductionFactor;
+      unsigned int rowPitch = 3 * mInfo.mTileSizeX / reductionFactor;
+
+      if (mInfo.mKey.mpRasterElement[channel] == NULL || band.isActiveNumberValid() == false)
+      {
+         for (unsigned int y1 = 0; y1 < rows; ++y1)
+         {
+            unsigned char* pTarget = &texData[y1 * rowPitch + channel];
+            for (unsigned int x1 = 0; x1 < columns; ++x1)
+            {
+               pTarget[3 * x1] = 0;
+            }
+         }
+
+         return true;
+      }
+
+      TileRows tileRows = getTileRows(pTile, reductionFactor, channel, band);
+      if (!tileRows.isValid())
+      {
+         return false;
+      }
+
+      const ChannelStretch& stretch = mStretches[channel];
+      for (unsigned int y1 = 0; y1 < rows; ++y1)
+      {
+         VERIFY(tileRows.isValid());
+         tileRows.stretchRow(stretch, columns, mInfo.mKey.mComponent, mRow);
+
+         unsigned char* pTarget = &texData[y1 * rowPitch + channel];
+         const unsigned int* pValues = &mRow.mValues[0];
+         for (unsigned int x1 = 0; x1 < columns; ++x1)
+         {
+            pTarget[3 * x1] = static_cast<unsigned char>(pValues[x1]);
+         }
+
+         tileRows.nextRow();
+      }
+
+      return true;
+   }
+};
+
+namespace
+{
+   // Only modified in the main thread
+   unsigned int sSynchronousTileUpdates = 0;
+}
+
+// Generates tile textures in the background.  The requested tiles are generated in order
+// by the application's thread pool, and the textures are created in the main thread by uploadTiles().
+class Image::TileQueue
+{
+public:
+   typedef pair<Tile*, unsigned int> TileLevel;
+
+   TileQueue(Image::ImageData& info) :
+      mInfo(info),
+      mStretchesValid(false),
+      mpPool(UtilityServicesImp::instance()->getThreadPool()),
+      mWorkerCount(0)
+   {
+   }
+
+   // Returns false if tiles cannot be generated in the background
+   bool isAvailable() const
+   {
+      return mpPool != NULL && mpPool->getThreadCount() > 0;
+   }
+
+   ~TileQueue()
+   {
+      cancel();
+   }
+
+   const vector<ChannelStretch>& getStretches()
+   {
+      // The stretches are only rebuilt by cancel(), so no tiles are being generated here
+      if (mStretchesValid == false)
+      {
+         if (mInfo.mKey.mStretchPoints2.size() == 0) // grayscale or colormap
+         {
+            int maxValue = 255;
+            if (mInfo.mKey.mColorMap.empty() == false)
+            {
+               maxValue = static_cast<int>(mInfo.mKey.mColorMap.size()) - 1;
+            }
+
+            mStretches.resize(1);
+            mStretches[0].initialize(mInfo, mInfo.mKey.mStretchPoints1, 0, maxValue, mInfo.mKey.mBadValues);
+         }
+         else // rgb
+         {
+            mStretches.resize(3);
+            mStretches[0].initialize(mInfo, mInfo.mKey.mStretchPoints1, 0, 255, vector<int>());
+            mStretches[1].initialize(mInfo, mInfo.mKey.mStretchPoints2, 1, 255, vector<int>());
+            mStretches[2].initialize(mInfo, mInfo.mKey.mStretchPoints3, 2, 255, vector<int>());
+         }
+
+         mStretchesValid = true;
+      }
+
+      return mStretches;
+   }
+
+   // Replaces any requests which have not been started.  The tiles are generated in the given order.
+   void request(const vector<TileLevel>& tiles)
+   {
+      getStretches();
+      if (mpPool == NULL)
+      {
+         return;
+      }
+
+      MutexLock lock(mMutex);
+      mPending.clear();
+      for (vector<TileLevel>::const_iterator iter = tiles.begin(); iter != tiles.end(); ++iter)
+      {
+         if (mGenerating.find(*iter) == mGenerating.end())
+         {
+            mPending.push_back(*iter);
+         }
+      }
+
+      unsigned int workerCount = min(static_cast<unsigned int>(mPending.size()), mpPool->getThreadCount());
+      for (; mWorkerCount < workerCount; ++mWorkerCount)
+      {
+         if (mpPool->queueTask(ThreadPool::TaskPtr(new GenerateTask(this)), this) == false)
+         {
+            break;
+         }
+      }
+   }
+
+   // Discards all requests and generated textures, and waits for the tiles being generated
+   void cancel()
+   {
+      {
+         MutexLock lock(mMutex);
+         mPending.clear();
+      }
+
+      if (mpPool != NULL)
+      {
+         mpPool->cancelTasks(this);
+      }
+
+      MutexLock lock(mMutex);
+      mGenerating.clear();
+      mCompleted.clear();
+      mWorkerCount = 0;
+      mStretches.clear();
+      mStretchesValid = false;
+   }
+
+   // Creates the textures for the generated tiles.  This must be called with the GL context current.
+   bool uploadTiles()
+   {
+      list<GeneratedTile> completed;
+      {
+         MutexLock lock(mMutex);
+         completed.swap(mCompleted);
+         for (list<GeneratedTile>::const_iterator iter = completed.begin(); iter != completed.end(); ++iter)
+         {
+            mGenerating.erase(iter->mTile);
+         }
+      }
+
+      for (list<GeneratedTile>::iterator iter = completed.begin(); iter != completed.end(); ++iter)
+      {
+         iter->mTile.first->setupTexture(iter->mTile.second, &iter->mData[0]);
+      }
+
+      return completed.empty() == false;
+   }
+
+   bool isBusy() const
+   {
+      MutexLock lock(mMutex);
+      return mPending.empty() == false || mWorkerCount > 0 || mCompleted.empty() == false;
+   }
+
+   bool hasGeneratedTiles() const
+   {
+      MutexLock lock(mMutex);
+      return mCompleted.empty() == false;
+   }
+
+private:
+   struct GeneratedTile
+   {
+      TileLevel mTile;
+      vector<unsigned char> mData;
+   };
+
+   class GenerateTask : public ThreadPool::Task
+   {
+   public:
+      GenerateTask(TileQueue* pQueue) :
+         mpQueue(pQueue)
+      {
+      }
+
+      void run()
+      {
+         mpQueue->generateTiles();
+      }
+
+   private:
+      TileQueue* mpQueue;
+   };
+
+   // Called in a pool thread.  Generates tiles until no requests remain.
+   void generateTiles()
+   {
+      TileGenerator generator(mInfo, mStretches);
+      vector<unsigned char> texData;
+
+      MutexLock lock(mMutex);
+      while (mPending.empty() == false)
+      {
+         TileLevel tile = mPending.front();
+         mPending.pop_front();
+         mGenerating.insert(tile);
+
+         mMutex.MutexUnlock();
+         bool success = generator.generate(tile.first, tile.second, texData);
+         mMutex.MutexLock();
+
+         if (success)
+         {
+            mCompleted.push_back(GeneratedTile());
+            mCompleted.back().mTile = tile;
+            mCompleted.back().mData.swap(texData);
+         }
+         else
+         {
+            mGenerating.erase(tile);
+         }
+      }
+
+      --mWorkerCount;
+   }
+
+   Image::ImageData& mInfo;
+   vector<ChannelStretch> mStretches;
+   bool mStretchesValid;
+   ThreadPool* mpPool;
+
+   mutable DMutex mMutex;
+   deque<TileLevel> mPending;
+   set<TileLevel> mGenerating;         // being generated or waiting to be uploaded
+   list<GeneratedTile> mCompleted;
+   unsigned int mWorkerCount;
+};
+
 Image::Image() :
    mInfo(0, DimensionDescriptor(), DimensionDescriptor(), DimensionDescriptor(), LINEAR, std::vector<double>(),
       std::vector<double>(), std::vector<double>(), sDefaultColorMap, COMPLEX_MAGNITUDE, GL_LUMINANCE, NULL,
@@ -37,7 +749,8 @@ Image::Image() :
    mNumTilesX(0),
    mNumTilesY(0),
    mpTiles(NULL),
-   mAlpha(255)
+   mAlpha(255),
+   mpTileQueue(new TileQueue(mInfo))
 {}
 
 // Grayscale
@@ -46,6 +759,8 @@ void Image::initialize(int sizeX, int sizeY, DimensionDescriptor channel, unsign
                        StretchType stretchType, vector<double>& stretchPoints, RasterElement* pRasterElement,
                        const vector<int>& badValues)
 {
+   mpTileQueue->cancel();
+
    mInfo = ImageData(channels, channel, DimensionDescriptor(), DimensionDescriptor(), stretchType, stretchPoints,
       std::vector<double>(), std::vector<double>(), sDefaultColorMap, COMPLEX_MAGNITUDE, GL_LUMINANCE,
       pRasterElement, pRasterElement, pRasterElement, badValues);
@@ -81,6 +796,7 @@ void Image::initialize(int sizeX, int sizeY, DimensionDescriptor channel, unsign
 
    setActiveTileSet(mInfo.mKey);
    createTiles();
+   updateOverviews();
 }
 
 void Image::initialize(int sizeX, int sizeY, DimensionDescriptor channel, unsigned int imageSizeX,
@@ -88,6 +804,8 @@ void Image::initialize(int sizeX, int sizeY, DimensionDescriptor channel, unsign
                        ComplexComponent component, void* data, StretchType stretchType, vector<double>& stretchPoints,
                        RasterElement* pRasterElement, const vector<int>& badValues)
 {
+   mpTileQueue->cancel();
+
    mInfo = ImageData(channels, channel, DimensionDescriptor(), DimensionDescriptor(), stretchType, stretchPoints,
       vector<double>(), vector<double>(), sDefaultColorMap, component, GL_LUMINANCE, pRasterElement, pRasterElement,
       pRasterElement, badValues);
@@ -123,6 +841,7 @@ void Image::initialize(int sizeX, int sizeY, DimensionDescriptor channel, unsign
 
    setActiveTileSet(mInfo.mKey);
    createTiles();
+   updateOverviews();
 }
 
 // Colormap
@@ -131,6 +850,8 @@ void Image::initialize(int sizeX, int sizeY, DimensionDescriptor channel, unsign
                        StretchType stretchType, vector<double>& stretchPoints, RasterElement* pRasterElement,
                        const vector<ColorType>& colorMap, const vector<int>& badValues)
 {
+   mpTileQueue->cancel();
+
    mInfo = ImageData(channels, channel, DimensionDescriptor(), DimensionDescriptor(), stretchType, stretchPoints,
       vector<double>(), vector<double>(), colorMap, COMPLEX_MAGNITUDE, GL_LUMINANCE, pRasterElement, pRasterElement,
       pRasterElement, badValues);
@@ -165,6 +886,7 @@ void Image::initialize(int sizeX, int sizeY, DimensionDescriptor channel, unsign
    }
    setActiveTileSet(mInfo.mKey);
    createTiles();
+   updateOverviews();
 }
 
 void Image::initialize(int sizeX, int sizeY, DimensionDescriptor channel, unsigned int imageSizeX,
@@ -172,6 +894,8 @@ void Image::initialize(int sizeX, int sizeY, DimensionDescriptor channel, unsign
                        ComplexComponent component, void* data, StretchType stretchType, vector<double>& stretchPoints,
                        RasterElement* pRasterElement, const vector<ColorType>& colorMap, const vector<int>& badValues)
 {
+   mpTileQueue->cancel();
+
    mInfo = ImageData(channels, channel, DimensionDescriptor(), DimensionDescriptor(), stretchType, stretchPoints,
       vector<double>(), vector<double>(), colorMap, component, GL_LUMINANCE, pRasterElement, pRasterElement,
       pRasterElement, badValues);
@@ -206,6 +930,7 @@ void Image::initialize(int sizeX, int sizeY, DimensionDescriptor channel, unsign
    }
    setActiveTileSet(mInfo.mKey);
    createTiles();
+   updateOverviews();
 }
 
 // RGB
@@ -215,6 +940,8 @@ void Image::initialize(int sizeX, int sizeY, DimensionDescriptor band1, Dimensio
                        vector<double>& stretchPointsRed, vector<double>& stretchPointsGreen,
                        vector<double>& stretchPointsBlue, RasterElement* pRasterElement)
 {
+   mpTileQueue->cancel();
+
    mInfo = ImageData(channels, band1, band2, band3, stretchType, stretchPointsRed, stretchPointsGreen,
       stretchPointsBlue, sDefaultColorMap, COMPLEX_MAGNITUDE, GL_RGB, pRasterElement, pRasterElement, pRasterElement);
    mInfo.mTileSizeX = sizeX;
@@ -248,6 +975,7 @@ void Image::initialize(int sizeX, int sizeY, DimensionDescriptor band1, Dimensio
    }
    setActiveTileSet(mInfo.mKey);
    createTiles();
+   updateOverviews();
 }
 
 void Image::initialize(int sizeX, int sizeY, DimensionDescriptor band1, DimensionDescriptor band2,
@@ -256,6 +984,8 @@ void Image::initialize(int sizeX, int sizeY, DimensionDescriptor band1, Dimensio
                        StretchType stretchType, vector<double>& stretchPointsRed, vector<double>& stretchPointsGreen,
                        vector<double>& stretchPointsBlue, RasterElement* pRasterElement)
 {
+   mpTileQueue->cancel();
+
    mInfo = ImageData(channels, band1, band2, band3, stretchType, stretchPointsRed, stretchPointsGreen,
       stretchPointsBlue, sDefaultColorMap, component, GL_RGB, pRasterElement, pRasterElement, pRasterElement);
    mInfo.mTileSizeX = sizeX;
@@ -289,6 +1019,7 @@ void Image::initialize(int sizeX, int sizeY, DimensionDescriptor band1, Dimensio
    }
    setActiveTileSet(mInfo.mKey);
    createTiles();
+   updateOverviews();
 }
 
 // new initialize for different things in the channels
@@ -300,6 +1031,8 @@ void Image::initialize(int sizeX, int sizeY, DimensionDescriptor band1, Dimensio
                        vector<double>& stretchPointsBlue, RasterElement* pRasterElement1,
                        RasterElement* pRasterElement2, RasterElement* pRasterElement3)
 {
+   mpTileQueue->cancel();
+
    mInfo = ImageData(channels, band1, band2, band3, stretchType, stretchPointsRed, stretchPointsGreen,
       stretchPointsBlue, sDefaultColorMap, component, GL_RGB, pRasterElement1, pRasterElement2, pRasterElement3);
    mInfo.mTileSizeX = sizeX;
@@ -333,10 +1066,18 @@ void Image::initialize(int sizeX, int sizeY, DimensionDescriptor band1, Dimensio
    }
    setActiveTileSet(mInfo.mKey);
    createTiles();
+   updateOverviews();
 }
 
 Image::~Image()
 {
+   delete mpTileQueue;
+
+   for (vector<OverviewPyramid*>::iterator iter = mOverviews.begin(); iter != mOverviews.end(); ++iter)
+   {
+      delete *iter;
+   }
+
    if (mInfo.mpExponentialMultipliers != NULL)
    {
       delete [] mInfo.mpExponentialMultipliers;
@@ -396,6 +1137,80 @@ void Image::createTiles()
    }
 }
 
+void Image::updateOverviews()
+{
+   mInfo.mpOverviews[0] = NULL;
+   mInfo.mpOverviews[1] = NULL;
+   mInfo.mpOverviews[2] = NULL;
+
+   // Zoomed out tiles of images smaller than a tile are inexpensive to generate from the data
+   vector<OverviewPyramid*> overviews;
+   if (canUseOverviews() == true && (mNumTilesX > 1 || mNumTilesY > 1))
+   {
+      DimensionDescriptor bands[3];
+      unsigned int channels = 1;
+      bands[0] = mInfo.mKey.mBand1;
+      if (mInfo.mKey.mStretchPoints2.size() != 0) // rgb
+      {
+         bands[1] = mInfo.mKey.mBand2;
+         bands[2] = mInfo.mKey.mBand3;
+         channels = 3;
+      }
+
+      for (unsigned int i = 0; i < channels; ++i)
+      {
+         RasterElement* pRasterElement = mInfo.mKey.mpRasterElement[i];
+         if (pRasterElement == NULL || bands[i].isActiveNumberValid() == false)
+         {
+            continue;
+         }
+
+         // Reuse the pyramid for a band which is still displayed
+         OverviewPyramid* pOverview = NULL;
+         for (unsigned int j = 0; j < overviews.size() && pOverview == NULL; ++j)
+         {
+            if (overviews[j]->getRasterElement() == pRasterElement && overviews[j]->getBand() == bands[i])
+            {
+               pOverview = overviews[j];
+            }
+         }
+
+         for (vector<OverviewPyramid*>::iterator iter = mOverviews.begin();
+            iter != mOverviews.end() && pOverview == NULL; ++iter)
+         {
+            if ((*iter)->getRasterElement() == pRasterElement && (*iter)->getBand() == bands[i])
+            {
+               pOverview = *iter;
+               mOverviews.erase(iter);
+               overviews.push_back(pOverview);
+               break;
+            }
+         }
+
+         if (pOverview == NULL)
+         {
+            pOverview = new OverviewPyramid(pRasterElement, bands[i]);
+            overviews.push_back(pOverview);
+         }
+
+         mInfo.mpOverviews[i] = pOverview;
+      }
+   }
+
+   // The pyramids of bands which are no longer displayed are reloaded from the cache when needed
+   for (vector<OverviewPyramid*>::iterator iter = mOverviews.begin(); iter != mOverviews.end(); ++iter)
+   {
+      delete *iter;
+   }
+
+   mOverviews.swap(overviews);
+}
+
+bool Image::canUseOverviews() const
+{
+   return true;
+}
+
 void Image::draw(GLfloat textureMode)
 {
    setActiveTileSet(mInfo.mKey);
@@ -406,14 +1221,12 @@ void Image::draw(GLfloat textureMode)
       return;
    }
 
+   mpTileQueue->uploadTiles();
+
    vector<unsigned int> tileZoomIndices;
    vector<Tile*> tilesToDraw = getTilesToDraw();
    vector<Tile*> tilesToUpdate = getTilesToUpdate(tilesToDraw, tileZoomIndices);
-
-   if (tilesToUpdate.empty() == false)
-   {
-      updateTiles(tilesToUpdate, tileZoomIndices);
-   }
+   queueTiles(tilesToDraw, tilesToUpdate, tileZoomIndices);
 
    // move the center of the whole image to the origin
    // this is necessary because the tiles are placed in the image
@@ -442,34 +1255,17 @@ void Image::draw(GLfloat textureMode)
    glFlush();
 }
 
-class SetTileTexture : public mta::ThreadCommand
-{
-public:
-   SetTileTexture(Tile* pTile, unsigned char* pData, unsigned int zoomIndex) :
-      mpTile(pTile), mpData(pData), mZoomIndex(zoomIndex) {}
-   void run()
-   {
-      if (mpTile != NULL)
-      {
-         mpTile->setupTexture(mZoomIndex, mpData);
-      }
-   }
-
-private:
-   Tile* mpTile;
-   unsigned char* mpData;
-   unsigned int mZoomIndex;
-};
-
 class TileThread;
 class TileInput
 {
 public:
-   TileInput(vector<Tile*>& tiles, vector<unsigned int>& tileZoomIndices, Image::ImageData& info) :
-      mTiles(tiles), mTileZoomIndices(tileZoomIndices), mInfo(info) {}
+   TileInput(vector<Tile*>& tiles, vector<unsigned int>& tileZoomIndices, Image::ImageData& info,
+      const vector<ChannelStretch>& stretches) :
+      mTiles(tiles), mTileZoomIndices(tileZoomIndices), mInfo(info), mStretches(stretches) {}
    vector<Tile*>& mTiles;
    vector<unsigned int>& mTileZoomIndices;
    Image::ImageData& mInfo;
+   const vector<ChannelStretch>& mStretches;
 };
 
 class TileOutput
@@ -484,11 +1280,11 @@ public:
 class TileThread : public mta::AlgorithmThread
 {
 public:
-   TileThread(const TileInput &input, int threadCount, int threadIndex, mta::ThreadReporter &reporter) : 
+   TileThread(const TileInput &input, int threadCount, int threadIndex, mta::ThreadReporter &reporter) :
       AlgorithmThread(threadIndex, reporter),
       mTiles(input.mTiles),
       mTileZoomIndices(input.mTileZoomIndices),
-      mInfo(input.mInfo),
+      mGenerator(input.mInfo, input.mStretches),
       mTileRange(getThreadRange(threadCount, mTiles.size()))
    {
    }
@@ -498,495 +1294,157 @@ public:
 private:
    vector<Tile*>& mTiles;
    vector<unsigned int>& mTileZoomIndices;
-   Image::ImageData& mInfo;
+   TileGenerator mGenerator;
    Range mTileRange;
+};
 
-   // grayscale, channel specifies the band to display
-   template <class T>
-   void createGrayscale(T* pData, ComplexComponent component)
-   {
-      if (mTileRange.mLast < mTileRange.mFirst)
-      {
-         return;
-      }
-
-      ScaleStruct scaleData;
-      Image::prepareScale(mInfo, mInfo.mKey.mStretchPoints1, scaleData, 0);
-
-      std::vector<int>::const_iterator badBegin = mInfo.mKey.mBadValues.begin();
-      std::vector<int>::const_iterator badEnd = mInfo.mKey.mBadValues.end();
-
-      int bufSize = mInfo.mTileSizeX * mInfo.mTileSizeY * sizeof(unsigned char);
-      bool hasBadValues = (badBegin != badEnd);
-      if (mInfo.mFormat == GL_LUMINANCE_ALPHA)
-      {
-         bufSize *= 2;
-      }
-
-      vector<unsigned char> pTexData(bufSize);
-
-      bool bHas1BadValue = mInfo.mKey.mBadValues.size() == 1;
-      int singleBadValue = 0;
-      if (bHas1BadValue)
-      {
-         singleBadValue = mInfo.mKey.mBadValues.front();
-      }
-
-      int oldPercentDone = -1;
+void TileThread::run()
+{
+   vector<unsigned char> texData;
+   int oldPercentDone = -1;
 
-      for (int tileId = mTileRange.mFirst; tileId <= mTileRange.mLast; ++tileId)
+   for (int tileId = mTileRange.mFirst; tileId <= mTileRange.mLast; ++tileId)
+   {
+      Tile* pTile = mTiles[tileId];
+      if (pTile->isTextureReady(mTileZoomIndices[tileId]) == false)
       {
-         Tile* pTile = mTiles[tileId];
-         if (pTile->isTextureReady(mTileZoomIndices[tileId]) == false)
+         if (mGenerator.generate(pTile, mTileZoomIndices[tileId], texData) == false)
          {
-            unsigned int posX = pTile->getPos().mX;
-            unsigned int posY = pTile->getPos().mY;
-            unsigned int geomSizeX = pTile->getGeomSize().mX;
-            unsigned int geomSizeY = pTile->getGeomSize().mY;
-
-            RasterElement* pRasterElement = mInfo.mKey.mpRasterElement[0];
-            VERIFYNRV(pRasterElement != NULL);
-            RasterDataDescriptor* pRasterDescriptor =
-               dynamic_cast<RasterDataDescriptor*>(pRasterElement->getDataDescriptor());
-            VERIFYNRV(pRasterDescriptor != NULL);
-            VERIFYNRV(mInfo.mKey.mBand1.isValid());
-            FactoryResource<DataRequest> pRequest;
-            pRequest->setRows(pRasterDescriptor->getActiveRow(posY), 
-               pRasterDescriptor->getActiveRow(posY+geomSizeY-1), geomSizeY);
-            pRequest->setColumns(pRasterDescriptor->getActiveColumn(posX), 
-               pRasterDescriptor->getActiveColumn(posX+geomSizeX-1), geomSizeX);
-            pRequest->setBands(mInfo.mKey.mBand1,
-               mInfo.mKey.mBand1, 1);
-
-            DataAccessor da = pRasterElement->getDataAccessor(pRequest.release());
-            if (!da.isValid())
-            {
-               return;
-            }
-
-            int reductionFactor = Tile::computeReductionFactor(mTileZoomIndices[tileId]);
-
-            vector<unsigned char>::iterator targetBase = pTexData.begin();
-
-            for (unsigned int y1 = 0;
-               y1 < geomSizeY;
-               y1 += reductionFactor, targetBase += mInfo.mTileSizeX / reductionFactor * (hasBadValues ? 2 : 1))
-            {
-               VERIFYNRV(da.isValid())
-               T* source = static_cast<T*>(da->getColumn());
-
-               vector<unsigned char>::iterator target = targetBase;
-               vector<unsigned char>::iterator targetStop = target + geomSizeX / reductionFactor *
-                  (hasBadValues ? 2 : 1);
-
-               for (; target < targetStop; ++target)
-               {
-                  double dValue = ModelServices::getDataValue(*source, component);
-                  *target = Image::scale(dValue, scaleData, mInfo);
-                  if (hasBadValues)
-                  {
-                     ++target;
-                     int tempInt = roundDouble(dValue);
-                     if (bHas1BadValue)
-                     {
-                        if (tempInt == singleBadValue)
-                        {
-                           *target = 0;
-                        }
-                        else
-                        {
-                           *target = 0xff;
-                        }
-                     }
-                     else if (binary_search(badBegin, badEnd, tempInt))
-                     {
-                        *target = 0;
-                     }
-                     else
-                     {
-                        *target = 0xff;
-                     }
-                  }
-                  else if (mInfo.mFormat == GL_LUMINANCE_ALPHA)
-                  {
-                     ++target;
-                     *target = 0xff;
-                  }
-
-                  da->nextColumn(reductionFactor);
-                  source = static_cast<T*>(da->getColumn());
-               }
-
-               da->nextRow(reductionFactor);
-            }
-
-            SetTileTexture cmd(pTile, &pTexData[0], mTileZoomIndices[tileId]);
-            runInMainThread(cmd);
+            return;
          }
 
-         int percentDone = 100 * (tileId - mTileRange.mFirst + 1) / (mTileRange.mLast - mTileRange.mFirst + 1);
-         if (percentDone >= oldPercentDone + 10)
-         {
-            oldPercentDone = percentDone;
-            getReporter().reportProgress(getThreadIndex(), percentDone);
-         }
+         SetTileTexture cmd(pTile, &texData[0], mTileZoomIndices[tileId]);
+         runInMainThread(cmd);
       }
-   }
 
-   // Colormap
-   template <class T>
-   void createColormap(T* pData, ComplexComponent component)
-   {
-      if (mTileRange.mLast < mTileRange.mFirst)
+      int percentDone = 100 * (tileId - mTileRange.mFirst + 1) / (mTileRange.mLast - mTileRange.mFirst + 1);
+      if (percentDone >= oldPercentDone + 10)
       {
-         return;
+         oldPercentDone = percentDone;
+         getReporter().reportProgress(getThreadIndex(), percentDone);
       }
+   }
+}
 
-      int maxValue = (int) (mInfo.mKey.mColorMap.size());
+void Image::updateTiles(vector<Tile*>& tilesToUpdate, vector<unsigned int>& tileZoomIndices)
+{
+   TileInput tileInput(tilesToUpdate, tileZoomIndices, mInfo, mpTileQueue->getStretches());
 
-      ScaleStruct scaleData;
-      Image::prepareScale(mInfo, mInfo.mKey.mStretchPoints1, scaleData, 0, maxValue-1);
+   TileOutput tileOutput;
 
-      std::vector<int>::const_iterator badBegin = mInfo.mKey.mBadValues.begin();
-      std::vector<int>::const_iterator badEnd = mInfo.mKey.mBadValues.end();
+   mta::StatusBarReporter barReporter("Generating Image", "app", "1BD64709-7C3B-4d54-8E85-ABCCA4B75B3B");
+   mta::StatusBarReporter* pReporter = NULL;
+   if (tilesToUpdate.size() > 1)
+   {
+      pReporter = &barReporter;
+   }
 
-      bool hasBadValues = (badBegin != badEnd);
-      int channels = (mInfo.mFormat == GL_RGBA ? 4 : 3);
-      int bufSize = mInfo.mTileSizeX * mInfo.mTileSizeY * channels * sizeof(unsigned char);
-      vector<unsigned char> pTexData(bufSize);
+   mta::MultiThreadedAlgorithm<TileInput, TileOutput, TileThread> tilingAlgorithm
+      (getNumRequiredThreads(tilesToUpdate.size()), tileInput, tileOutput, pReporter);
+   tilingAlgorithm.run();
+}
 
-      bool bHas1BadValue = mInfo.mKey.mBadValues.size() == 1;
-      int singleBadValue = 0;
-      if (bHas1BadValue)
+void Image::queueTiles(const vector<Tile*>& tilesToDraw, vector<Tile*>& tilesToUpdate,
+                       vector<unsigned int>& tileZoomIndices)
+{
+   // The tiles are generated in this thread when the thread pool is not running
+   if (sSynchronousTileUpdates > 0 || mpTileQueue->isAvailable() == false)
+   {
+      if (tilesToUpdate.empty() == false)
       {
-         singleBadValue = mInfo.mKey.mBadValues.front();
+         updateTiles(tilesToUpdate, tileZoomIndices);
       }
 
-      int oldPercentDone = -1;
-
-      for (int tileId = mTileRange.mFirst; tileId <= mTileRange.mLast; ++tileId)
-      {
-         Tile* pTile = mTiles[tileId];
-         if (pTile->isTextureReady(mTileZoomIndices[tileId]) == false)
-         {
-            unsigned int posX = pTile->getPos().mX;
-            unsigned int posY = pTile->getPos().mY;
-            unsigned int geomSizeX = pTile->getGeomSize().mX;
-            unsigned int geomSizeY = pTile->getGeomSize().mY;
-            RasterElement* pRasterElement = mInfo.mKey.mpRasterElement[0];
-            VERIFYNRV(pRasterElement != NULL);
-            RasterDataDescriptor* pRasterDescriptor =
-               dynamic_cast<RasterDataDescriptor*>(pRasterElement->getDataDescriptor());
-            VERIFYNRV(pRasterDescriptor != NULL);
-            VERIFYNRV(mInfo.mKey.mBand1.isValid());
-            
-            FactoryResource<DataRequest> pRequest;
-            pRequest->setRows(pRasterDescriptor->getActiveRow(posY), 
-               pRasterDescriptor->getActiveRow(posY + geomSizeY - 1), geomSizeY);
-            pRequest->setColumns(pRasterDescriptor->getActiveColumn(posX), 
-               pRasterDescriptor->getActiveColumn(posX + geomSizeX - 1), geomSizeX);
-            pRequest->setBands(mInfo.mKey.mBand1,
-               mInfo.mKey.mBand1, 1);
-
-            DataAccessor da = pRasterElement->getDataAccessor(pRequest.release());
-            if (!da.isValid())
-            {
-               return;
-            }
-
-            int reductionFactor = Tile::computeReductionFactor(mTileZoomIndices[tileId]);
-            vector<unsigned char>::iterator targetBase = pTexData.begin();
-
-            for (unsigned int y1 = 0;
-               y1 < geomSizeY;
-               y1 += reductionFactor, targetBase += channels * mInfo.mTileSizeX / reductionFactor)
-            {
-               VERIFYNRV(da.isValid())
-               vector<unsigned char>::iterator target = targetBase;
-               for (unsigned int x1 = 0; x1 < geomSizeX; x1 += reductionFactor)
-               {
-                  T* source = static_cast<T*>(da->getColumn());
-                  double dValue = ModelServices::getDataValue(*source, component);
-
-                  int index = Image::scale(dValue, scaleData, mInfo, maxValue);
-
-                  *target = mInfo.mKey.mColorMap[index].mRed;
-                  ++target;
-
-                  *target = mInfo.mKey.mColorMap[index].mGreen;
-                  ++target;
-
-                  *target = mInfo.mKey.mColorMap[index].mBlue;
-                  ++target;
-
-                  if (hasBadValues)
-                  {
-                     int tempInt = roundDouble(dValue);
-                     if (bHas1BadValue)
-                     {
-                        if (tempInt == singleBadValue)
-                        {
-                           *target = 0;
-                        }
-                        else
-                        {
-                           *target = mInfo.mKey.mColorMap[index].mAlpha;
-                        }
-                     }
-                     else if (binary_search(badBegin, badEnd, tempInt))
-                     {
-                        *target = 0;
-                     }
-                     else
-                     {
-                        *target = mInfo.mKey.mColorMap[index].mAlpha;
-                     }
-                     ++target;
-                  }
-                  else if (channels == 4)
-                  {
-                     *target = mInfo.mKey.mColorMap[index].mAlpha;
-                     ++target;
-                  }
-
-                  da->nextColumn(reductionFactor);
-               }
-               da->nextRow(reductionFactor);
-            }
-
-            SetTileTexture cmd(pTile, &pTexData[0], mTileZoomIndices[tileId]);
-            runInMainThread(cmd);
-         }
-
-         int percentDone = 100 * (tileId- mTileRange.mFirst + 1) / (mTileRange.mLast - mTileRange.mFirst + 1);
-         if (percentDone >= oldPercentDone + 10)
-         {
-            oldPercentDone = percentDone;
-            getReporter().reportProgress(getThreadIndex(), percentDone);
-         }
-      }
+      return;
    }
 
-   // RGB: channel1=red, channel2=green, channel3=blue band
-   template <class T>
-   void createRgbTile(T*pData, std::vector<unsigned char> &pTexData, ComplexComponent component, 
-      DataAccessor da, unsigned int posX, unsigned int posY, unsigned int geomSizeX, unsigned int geomSizeY, 
-      int reductionFactor, ScaleStruct &scaleData, int offset)
-   {
-      T* source;
-      vector<unsigned char>::iterator targetBase = pTexData.begin();
-
-      for (unsigned int y1 = 0;
-         y1 < geomSizeY;
-         y1 += reductionFactor, targetBase += 3 * mInfo.mTileSizeX / reductionFactor)
-      {
-         VERIFYNRV(da.isValid());
-         unsigned char *target = &*targetBase;
-         //vector<unsigned char>::iterator target = targetBase;
-         target += offset;
-         for (unsigned int x1 = 0; x1 < geomSizeX; x1 += reductionFactor)
-         {
-            source = static_cast<T*>(da->getColumn());
-            double dValue = ModelServices::getDataValue(*source, component);
-            *target = Image::scale(dValue, scaleData, mInfo);
-            target += 3;
-
-            da->nextColumn(reductionFactor);
-         }
-         da->nextRow(reductionFactor);
-      }
+   if (tilesToDraw.empty() == true)
+   {
+      return;
    }
 
-   void createEmptyRgbTile(std::vector<unsigned char> &pTexData, 
-      unsigned int posX, unsigned int posY, unsigned int geomSizeX, unsigned int geomSizeY, 
-      int reductionFactor, int offset)
+   // Visible tiles are generated nearest the center of the view first
+   vector<pair<double, unsigned int> > visibleTiles;
+   for (unsigned int i = 0; i < tilesToUpdate.size(); ++i)
    {
-      vector<unsigned char>::iterator targetBase = pTexData.begin();
-
-      for (unsigned int y1 = 0;
-         y1 < geomSizeY;
-         y1 += reductionFactor, targetBase += 3 * mInfo.mTileSizeX / reductionFactor)
-      {
-         unsigned char* target = &*targetBase;
-         target += offset;
-         for (unsigned int x1 = 0; x1 < geomSizeX; x1 += reductionFactor)
-         {
-            *target = 0;
-            target += 3;
-         }
-      }
+      LocationType center = tilesToUpdate[i]->getPos() + tilesToUpdate[i]->getGeomSize() * 0.5;
+      double distance = fabs(center.mX - mDrawCenter.mX) + fabs(center.mY - mDrawCenter.mY);
+      visibleTiles.push_back(make_pair(distance, i));
    }
+   sort(visibleTiles.begin(), visibleTiles.end());
+
+   vector<TileQueue::TileLevel> requests;
 
-   void createRgb(EncodingType encodingRed, EncodingType encodingGreen, EncodingType encodingBlue,
-      ComplexComponent component)
+   // A coarse placeholder is drawn until the requested resolution is available
+   for (unsigned int i = 0; i < visibleTiles.size(); ++i)
    {
-      if (mTileRange.mLast < mTileRange.mFirst)
+      Tile* pTile = tilesToUpdate[visibleTiles[i].second];
+      if (tileZoomIndices[visibleTiles[i].second] < Tile::MAX_TEXTURE_INDEX && pTile->hasTexture() == false)
       {
-         return;
+         requests.push_back(make_pair(pTile, Tile::MAX_TEXTURE_INDEX));
       }
+   }
 
-      ScaleStruct scaleDataRed;
-      ScaleStruct scaleDataGreen;
-      ScaleStruct scaleDataBlue;
-
-      Image::prepareScale(mInfo, mInfo.mKey.mStretchPoints1, scaleDataRed, 0);
-      Image::prepareScale(mInfo, mInfo.mKey.mStretchPoints2, scaleDataGreen, 1);
-      Image::prepareScale(mInfo, mInfo.mKey.mStretchPoints3, scaleDataBlue, 2);
-      
-      int bufSize = mInfo.mTileSizeX * mInfo.mTileSizeY * 3 * sizeof(unsigned char);
-      std::vector<unsigned char> pTexData(bufSize);
+   for (unsigned int i = 0; i < visibleTiles.size(); ++i)
+   {
+      requests.push_back(make_pair(tilesToUpdate[visibleTiles[i].second], tileZoomIndices[visibleTiles[i].second]));
+   }
 
-      int oldPercentDone = -1;
+   // Prefetch the ring of tiles surrounding the view at the same resolution
+   int firstColumn = mNumTilesX;
+   int lastColumn = -1;
+   int firstRow = mNumTilesY;
+   int lastRow = -1;
+   for (vector<Tile*>::const_iterator iter = tilesToDraw.begin(); iter != tilesToDraw.end(); ++iter)
+   {
+      LocationType pos = (*iter)->getPos();
+      int column = static_cast<int>(pos.mX) / mInfo.mTileSizeX;
+      int row = static_cast<int>(pos.mY) / mInfo.mTileSizeY;
+      firstColumn = min(firstColumn, column);
+      lastColumn = max(lastColumn, column);
+      firstRow = min(firstRow, row);
+      lastRow = max(lastRow, row);
+   }
 
-      for (int tileId = mTileRange.mFirst; tileId <= mTileRange.mLast; ++tileId)
+   unsigned int zoomIndex = tilesToDraw.front()->getTextureIndex();
+   for (int row = max(firstRow - 1, 0); row <= min(lastRow + 1, mNumTilesY - 1); ++row)
+   {
+      for (int column = max(firstColumn - 1, 0); column <= min(lastColumn + 1, mNumTilesX - 1); ++column)
       {
-         Tile* pTile = mTiles[tileId];
-         if (pTile->isTextureReady(mTileZoomIndices[tileId]) == false)
+         if (row >= firstRow && row <= lastRow && column >= firstColumn && column <= lastColumn)
          {
-            unsigned int posX = pTile->getPos().mX;
-            unsigned int posY = pTile->getPos().mY;
-            unsigned int geomSizeX = pTile->getGeomSize().mX;
-            unsigned int geomSizeY = pTile->getGeomSize().mY;
-
-            // Create a data accessor for each band
-            RasterElement* pRedRasterElement = mInfo.mKey.mpRasterElement[0];
-            DimensionDescriptor redBand = mInfo.mKey.mBand1;
-            bool haveRedData = (pRedRasterElement != NULL) && (redBand.isActiveNumberValid());
-
-            RasterElement* pGreenRasterElement = mInfo.mKey.mpRasterElement[1];
-            DimensionDescriptor greenBand = mInfo.mKey.mBand2;
-            bool haveGreenData = (pGreenRasterElement != NULL) && (greenBand.isActiveNumberValid());
-
-            RasterElement* pBlueRasterElement = mInfo.mKey.mpRasterElement[2];
-            DimensionDescriptor blueBand = mInfo.mKey.mBand3;
-            bool haveBlueData = (pBlueRasterElement != NULL) && (blueBand.isActiveNumberValid());
-
-            int reductionFactor = Tile::computeReductionFactor(mTileZoomIndices[tileId]);
-
-            if (haveRedData)
-            {
-               RasterDataDescriptor* pRedRasterDescriptor =
-                  dynamic_cast<RasterDataDescriptor*>(pRedRasterElement->getDataDescriptor());
-               VERIFYNRV(pRedRasterDescriptor != NULL);
-               FactoryResource<DataRequest> pRedRequest;
-               pRedRequest->setRows(pRedRasterDescriptor->getActiveRow(posY), 
-                  pRedRasterDescriptor->getActiveRow(posY+geomSizeY-1), geomSizeY);
-               pRedRequest->setColumns(pRedRasterDescriptor->getActiveColumn(posX), 
-                  pRedRasterDescriptor->getActiveColumn(posX+geomSizeX-1), geomSizeX);
-               pRedRequest->setBands(mInfo.mKey.mBand1, mInfo.mKey.mBand1, 1);
-
-               DataAccessor daRed = pRedRasterElement->getDataAccessor(pRedRequest.release());
-               if (!daRed.isValid())
-               {
-                  return;
-               }
-               switchOnComplexEncoding(encodingRed, createRgbTile, NULL, pTexData, component, daRed, posX, posY,
-                  geomSizeX, geomSizeY, reductionFactor, scaleDataRed, 0);
-            }
-            else
-            {
-               createEmptyRgbTile(pTexData, posX, posY, geomSizeX, geomSizeY, reductionFactor, 0);
-            }
-
-            if (haveGreenData)
-            {
-               RasterDataDescriptor* pGreenRasterDescriptor =
-                  dynamic_cast<RasterDataDescriptor*>(pGreenRasterElement->getDataDescriptor());
-               VERIFYNRV(pGreenRasterDescriptor != NULL);
-               FactoryResource<DataRequest> pGreenRequest;
-               pGreenRequest->setRows(pGreenRasterDescriptor->getActiveRow(posY), 
-                  pGreenRasterDescriptor->getActiveRow(posY+geomSizeY-1), geomSizeY);
-               pGreenRequest->setColumns(pGreenRasterDescriptor->getActiveColumn(posX), 
-                  pGreenRasterDescriptor->getActiveColumn(posX+geomSizeX-1), geomSizeX);
-               pGreenRequest->setBands(mInfo.mKey.mBand2, mInfo.mKey.mBand2, 1);
-
-               DataAccessor daGreen = pGreenRasterElement->getDataAccessor(pGreenRequest.release());
-               if (!daGreen.isValid())
-               {
-                  return;
-               }
-               switchOnComplexEncoding(encodingGreen, createRgbTile, NULL, pTexData, component, daGreen, posX, posY,
-                  geomSizeX, geomSizeY, reductionFactor, scaleDataGreen, 1);
-            }
-            else
-            {
-               createEmptyRgbTile(pTexData, posX, posY, geomSizeX, geomSizeY, reductionFactor, 1);
-            }
-
-            if (haveBlueData)
-            {
-               RasterDataDescriptor* pBlueRasterDescriptor =
-                  dynamic_cast<RasterDataDescriptor*>(pBlueRasterElement->getDataDescriptor());
-               VERIFYNRV(pBlueRasterDescriptor != NULL);
-               FactoryResource<DataRequest> pBlueRequest;
-               pBlueRequest->setRows(pBlueRasterDescriptor->getActiveRow(posY), 
-                  pBlueRasterDescriptor->getActiveRow(posY+geomSizeY-1), geomSizeY);
-               pBlueRequest->setColumns(pBlueRasterDescriptor->getActiveColumn(posX), 
-                  pBlueRasterDescriptor->getActiveColumn(posX+geomSizeX-1), geomSizeX);
-               pBlueRequest->setBands(mInfo.mKey.mBand3, mInfo.mKey.mBand3, 1);
-
-               DataAccessor daBlue = pBlueRasterElement->getDataAccessor(pBlueRequest.release());
-               if (!daBlue.isValid())
-               {
-                  return;
-               }
-               switchOnComplexEncoding(encodingBlue, createRgbTile, NULL, pTexData, component, daBlue, posX, posY,
-                  geomSizeX, geomSizeY, reductionFactor, scaleDataBlue, 2);
-            }
-            else
-            {
-               createEmptyRgbTile(pTexData, posX, posY, geomSizeX, geomSizeY, reductionFactor, 2);
-            }
-
-            SetTileTexture cmd(pTile, &pTexData[0], mTileZoomIndices[tileId]);
-            runInMainThread(cmd);
+            continue;
          }
 
-         int percentDone = 100 * (tileId - mTileRange.mFirst + 1) / (mTileRange.mLast - mTileRange.mFirst + 1);
-         if (percentDone >= oldPercentDone + 10)
+         Tile* pTile = mpTiles->at(row * mNumTilesX + column);
+         if (pTile != NULL && pTile->isTextureReady(zoomIndex) == false)
          {
-            oldPercentDone = percentDone;
-            getReporter().reportProgress(getThreadIndex(), percentDone);
+            requests.push_back(make_pair(pTile, zoomIndex));
          }
       }
    }
-};
 
-void TileThread::run()
-{
-   if (mInfo.mKey.mStretchPoints2.size() == 0) // grayscale or colormap
-   {
-      if (mInfo.mKey.mColorMap.size() == 0)
-      {
-         switchOnComplexEncoding(mInfo.mRawType[0], createGrayscale, mInfo.mpData, mInfo.mKey.mComponent);
-      }
-      else
-      {
-         switchOnComplexEncoding(mInfo.mRawType[0], createColormap, mInfo.mpData, mInfo.mKey.mComponent);
-      }
-   }
-   else // rgb
-   {
-      createRgb(mInfo.mRawType[0], mInfo.mRawType[1], mInfo.mRawType[2], mInfo.mKey.mComponent);
-   }
+   mpTileQueue->request(requests);
 }
 
-void Image::updateTiles(vector<Tile*>& tilesToUpdate, vector<unsigned int>& tileZoomIndices)
+bool Image::isGeneratingTiles() const
 {
-   TileInput tileInput(tilesToUpdate, tileZoomIndices, mInfo);
+   return mpTileQueue->isBusy();
+}
 
-   TileOutput tileOutput;
+bool Image::hasGeneratedTiles() const
+{
+   return mpTileQueue->hasGeneratedTiles();
+}
 
-   mta::StatusBarReporter barReporter("Generating Image", "app", "1BD64709-7C3B-4d54-8E85-ABCCA4B75B3B");
-   mta::StatusBarReporter* pReporter = NULL;
-   if (tilesToUpdate.size() > 1)
-   {
-      pReporter = &barReporter;
-   }
+Image::SynchronousTileUpdates::SynchronousTileUpdates()
+{
+   ++sSynchronousTileUpdates;
+}
 
-   mta::MultiThreadedAlgorithm<TileInput, TileOutput, TileThread> tilingAlgorithm
-      (getNumRequiredThreads(tilesToUpdate.size()), tileInput, tileOutput, pReporter);
-   tilingAlgorithm.run();
+Image::SynchronousTileUpdates::~SynchronousTileUpdates()
+{
+   --sSynchronousTileUpdates;
 }
 
 bool Image::prepareScale(ImageData& info, vector<double>& stretchPoints, ScaleStruct& data, unsigned int color,
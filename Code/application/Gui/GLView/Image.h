@@ -21,6 +21,7 @@
 #include <vector>
 #include <map>
 
+class OverviewPyramid;
 class RasterElement;
 class Tile;
 
@@ -470,6 +471,9 @@ public:
          mpEqualizationValues[0] = NULL;
          mpEqualizationValues[1] = NULL;
          mpEqualizationValues[2] = NULL;
+         mpOverviews[0] = NULL;
+         mpOverviews[1] = NULL;
+         mpOverviews[2] = NULL;
       }
 
       void operator=(const class ImageData& rhs)
@@ -488,6 +492,7 @@ public:
       double* mpExponentialMultipliers;
       double* mpLogarithmicMultipliers;
       unsigned int* mpEqualizationValues[3];
+      const OverviewPyramid* mpOverviews[3];
    };
 
    class TileSet
@@ -623,18 +628,35 @@ public:
    bool generateFullResTexture();
    void generateAllFullResTextures();
 
+   // Tiles which are not ready are generated in the background while the image is drawn.
+   // The image should be drawn again when hasGeneratedTiles() returns true.
+   bool isGeneratingTiles() const;
+   bool hasGeneratedTiles() const;
+
+   // Generates all tiles needed by draw() before drawing while an instance is in scope,
+   // e.g. when capturing a view as an image.  This may only be used in the main thread.
+   class SynchronousTileUpdates
+   {
+   public:
+      SynchronousTileUpdates();
+      ~SynchronousTileUpdates();
+   };
+
 protected:
    const ImageData& getImageData() const;
    virtual Tile* createTile() const;
    const std::vector<Tile*>* getActiveTiles() const;
    const std::map<ImageKey, TileSet>& getTileSets() const;
    virtual void updateTiles(std::vector<Tile*>& tilesToUpdate, std::vector<unsigned int>& tileZoomIndices);
+   virtual void queueTiles(const std::vector<Tile*>& tilesToDraw, std::vector<Tile*>& tilesToUpdate,
+      std::vector<unsigned int>& tileZoomIndices);
    virtual void drawTiles(const std::vector<Tile*>& tiles, GLfloat textureMode);
    virtual void setActiveTileSet(const ImageKey &key);
    virtual unsigned int getMaxNumTileSets() const;
    std::vector<Tile*> getTilesToDraw();
    virtual std::vector<Tile*> getTilesToUpdate(const std::vector<Tile*>& tilesToDraw,
       std::vector<unsigned int>& tileZoomIndices);
+   virtual bool canUseOverviews() const;
 
    ImageData mInfo;
 
@@ -646,7 +668,14 @@ private:
    unsigned int mAlpha;
    LocationType mDrawCenter;
 
+   class TileQueue;
+   TileQueue* mpTileQueue;
+
+   // Overview pyramids of the displayed bands, which are generated in the background
+   std::vector<OverviewPyramid*> mOverviews;
+
    void createTiles();
+   void updateOverviews();
    static std::vector<ColorType> sDefaultColorMap;
 
    Tile* selectNearbyTile() const;
@@ -0,0 +1,687 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QStringList>
+#include <QtCore/QTemporaryFile>
+
+#include "AppVerify.h"
+#include "ConfigurationSettings.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "Filename.h"
+#include "ObjectResource.h"
+#include "OverviewPyramid.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterElementImp.h"
+#include "RasterFileDescriptor.h"
+#include "RasterUtilities.h"
+#include "Tile.h"
+#include "UtilityServicesImp.h"
+
+#include <string.h>
+
+using namespace std;
+
+const unsigned int OverviewPyramid::LEVEL_COUNT = Tile::MAX_TEXTURE_INDEX;
+
+namespace
+{
+   const quint32 sCacheMagic = 0x4f565231;   // "OVR1"
+   const quint32 sCacheVersion = 2;
+   const qint64 sCacheAlignment = 16;
+
+   // The least recently used files are removed when the cache is larger than this
+   const qint64 sCacheMaxSize = Q_INT64_C(2) * 1024 * 1024 * 1024;
+
+   // Temporary files left behind by an application which did not exit normally are removed after a day
+   const int sTempFileAge = 24 * 60 * 60;
+
+   // The levels are built in tasks of about this many first level rows, so other work in the
+   // thread pool does not wait behind a whole band
+   const unsigned int sBlockRows = 256;
+
+   void addKey(vector<quint32>& key, const vector<DimensionDescriptor>& dims)
+   {
+      key.push_back(static_cast<quint32>(dims.size()));
+      for (vector<DimensionDescriptor>::const_iterator iter = dims.begin(); iter != dims.end(); ++iter)
+      {
+         key.push_back(iter->getOriginalNumber());
+         key.push_back(iter->getOnDiskNumber());
+      }
+   }
+
+   // The modification time of a cache file is used as its last access time
+   void touchFile(const QString& filename)
+   {
+      QFile file(filename);
+      char magic[4];
+      if (file.open(QIODevice::ReadWrite) == true && file.read(magic, sizeof(magic)) == sizeof(magic) &&
+         file.seek(0) == true)
+      {
+         file.write(magic, sizeof(magic));
+      }
+   }
+
+   // Removes the least recently used cache files until the cache is within its size limit
+   void pruneCache(const QString& cachePath, const QString& keepFilename)
+   {
+      QDir cacheDir(cachePath);
+      QFileInfoList files = cacheDir.entryInfoList(QStringList() << "*.ovr", QDir::Files, QDir::Time | QDir::Reversed);
+      qint64 totalSize = 0;
+      for (QFileInfoList::const_iterator iter = files.begin(); iter != files.end(); ++iter)
+      {
+         totalSize += iter->size();
+      }
+
+      // A file which is mapped by another pyramid cannot be removed on all platforms, so it is skipped
+      for (QFileInfoList::const_iterator iter = files.begin(); iter != files.end() && totalSize > sCacheMaxSize; ++iter)
+      {
+         if (iter->absoluteFilePath() != keepFilename && QFile::remove(iter->absoluteFilePath()) == true)
+         {
+            totalSize -= iter->size();
+         }
+      }
+
+      QDateTime expired = QDateTime::currentDateTime().addSecs(-sTempFileAge);
+      QFileInfoList tempFiles = cacheDir.entryInfoList(QStringList() << "*.tmp", QDir::Files);
+      for (QFileInfoList::const_iterator iter = tempFiles.begin(); iter != tempFiles.end(); ++iter)
+      {
+         if (iter->lastModified() < expired)
+         {
+            QFile::remove(iter->absoluteFilePath());
+         }
+      }
+   }
+
+   // Copies every other element of a row
+   void decimateRow(const char* pSource, ptrdiff_t sourceStride, unsigned int count, unsigned int bytesPerElement,
+      char* pTarget)
+   {
+      switch (bytesPerElement)
+      {
+      case 1:
+         for (unsigned int i = 0; i < count; ++i)
+         {
+            pTarget[i] = pSource[i * sourceStride];
+         }
+         break;
+      case 2:
+         for (unsigned int i = 0; i < count; ++i)
+         {
+            memcpy(pTarget + 2 * i, pSource + i * sourceStride, 2);
+         }
+         break;
+      case 4:
+         for (unsigned int i = 0; i < count; ++i)
+         {
+            memcpy(pTarget + 4 * i, pSource + i * sourceStride, 4);
+         }
+         break;
+      default:
+         for (unsigned int i = 0; i < count; ++i)
+         {
+            memcpy(pTarget + bytesPerElement * i, pSource + i * sourceStride, bytesPerElement);
+         }
+         break;
+      }
+   }
+}
+
+class OverviewPyramid::GenerateTask : public mta::ThreadPool::Task
+{
+public:
+   GenerateTask(OverviewPyramid* pPyramid) :
+      mpPyramid(pPyramid)
+   {
+   }
+
+   void run()
+   {
+      mpPyramid->generate();
+   }
+
+private:
+   OverviewPyramid* mpPyramid;
+};
+
+class OverviewPyramid::BlockTask : public mta::ThreadPool::Task
+{
+public:
+   BlockTask(OverviewPyramid* pPyramid, unsigned int firstRow, unsigned int rowCount) :
+      mpPyramid(pPyramid),
+      mFirstRow(firstRow),
+      mRowCount(rowCount)
+   {
+   }
+
+   void run()
+   {
+      mpPyramid->finishBlock(mpPyramid->buildBlock(mFirstRow, mRowCount));
+   }
+
+private:
+   OverviewPyramid* mpPyramid;
+   unsigned int mFirstRow;
+   unsigned int mRowCount;
+};
+
+OverviewPyramid::OverviewPyramid(RasterElement* pRasterElement, DimensionDescriptor band) :
+   mpRasterElement(pRasterElement),
+   mBand(band),
+   mBytesPerElement(0),
+   mRows(0),
+   mColumns(0),
+   mpMappedData(NULL),
+   mpPool(UtilityServicesImp::instance()->getThreadPool()),
+   mPendingBlocks(0),
+   mBuildFailed(false),
+   mReady(false),
+   mAborted(false)
+{
+   VERIFYNRV(mpRasterElement != NULL);
+   const RasterDataDescriptor* pDescriptor =
+      dynamic_cast<const RasterDataDescriptor*>(mpRasterElement->getDataDescriptor());
+   VERIFYNRV(pDescriptor != NULL && mBand.isValid());
+
+   mDataType = pDescriptor->getDataType();
+   mBytesPerElement = static_cast<unsigned int>(RasterUtilities::bytesInEncoding(mDataType));
+   mRows = pDescriptor->getRowCount();
+   mColumns = pDescriptor->getColumnCount();
+   VERIFYNRV(mBytesPerElement > 0);
+
+   // The level sizes do not depend on the data, so they are used to validate a cache file
+   mLevels.resize(LEVEL_COUNT);
+   unsigned int levelRows = mRows;
+   unsigned int levelColumns = mColumns;
+   for (vector<Level>::iterator iter = mLevels.begin(); iter != mLevels.end(); ++iter)
+   {
+      levelRows = (levelRows + 1) / 2;
+      levelColumns = (levelColumns + 1) / 2;
+      iter->mRows = levelRows;
+      iter->mColumns = levelColumns;
+      iter->mpData = NULL;
+   }
+
+   const Filename* pTempPath = ConfigurationSettings::getSettingTempPath();
+   if (pTempPath != NULL)
+   {
+      mCachePath = QString::fromStdString(pTempPath->getFullPathAndName()) + "/OverviewCache";
+   }
+
+   if (mCachePath.isEmpty() == true || QDir().mkpath(mCachePath) == false)
+   {
+      mCachePath = QDir::tempPath();
+   }
+
+   // The cache is only valid for data which is unchanged from its file
+   const RasterElementImp* pElementImp = dynamic_cast<const RasterElementImp*>(mpRasterElement);
+   const RasterFileDescriptor* pFileDescriptor =
+      dynamic_cast<const RasterFileDescriptor*>(pDescriptor->getFileDescriptor());
+   if (pFileDescriptor != NULL && pElementImp != NULL && pElementImp->isDataModified() == false &&
+      pTempPath != NULL)
+   {
+      QFileInfo sourceInfo(QString::fromStdString(mpRasterElement->getFilename()));
+      if (sourceInfo.isFile() == true)
+      {
+         mSourceFilename = sourceInfo.absoluteFilePath().toStdString();
+
+         // The import parameters, subset, and band are part of the cache name,
+         // so each displayed band of each import has its own file
+         QCryptographicHash hash(QCryptographicHash::Md5);
+         hash.addData(sourceInfo.absoluteFilePath().toUtf8());
+         hash.addData(QByteArray(pFileDescriptor->getDatasetLocation().c_str(),
+            static_cast<int>(pFileDescriptor->getDatasetLocation().size() + 1)));
+
+         const vector<const Filename*>& bandFiles = pFileDescriptor->getBandFiles();
+         for (vector<const Filename*>::const_iterator iter = bandFiles.begin(); iter != bandFiles.end(); ++iter)
+         {
+            if (*iter != NULL)
+            {
+               string bandFilename = (*iter)->getFullPathAndName();
+               hash.addData(QByteArray(bandFilename.c_str(), static_cast<int>(bandFilename.size() + 1)));
+            }
+         }
+
+         vector<quint32> key;
+         key.push_back(mBand.getOriginalNumber());
+         key.push_back(mBand.getOnDiskNumber());
+         key.push_back(static_cast<quint32>(mDataType));
+         key.push_back(static_cast<quint32>(pFileDescriptor->getInterleaveFormat()));
+         key.push_back(static_cast<quint32>(pFileDescriptor->getEndian()));
+         key.push_back(pFileDescriptor->getBitsPerElement());
+         key.push_back(pFileDescriptor->getHeaderBytes());
+         key.push_back(pFileDescriptor->getTrailerBytes());
+         key.push_back(pFileDescriptor->getPrelineBytes());
+         key.push_back(pFileDescriptor->getPostlineBytes());
+         key.push_back(pFileDescriptor->getPrebandBytes());
+         key.push_back(pFileDescriptor->getPostbandBytes());
+         addKey(key, pDescriptor->getRows());
+         addKey(key, pDescriptor->getColumns());
+         addKey(key, pFileDescriptor->getRows());
+         addKey(key, pFileDescriptor->getColumns());
+         addKey(key, pFileDescriptor->getBands());
+
+         hash.addData(reinterpret_cast<const char*>(&key[0]), static_cast<int>(key.size() * sizeof(quint32)));
+         mCacheFilename = (mCachePath + "/" + sourceInfo.fileName() + "." +
+            QString::fromLatin1(hash.result().toHex()) + ".ovr").toStdString();
+      }
+   }
+
+   if (mpPool != NULL)
+   {
+      mpPool->queueTask(mta::ThreadPool::TaskPtr(new GenerateTask(this)), this);
+   }
+}
+
+OverviewPyramid::~OverviewPyramid()
+{
+   {
+      mta::MutexLock lock(mMutex);
+      mAborted = true;
+   }
+
+   // Block tasks which were removed from the queue leave the build unfinished
+   if (mpPool != NULL)
+   {
+      mpPool->cancelTasks(this);
+   }
+
+   closeCache();
+   if (mBuildFilename.isEmpty() == false)
+   {
+      QFile::remove(mBuildFilename);
+   }
+
+   if (mTempFilename.isEmpty() == false)
+   {
+      QFile::remove(mTempFilename);
+   }
+}
+
+RasterElement* OverviewPyramid::getRasterElement() const
+{
+   return mpRasterElement;
+}
+
+DimensionDescriptor OverviewPyramid::getBand() const
+{
+   return mBand;
+}
+
+bool OverviewPyramid::isReady() const
+{
+   mta::MutexLock lock(mMutex);
+   return mReady;
+}
+
+EncodingType OverviewPyramid::getDataType() const
+{
+   return mDataType;
+}
+
+unsigned int OverviewPyramid::getBytesPerElement() const
+{
+   return mBytesPerElement;
+}
+
+const void* OverviewPyramid::getRow(int reductionFactor, unsigned int row) const
+{
+   if (isReady() == false)
+   {
+      return NULL;
+   }
+
+   for (unsigned int i = 0; i < mLevels.size(); ++i)
+   {
+      if ((2 << i) == reductionFactor)
+      {
+         const Level& level = mLevels[i];
+         if (row >= level.mRows || level.mpData == NULL)
+         {
+            return NULL;
+         }
+
+         return level.mpData + static_cast<size_t>(row) * level.mColumns * mBytesPerElement;
+      }
+   }
+
+   return NULL;
+}
+
+bool OverviewPyramid::isAborted() const
+{
+   mta::MutexLock lock(mMutex);
+   return mAborted;
+}
+
+void OverviewPyramid::generate()
+{
+   if (mBytesPerElement == 0)
+   {
+      return;
+   }
+
+   if (mCacheFilename.empty() == false)
+   {
+      QString cacheFilename = QString::fromStdString(mCacheFilename);
+      if (QFile::exists(cacheFilename) == true)
+      {
+         touchFile(cacheFilename);
+         if (mapCache(cacheFilename) == true)
+         {
+            mta::MutexLock lock(mMutex);
+            mReady = true;
+            return;
+         }
+      }
+   }
+
+   startBuild();
+}
+
+void OverviewPyramid::startBuild()
+{
+   // The levels are built in a new file so that an interrupted build never leaves a partial cache
+   {
+      QTemporaryFile tempFile(mCachePath + "/XXXXXX.tmp");
+      tempFile.setAutoRemove(false);
+      if (tempFile.open() == false)
+      {
+         return;
+      }
+
+      mBuildFilename = tempFile.fileName();
+   }
+
+   bool success = false;
+   mCacheFile.setFileName(mBuildFilename);
+   if (mCacheFile.open(QIODevice::ReadWrite | QIODevice::Truncate) == true)
+   {
+      QDataStream stream(&mCacheFile);
+      writeHeader(stream);
+      success = stream.status() == QDataStream::Ok && mapLevels() == true;
+   }
+
+   if (success == false)
+   {
+      closeCache();
+      QFile::remove(mBuildFilename);
+      mBuildFilename.clear();
+      return;
+   }
+
+   // Each level row of a block is decimated from first level rows of the same block, so the
+   // block size is a multiple of the reduction of the last level
+   const unsigned int reduction = 1U << (mLevels.size() - 1);
+   const unsigned int blockRows = (sBlockRows + reduction - 1) / reduction * reduction;
+   const unsigned int firstRows = mLevels.front().mRows;
+
+   // The tasks are queued with the mutex locked, so the destructor either sees them
+   // in the queue or prevents them from being queued
+   bool finished = false;
+   {
+      mta::MutexLock lock(mMutex);
+      if (mAborted == true)
+      {
+         return;
+      }
+
+      mPendingBlocks = (firstRows + blockRows - 1) / blockRows;
+      for (unsigned int row = 0; row < firstRows; row += blockRows)
+      {
+         mta::ThreadPool::TaskPtr pTask(new BlockTask(this, row, min(blockRows, firstRows - row)));
+         if (mpPool->queueTask(pTask, this) == false)
+         {
+            mBuildFailed = true;
+            --mPendingBlocks;
+         }
+      }
+
+      finished = (mPendingBlocks == 0);
+   }
+
+   if (finished == true)
+   {
+      finishBuild();
+   }
+}
+
+bool OverviewPyramid::buildBlock(unsigned int firstRow, unsigned int rowCount)
+{
+   const RasterDataDescriptor* pDescriptor =
+      dynamic_cast<const RasterDataDescriptor*>(mpRasterElement->getDataDescriptor());
+   VERIFY(pDescriptor != NULL);
+
+   // The first level is read from the data, reading only every other row
+   const Level& first = mLevels[0];
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setRows(pDescriptor->getActiveRow(2 * firstRow),
+      pDescriptor->getActiveRow(2 * (firstRow + rowCount - 1)));
+   pRequest->setBands(mBand, mBand, 1);
+   DataAccessor da = mpRasterElement->getDataAccessor(pRequest.release());
+   if (da.isValid() == false)
+   {
+      return false;
+   }
+
+   size_t rowBytes = static_cast<size_t>(first.mColumns) * mBytesPerElement;
+   for (unsigned int row = firstRow; row < firstRow + rowCount; ++row)
+   {
+      if (isAborted() == true || da.isValid() == false)
+      {
+         return false;
+      }
+
+      // The distance moved by nextColumn() includes any interleaved bands
+      const char* pSource = static_cast<const char*>(da->getColumn());
+      ptrdiff_t stride = 0;
+      if (first.mColumns > 1)
+      {
+         da->nextColumn(2);
+         stride = static_cast<const char*>(da->getColumn()) - pSource;
+      }
+
+      decimateRow(pSource, stride, first.mColumns, mBytesPerElement, first.mpData + row * rowBytes);
+      da->nextRow(2);
+   }
+
+   // The remaining levels are decimated from the previous level
+   for (unsigned int i = 1; i < mLevels.size(); ++i)
+   {
+      const Level& previous = mLevels[i - 1];
+      const Level& level = mLevels[i];
+      size_t previousRowBytes = static_cast<size_t>(previous.mColumns) * mBytesPerElement;
+      size_t levelRowBytes = static_cast<size_t>(level.mColumns) * mBytesPerElement;
+      unsigned int stopRow = min(level.mRows, (firstRow + rowCount + (1U << i) - 1) >> i);
+      for (unsigned int row = firstRow >> i; row < stopRow; ++row)
+      {
+         decimateRow(previous.mpData + 2 * row * previousRowBytes, 2 * mBytesPerElement, level.mColumns,
+            mBytesPerElement, level.mpData + row * levelRowBytes);
+      }
+
+      if (isAborted() == true)
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+void OverviewPyramid::finishBlock(bool success)
+{
+   {
+      mta::MutexLock lock(mMutex);
+      mBuildFailed = mBuildFailed || success == false;
+      if (--mPendingBlocks > 0)
+      {
+         return;
+      }
+   }
+
+   finishBuild();
+}
+
+void OverviewPyramid::finishBuild()
+{
+   bool success = false;
+   {
+      mta::MutexLock lock(mMutex);
+      success = (mBuildFailed == false && mAborted == false);
+   }
+
+   QString tempFilename = mBuildFilename;
+   mBuildFilename.clear();
+
+   // Unmapping writes the levels to the file
+   closeCache();
+   if (success == true && mCacheFilename.empty() == false)
+   {
+      QString cacheFilename = QString::fromStdString(mCacheFilename);
+      QFile::remove(cacheFilename);
+      if (QFile::rename(tempFilename, cacheFilename) == true)
+      {
+         pruneCache(mCachePath, cacheFilename);
+         success = mapCache(cacheFilename);
+         tempFilename.clear();
+      }
+   }
+
+   // Levels which are not cached are mapped from the temporary file until the pyramid is destroyed
+   if (success == true && tempFilename.isEmpty() == false)
+   {
+      success = mapCache(tempFilename);
+      if (success == true)
+      {
+         mTempFilename = tempFilename;
+         tempFilename.clear();
+      }
+   }
+
+   if (tempFilename.isEmpty() == false)
+   {
+      QFile::remove(tempFilename);
+   }
+
+   if (success == true)
+   {
+      mta::MutexLock lock(mMutex);
+      mReady = true;
+   }
+}
+
+bool OverviewPyramid::mapCache(const QString& filename)
+{
+   mCacheFile.setFileName(filename);
+   if (mCacheFile.open(QIODevice::ReadOnly) == false)
+   {
+      return false;
+   }
+
+   QDataStream stream(&mCacheFile);
+   if (readHeader(stream) == false || mapLevels() == false)
+   {
+      closeCache();
+      return false;
+   }
+
+   return true;
+}
+
+void OverviewPyramid::closeCache()
+{
+   if (mpMappedData != NULL)
+   {
+      mCacheFile.unmap(mpMappedData);
+      mpMappedData = NULL;
+   }
+
+   mCacheFile.close();
+   for (vector<Level>::iterator iter = mLevels.begin(); iter != mLevels.end(); ++iter)
+   {
+      iter->mpData = NULL;
+   }
+}
+
+void OverviewPyramid::writeHeader(QDataStream& stream) const
+{
+   QString sourceFilename;
+   qint64 sourceSize = 0;
+   qint64 sourceModified = 0;
+   if (mSourceFilename.empty() == false)
+   {
+      QFileInfo sourceInfo(QString::fromStdString(mSourceFilename));
+      sourceFilename = sourceInfo.absoluteFilePath();
+      sourceSize = sourceInfo.size();
+      sourceModified = static_cast<qint64>(sourceInfo.lastModified().toTime_t());
+   }
+
+   stream << sCacheMagic << sCacheVersion << sourceFilename << sourceSize << sourceModified <<
+      static_cast<quint32>(mDataType) << static_cast<quint32>(mRows) << static_cast<quint32>(mColumns) <<
+      static_cast<quint32>(mLevels.size());
+   for (vector<Level>::const_iterator iter = mLevels.begin(); iter != mLevels.end(); ++iter)
+   {
+      stream << iter->mRows << iter->mColumns;
+   }
+}
+
+bool OverviewPyramid::readHeader(QDataStream& stream) const
+{
+   QByteArray expected;
+   QDataStream expectedStream(&expected, QIODevice::WriteOnly);
+   writeHeader(expectedStream);
+
+   QByteArray header(expected.size(), 0);
+   return stream.readRawData(header.data(), header.size()) == header.size() && header == expected;
+}
+
+bool OverviewPyramid::mapLevels()
+{
+   // The levels start at an aligned offset after the header
+   mCacheFile.flush();
+   qint64 offset = (mCacheFile.pos() + sCacheAlignment - 1) / sCacheAlignment * sCacheAlignment;
+   qint64 size = 0;
+   for (vector<Level>::const_iterator iter = mLevels.begin(); iter != mLevels.end(); ++iter)
+   {
+      size += static_cast<qint64>(iter->mRows) * iter->mColumns * mBytesPerElement;
+   }
+
+   // A new file is sized to hold the levels; an existing file must already be the correct size
+   if ((mCacheFile.openMode() & QIODevice::WriteOnly) != 0 && mCacheFile.resize(offset + size) == false)
+   {
+      return false;
+   }
+
+   if (mCacheFile.size() != offset + size)
+   {
+      return false;
+   }
+
+   mpMappedData = mCacheFile.map(offset, size);
+   if (mpMappedData == NULL)
+   {
+      return false;
+   }
+
+   char* pData = reinterpret_cast<char*>(mpMappedData);
+   for (vector<Level>::iterator iter = mLevels.begin(); iter != mLevels.end(); ++iter)
+   {
+      iter->mpData = pData;
+      pData += static_cast<size_t>(iter->mRows) * iter->mColumns * mBytesPerElement;
+   }
+
+   return true;
+}
@@ -0,0 +1,118 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef OVERVIEWPYRAMID_H
+#define OVERVIEWPYRAMID_H
+
+#include <QtCore/QFile>
+
+#include "DimensionDescriptor.h"
+#include "DMutex.h"
+#include "ThreadPool.h"
+#include "TypesFile.h"
+
+#include <string>
+#include <vector>
+
+class QDataStream;
+class RasterElement;
+
+// Reduced resolution copies of one band of a raster element, used to generate zoomed out tiles
+// without reading the full resolution data.
+//
+// Level n holds every 2^n'th row and column of the active data, so a tile generated from a level
+// is identical to one generated from the full resolution data at the same reduction factor.
+// The raw values are kept, so the pyramid is independent of the stretch and of the displayed
+// color channel.  The levels are generated in the background, one block of rows per task, into a
+// file which is memory mapped, so they are paged by the operating system instead of being held in
+// memory.  For unmodified data loaded from a file, the file is kept in a cache keyed by the source
+// file and its import parameters, so reopening the data set only maps the cache.
+class OverviewPyramid
+{
+public:
+   // Starts generating the levels in the application's thread pool.  The pyramid is never
+   // ready when the pool is not running.
+   OverviewPyramid(RasterElement* pRasterElement, DimensionDescriptor band);
+
+   // Stops any generation in progress
+   ~OverviewPyramid();
+
+   RasterElement* getRasterElement() const;
+   DimensionDescriptor getBand() const;
+
+   // Returns true once all levels are available.  The levels are not modified after this.
+   bool isReady() const;
+
+   EncodingType getDataType() const;
+   unsigned int getBytesPerElement() const;
+
+   // Returns the first element in a row of the level for the given reduction factor,
+   // or NULL if the pyramid is not ready or has no such level
+   const void* getRow(int reductionFactor, unsigned int row) const;
+
+   static const unsigned int LEVEL_COUNT;
+
+private:
+   OverviewPyramid(const OverviewPyramid& rhs);
+   OverviewPyramid& operator=(const OverviewPyramid& rhs);
+
+   class GenerateTask;
+   friend class GenerateTask;
+   class BlockTask;
+   friend class BlockTask;
+
+   struct Level
+   {
+      unsigned int mRows;
+      unsigned int mColumns;
+      char* mpData;
+   };
+
+   void generate();
+   void startBuild();
+   bool buildBlock(unsigned int firstRow, unsigned int rowCount);
+   void finishBlock(bool success);
+   void finishBuild();
+   bool mapCache(const QString& filename);
+   void closeCache();
+   void writeHeader(QDataStream& stream) const;
+   bool readHeader(QDataStream& stream) const;
+   bool mapLevels();
+   bool isAborted() const;
+
+   RasterElement* mpRasterElement;
+   DimensionDescriptor mBand;
+   EncodingType mDataType;
+   unsigned int mBytesPerElement;
+   unsigned int mRows;
+   unsigned int mColumns;
+   std::vector<Level> mLevels;
+
+   // Identifies the source data; the cache is not used when this is empty
+   std::string mSourceFilename;
+   std::string mCacheFilename;
+   QString mCachePath;
+
+   // The mapped levels, and the file to remove when the data could not be cached
+   QFile mCacheFile;
+   uchar* mpMappedData;
+   QString mTempFilename;
+
+   // The file being built, which is written by one task for each block of rows
+   QString mBuildFilename;
+
+   mta::ThreadPool* mpPool;
+   mutable mta::DMutex mMutex;
+   unsigned int mPendingBlocks;
+   bool mBuildFailed;
+   bool mReady;
+   bool mAborted;
+};
+
+#endif
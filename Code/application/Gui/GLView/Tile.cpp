@@ -10,6 +10,8 @@
 #include "Tile.h"
 #include "DrawUtil.h"
 
+#include <stdlib.h>
+
 const int Tile::INIT_TILE_SIZE = 512;
 
 Tile::Tile() :
@@ -47,9 +49,9 @@ unsigned int Tile::getTextureIndex() const
       pixelSize *= 2.0;
    }
 
-   if (index > 3)
+   if (index > MAX_TEXTURE_INDEX)
    {
-      index = 3;
+      index = MAX_TEXTURE_INDEX;
    }
 
    return index;
@@ -65,10 +67,33 @@ bool Tile::isTextureReady(unsigned int index) const
    return mTextures[index].isAllocated();
 }
 
+bool Tile::hasTexture() const
+{
+   for (std::vector<Texture>::const_iterator iter = mTextures.begin(); iter != mTextures.end(); ++iter)
+   {
+      if (iter->isAllocated())
+      {
+         return true;
+      }
+   }
+
+   return false;
+}
+
 void Tile::draw(GLfloat textureMode)
 {
-   unsigned int index = getTextureIndex();
-   if (mTextures.size() <= index)
+   // Draw the nearest available resolution until the texture for the current zoom level has been generated
+   int index = -1;
+   int preferredIndex = static_cast<int>(getTextureIndex());
+   for (int i = 0; i < static_cast<int>(mTextures.size()); ++i)
+   {
+      if (mTextures[i].isAllocated() && (index < 0 || abs(i - preferredIndex) < abs(index - preferredIndex)))
+      {
+         index = i;
+      }
+   }
+
+   if (index < 0)
    {
       return;
    }
@@ -125,17 +150,7 @@ void Tile::setupTexture(unsigned int index, unsigned char* pTextureData)
       return;
    }
 
-   mXcoords[0] = -(mTexSizeX / 2);
-   mYcoords[0] = -(mTexSizeY / 2);
-
-   mXcoords[1] = -(mTexSizeX / 2) + mGeomSizeX;
-   mYcoords[1] = -(mTexSizeY / 2);
-
-   mXcoords[2] = -(mTexSizeX / 2) + mGeomSizeX;
-   mYcoords[2] = -(mTexSizeY / 2) + mGeomSizeY;
-
-   mXcoords[3] = -(mTexSizeX / 2);
-   mYcoords[3] = -(mTexSizeY / 2) + mGeomSizeY;
+   updateCoords();
 
    int channels = 1;
    if (mTexFormat == GL_RGB)
@@ -198,3 +213,19 @@ const std::vector<GLfloat>& Tile::getYCoords() const
 {
    return mYcoords;
 }
+
+void Tile::updateCoords()
+{
+   // Set when the sizes change so that getTextureIndex() is correct before any texture is created
+   mXcoords[0] = -(mTexSizeX / 2);
+   mYcoords[0] = -(mTexSizeY / 2);
+
+   mXcoords[1] = -(mTexSizeX / 2) + mGeomSizeX;
+   mYcoords[1] = -(mTexSizeY / 2);
+
+   mXcoords[2] = -(mTexSizeX / 2) + mGeomSizeX;
+   mYcoords[2] = -(mTexSizeY / 2) + mGeomSizeY;
+
+   mXcoords[3] = -(mTexSizeX / 2);
+   mYcoords[3] = -(mTexSizeY / 2) + mGeomSizeY;
+}
@@ -36,12 +36,14 @@ public:
    {
       mTexSizeX = sizeX;
       mTexSizeY = sizeY;
+      updateCoords();
    }
 
    void setGeomSize(int sizeX, int sizeY)
    {
       mGeomSizeX = sizeX;
       mGeomSizeY = sizeY;
+      updateCoords();
    }
 
    GLenum getTexFormat() const
@@ -65,6 +67,7 @@ public:
    }
 
    virtual bool isTextureReady(unsigned int index) const;
+   bool hasTexture() const;
    virtual void setupTexture(unsigned int index, unsigned char* pTextureData);
    void draw(GLfloat textureMode);
    unsigned int getTextureIndex() const;
@@ -77,6 +80,8 @@ public:
       return 1 << index;
    }
 
+   static const unsigned int MAX_TEXTURE_INDEX = 3;
+
 protected:
    void setXCoords(const std::vector<GLfloat>& xCoords);
    void setYCoords(const std::vector<GLfloat>& yCoords);
@@ -84,6 +89,8 @@ protected:
    const std::vector<GLfloat>& getYCoords() const;
 
 private:
+   void updateCoords();
+
    GLenum  mTexFormat;
    std::vector<Texture> mTextures;
    int mTexSizeX;
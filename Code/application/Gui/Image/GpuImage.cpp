@@ -845,6 +845,16 @@ void GpuTileProcessor::run()
    }
 }
 
+void GpuImage::queueTiles(const vector<Tile*>& tilesToDraw, vector<Tile*>& tilesToUpdate,
+                          vector<unsigned int>& tileZoomIndices)
+{
+   // The raw data is loaded into textures in the GL context, so the tiles cannot be updated in the background
+   if (tilesToUpdate.empty() == false)
+   {
+      updateTiles(tilesToUpdate, tileZoomIndices);
+   }
+}
+
 void GpuImage::enableFilter(ImageFilterDescriptor *pDescriptor)
 {
    if (isFilterEnabled(pDescriptor) == true)
@@ -1411,6 +1421,12 @@ unsigned int GpuImage::getMaxNumTileSets() const
    return 3;
 }
 
+bool GpuImage::canUseOverviews() const
+{
+   // The tiles are loaded from the raw data at full resolution
+   return false;
+}
+
 vector<Tile*> GpuImage::getTilesToUpdate(const vector<Tile*>& tilesToDraw, vector<unsigned int>& tileZoomIndices)
 {
    const Image::ImageData imageInfo = Image::getImageData();
@@ -83,9 +83,12 @@ protected:
 
    Tile* createTile() const;
    void updateTiles(std::vector<Tile*>& tilesToUpdate, std::vector<unsigned int>& tileZoomIndices);
+   void queueTiles(const std::vector<Tile*>& tilesToDraw, std::vector<Tile*>& tilesToUpdate,
+      std::vector<unsigned int>& tileZoomIndices);
    void drawTiles(const std::vector<Tile*>& tiles, GLfloat textureMode);
    void setActiveTileSet(const ImageKey &key);
    unsigned int getMaxNumTileSets() const;
+   bool canUseOverviews() const;
    std::vector<Tile*> getTilesToUpdate(const std::vector<Tile*>& tilesToDraw,
       std::vector<unsigned int>& tileZoomIndices);
    void getTilesToRead(int xCoord, int yCoord, GLsizei width, GLsizei height, 
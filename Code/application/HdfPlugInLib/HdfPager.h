@@ -18,6 +18,12 @@
  * This base class is a raster pager for all HDF files. It provides a specification
  * for HDF4 and HDF5 pagers.
  *
+ * HDF pagers do not override CachedPager::getReadAheadDepth(), so they do not
+ * read ahead.  Read-ahead calls fetchUnit() from a pool thread, while the importer
+ * and pagers of other HDF data sets call the HDF library from other threads.  The
+ * HDF4 library and the default HDF5 build are not thread-safe, so every HDF call
+ * would have to be serialized by a lock shared by all HDF plug-ins first.
+ *
  * @see Hdf4Pager, Hdf5Pager
  */
 class HdfPager : public CachedPager
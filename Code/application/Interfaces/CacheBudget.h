@@ -0,0 +1,154 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef CACHEBUDGET_H
+#define CACHEBUDGET_H
+
+#include <boost/shared_ptr.hpp>
+#include <stddef.h>
+
+/**
+ *  \ingroup ServiceModule
+ *  A memory budget shared by all caches in the application.
+ *
+ *  Caches of data which can be recreated on demand, such as pages read from
+ *  a file, charge their entries against this budget.  When the budget is
+ *  exceeded, the least recently used entries are released regardless of which
+ *  cache or module they belong to, so opening additional data sets does not
+ *  increase the amount of memory used for caching.
+ *
+ *  The budget holds the only long-lived reference to each entry; a cache
+ *  should only keep weak references to its entries so that an eviction frees
+ *  the memory.
+ *
+ *  The budget is obtained from UtilityServices::getCacheBudget().  All methods
+ *  may be called from any thread.
+ */
+class CacheBudget
+{
+public:
+   /**
+    *  An item which is charged against the budget.
+    */
+   class Entry
+   {
+   public:
+      /**
+       *  Destroys the entry.
+       */
+      virtual ~Entry() {}
+
+      /**
+       *  Returns the amount of memory held by this entry.
+       *
+       *  @return  The size of the entry in bytes.  This must not change while
+       *           the entry is in the budget.
+       */
+      virtual size_t getSize() const = 0;
+   };
+
+   /**
+    *  A reference to an entry in the budget.
+    */
+   typedef boost::shared_ptr<Entry> EntryPtr;
+
+   /**
+    *  Sets the maximum number of bytes held by all caches combined.
+    *
+    *  If the new size is smaller than the number of bytes currently held, the
+    *  least recently used entries are released immediately.
+    *
+    *  @param   maxSize
+    *           The maximum size of all caches combined, in bytes.
+    */
+   virtual void setMaximumSize(size_t maxSize) = 0;
+
+   /**
+    *  Returns the maximum number of bytes held by all caches combined.
+    *
+    *  @return  The maximum size of all caches combined, in bytes.
+    */
+   virtual size_t getMaximumSize() const = 0;
+
+   /**
+    *  Returns the number of bytes currently held by all caches combined.
+    *
+    *  @return  The size of all caches combined, in bytes.
+    */
+   virtual size_t getTotalSize() const = 0;
+
+   /**
+    *  Limits the number of bytes held by a single cache.
+    *
+    *  The limit applies in addition to the maximum size of the budget.  When
+    *  the owner exceeds its limit, its own least recently used entries are
+    *  released.
+    *
+    *  @param   pOwner
+    *           The cache to limit.
+    *  @param   maxSize
+    *           The maximum size of the owner's entries, in bytes.  Specify 0
+    *           to remove the limit.
+    */
+   virtual void setOwnerMaximumSize(const void* pOwner, size_t maxSize) = 0;
+
+   /**
+    *  Adds an entry to the budget.
+    *
+    *  The entry is marked as most recently used.  Least recently used entries
+    *  are released as needed to remain within the budget; the new entry is
+    *  always kept, even if it is larger than the budget.  Adding an entry
+    *  which is already in the budget does nothing.
+    *
+    *  @param   pOwner
+    *           The cache which owns the entry.
+    *  @param   pEntry
+    *           The entry to add.  If this is \c NULL, this method does nothing.
+    */
+   virtual void insert(const void* pOwner, EntryPtr pEntry) = 0;
+
+   /**
+    *  Marks an entry as most recently used.
+    *
+    *  @param   pEntry
+    *           The entry to mark.
+    *
+    *  @return  \c True if the entry is in the budget, or \c false if it has
+    *           already been released.
+    */
+   virtual bool touch(const Entry* pEntry) = 0;
+
+   /**
+    *  Releases a single entry.
+    *
+    *  @param   pEntry
+    *           The entry to release.  If the entry is not in the budget, this
+    *           method does nothing.
+    */
+   virtual void remove(const Entry* pEntry) = 0;
+
+   /**
+    *  Releases all entries of a cache and removes the cache's limit.
+    *
+    *  This must be called before a cache which owns entries is destroyed.
+    *
+    *  @param   pOwner
+    *           The cache whose entries should be released.
+    */
+   virtual void removeOwner(const void* pOwner) = 0;
+
+protected:
+   /**
+    *  The budget will be destroyed during application close.  Plug-ins do not
+    *  need to destroy it.
+    */
+   virtual ~CacheBudget() {}
+};
+
+#endif
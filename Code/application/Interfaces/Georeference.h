@@ -143,6 +143,114 @@ public:
     */
    virtual bool canHandleRasterElement(RasterElement *pRaster) const = 0;
 
+   /**
+    *  Converts an array of scene pixel coordinates to geocoordinates.
+    *
+    *  This is equivalent to calling pixelToGeo() or pixelToGeoQuick() for each
+    *  pixel, but allows the plug-in to convert large numbers of points without
+    *  the overhead of a virtual call per point.
+    *
+    *  @param   pPixels
+    *           A contiguous array of \c count scene pixel locations.
+    *  @param   pGeocoords
+    *           A contiguous array of \c count locations which receives the
+    *           corresponding geocoordinates.  This may be the same array as
+    *           \c pPixels to convert the points in place.
+    *  @param   count
+    *           The number of points to convert.
+    *  @param   quick
+    *           If \c true, the approximation used by pixelToGeoQuick() is
+    *           acceptable.
+    *  @param   pAccurate
+    *           Output indicator of conversion accuracy.  This is set to \c false if
+    *           any of the points could not be converted accurately, as described in
+    *           pixelToGeo().  When \c NULL, no accuracy check is performed.
+    *
+    *  @default The default implementation calls pixelToGeo() or pixelToGeoQuick()
+    *           for each pixel.
+    */
+   virtual void pixelsToGeo(const LocationType* pPixels, LocationType* pGeocoords, size_t count,
+      bool quick = false, bool* pAccurate = NULL) const
+   {
+      if (pAccurate != NULL)
+      {
+         *pAccurate = true;
+      }
+
+      for (size_t i = 0; i < count; ++i)
+      {
+         bool accurate = true;
+         bool* pPointAccurate = (pAccurate == NULL ? NULL : &accurate);
+         if (quick)
+         {
+            pGeocoords[i] = pixelToGeoQuick(pPixels[i], pPointAccurate);
+         }
+         else
+         {
+            pGeocoords[i] = pixelToGeo(pPixels[i], pPointAccurate);
+         }
+
+         if (pAccurate != NULL)
+         {
+            *pAccurate = *pAccurate && accurate;
+         }
+      }
+   }
+
+   /**
+    *  Converts an array of geocoordinates to scene pixel coordinates.
+    *
+    *  This is equivalent to calling geoToPixel() or geoToPixelQuick() for each
+    *  geocoordinate, but allows the plug-in to convert large numbers of points
+    *  without the overhead of a virtual call per point.
+    *
+    *  @param   pGeocoords
+    *           A contiguous array of \c count geocoordinates.
+    *  @param   pPixels
+    *           A contiguous array of \c count locations which receives the
+    *           corresponding scene pixel locations.  This may be the same array as
+    *           \c pGeocoords to convert the points in place.
+    *  @param   count
+    *           The number of points to convert.
+    *  @param   quick
+    *           If \c true, the approximation used by geoToPixelQuick() is
+    *           acceptable.
+    *  @param   pAccurate
+    *           Output indicator of conversion accuracy.  This is set to \c false if
+    *           any of the points could not be converted accurately, as described in
+    *           geoToPixel().  When \c NULL, no accuracy check is performed.
+    *
+    *  @default The default implementation calls geoToPixel() or geoToPixelQuick()
+    *           for each geocoordinate.
+    */
+   virtual void geosToPixels(const LocationType* pGeocoords, LocationType* pPixels, size_t count,
+      bool quick = false, bool* pAccurate = NULL) const
+   {
+      if (pAccurate != NULL)
+      {
+         *pAccurate = true;
+      }
+
+      for (size_t i = 0; i < count; ++i)
+      {
+         bool accurate = true;
+         bool* pPointAccurate = (pAccurate == NULL ? NULL : &accurate);
+         if (quick)
+         {
+            pPixels[i] = geoToPixelQuick(pGeocoords[i], pPointAccurate);
+         }
+         else
+         {
+            pPixels[i] = geoToPixel(pGeocoords[i], pPointAccurate);
+         }
+
+         if (pAccurate != NULL)
+         {
+            *pAccurate = *pAccurate && accurate;
+         }
+      }
+   }
+
 protected:
    /**
     *  Since the Georeference interface is usually used in conjunction with the
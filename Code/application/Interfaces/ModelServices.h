@@ -665,6 +665,11 @@ public:
     *  create space for a dataset in the studio's memory space that it can be
     *  accessed when a plug-in has been unloaded.
     *
+    *  The memory is initialized to zero.  Large blocks are mapped directly
+    *  from the operating system, so physical memory is only committed as each
+    *  page is first written and is placed near the processor of the writing
+    *  thread.
+    *
     *  NOTE: On a 64-bit platform, the maximum available bytes to allocate is
     *  2^64, which is well over 18 million GB.  On a 32-bit platform, the
     *  maximum available bytes to allocate is 4 GB.
@@ -475,8 +475,9 @@ public:
    /**
     *  Returns geocoordinates for multiple pixel locations.
     *
-    *  This method uses the convertPixelToGeocoord() method to perform the
-    *  conversion for each pixel location.
+    *  The pixel locations are passed to the Georeference plug-in in a single
+    *  call to Georeference::pixelsToGeo(), which is considerably faster than
+    *  calling convertPixelToGeocoord() for each pixel location.
     *
     *  @param   pixels
     *           The pixel locations for which to get their geocoordinates.
@@ -514,8 +515,9 @@ public:
    /**
     *  Returns pixel locations for multiple geocoordinates.
     *
-    *  This method uses the convertGeocoordToPixel() method to perform the
-    *  conversion for each geocoordinate.
+    *  The geocoordinates are passed to the Georeference plug-in in a single
+    *  call to Georeference::geosToPixels(), which is considerably faster than
+    *  calling convertGeocoordToPixel() for each geocoordinate.
     *
     *  @param   geocoords
     *           The geocoordinates for which to get the pixel locations.
@@ -16,6 +16,13 @@
 #include "Progress.h"
 #include "Service.h"
 
+class CacheBudget;
+
+namespace mta
+{
+   class ThreadPool;
+}
+
 /**
  *  \ingroup ServiceModule
  *  Provides access to data objects not available in the object factory
@@ -215,6 +222,31 @@ public:
     */
    virtual uint64_t getAvailableDiskSpace( std::string path = "" ) = 0;
 
+   /**
+    *  Returns the memory budget shared by all caches in the application.
+    *
+    *  Caches which can recreate their contents on demand should charge their
+    *  entries against this budget instead of keeping a private cache, so that
+    *  the total amount of cached data remains bounded.
+    *
+    *  @return  The application-wide cache budget.
+    */
+   virtual CacheBudget* getCacheBudget() = 0;
+
+   /**
+    *  Returns the thread pool shared by all modules in the application.
+    *
+    *  Plug-ins should queue short background tasks in this pool instead of
+    *  creating their own threads, so that the number of busy threads does not
+    *  exceed ConfigurationSettings::getSettingThreadCount().  The pool is
+    *  created when the application starts and is stopped before plug-ins are
+    *  unloaded, after which mta::ThreadPool::queueTask() returns \c false.
+    *
+    *  @return  The application-wide thread pool, or \c NULL if the application
+    *           has not started it.
+    */
+   virtual mta::ThreadPool* getThreadPool() = 0;
+
 protected:
    /**
     * This will be cleaned up during application close.  Plug-ins do not
@@ -1195,17 +1195,23 @@ const bool** BitMaskImp::getRegion(int x1, int y1, int x2, int y2)
    {
       pBuffer = &mpBuffer[i - y1][-offset];
       pSafe = mpBuffer[i - y1];
-      for (j = left; j <= right; j += 32)
+      for (j = left; j <= right; j += 32, pBuffer += 32)
       {
          values = getPixels (j, i);
-         mask = 0x80000000;
-         for (k = 0; k < 32; ++k, ++pBuffer)
+
+         // skip the bits before the start of the region
+         k = (pBuffer < pSafe ? static_cast<int>(pSafe - pBuffer) : 0);
+
+         // solid runs of 32 pixels are filled at once
+         if (values == 0 || values == 0xffffffff)
          {
-            if (pBuffer >= pSafe)
-            {
-               *pBuffer = ((values & mask) != 0);
-            }
-            mask >>= 1;
+            memset(pBuffer + k, values != 0, 32 - k);
+            continue;
+         }
+
+         for (mask = 0x80000000 >> k; k < 32; ++k, mask >>= 1)
+         {
+            pBuffer[k] = ((values & mask) != 0);
          }
       }
    }
@@ -1232,14 +1238,7 @@ int BitMaskImp::computeCount() const
       pRowMask = mpMask[i];
       for (int j = 0; j < mxSize; ++j)
       {
-         if (pRowMask[j] == 0xffffffff)
-         {
-            count += LONG_BITS;
-         }
-         else
-         {
-            count += countBits(pRowMask[j]);
-         }
+         count += countBits(pRowMask[j]);
       }
    }
 
@@ -1413,18 +1412,10 @@ void BitMaskImp::growToInclude(int x1, int y1, int x2, int y2, bool fill)
  */
 static inline int countBits(unsigned int v)
 {
-   int count = 0;
-   for (int i = 0; i < LONG_BITS; ++i)
-   {
-      if (v & 0x1)
-      {
-         count++;
-      }
-
-      v >>= 1;
-   }
-
-   return count;
+   // add the bits in parallel: pairs, then nibbles, then sum the bytes with a multiply
+   v = v - ((v >> 1) & 0x55555555);
+   v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+   return static_cast<int>((((v + (v >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24);
 }
 
 /**
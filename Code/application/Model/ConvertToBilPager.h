@@ -10,32 +10,22 @@
 #ifndef CONVERTTOBILPAGER_H
 #define CONVERTTOBILPAGER_H
 
-#include "RasterPager.h"
+#include "InterleaveConverterPager.h"
 
 class RasterElement;
 
 /**
- * This class converts BSQ or BIP formatted data to BIL on the fly.
+ * This class converts BIP or BSQ formatted data to BIL on the fly.
  */
-class ConvertToBilPager : public RasterPager
+class ConvertToBilPager : public InterleaveConverterPager
 {
 public:
    ConvertToBilPager(RasterElement* pRaster);
 
    virtual ~ConvertToBilPager(void);
 
-   void releasePage(RasterPage* pPage);
-
-   int getSupportedRequestVersion() const;
-
-   RasterPage* getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
-      DimensionDescriptor startColumn, DimensionDescriptor startBand);
-
 private:
    ConvertToBilPager();
-
-   RasterElement* const mpRaster;
-   unsigned int mBytesPerElement;
 };
 
 #endif
@@ -10,32 +10,22 @@
 #ifndef CONVERTTOBIPPAGER_H
 #define CONVERTTOBIPPAGER_H
 
-#include "RasterPager.h"
+#include "InterleaveConverterPager.h"
 
 class RasterElement;
 
 /**
  * This class converts BSQ or BIL formatted data to BIP on the fly.
  */
-class ConvertToBipPager : public RasterPager
+class ConvertToBipPager : public InterleaveConverterPager
 {
 public:
    ConvertToBipPager(RasterElement* pRaster);
 
    virtual ~ConvertToBipPager(void);
 
-   void releasePage(RasterPage* pPage);
-
-   int getSupportedRequestVersion() const;
-
-   RasterPage *getPage(DataRequest* pOriginalRequest,  DimensionDescriptor startRow,
-      DimensionDescriptor startColumn, DimensionDescriptor startBand);
-
 private:
    ConvertToBipPager();
-
-   RasterElement* const mpRaster;
-   unsigned int mBytesPerElement;
 };
 
 #endif
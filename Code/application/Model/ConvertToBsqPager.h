@@ -10,32 +10,22 @@
 #ifndef CONVERTTOBSQPAGER_H
 #define CONVERTTOBSQPAGER_H
 
-#include "RasterPager.h"
+#include "InterleaveConverterPager.h"
 
 class RasterElement;
 
 /**
  * This class converts BIP or BIL formatted data to BSQ on the fly.
  */
-class ConvertToBsqPager : public RasterPager
+class ConvertToBsqPager : public InterleaveConverterPager
 {
 public:
    ConvertToBsqPager(RasterElement* pRaster);
 
    virtual ~ConvertToBsqPager(void);
 
-   void releasePage(RasterPage* pPage);
-
-   int getSupportedRequestVersion() const;
-
-   RasterPage* getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
-      DimensionDescriptor startColumn, DimensionDescriptor startBand);
-
 private:
    ConvertToBsqPager();
-
-   RasterElement* const mpRaster;
-   unsigned int mBytesPerElement;
 };
 
 #endif
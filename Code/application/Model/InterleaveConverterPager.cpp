@@ -0,0 +1,510 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppConfig.h"
+#include "AppVerify.h"
+#include "CacheBudget.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "InterleaveConverterPager.h"
+#include "ObjectResource.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterElementImp.h"
+#include "RasterPage.h"
+#include "RasterUtilities.h"
+#include "UtilityServices.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+   // Rows are converted in blocks of about this many bytes
+   const size_t BLOCK_SIZE = 2 * 1024 * 1024;
+
+   // Each pager keeps at most this many bytes of converted blocks in the cache budget
+   const size_t CACHE_SIZE = 32 * 1024 * 1024;
+
+   // Every band in a cache line of BIP data is converted when converting one band to BSQ
+   const unsigned int CACHE_LINE_SIZE = 64;
+
+   // BSQ data is read through one accessor per band, so bands are transposed this many at a time
+   const unsigned int BAND_GROUP_SIZE = 16;
+}
+
+/**
+ * A block of rows converted to the pager's interleave.
+ */
+struct InterleaveConverterPager::Block : public CacheBudget::Entry
+{
+   Block(unsigned int startRow, unsigned int rowCount, unsigned int startColumn, unsigned int columnCount,
+      unsigned int startBand, unsigned int bandCount, unsigned int bytesPerElement,
+      InterleaveFormatType interleave) :
+      mStartRow(startRow),
+      mRowCount(rowCount),
+      mStartColumn(startColumn),
+      mColumnCount(columnCount),
+      mStartBand(startBand),
+      mBandCount(bandCount),
+      mSize(static_cast<size_t>(rowCount) * columnCount * bandCount * bytesPerElement),
+      mColumnStride(bytesPerElement),
+      mRowStride(static_cast<size_t>(columnCount) * bandCount * bytesPerElement),
+      mBandStride(static_cast<size_t>(columnCount) * bytesPerElement),
+      mData(static_cast<int>(mSize), true)
+   {
+      if (interleave == BIP)
+      {
+         mColumnStride = static_cast<size_t>(bandCount) * bytesPerElement;
+         mBandStride = bytesPerElement;
+      }
+      else if (interleave == BSQ)
+      {
+         mRowStride = mBandStride;
+         mBandStride = mRowStride * rowCount;
+      }
+   }
+
+   unsigned char* getData(unsigned int row, unsigned int band)
+   {
+      return mData.get() + row * mRowStride + band * mBandStride;
+   }
+
+   size_t getSize() const
+   {
+      return mSize;
+   }
+
+   bool overlaps(unsigned int startRow, unsigned int stopRow, unsigned int startBand, unsigned int stopBand) const
+   {
+      return mStartRow <= stopRow && startRow < mStartRow + mRowCount &&
+         mStartBand <= stopBand && startBand < mStartBand + mBandCount;
+   }
+
+   const unsigned int mStartRow;
+   const unsigned int mRowCount;
+   const unsigned int mStartColumn;
+   const unsigned int mColumnCount;
+   const unsigned int mStartBand;
+   const unsigned int mBandCount;
+   const size_t mSize;
+   size_t mColumnStride;
+   size_t mRowStride;
+   size_t mBandStride;
+   ArrayResource<unsigned char> mData;
+};
+
+/**
+ * A page pointing into a converted block.  The page holds a reference to the block, so the block
+ * remains valid if it is removed from the cache while the page is leased.
+ */
+class InterleaveConverterPager::Page : public RasterPage
+{
+public:
+   Page(BlockPtr pBlock, unsigned int row, unsigned int band, unsigned int bandCount, bool writable) :
+      mpBlock(pBlock),
+      mRow(row),
+      mBand(band),
+      mBandCount(bandCount),
+      mWritable(writable)
+   {}
+
+   unsigned int getNumRows()
+   {
+      return mpBlock->mRowCount - mRow;
+   }
+
+   unsigned int getNumColumns()
+   {
+      return mpBlock->mColumnCount;
+   }
+
+   unsigned int getNumBands()
+   {
+      return mBandCount;
+   }
+
+   unsigned int getInterlineBytes()
+   {
+      return 0;
+   }
+
+   void* getRawData()
+   {
+      return mpBlock->getData(mRow, mBand);
+   }
+
+   Block& getBlock()
+   {
+      return *mpBlock;
+   }
+
+   unsigned int getBand() const
+   {
+      return mBand;
+   }
+
+   bool isWritable() const
+   {
+      return mWritable;
+   }
+
+private:
+   BlockPtr mpBlock;
+   unsigned int mRow;
+   unsigned int mBand;
+   unsigned int mBandCount;
+   bool mWritable;
+};
+
+InterleaveConverterPager::InterleaveConverterPager(RasterElement* pRaster, InterleaveFormatType interleave) :
+   mpRaster(pRaster),
+   mInterleave(interleave),
+   mBytesPerElement(0),
+   mpBudget(Service<UtilityServices>()->getCacheBudget()),
+   mGeneration(0)
+{
+   mpBudget->setOwnerMaximumSize(this, CACHE_SIZE);
+
+   if (mpRaster != NULL)
+   {
+      const RasterDataDescriptor* pDd = dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+      if (pDd != NULL)
+      {
+         mSourceInterleave = pDd->getInterleaveFormat();
+         mBytesPerElement = pDd->getBytesPerElement();
+      }
+   }
+}
+
+InterleaveConverterPager::~InterleaveConverterPager()
+{
+   mpBudget->removeOwner(this);
+}
+
+RasterPage* InterleaveConverterPager::getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+   DimensionDescriptor startColumn, DimensionDescriptor startBand)
+{
+   VERIFYRV(pOriginalRequest != NULL, NULL);
+   VERIFYRV(pOriginalRequest->getInterleaveFormat() == mInterleave, NULL);
+
+   VERIFYRV(mpRaster != NULL, NULL);
+   const RasterDataDescriptor* pDd = dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   VERIFYRV(pDd != NULL, NULL);
+   VERIFYRV(mSourceInterleave != mInterleave && mBytesPerElement > 0, NULL);
+
+   DimensionDescriptor stopRow = pOriginalRequest->getStopRow();
+   DimensionDescriptor stopColumn = pOriginalRequest->getStopColumn();
+   DimensionDescriptor stopBand = pOriginalRequest->getStopBand();
+
+   unsigned int numRows = pDd->getRowCount();
+   unsigned int numCols = pDd->getColumnCount();
+   unsigned int numBands = pDd->getBandCount();
+
+   if (startRow.getActiveNumber() >= numRows || stopRow.getActiveNumber() >= numRows ||
+      startColumn.getActiveNumber() >= numCols || stopColumn.getActiveNumber() >= numCols ||
+      startBand.getActiveNumber() >= numBands || stopBand.getActiveNumber() >= numBands ||
+      startRow.getActiveNumber() > stopRow.getActiveNumber() ||
+      startColumn.getActiveNumber() > stopColumn.getActiveNumber() ||
+      startBand.getActiveNumber() > stopBand.getActiveNumber())
+   {
+      return NULL;
+   }
+
+   unsigned int rowCount = stopRow.getActiveNumber() - startRow.getActiveNumber() + 1;
+   unsigned int concurrentRows = std::min(std::max(pOriginalRequest->getConcurrentRows(), 1U), rowCount);
+   unsigned int columnCount = stopColumn.getActiveNumber() - startColumn.getActiveNumber() + 1;
+   unsigned int blockStartBand = startBand.getActiveNumber();
+   unsigned int blockBandCount = stopBand.getActiveNumber() - startBand.getActiveNumber() + 1;
+   if (mInterleave == BSQ)
+   {
+      VERIFYRV(blockBandCount == 1 && pOriginalRequest->getConcurrentBands() == 1, NULL);
+      if (mSourceInterleave == BIP && pOriginalRequest->getWritable() == false)
+      {
+         // Neighboring bands share the cache lines read for each pixel, so convert them together
+         // and leave them in the cache for the next band requested.  A writable block only holds
+         // the requested band, so no other band is written back or marked as modified.
+         unsigned int groupSize = std::max(1U, CACHE_LINE_SIZE / mBytesPerElement);
+         blockStartBand = (blockStartBand / groupSize) * groupSize;
+         blockBandCount = std::min(groupSize, numBands - blockStartBand);
+      }
+   }
+
+   bool writable = pOriginalRequest->getWritable();
+   BlockPtr pBlock;
+   if (writable == false)
+   {
+      pBlock = findBlock(startRow.getActiveNumber(), startRow.getActiveNumber() + concurrentRows - 1,
+         startColumn.getActiveNumber(), columnCount, blockStartBand, blockBandCount);
+   }
+
+   if (pBlock.get() == NULL)
+   {
+      unsigned int generation = 0;
+      {
+         mta::MutexLock lock(mMutex);
+         generation = mGeneration;
+      }
+
+      size_t rowSize = static_cast<size_t>(columnCount) * blockBandCount * mBytesPerElement;
+      unsigned int blockRows = static_cast<unsigned int>(std::min<size_t>(rowCount,
+         std::max<size_t>(concurrentRows, BLOCK_SIZE / rowSize)));
+      pBlock.reset(new Block(startRow.getActiveNumber(), blockRows, startColumn.getActiveNumber(), columnCount,
+         blockStartBand, blockBandCount, mBytesPerElement, mInterleave));
+      if (pBlock->mData.get() == NULL)
+      {
+         return NULL;
+      }
+
+      if (transfer(*pBlock, 0, blockBandCount, writable, false) == false)
+      {
+         return NULL;
+      }
+
+      if (writable == false)
+      {
+         insertBlock(pBlock, generation);
+      }
+   }
+
+   unsigned int band = 0;
+   unsigned int bandCount = pBlock->mBandCount;
+   if (mInterleave == BSQ)
+   {
+      band = startBand.getActiveNumber() - pBlock->mStartBand;
+      bandCount = 1;
+   }
+
+   return new Page(pBlock, startRow.getActiveNumber() - pBlock->mStartRow, band, bandCount, writable);
+}
+
+void InterleaveConverterPager::releasePage(RasterPage* pPage)
+{
+   // Check that pPage is the correct type before deleting it.
+   Page* pConvertedPage = dynamic_cast<Page*>(pPage);
+   if (pConvertedPage != NULL && pConvertedPage->isWritable())
+   {
+      Block& block = pConvertedPage->getBlock();
+      unsigned int startBand = 0;
+      unsigned int bandCount = block.mBandCount;
+      if (mInterleave == BSQ)
+      {
+         startBand = pConvertedPage->getBand();
+         bandCount = 1;
+      }
+
+      transfer(block, startBand, bandCount, true, true);
+
+      // Blocks converted by any view of the raster element while the page was leased are now stale
+      RasterElementImp* pRasterImp = dynamic_cast<RasterElementImp*>(mpRaster);
+      if (pRasterImp != NULL)
+      {
+         pRasterImp->invalidateConvertedData(block.mStartRow, block.mStartRow + block.mRowCount - 1,
+            block.mStartBand + startBand, block.mStartBand + startBand + bandCount - 1);
+      }
+   }
+
+   delete pConvertedPage;
+}
+
+int InterleaveConverterPager::getSupportedRequestVersion() const
+{
+   return 1;
+}
+
+void InterleaveConverterPager::invalidate()
+{
+   mta::MutexLock lock(mMutex);
+   for (std::list<BlockRef>::iterator iter = mBlocks.begin(); iter != mBlocks.end(); ++iter)
+   {
+      BlockPtr pBlock = iter->lock();
+      if (pBlock.get() != NULL)
+      {
+         mpBudget->remove(pBlock.get());
+      }
+   }
+
+   mBlocks.clear();
+   ++mGeneration;
+}
+
+void InterleaveConverterPager::invalidate(unsigned int startRow, unsigned int stopRow, unsigned int startBand,
+   unsigned int stopBand)
+{
+   mta::MutexLock lock(mMutex);
+   for (std::list<BlockRef>::iterator iter = mBlocks.begin(); iter != mBlocks.end();)
+   {
+      BlockPtr pBlock = iter->lock();
+      if (pBlock.get() == NULL || pBlock->overlaps(startRow, stopRow, startBand, stopBand))
+      {
+         if (pBlock.get() != NULL)
+         {
+            mpBudget->remove(pBlock.get());
+         }
+
+         iter = mBlocks.erase(iter);
+      }
+      else
+      {
+         ++iter;
+      }
+   }
+
+   // A block being converted may have read the data before it changed
+   ++mGeneration;
+}
+
+InterleaveConverterPager::BlockPtr InterleaveConverterPager::findBlock(unsigned int startRow, unsigned int stopRow,
+   unsigned int startColumn, unsigned int columnCount, unsigned int startBand, unsigned int bandCount)
+{
+   mta::MutexLock lock(mMutex);
+   for (std::list<BlockRef>::iterator iter = mBlocks.begin(); iter != mBlocks.end();)
+   {
+      BlockPtr pBlock = iter->lock();
+      if (pBlock.get() == NULL)
+      {
+         // The block was evicted from the budget
+         iter = mBlocks.erase(iter);
+         continue;
+      }
+
+      const Block& block = *pBlock;
+      if (block.mStartColumn == startColumn && block.mColumnCount == columnCount &&
+         block.mStartBand == startBand && block.mBandCount == bandCount &&
+         block.mStartRow <= startRow && stopRow < block.mStartRow + block.mRowCount)
+      {
+         mpBudget->touch(pBlock.get());
+         mBlocks.splice(mBlocks.begin(), mBlocks, iter);
+         return pBlock;
+      }
+
+      ++iter;
+   }
+
+   return BlockPtr();
+}
+
+void InterleaveConverterPager::insertBlock(BlockPtr pBlock, unsigned int generation)
+{
+   mta::MutexLock lock(mMutex);
+   if (generation != mGeneration)
+   {
+      // The source data changed while the block was being converted
+      return;
+   }
+
+   mBlocks.push_front(pBlock);
+   mpBudget->insert(this, pBlock);
+}
+
+bool InterleaveConverterPager::transfer(Block& block, unsigned int startBand, unsigned int bandCount,
+   bool writable, bool writeBack)
+{
+   VERIFY(mpRaster != NULL);
+   const RasterDataDescriptor* pDd = dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   VERIFY(pDd != NULL);
+
+   DimensionDescriptor startRow = pDd->getActiveRow(block.mStartRow);
+   DimensionDescriptor stopRow = pDd->getActiveRow(block.mStartRow + block.mRowCount - 1);
+   DimensionDescriptor startColumn = pDd->getActiveColumn(block.mStartColumn);
+   DimensionDescriptor stopColumn = pDd->getActiveColumn(block.mStartColumn + block.mColumnCount - 1);
+
+   std::vector<unsigned char*> rasterRows(bandCount);
+   std::vector<unsigned char*> blockRows(bandCount);
+   unsigned int groupSize = (mSourceInterleave == BSQ ? BAND_GROUP_SIZE : bandCount);
+   for (unsigned int group = 0; group < bandCount; group += groupSize)
+   {
+      unsigned int groupCount = std::min(groupSize, bandCount - group);
+      unsigned int firstBand = block.mStartBand + startBand + group;
+
+      std::vector<DataAccessor> accessors;
+      for (unsigned int i = 0; i < (mSourceInterleave == BSQ ? groupCount : 1); ++i)
+      {
+         FactoryResource<DataRequest> pRequest;
+         pRequest->setRows(startRow, stopRow, 1);
+         pRequest->setColumns(startColumn, stopColumn, block.mColumnCount);
+         if (mSourceInterleave == BSQ)
+         {
+            DimensionDescriptor band = pDd->getActiveBand(firstBand + i);
+            pRequest->setBands(band, band, 1);
+         }
+         else
+         {
+            pRequest->setBands(pDd->getActiveBand(firstBand), pDd->getActiveBand(firstBand + groupCount - 1),
+               groupCount);
+         }
+
+         pRequest->setWritable(writable);
+         accessors.push_back(mpRaster->getDataAccessor(pRequest.release()));
+      }
+
+      for (unsigned int row = 0; row < block.mRowCount; ++row)
+      {
+         size_t rasterStride = mBytesPerElement;
+         for (std::vector<DataAccessor>::iterator iter = accessors.begin(); iter != accessors.end(); ++iter)
+         {
+            if (iter->isValid() == false)
+            {
+               return false;
+            }
+         }
+
+         if (mSourceInterleave == BSQ)
+         {
+            for (unsigned int i = 0; i < groupCount; ++i)
+            {
+               rasterRows[i] = reinterpret_cast<unsigned char*>(accessors[i]->getRow());
+            }
+         }
+         else
+         {
+            DataAccessor& da = accessors.front();
+            unsigned char* pRow = reinterpret_cast<unsigned char*>(da->getRow());
+            size_t bandStride = mBytesPerElement;
+            if (mSourceInterleave == BIP)
+            {
+               rasterStride = da->getRowSize() / da->getConcurrentColumns();
+            }
+            else
+            {
+               bandStride = da->getConcurrentColumns() * mBytesPerElement;
+            }
+
+            for (unsigned int i = 0; i < groupCount; ++i)
+            {
+               rasterRows[i] = pRow + i * bandStride;
+            }
+         }
+
+         for (unsigned int i = 0; i < groupCount; ++i)
+         {
+            blockRows[i] = block.getData(row, startBand + group + i);
+         }
+
+         if (writeBack)
+         {
+            RasterUtilities::copyElements(&blockRows[0], block.mColumnStride, &rasterRows[0], rasterStride,
+               groupCount, block.mColumnCount, mBytesPerElement);
+         }
+         else
+         {
+            RasterUtilities::copyElements(&rasterRows[0], rasterStride, &blockRows[0], block.mColumnStride,
+               groupCount, block.mColumnCount, mBytesPerElement);
+         }
+
+         for (std::vector<DataAccessor>::iterator iter = accessors.begin(); iter != accessors.end(); ++iter)
+         {
+            (*iter)->nextRow();
+         }
+      }
+   }
+
+   return true;
+}
@@ -0,0 +1,86 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef INTERLEAVECONVERTERPAGER_H
+#define INTERLEAVECONVERTERPAGER_H
+
+#include "DMutex.h"
+#include "RasterPager.h"
+#include "TypesFile.h"
+
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <list>
+
+class CacheBudget;
+class RasterElement;
+
+/**
+ * Base class for the pagers which convert a raster element's data to another interleave on the fly.
+ *
+ * Data is converted a block of rows at a time with cache-blocked transposes.  Converted blocks are
+ * charged to the application's CacheBudget, so repeated requests such as a sweep through every band
+ * of BIP data as BSQ do not convert the same rows again.  Writable requests are converted into a
+ * private block which is written back to the raster element when the page is released, after which
+ * the overlapping blocks of every converter of the raster element are discarded.
+ */
+class InterleaveConverterPager : public RasterPager
+{
+public:
+   virtual ~InterleaveConverterPager();
+
+   RasterPage* getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+      DimensionDescriptor startColumn, DimensionDescriptor startBand);
+
+   void releasePage(RasterPage* pPage);
+
+   int getSupportedRequestVersion() const;
+
+   /**
+    * Discards all cached data.  This must be called whenever the source data may have changed.
+    * Pages which are currently leased are not affected.
+    */
+   void invalidate();
+
+   /**
+    * Discards the cached data which overlaps the given active rows and bands.
+    * Pages which are currently leased are not affected.
+    */
+   void invalidate(unsigned int startRow, unsigned int stopRow, unsigned int startBand, unsigned int stopBand);
+
+protected:
+   InterleaveConverterPager(RasterElement* pRaster, InterleaveFormatType interleave);
+
+private:
+   InterleaveConverterPager(const InterleaveConverterPager& rhs);
+   InterleaveConverterPager& operator=(const InterleaveConverterPager& rhs);
+
+   struct Block;
+   class Page;
+   typedef boost::shared_ptr<Block> BlockPtr;
+   typedef boost::weak_ptr<Block> BlockRef;
+
+   BlockPtr findBlock(unsigned int startRow, unsigned int stopRow, unsigned int startColumn,
+      unsigned int columnCount, unsigned int startBand, unsigned int bandCount);
+   void insertBlock(BlockPtr pBlock, unsigned int generation);
+   bool transfer(Block& block, unsigned int startBand, unsigned int bandCount, bool writable, bool writeBack);
+
+   RasterElement* const mpRaster;
+   const InterleaveFormatType mInterleave;
+   InterleaveFormatType mSourceInterleave;
+   unsigned int mBytesPerElement;
+
+   // Most recently used first.  The budget owns the blocks, so a block evicted from the budget expires here.
+   std::list<BlockRef> mBlocks;
+   CacheBudget* mpBudget;
+   unsigned int mGeneration;
+   mta::DMutex mMutex;
+};
+
+#endif
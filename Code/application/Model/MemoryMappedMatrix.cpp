@@ -44,8 +44,32 @@ MemoryMappedMatrix::MemoryMappedMatrix(const string& fileName, unsigned int head
    mInterLineBytes(interLineBytes),
    mInterBandBytes(interBandBytes),
    mHeaderOffset(headerOffset),
-   mReadOnly(readOnly)
+   mReadOnly(readOnly),
+   mMinorSize(0),
+   mMiddleSize(0),
+   mMajorSize(0),
+   mpFileBlock(NULL)
 {
+   // same layout as MemoryMappedMatrixView
+   if (mInterleave == BIP)
+   {
+      mMinorSize = mBytesPerElement;
+      mMiddleSize = mMinorSize * mBandNum;
+      mMajorSize = mMiddleSize * mColumnNum + mInterLineBytes;
+   }
+   else if (mInterleave == BSQ)
+   {
+      mMinorSize = mBytesPerElement;
+      mMiddleSize = mMinorSize * mColumnNum + mInterLineBytes;
+      mMajorSize = mMiddleSize * mRowNum + mInterBandBytes;
+   }
+   else if (mInterleave == BIL)
+   {
+      mMinorSize = mBytesPerElement;
+      mMiddleSize = mMinorSize * mColumnNum;
+      mMajorSize = mMiddleSize * mBandNum + mInterLineBytes;
+   }
+
 #if defined(WIN_API)
    // All addresses must align on a page boundary.
    SYSTEM_INFO info;
@@ -110,9 +134,17 @@ MemoryMappedMatrix::MemoryMappedMatrix(const string& fileName, unsigned int head
 MemoryMappedMatrix::~MemoryMappedMatrix()
 {
 #if defined(WIN_API)
+   if (mpFileBlock != NULL)
+   {
+      UnmapViewOfFile(mpFileBlock);
+   }
    CloseHandle(mHandle);
    CloseHandle(mFileHandle);
 #else
+   if (mpFileBlock != NULL)
+   {
+      munmap(reinterpret_cast<char*>(mpFileBlock), static_cast<size_t>(mFileSize));
+   }
    close(mHandle);
 #endif
 }
@@ -131,3 +163,99 @@ void MemoryMappedMatrix::release(MemoryMappedMatrixView* pView)
 {
    mViews.erase(pView);
 }
+
+bool MemoryMappedMatrix::mapFile()
+{
+   if (mpFileBlock != NULL)
+   {
+      return true;
+   }
+
+   if (sizeof(void*) < 8 || mFileSize <= 0)
+   {
+      return false;
+   }
+
+#if defined(WIN_API)
+   DWORD accessPermissions = mReadOnly ? FILE_MAP_READ : (FILE_MAP_READ | FILE_MAP_WRITE);
+   mpFileBlock = static_cast<unsigned char*>(MapViewOfFile(mHandle, accessPermissions, 0, 0, 0));
+#else
+   int accessPermissions = mReadOnly ? PROT_READ : (PROT_READ | PROT_WRITE);
+   void* pBlock = mmap(static_cast<caddr_t>(0), static_cast<size_t>(mFileSize), accessPermissions,
+      MAP_SHARED, mHandle, 0);
+   mpFileBlock = (pBlock == MAP_FAILED) ? NULL : reinterpret_cast<unsigned char*>(pBlock);
+#endif
+
+   return mpFileBlock != NULL;
+}
+
+bool MemoryMappedMatrix::isFileMapped() const
+{
+   return mpFileBlock != NULL;
+}
+
+unsigned char* MemoryMappedMatrix::getFileSegment(unsigned int row, unsigned int column, unsigned int band) const
+{
+   if (mpFileBlock == NULL)
+   {
+      return NULL;
+   }
+
+   int64_t start = mHeaderOffset;
+   if (mInterleave == BIP)
+   {
+      start += row * mMajorSize + column * mMiddleSize + band * mMinorSize;
+   }
+   else if (mInterleave == BSQ)
+   {
+      start += band * mMajorSize + row * mMiddleSize + column * mMinorSize;
+   }
+   else if (mInterleave == BIL)
+   {
+      start += row * mMajorSize + band * mMiddleSize + column * mMinorSize;
+   }
+
+   if (start >= mFileSize)
+   {
+      return NULL;
+   }
+
+   return mpFileBlock + start;
+}
+
+unsigned char* MemoryMappedMatrix::getEndOfFile() const
+{
+   return (mpFileBlock == NULL) ? NULL : (mpFileBlock + mFileSize);
+}
+
+namespace
+{
+#if !defined(WIN_API)
+   // madvise requires a page aligned start address
+   void adviseRange(unsigned char* pStart, size_t size, int advice)
+   {
+      if (pStart == NULL || size == 0)
+      {
+         return;
+      }
+
+      size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+      size_t misalignment = reinterpret_cast<size_t>(pStart) % pageSize;
+      madvise(reinterpret_cast<caddr_t>(pStart - misalignment), size + misalignment, advice);
+   }
+#endif
+}
+
+void MemoryMappedMatrix::adviseAccess(unsigned char* pStart, size_t size, bool sequential)
+{
+#if !defined(WIN_API)
+   adviseRange(pStart, size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+#endif
+}
+
+void MemoryMappedMatrix::adviseWillNeed(unsigned char* pStart, size_t size)
+{
+#if !defined(WIN_API)
+   adviseRange(pStart, size, MADV_WILLNEED);
+#endif
+}
@@ -40,6 +40,19 @@ public:
 
    void release(MemoryMappedMatrixView* pView);
 
+   // Maps the whole file once, so addresses can be handed out without creating views.
+   // This is only done on 64-bit hosts, where the address space can hold any file.
+   bool mapFile();
+   bool isFileMapped() const;
+
+   // Returns NULL if the file is not mapped or the element is past the end of the file
+   unsigned char* getFileSegment(unsigned int row, unsigned int column, unsigned int band) const;
+   unsigned char* getEndOfFile() const;
+
+   // Hints the access pattern of a mapped range.  This does nothing on Windows.
+   static void adviseAccess(unsigned char* pStart, size_t size, bool sequential);
+   static void adviseWillNeed(unsigned char* pStart, size_t size);
+
 private:
    std::string mFileName;
 
@@ -70,6 +83,12 @@ private:
 
    unsigned int mHeaderOffset;
    bool mReadOnly;
+
+   int64_t mMinorSize;
+   int64_t mMiddleSize;
+   int64_t mMajorSize;
+
+   unsigned char* mpFileBlock;
 };
 
 #endif
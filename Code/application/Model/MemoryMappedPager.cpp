@@ -33,7 +33,15 @@ MemoryMappedPager::MemoryMappedPager() :
    mbUseDataDescriptor(true),
    mpDataDescriptor(NULL),
    mSwapEndian(false),
-   mWritable(false)
+   mWritable(false),
+   mFileMapped(false),
+   mInterleave(BIP),
+   mNumBands(0),
+   mNumColumns(0),
+   mInterlineBytes(0),
+   mOffsetRow(0),
+   mOffsetColumn(0),
+   mRowSize(0)
 {
    setName("MemoryMappedPager");
    setCopyright("Copyright (2005) by Ball Aerospace & Technologies Corp.");
@@ -277,37 +285,34 @@ bool MemoryMappedPager::execute(PlugInArgList* pInputArgList, PlugInArgList* pOu
       VERIFY(false);
    } 
    VERIFY(!mMatrices.empty());
+   VERIFY(computeLayout());
 
-   return true;
-}
-
-RasterPage* MemoryMappedPager::getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
-                                       DimensionDescriptor startColumn, DimensionDescriptor startBand)
-{
-   //ensure only one thread enters this code at a time
-   VERIFYRV((mpDataDescriptor != NULL) && (!mMatrices.empty()) && pOriginalRequest != NULL, NULL);
-
-   unsigned int bandIndex = startBand.getActiveNumber();
-
-   if (pOriginalRequest->getWritable() == true && (mWritable == false || mSwapEndian == true))
+   if (MemoryMappedPager::getSettingMapWholeFile())
    {
-      return NULL;
+      mFileMapped = true;
+      for (vector<MemoryMappedMatrix*>::iterator iter = mMatrices.begin(); iter != mMatrices.end(); ++iter)
+      {
+         if ((*iter)->mapFile() == false)
+         {
+            mFileMapped = false;
+         }
+      }
    }
 
-   mta::MutexLock mutex(mMutex);
+   return true;
+}
 
-   InterleaveFormatType interleave;
-   unsigned int numBands = 0;
-   unsigned int numColumns = 0;
-   unsigned int interlineBytes = 0;
-   unsigned int offsetRow = 0; /* OFFSET-SUBCUBING */
-   unsigned int offsetCol = 0; /* OFFSET-SUBCUBING */
+bool MemoryMappedPager::computeLayout()
+{
+   mInterlineBytes = 0;
+   mOffsetRow = 0; /* OFFSET-SUBCUBING */
+   mOffsetColumn = 0; /* OFFSET-SUBCUBING */
 
    if (mbUseDataDescriptor == true)
    {
-      interleave = mpDataDescriptor->getInterleaveFormat();
-      numColumns = mpDataDescriptor->getColumnCount();
-      numBands = mpDataDescriptor->getBandCount();
+      mInterleave = mpDataDescriptor->getInterleaveFormat();
+      mNumColumns = mpDataDescriptor->getColumnCount();
+      mNumBands = mpDataDescriptor->getBandCount();
    }
    else
    {
@@ -318,10 +323,10 @@ RasterPage* MemoryMappedPager::getPage(DataRequest* pOriginalRequest, DimensionD
          return false;
       }
 
-      interleave = pFileDescriptor->getInterleaveFormat();
-      numBands = pFileDescriptor->getBandCount();
-      numColumns = pFileDescriptor->getColumnCount();
-      interlineBytes = pFileDescriptor->getPostlineBytes() + pFileDescriptor->getPrelineBytes();
+      mInterleave = pFileDescriptor->getInterleaveFormat();
+      mNumBands = pFileDescriptor->getBandCount();
+      mNumColumns = pFileDescriptor->getColumnCount();
+      mInterlineBytes = pFileDescriptor->getPostlineBytes() + pFileDescriptor->getPrelineBytes();
 
       DimensionDescriptor rowDim;
       const vector<DimensionDescriptor>& rows = mpDataDescriptor->getRows();
@@ -339,7 +344,7 @@ RasterPage* MemoryMappedPager::getPage(DataRequest* pOriginalRequest, DimensionD
 
       if (rowDim.isValid() && fileRowDim.isValid())
       {
-         offsetRow = rowDim.getOnDiskNumber() - fileRowDim.getOnDiskNumber();
+         mOffsetRow = rowDim.getOnDiskNumber() - fileRowDim.getOnDiskNumber();
       }
 
       DimensionDescriptor columnDim;
@@ -358,85 +363,151 @@ RasterPage* MemoryMappedPager::getPage(DataRequest* pOriginalRequest, DimensionD
 
       if (columnDim.isValid() && fileColumnDim.isValid())
       {
-         offsetCol = columnDim.getOnDiskNumber() - fileColumnDim.getOnDiskNumber();
+         mOffsetColumn = columnDim.getOnDiskNumber() - fileColumnDim.getOnDiskNumber();
       }
    }
 
+   //determine the size of a row depending on whether the interleave is BIP or BSQ
    unsigned int bytesPerElement = mpDataDescriptor->getBytesPerElement();
-   unsigned long segmentSize = 0;
-   unsigned long rowSize = 0;
-   unsigned int numRows = 0;
-   //determine the size of the segment we need to memory map
-   //depending on whether the interleave is BIP or BSQ
-   if ((interleave == BIP) || (numBands == 1))
+   if ((mInterleave == BIP) || (mNumBands == 1))
    {
-      rowSize = (numColumns * numBands * bytesPerElement + interlineBytes);
+      mRowSize = (mNumColumns * mNumBands * bytesPerElement + mInterlineBytes);
    }
-   else if (interleave == BSQ)
+   else if (mInterleave == BSQ)
    {
-      rowSize = (numColumns * bytesPerElement + interlineBytes);
-      if (mMatrices.size() != 1)
-      {
-         VERIFY(pOriginalRequest->getStopBand().getActiveNumber() < mMatrices.size());
-      }
+      mRowSize = (mNumColumns * bytesPerElement + mInterlineBytes);
    }
-   else if (interleave == BIL)
+   else if (mInterleave == BIL)
    {
-      rowSize = numColumns * numBands * bytesPerElement;
+      mRowSize = mNumColumns * mNumBands * bytesPerElement;
    }
 
-   unsigned int concurrentRows = pOriginalRequest->getConcurrentRows();
-   segmentSize = concurrentRows * rowSize;
-   numRows = concurrentRows;
+   return true;
+}
+
+RasterPage* MemoryMappedPager::getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+                                       DimensionDescriptor startColumn, DimensionDescriptor startBand)
+{
+   VERIFYRV((mpDataDescriptor != NULL) && (!mMatrices.empty()) && pOriginalRequest != NULL, NULL);
+
+   unsigned int bandIndex = startBand.getActiveNumber();
+
+   if (pOriginalRequest->getWritable() == true && (mWritable == false || mSwapEndian == true))
+   {
+      return NULL;
+   }
+
+   if ((mInterleave == BSQ) && (mNumBands != 1) && (mMatrices.size() != 1))
+   {
+      VERIFYRV(pOriginalRequest->getStopBand().getActiveNumber() < mMatrices.size(), NULL);
+   }
 
-   //get the MemoryMappedMatrixView of a let segmentSize large
-   MemoryMappedMatrixView* pView = NULL;
    MemoryMappedMatrix* pMatrix = mMatrices.front();
    if (mMatrices.size() > 1)
    {
       VERIFYRV(bandIndex < mMatrices.size(), NULL);
       pMatrix = mMatrices[bandIndex];
+      bandIndex = 0;
    }
    VERIFYRV(pMatrix != NULL, NULL);
-   pView = pMatrix->getView(segmentSize);
+
+   unsigned int numRows = pOriginalRequest->getConcurrentRows();
+   size_t segmentSize = static_cast<size_t>(numRows) * mRowSize;
+   unsigned int row = startRow.getActiveNumber() + mOffsetRow;
+   unsigned int column = startColumn.getActiveNumber() + mOffsetColumn;
+
+   // reading in the file's interleave walks forward through the file,
+   // while converting to another interleave jumps between bands or rows
+   bool sequential = (mNumBands == 1 || pOriginalRequest->getInterleaveFormat() == mInterleave);
+
+   if (mFileMapped)
+   {
+      // the whole file is already mapped, so the page is just an address in the mapping
+      unsigned char* pRawData = pMatrix->getFileSegment(row, column, bandIndex);
+      if (pRawData == NULL)
+      {
+         return NULL;
+      }
+
+      // only the rows of this page are advised, so accessors with other patterns keep their own hints
+      size_t available = static_cast<size_t>(pMatrix->getEndOfFile() - pRawData);
+      MemoryMappedMatrix::adviseAccess(pRawData, min(segmentSize, available), sequential);
+      if (sequential && numRows > 1)
+      {
+         MemoryMappedMatrix::adviseWillNeed(pRawData, min(segmentSize, available));
+      }
+      else if (sequential == false && mInterleave == BSQ && mMatrices.size() == 1)
+      {
+         // the page reads the same rows from every band
+         for (unsigned int band = 0; band < mNumBands; ++band)
+         {
+            unsigned char* pBandData = pMatrix->getFileSegment(row, column, band);
+            if (band != bandIndex && pBandData != NULL)
+            {
+               available = static_cast<size_t>(pMatrix->getEndOfFile() - pBandData);
+               MemoryMappedMatrix::adviseAccess(pBandData, min(segmentSize, available), false);
+            }
+         }
+      }
+
+      return createPage(reinterpret_cast<char*>(pRawData), NULL, pMatrix->getEndOfFile(), numRows);
+   }
+
+   //ensure only one thread creates a view at a time
+   mta::MutexLock mutex(mMutex);
+
+   //get the MemoryMappedMatrixView of a let segmentSize large
+   MemoryMappedMatrixView* pView = pMatrix->getView(segmentSize);
    VERIFYRV(pView != NULL, NULL);
 
    //ask the MemoryMappedMatrixView for a pointer starting
    //at the given location
-   if (mMatrices.size() > 1)
-   {
-      bandIndex = 0;
-   }
-   char* pRawCubePointer = reinterpret_cast<char*>(pView->getSegment(startRow.getActiveNumber() + offsetRow,
-                                                   startColumn.getActiveNumber() + offsetCol, bandIndex));
+   char* pRawCubePointer = reinterpret_cast<char*>(pView->getSegment(row, column, bandIndex));
    if (pRawCubePointer == NULL)
    {
+      pMatrix->release(pView);
+      delete pView;
       return NULL;
    }
 
+   MemoryMappedMatrix::adviseAccess(reinterpret_cast<unsigned char*>(pRawCubePointer),
+      static_cast<size_t>(pView->getEndOfSegment() - reinterpret_cast<unsigned char*>(pRawCubePointer)), sequential);
+
    //we know have a pointer in raw memory that has
    //been memory mapped, so now create a RasterPage
    //and return it.
-   MemoryMappedPage* pPage = new MemoryMappedPage;
-   pPage->setRawData(pRawCubePointer);
-   pPage->setMemoryMappedMatrixView(pView);
-   pPage->setNumRows(numRows);
-   pPage->setNumColumns(numColumns);
-   pPage->setInterlineBytes(interlineBytes);
-
    if (mSwapEndian)
    {
-      EndianSwapPage* pEndianPage = new EndianSwapPage(pPage->getRawData(), mpDataDescriptor->getDataType(),
-                                                       numRows, numColumns, rowSize - interlineBytes, interlineBytes,
-                                                       pPage->getMemoryMappedMatrixView()->getEndOfSegment());
-
       pMatrix->release(pView);
-      delete pPage;
+      return createPage(pRawCubePointer, pView, pView->getEndOfSegment(), numRows);
+   }
+
+   MemoryMappedPage* pPage = static_cast<MemoryMappedPage*>(
+      createPage(pRawCubePointer, pView, pView->getEndOfSegment(), numRows));
+   mCurrentlyLeasedPages[pPage] = pMatrix;
+
+   return pPage;
+}
+
+RasterPage* MemoryMappedPager::createPage(char* pRawData, MemoryMappedMatrixView* pView,
+                                          unsigned char* pEndOfData, unsigned int numRows)
+{
+   if (mSwapEndian)
+   {
+      // the swapped page holds a copy of the data, so the view is no longer needed
+      EndianSwapPage* pEndianPage = new EndianSwapPage(pRawData, mpDataDescriptor->getDataType(),
+         numRows, mNumColumns, mRowSize - mInterlineBytes, mInterlineBytes, pEndOfData);
+      delete pView;
 
       return pEndianPage;
    }
 
-   mCurrentlyLeasedPages[pPage] = pMatrix;
+   MemoryMappedPage* pPage = new MemoryMappedPage;
+   pPage->setRawData(pRawData);
+   pPage->setMemoryMappedMatrixView(pView);
+   pPage->setNumRows(numRows);
+   pPage->setNumColumns(mNumColumns);
+   pPage->setInterlineBytes(mInterlineBytes);
 
    return pPage;
 }
@@ -445,35 +516,40 @@ void MemoryMappedPager::releasePage(RasterPage* pPage)
 {
    VERIFYNRV(pPage != NULL);
 
-   //ensure only one thread enters this code at a time
-   mta::MutexLock mutex(mMutex);
-
    if (mSwapEndian)
    {
       delete static_cast<EndianSwapPage*>(pPage);
+      return;
    }
-   else
+
+   MemoryMappedPage* pOurPage = static_cast<MemoryMappedPage*>(pPage);
+   if (pOurPage->getMemoryMappedMatrixView() == NULL)
    {
-      MemoryMappedPage* pOurPage = static_cast<MemoryMappedPage*>(pPage);
+      // pages in the whole file mapping own no resources
+      delete pOurPage;
+      return;
+   }
 
-      map<MemoryMappedPage*, MemoryMappedMatrix*>::iterator foundIter;
-      foundIter = mCurrentlyLeasedPages.find(pOurPage);
-      if (foundIter != mCurrentlyLeasedPages.end())
-      {
-         //we leased the page out from this instance,
-         //so now we can release the resources used for it.
-         
-         //destroy the memory mapped section of the file
-         //associated with that page
-         foundIter->second->release(pOurPage->getMemoryMappedMatrixView());
-
-         //remove the page from the vector
-         mCurrentlyLeasedPages.erase(foundIter);
-         
-         //delete the actual page that we allocated earlier
-         //in the getPage() method.
-         delete pOurPage;
-      }
+   //ensure only one thread enters this code at a time
+   mta::MutexLock mutex(mMutex);
+
+   map<MemoryMappedPage*, MemoryMappedMatrix*>::iterator foundIter;
+   foundIter = mCurrentlyLeasedPages.find(pOurPage);
+   if (foundIter != mCurrentlyLeasedPages.end())
+   {
+      //we leased the page out from this instance,
+      //so now we can release the resources used for it.
+      
+      //destroy the memory mapped section of the file
+      //associated with that page
+      foundIter->second->release(pOurPage->getMemoryMappedMatrixView());
+
+      //remove the page from the vector
+      mCurrentlyLeasedPages.erase(foundIter);
+      
+      //delete the actual page that we allocated earlier
+      //in the getPage() method.
+      delete pOurPage;
    }
 }
 
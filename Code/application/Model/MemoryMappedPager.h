@@ -12,6 +12,7 @@
 #ifndef MEMORYMAPPEDPAGER_H
 #define MEMORYMAPPEDPAGER_H
 
+#include "ConfigurationSettings.h"
 #include "RasterPagerShell.h"
 #include "DMutex.h"
 
@@ -25,6 +26,8 @@ class MemoryMappedMatrix;
 class MemoryMappedPager : public RasterPagerShell
 {
 public:
+   SETTING(MapWholeFile, MemoryMappedPager, bool, true)
+
    MemoryMappedPager();
    ~MemoryMappedPager();
 
@@ -44,6 +47,10 @@ public:
 
 
 private:
+   bool computeLayout();
+   RasterPage* createPage(char* pRawData, MemoryMappedMatrixView* pView, unsigned char* pEndOfData,
+      unsigned int numRows);
+
    bool mbUseDataDescriptor;
    const RasterDataDescriptor* mpDataDescriptor;
    bool mSwapEndian;
@@ -56,6 +63,18 @@ private:
    mta::DMutex                           mMutex;
 
    bool mWritable;
+
+   // True when every matrix maps its whole file, so pages are created without locking
+   bool mFileMapped;
+
+   // Layout of the data, computed once in execute()
+   InterleaveFormatType mInterleave;
+   unsigned int mNumBands;
+   unsigned int mNumColumns;
+   unsigned int mInterlineBytes;
+   unsigned int mOffsetRow;
+   unsigned int mOffsetColumn;
+   unsigned long mRowSize;
 };
 
 #endif
@@ -39,6 +39,12 @@
 #include <boost/bind.hpp>
 #include <queue>
 
+#if defined(WIN_API)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
 using namespace std;
 
 ModelServicesImp* ModelServicesImp::spInstance = NULL;
@@ -735,6 +741,15 @@ void ModelServicesImp::clear()
    mElements.clear();
 }
 
+namespace
+{
+   // Blocks at least this large are mapped from the operating system instead of allocated from the heap
+   const size_t MAPPED_BLOCK_SIZE = 1024 * 1024;
+
+   // Blocks at least this large are backed by transparent huge pages where the operating system supports it
+   const size_t HUGE_PAGE_BLOCK_SIZE = 64 * 1024 * 1024;
+}
+
 char* ModelServicesImp::getMemoryBlock(size_t size)
 {
    if (size == 0)
@@ -742,10 +757,44 @@ char* ModelServicesImp::getMemoryBlock(size_t size)
       return NULL;
    }
 
-   char* pBlock = new (nothrow) char[size];
+   // Small blocks are not worth a system call
+   if (size < MAPPED_BLOCK_SIZE)
+   {
+      char* pBlock = new (nothrow) char[size];
+      if (pBlock != NULL)
+      {
+         memset(pBlock, 0, size);
+      }
+
+      return pBlock;
+   }
+
+   // Large blocks are mapped directly from the operating system, which provides zeroed pages as they are
+   // first written.  Creating a block does not touch its memory, and each page is placed on the NUMA node
+   // of the thread which first writes it.
+#if defined(WIN_API)
+   char* pBlock = reinterpret_cast<char*>(VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+#else
+#if defined(MAP_ANONYMOUS)
+   const int anonymousFlag = MAP_ANONYMOUS;
+#else
+   const int anonymousFlag = MAP_ANON;
+#endif
+   void* pMapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | anonymousFlag, -1, 0);
+   char* pBlock = (pMapping == MAP_FAILED ? NULL : reinterpret_cast<char*>(pMapping));
+#if defined(MADV_HUGEPAGE)
+   if (pBlock != NULL && size >= HUGE_PAGE_BLOCK_SIZE)
+   {
+      // Only a hint: the block is still usable if transparent huge pages are not available
+      madvise(pBlock, size, MADV_HUGEPAGE);
+   }
+#endif
+#endif
+
    if (pBlock != NULL)
    {
-      memset(pBlock, 0, size);
+      mta::MutexLock lock(mMappedBlockMutex);
+      mMappedBlocks[pBlock] = size;
    }
 
    return pBlock;
@@ -753,7 +802,33 @@ char* ModelServicesImp::getMemoryBlock(size_t size)
 
 void ModelServicesImp::deleteMemoryBlock(char* memory)
 {
-   delete [] memory;
+   if (memory == NULL)
+   {
+      return;
+   }
+
+   size_t mappedSize = 0;
+   {
+      mta::MutexLock lock(mMappedBlockMutex);
+      map<char*, size_t>::iterator iter = mMappedBlocks.find(memory);
+      if (iter != mMappedBlocks.end())
+      {
+         mappedSize = iter->second;
+         mMappedBlocks.erase(iter);
+      }
+   }
+
+   if (mappedSize == 0)
+   {
+      delete [] memory;
+      return;
+   }
+
+#if defined(WIN_API)
+   VirtualFree(memory, 0, MEM_RELEASE);
+#else
+   munmap(memory, mappedSize);
+#endif
 }
 
 bool ModelServicesImp::isKindOfElement(const string& className, const string& elementName) const
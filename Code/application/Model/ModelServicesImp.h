@@ -13,12 +13,14 @@
 #include <xercesc/dom/DOM.hpp>
 
 #include "DataElement.h"
+#include "DMutex.h"
 #include "ModelServices.h"
 #include "SettableSessionItemAdapter.h"
 #include "StringUtilities.h"
 #include "SubjectImp.h"
 #include "XercesIncludes.h"
 
+#include <map>
 #include <vector>
 
 using XERCES_CPP_NAMESPACE_QUALIFIER DOMElement;
@@ -149,6 +151,10 @@ private:
    std::vector<std::string> mElementTypes;
    std::multimap<Key, DataElement*> mElements;
 
+   // Sizes of the blocks returned by getMemoryBlock() which were mapped from the operating system
+   std::map<char*, size_t> mMappedBlocks;
+   mta::DMutex mMappedBlockMutex;
+
    std::multimap<Key, DataElement*>::iterator findElement(const DataElement* pElement);
    std::multimap<Key, DataElement*>::iterator findElement(const Key& key, const std::string& type);
    std::multimap<Key, DataElement*>::const_iterator findElement(const Key& key, const std::string& type) const;
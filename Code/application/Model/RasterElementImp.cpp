@@ -20,7 +20,9 @@
 #include "FileResource.h"
 #include "Georeference.h"
 #include "Importer.h"
+#include "InterleaveConverterPager.h"
 #include "ModelServices.h"
+#include "MultiThreadedAlgorithm.h"
 #include "ObjectResource.h"
 #include "PlugInArg.h"
 #include "PlugInArgList.h"
@@ -34,15 +36,18 @@
 #include "RasterPage.h"
 #include "RasterPager.h"
 #include "RasterUtilities.h"
+#include "SessionBlockPager.h"
 #include "SessionItemDeserializer.h"
+#include "SessionItemDeserializerImp.h"
 #include "SessionItemSerializer.h"
+#include "SessionItemSerializerImp.h"
 #include "SessionManager.h"
 #include "StatisticsImp.h"
 #include "xmlwriter.h"
 
+#include <algorithm>
 #include <fstream>
 #include <limits>
-#include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 using namespace std;
 XERCES_CPP_NAMESPACE_USE
@@ -149,16 +154,22 @@ namespace
       return *(reinterpret_cast<const double*>(pValue) + iIndex);
    }
 
+   // The cube is saved to sessions in blocks of whole rows of about this many bytes
+   const size_t SESSION_BLOCK_SIZE = 4 * 1024 * 1024;
 };
 RasterElementImp::RasterElementImp(const DataDescriptorImp& descriptor, const string& id) :
    DataElementImp(descriptor, id),
    mpTerrain(NULL),
    mpPager(NULL),
+   mpRetiredPager(NULL),
    mpBipConverterPager(NULL),
    mpBilConverterPager(NULL),
    mpBsqConverterPager(NULL),
    mCubePointerAccessor(NULL, NULL),
    mModified(false),
+   mSessionBlockChanges(0),
+   mWritableAccessors(0),
+   mRawDataExposed(false),
    mpGeoPlugin(NULL)
 {
    RasterDataDescriptorImp* pDescriptor = dynamic_cast<RasterDataDescriptorImp*>(getDataDescriptor());
@@ -276,6 +287,11 @@ RasterElementImp::~RasterElementImp()
       pPluginManager->destroyPlugIn(dynamic_cast<PlugIn*>(mpPager));
    }
 
+   if (mpRetiredPager != NULL)
+   {
+      pPluginManager->destroyPlugIn(dynamic_cast<PlugIn*>(mpRetiredPager));
+   }
+
    if (mTempFilename.empty() == false)
    {
       remove(mTempFilename.c_str());
@@ -336,10 +352,23 @@ void RasterElementImp::updateData()
       }
    }
 
+   invalidateConvertedData();
    mModified = true;
+
+   // Writes through the cube pointer are not tracked, so every session block must be checked at the next save
+   if (mRawDataExposed)
+   {
+      markSessionBlocksModified();
+   }
+
    notify(SIGNAL_NAME(RasterElement, DataModified));
 }
 
+bool RasterElementImp::isDataModified() const
+{
+   return mModified;
+}
+
 uint64_t RasterElementImp::sanitizeData(double value)
 {
    uint64_t badValueCount = 0;
@@ -486,6 +515,15 @@ void RasterElementImp::getElementTypes(vector<string>& classList)
 
 void RasterElementImp::Deleter::operator()(DataAccessorImpl* pDataAccessor)
 {
+   if (pDataAccessor != NULL)
+   {
+      RasterElementImp* pElement = dynamic_cast<RasterElementImp*>(pDataAccessor->getAssociatedRasterElement());
+      if (pElement != NULL)
+      {
+         pElement->releaseAccessor(*pDataAccessor);
+      }
+   }
+
    delete pDataAccessor;
    delete this;
 }
@@ -1286,6 +1324,8 @@ bool RasterElementImp::setPager(RasterPager* pPager)
 
    //re-assign the pointers to hold onto the new plug-ins.
    mpPager = pPager;
+   invalidateConvertedData();
+   markSessionBlocksModified();
 
    return true;
 }
@@ -1295,6 +1335,43 @@ RasterPager* RasterElementImp::getPager() const
    return mpPager;
 }
 
+void RasterElementImp::invalidateConvertedData()
+{
+   if (mpBipConverterPager != NULL)
+   {
+      mpBipConverterPager->invalidate();
+   }
+
+   if (mpBilConverterPager != NULL)
+   {
+      mpBilConverterPager->invalidate();
+   }
+
+   if (mpBsqConverterPager != NULL)
+   {
+      mpBsqConverterPager->invalidate();
+   }
+}
+
+void RasterElementImp::invalidateConvertedData(unsigned int startRow, unsigned int stopRow, unsigned int startBand,
+                                               unsigned int stopBand)
+{
+   if (mpBipConverterPager != NULL)
+   {
+      mpBipConverterPager->invalidate(startRow, stopRow, startBand, stopBand);
+   }
+
+   if (mpBilConverterPager != NULL)
+   {
+      mpBilConverterPager->invalidate(startRow, stopRow, startBand, stopBand);
+   }
+
+   if (mpBsqConverterPager != NULL)
+   {
+      mpBsqConverterPager->invalidate(startRow, stopRow, startBand, stopBand);
+   }
+}
+
 const string& RasterElementImp::getTemporaryFilename() const
 {
    return mTempFilename;
@@ -1337,55 +1414,22 @@ bool RasterElementImp::serialize(SessionItemSerializer& serializer) const
       }
       xml.popAddPoint();
    }
-   if (!serializer.serialize(xml))
-   {
-      return false;
-   }
 
+   // Data which is unchanged from its file is imported again when the session is restored
    if (mModified || pDescriptor->getFileDescriptor() == NULL)
    {
-#pragma message(__FILE__ "(" STRING(__LINE__) ") : warning : Modify this to only save when necessary (tclarke)")
-      //mModified = false;
-
-      // serialize the cube
-      serializer.endBlock();
-      int64_t datasetSize = static_cast<int64_t>(pDescriptor->getRowCount()) *
-         pDescriptor->getColumnCount() *
-         pDescriptor->getBandCount() *
-         pDescriptor->getBytesPerElement();
-      serializer.reserve(datasetSize);
+      SessionItemSerializerImp* pSerializer = dynamic_cast<SessionItemSerializerImp*>(&serializer);
+      VERIFY(pSerializer != NULL);
 
-      // if the entire thing is contiguous so use a single serialize
-      const void* pRawData = getRawData();
-      if (pRawData != NULL)
+      xml.pushAddPoint(xml.addElement("SessionBlocks"));
+      if (!serializeSessionBlocks(*pSerializer, xml))
       {
-         return serializer.serialize(pRawData, datasetSize);
-      }
-
-      // write out all the data a row at a time
-      unsigned int totalOuterBands = (pDescriptor->getInterleaveFormat() == BSQ) ? pDescriptor->getBandCount() : 1;
-      for (unsigned int outerBand = 0; outerBand < totalOuterBands; ++outerBand)
-      {
-         // Get a data accessor with an entire concurrent row
-         FactoryResource<DataRequest> pRequest;
-#pragma message(__FILE__ "(" STRING(__LINE__) ") : warning : fix this when there's a getNextBand() (tclarke)")
-         // since there's not getNextBand() we need to request only 1 band for BSQ
-         if (pDescriptor->getInterleaveFormat() == BSQ)
-         {
-            pRequest->setBands(pDescriptor->getActiveBand(outerBand), pDescriptor->getActiveBand(outerBand), 1);
-         }
-         DataAccessor acc = getDataAccessor(pRequest.release());
-         for (unsigned int row = 0; row < pDescriptor->getRowCount(); ++row)
-         {
-            if (!acc.isValid() || !serializer.serialize(acc->getRow(), acc->getRowSize()))
-            {
-               return false;
-            }
-            acc->nextRow();
-         }
+         return false;
       }
+      xml.popAddPoint();
    }
-   return true;
+
+   return serializer.serialize(xml);
 }
 
 bool RasterElementImp::deserialize(SessionItemDeserializer& deserializer)
@@ -1413,6 +1457,7 @@ bool RasterElementImp::deserialize(SessionItemDeserializer& deserializer)
       setDisplayName(A(pRoot->getAttribute(X("displayName"))));
       mStatistics.clear();
       const RasterDataDescriptorImp* pDataDesc = static_cast<RasterDataDescriptorImp*>(getDataDescriptor());
+      DOMNode* pBlocks = NULL;
       for (DOMNode *pNode = pRoot->getFirstChild(); pNode != NULL; pNode = pNode->getNextSibling())
       {
          if (XMLString::equals(pNode->getNodeName(), X("DataDescriptor")))
@@ -1441,9 +1486,24 @@ bool RasterElementImp::deserialize(SessionItemDeserializer& deserializer)
             }
             mStatistics[bandDesc] = pStatistics;
          }
+         else if (XMLString::equals(pNode->getNodeName(), X("SessionBlocks")))
+         {
+            pBlocks = pNode;
+         }
       }
 
-      if (deserializer.getBlockSizes().size() > 1)
+      if (pBlocks != NULL)
+      {
+         SessionItemDeserializerImp* pDeserializer = dynamic_cast<SessionItemDeserializerImp*>(&deserializer);
+         if (pDeserializer == NULL || !deserializeSessionBlocks(*pDeserializer, pBlocks))
+         {
+            return false;
+         }
+
+         // The restored data may differ from the original file, so it must be saved with the next session
+         mModified = true;
+      }
+      else if (deserializer.getBlockSizes().size() > 1)
       {
          int64_t cubeSize = deserializer.getBlockSizes()[1];
          deserializer.nextBlock();
@@ -1517,11 +1577,455 @@ bool RasterElementImp::deserialize(SessionItemDeserializer& deserializer)
    return true;
 }
 
+unsigned int RasterElementImp::getSessionBlockRows() const
+{
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(getDataDescriptor());
+   VERIFYRV(pDescriptor != NULL, 1);
+
+   size_t rowBytes = static_cast<size_t>(pDescriptor->getColumnCount()) * pDescriptor->getBytesPerElement();
+   if (pDescriptor->getInterleaveFormat() != BSQ)
+   {
+      rowBytes *= pDescriptor->getBandCount();
+   }
+
+   if (rowBytes == 0)
+   {
+      return 1;
+   }
+
+   size_t rows = min(max(SESSION_BLOCK_SIZE / rowBytes, static_cast<size_t>(1)),
+      static_cast<size_t>(max(pDescriptor->getRowCount(), 1U)));
+   return static_cast<unsigned int>(rows);
+}
+
+void RasterElementImp::markSessionBlocksModified()
+{
+   mta::MutexLock lock(mSessionBlockMutex);
+   mSessionBlocks.clear();
+   ++mSessionBlockChanges;
+}
+
+void RasterElementImp::markSessionBlocksModified(unsigned int startRow, unsigned int stopRow, unsigned int startBand,
+                                                 unsigned int stopBand)
+{
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(getDataDescriptor());
+   VERIFYNRV(pDescriptor != NULL);
+
+   // BIP and BIL blocks hold every band of their rows, while BSQ blocks hold the rows of a single band
+   unsigned int rowsPerBlock = getSessionBlockRows();
+   unsigned int rowBlocks = (pDescriptor->getRowCount() + rowsPerBlock - 1) / rowsPerBlock;
+   unsigned int bandBlocks = 1;
+   if (pDescriptor->getInterleaveFormat() == BSQ)
+   {
+      bandBlocks = pDescriptor->getBandCount();
+   }
+   else
+   {
+      startBand = 0;
+      stopBand = 0;
+   }
+
+   // Writable accessors on several threads may mark their blocks at the same time
+   mta::MutexLock lock(mSessionBlockMutex);
+   ++mSessionBlockChanges;
+   if (mSessionBlocks.empty())
+   {
+      return;
+   }
+
+   if (mSessionBlocks.size() != static_cast<size_t>(rowBlocks) * bandBlocks || stopRow < startRow ||
+      stopBand < startBand || stopRow / rowsPerBlock >= rowBlocks || stopBand >= bandBlocks)
+   {
+      mSessionBlocks.clear();
+      return;
+   }
+
+   for (unsigned int band = startBand; band <= stopBand; ++band)
+   {
+      for (unsigned int block = startRow / rowsPerBlock; block <= stopRow / rowsPerBlock; ++block)
+      {
+         mSessionBlocks[band * rowBlocks + block].clear();
+      }
+   }
+}
+
+void RasterElementImp::releaseAccessor(DataAccessorImpl& da)
+{
+   if (da.mpRequest->getWritable() == false)
+   {
+      return;
+   }
+
+   // The accessor may have written its rows after a save took its copy of the block names, so the rows are
+   // marked again before the accessor stops being counted
+   markSessionBlocksModified(da.mpRequest->getStartRow().getActiveNumber(),
+      da.mpRequest->getStopRow().getActiveNumber(), da.mpRequest->getStartBand().getActiveNumber(),
+      da.mpRequest->getStopBand().getActiveNumber());
+
+   mta::MutexLock lock(mSessionBlockMutex);
+   if (mWritableAccessors > 0)
+   {
+      --mWritableAccessors;
+   }
+}
+
+bool RasterElementImp::serializeSessionBlocks(SessionItemSerializerImp& serializer, XMLWriter& xml) const
+{
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(getDataDescriptor());
+   VERIFY(pDescriptor != NULL);
+
+   unsigned int numRows = pDescriptor->getRowCount();
+   unsigned int rowsPerBlock = getSessionBlockRows();
+   unsigned int rowBlocks = (numRows + rowsPerBlock - 1) / rowsPerBlock;
+   unsigned int bandBlocks = 1;
+   size_t rowBytes = static_cast<size_t>(pDescriptor->getColumnCount()) * pDescriptor->getBytesPerElement();
+   if (pDescriptor->getInterleaveFormat() == BSQ)
+   {
+      bandBlocks = pDescriptor->getBandCount();
+   }
+   else
+   {
+      rowBytes *= pDescriptor->getBandCount();
+   }
+
+   // Blocks which have not been modified since the last save are only written if they are
+   // missing from the session directory, such as when the session is saved to a new location.
+   // The names are updated in a copy so that accessors can mark blocks modified during the save.
+   vector<string> blocks;
+   unsigned int changes = 0;
+   {
+      mta::MutexLock lock(mSessionBlockMutex);
+      blocks = mSessionBlocks;
+      changes = mSessionBlockChanges;
+   }
+
+   if (blocks.size() != static_cast<size_t>(rowBlocks) * bandBlocks)
+   {
+      blocks.assign(static_cast<size_t>(rowBlocks) * bandBlocks, string());
+   }
+
+   xml.addAttr("rowsPerBlock", rowsPerBlock);
+
+   // Blocks are hashed and written concurrently in batches, which also bounds the memory used for
+   // blocks that must be copied out of the pager
+   const size_t batchSize = max(2U, 2 * mta::getWorkerCount());
+   const char* pCube = reinterpret_cast<const char*>(getRawData());
+   vector<vector<char> > buffers(pCube == NULL ? batchSize : 0);
+   vector<SessionItemSerializerImp::SharedBlock> batch;
+   vector<unsigned int> batchIndices;
+   unsigned int totalBlocks = rowBlocks * bandBlocks;
+   for (unsigned int index = 0; index < totalBlocks; ++index)
+   {
+      unsigned int band = index / rowBlocks;
+      unsigned int startRow = (index % rowBlocks) * rowsPerBlock;
+      unsigned int blockRows = min(rowsPerBlock, numRows - startRow);
+      int64_t blockBytes = static_cast<int64_t>(blockRows) * rowBytes;
+
+      const string& name = blocks[index];
+      if (name.empty() || serializer.referenceSharedBlock(name, blockBytes) == false)
+      {
+         SessionItemSerializerImp::SharedBlock sharedBlock;
+         sharedBlock.mSize = blockBytes;
+         if (pCube != NULL)
+         {
+            sharedBlock.mpData = pCube + (static_cast<int64_t>(band) * numRows + startRow) * rowBytes;
+         }
+         else
+         {
+            FactoryResource<DataRequest> pRequest;
+            pRequest->setRows(pDescriptor->getActiveRow(startRow),
+               pDescriptor->getActiveRow(startRow + blockRows - 1), 1);
+            if (pDescriptor->getInterleaveFormat() == BSQ)
+            {
+               pRequest->setBands(pDescriptor->getActiveBand(band), pDescriptor->getActiveBand(band), 1);
+            }
+
+            DataAccessor acc = getDataAccessor(pRequest.release());
+            vector<char>& buffer = buffers[batch.size()];
+            buffer.resize(static_cast<size_t>(blockBytes));
+            for (unsigned int row = 0; row < blockRows; ++row)
+            {
+               if (!acc.isValid())
+               {
+                  return false;
+               }
+
+               memcpy(&buffer[row * rowBytes], acc->getRow(), rowBytes);
+               acc->nextRow();
+            }
+
+            sharedBlock.mpData = &buffer.front();
+         }
+
+         batch.push_back(sharedBlock);
+         batchIndices.push_back(index);
+      }
+
+      if (batch.size() == batchSize || (index + 1 == totalBlocks && batch.empty() == false))
+      {
+         bool success = serializer.serializeSharedBlocks(batch);
+         for (unsigned int i = 0; i < batch.size(); ++i)
+         {
+            blocks[batchIndices[i]] = success ? batch[i].mName : string();
+         }
+
+         if (success == false)
+         {
+            return false;
+         }
+
+         batch.clear();
+         batchIndices.clear();
+         serializer.updateProgress(index + 1, totalBlocks);
+      }
+   }
+
+   for (vector<string>::const_iterator iter = blocks.begin(); iter != blocks.end(); ++iter)
+   {
+      xml.addAttr("file", *iter, xml.addElement("block"));
+   }
+
+   // A block written while it was being saved may not match its saved contents, so the saved names are only
+   // kept if nothing was marked modified during the save and no writable accessor is still open
+   mta::MutexLock lock(mSessionBlockMutex);
+   if (mSessionBlockChanges == changes && mWritableAccessors == 0)
+   {
+      mSessionBlocks.swap(blocks);
+   }
+   else
+   {
+      mSessionBlocks.clear();
+   }
+
+   return true;
+}
+
+bool RasterElementImp::deserializeSessionBlocks(SessionItemDeserializerImp& deserializer, DOMNode* pBlocks)
+{
+   VERIFY(pBlocks != NULL);
+
+   vector<string> blocks;
+   vector<string> filenames;
+   for (DOMNode* pNode = pBlocks->getFirstChild(); pNode != NULL; pNode = pNode->getNextSibling())
+   {
+      if (XMLString::equals(pNode->getNodeName(), X("block")))
+      {
+         blocks.push_back(A(static_cast<DOMElement*>(pNode)->getAttribute(X("file"))));
+         filenames.push_back(deserializer.getSharedBlockFilename(blocks.back()));
+      }
+   }
+
+   unsigned int rowsPerBlock = StringUtilities::fromXmlString<unsigned int>(
+      A(static_cast<DOMElement*>(pBlocks)->getAttribute(X("rowsPerBlock"))));
+   if (rowsPerBlock == 0)
+   {
+      return false;
+   }
+
+   // The data is mapped from the session files when it is accessed.  Blocks saved with a different
+   // block size are copied now and written again at the next save.
+   if (rowsPerBlock != getSessionBlockRows())
+   {
+      return copySessionBlocks(filenames, rowsPerBlock);
+   }
+
+   if (!createSessionBlockPager(filenames, rowsPerBlock))
+   {
+      return false;
+   }
+
+   mta::MutexLock lock(mSessionBlockMutex);
+   mSessionBlocks.swap(blocks);
+   return true;
+}
+
+bool RasterElementImp::createSessionBlockPager(const vector<string>& filenames, unsigned int rowsPerBlock)
+{
+   ExecutableResource pPlugin("Session Block Pager");
+   VERIFY(pPlugin->getPlugIn() != NULL);
+
+   RasterPager* pPager = dynamic_cast<RasterPager*>(pPlugin->getPlugIn());
+   VERIFY(pPager != NULL);
+
+   vector<string> blockFiles = filenames;
+   VERIFY(pPlugin->getInArgList().setPlugInArgValue("Raster Element", dynamic_cast<RasterElement*>(this)));
+   VERIFY(pPlugin->getInArgList().setPlugInArgValue("Block Files", &blockFiles));
+   VERIFY(pPlugin->getInArgList().setPlugInArgValue("Rows Per Block", &rowsPerBlock));
+   if (pPlugin->execute() == false)
+   {
+      return false;
+   }
+
+   VERIFY(setPager(pPager));
+
+   pPlugin->releasePlugIn();
+
+   return true;
+}
+
+bool RasterElementImp::copySessionBlocks(const vector<string>& filenames, unsigned int rowsPerBlock,
+                                         SessionBlockPager* pSource)
+{
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(getDataDescriptor());
+   VERIFY(pDescriptor != NULL && rowsPerBlock > 0);
+
+   unsigned int numRows = pDescriptor->getRowCount();
+   unsigned int rowBlocks = (numRows + rowsPerBlock - 1) / rowsPerBlock;
+   unsigned int bandBlocks = 1;
+   size_t rowBytes = static_cast<size_t>(pDescriptor->getColumnCount()) * pDescriptor->getBytesPerElement();
+   if (pDescriptor->getInterleaveFormat() == BSQ)
+   {
+      bandBlocks = pDescriptor->getBandCount();
+   }
+   else
+   {
+      rowBytes *= pDescriptor->getBandCount();
+   }
+
+   if (filenames.size() != static_cast<size_t>(rowBlocks) * bandBlocks)
+   {
+      return false;
+   }
+
+   if (!createDefaultPager())
+   {
+      // should never have on-disk read-only data saved to the session
+      return false;
+   }
+
+   char* pCube = reinterpret_cast<char*>(getCubePointer());
+   vector<char> buffer;
+   for (unsigned int band = 0; band < bandBlocks; ++band)
+   {
+      for (unsigned int block = 0; block < rowBlocks; ++block)
+      {
+         unsigned int startRow = block * rowsPerBlock;
+         unsigned int blockRows = min(rowsPerBlock, numRows - startRow);
+         int64_t blockBytes = static_cast<int64_t>(blockRows) * rowBytes;
+
+         char* pBlock = NULL;
+         if (pCube != NULL)
+         {
+            pBlock = pCube + (static_cast<int64_t>(band) * numRows + startRow) * rowBytes;
+         }
+         else
+         {
+            buffer.resize(static_cast<size_t>(blockBytes));
+            pBlock = &buffer.front();
+         }
+
+         if (pSource != NULL)
+         {
+            if (pSource->copyBlock(band * rowBlocks + block, pBlock) == false)
+            {
+               return false;
+            }
+         }
+         else
+         {
+            LargeFileResource blockFile;
+            if (!blockFile.open(filenames[band * rowBlocks + block], O_RDONLY | O_BINARY, S_IREAD) ||
+               blockFile.read(pBlock, blockBytes) != blockBytes)
+            {
+               return false;
+            }
+         }
+
+         if (pCube != NULL)
+         {
+            continue;
+         }
+
+         FactoryResource<DataRequest> pRequest;
+         pRequest->setRows(pDescriptor->getActiveRow(startRow),
+            pDescriptor->getActiveRow(startRow + blockRows - 1), 1);
+         if (pDescriptor->getInterleaveFormat() == BSQ)
+         {
+            pRequest->setBands(pDescriptor->getActiveBand(band), pDescriptor->getActiveBand(band), 1);
+         }
+         pRequest->setWritable(true);
+
+         DataAccessor acc = getDataAccessor(pRequest.release());
+         for (unsigned int row = 0; row < blockRows; ++row)
+         {
+            if (!acc.isValid())
+            {
+               return false;
+            }
+
+            memcpy(acc->getRow(), pBlock + row * rowBytes, rowBytes);
+            acc->nextRow();
+         }
+      }
+   }
+
+   return true;
+}
+
+void RasterElementImp::getMappedSessionBlocks(vector<string>& filenames)
+{
+   mta::MutexLock lock(mPagerMutex);
+   RasterPager* pPagers[] = { mpPager, mpRetiredPager };
+   for (unsigned int i = 0; i < sizeof(pPagers) / sizeof(pPagers[0]); ++i)
+   {
+      SessionBlockPager* pSessionPager = dynamic_cast<SessionBlockPager*>(pPagers[i]);
+      if (pSessionPager != NULL)
+      {
+         const vector<string>& blockFiles = pSessionPager->getBlockFilenames();
+         filenames.insert(filenames.end(), blockFiles.begin(), blockFiles.end());
+      }
+   }
+}
+
+bool RasterElementImp::detachSessionBlockPager()
+{
+   // Accessors created on other threads must not see the pager while it is being replaced.  The copy
+   // creates accessors on this thread, which is why the mutex is recursive.
+   mta::MutexLock lock(mPagerMutex);
+   SessionBlockPager* pSessionPager = dynamic_cast<SessionBlockPager*>(mpPager);
+   if (pSessionPager == NULL)
+   {
+      return true;
+   }
+
+   // Accessors may still hold pages from the session pager, so it is kept until the element is destroyed
+   vector<string> blocks;
+   {
+      mta::MutexLock blockLock(mSessionBlockMutex);
+      blocks = mSessionBlocks;
+   }
+
+   mCubePointerAccessor = DataAccessor(NULL, NULL);
+   mpPager = NULL;
+   // Blocks which have been written are only held by the pager, so the data is copied from it
+   if (copySessionBlocks(pSessionPager->getBlockFilenames(), pSessionPager->getRowsPerBlock(), pSessionPager) == false)
+   {
+      if (mpPager != NULL)
+      {
+         Service<PlugInManagerServices>()->destroyPlugIn(dynamic_cast<PlugIn*>(mpPager));
+      }
+
+      mCubePointerAccessor = DataAccessor(NULL, NULL);
+      mpPager = pSessionPager;
+      return false;
+   }
+
+   mpRetiredPager = pSessionPager;
+
+   // The copy holds the same data, so the blocks saved with the session are still current
+   mta::MutexLock blockLock(mSessionBlockMutex);
+   mSessionBlocks.swap(blocks);
+   return true;
+}
+
 void RasterElementImp::incrementDataAccessor(DataAccessorImpl& da)
 {
    VERIFYNRV (da.mpRasterPager != NULL);
    VERIFYNRV (da.mpRasterPager != NULL);
 
+   // The accessor keeps the pager it was created with, and a session pager which has been replaced is retired
+   // rather than destroyed, so a concurrent detachSessionBlockPager() can not invalidate it
+
    const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(getDataDescriptor());
    VERIFYNRV (pDescriptor != NULL);
 
@@ -1593,6 +2097,13 @@ void RasterElementImp::incrementDataAccessor(DataAccessorImpl& da)
       da.mpPage = NULL;
    }
 
+   // A writable accessor may be held across a session save, so each page it moves to is marked again
+   if (da.isValid() && da.mpRequest->getWritable())
+   {
+      markSessionBlocksModified(da.mAccessorRow, da.mAccessorRow + da.mConcurrentRows - 1,
+         da.mpRequest->getStartBand().getActiveNumber(), da.mpRequest->getStopBand().getActiveNumber());
+   }
+
    da.mpRasterPage = pPage;
 }
 
@@ -1635,47 +2146,67 @@ DataAccessor RasterElementImp::getDataAccessor(DataRequest* pRequestIn)
       return DataAccessor(NULL, NULL);
    }
 
-   if (createDefaultPager() == false)
-   {
-      return DataAccessor(NULL, NULL);
-   }
-
    unsigned int numRows = pDescriptor->getRowCount();
    unsigned int numColumns = pDescriptor->getColumnCount();
    unsigned int numBands = pDescriptor->getBandCount();
    unsigned int bytesPerElement = pDescriptor->getBytesPerElement();
 
-   InterleaveFormatType sourceInterleave = pDescriptor->getInterleaveFormat();
-   InterleaveFormatType interleave = pRequest->getInterleaveFormat();
-
-   RasterPager* pPager = mpPager;
-   if (interleave == BIP && (sourceInterleave == BSQ || sourceInterleave == BIL))
+   // The pager is chosen while no other thread can replace the session pager or create a converter pager
+   RasterPager* pPager = NULL;
+   bool sourcePager = false;
    {
-      if (mpBipConverterPager == NULL)
+      mta::MutexLock lock(mPagerMutex);
+
+      if (createDefaultPager() == false)
+      {
+         return DataAccessor(NULL, NULL);
+      }
+
+      InterleaveFormatType sourceInterleave = pDescriptor->getInterleaveFormat();
+      InterleaveFormatType interleave = pRequest->getInterleaveFormat();
+
+      pPager = mpPager;
+      if (interleave == BIP && (sourceInterleave == BSQ || sourceInterleave == BIL))
       {
-         mpBipConverterPager = new ConvertToBipPager(dynamic_cast<RasterElement*>(this));
+         if (mpBipConverterPager == NULL)
+         {
+            mpBipConverterPager = new ConvertToBipPager(dynamic_cast<RasterElement*>(this));
+         }
+         pPager = mpBipConverterPager;
       }
-      pPager = mpBipConverterPager;
-   }
-   else if (interleave == BSQ && (sourceInterleave == BIP || sourceInterleave == BIL))
-   {
-      if (mpBsqConverterPager == NULL)
+      else if (interleave == BSQ && (sourceInterleave == BIP || sourceInterleave == BIL))
       {
-         mpBsqConverterPager = new ConvertToBsqPager(dynamic_cast<RasterElement*>(this));
+         if (mpBsqConverterPager == NULL)
+         {
+            mpBsqConverterPager = new ConvertToBsqPager(dynamic_cast<RasterElement*>(this));
+         }
+         pPager = mpBsqConverterPager;
       }
-      pPager = mpBsqConverterPager;
-   }
-   else if (interleave == BIL && (sourceInterleave == BIP || sourceInterleave == BSQ))
-   {
-      if (mpBilConverterPager == NULL)
+      else if (interleave == BIL && (sourceInterleave == BIP || sourceInterleave == BSQ))
       {
-         mpBilConverterPager = new ConvertToBilPager(dynamic_cast<RasterElement*>(this));
+         if (mpBilConverterPager == NULL)
+         {
+            mpBilConverterPager = new ConvertToBilPager(dynamic_cast<RasterElement*>(this));
+         }
+         pPager = mpBilConverterPager;
+      }
+      else if ( interleave != sourceInterleave )
+      {
+         return DataAccessor(NULL, NULL);
+      }
+
+      sourcePager = (pPager == mpPager);
+
+      if (pRequest->getWritable())
+      {
+         // Data converted before the accessor writes to the raster element would be stale
+         unsigned int startRow = pRequest->getStartRow().getActiveNumber();
+         unsigned int stopRow = pRequest->getStopRow().getActiveNumber();
+         unsigned int startBand = pRequest->getStartBand().getActiveNumber();
+         unsigned int stopBand = pRequest->getStopBand().getActiveNumber();
+         invalidateConvertedData(startRow, stopRow, startBand, stopBand);
+         markSessionBlocksModified(startRow, stopRow, startBand, stopBand);
       }
-      pPager = mpBilConverterPager;
-   }
-   else if ( interleave != sourceInterleave )
-   {
-      return DataAccessor(NULL, NULL);
    }
 
    if (pPager == NULL)
@@ -1702,7 +2233,7 @@ DataAccessor RasterElementImp::getDataAccessor(DataRequest* pRequestIn)
          unsigned int numPageBands = pPage->getNumBands();
          unsigned int numPageInterlineBytes = pPage->getInterlineBytes();
 
-         if (pPager == mpPager)
+         if (sourcePager)
          {
             if (numPageColumns == 0)
             {
@@ -1787,6 +2318,11 @@ DataAccessor RasterElementImp::getDataAccessor(DataRequest* pRequestIn)
    if (pImpl != NULL)
    {
       pDeleter = new RasterElementImp::Deleter;
+      if (pImpl->mpRequest->getWritable())
+      {
+         mta::MutexLock lock(mSessionBlockMutex);
+         ++mWritableAccessors;
+      }
    }
 
    //return the DataAccessor
@@ -1952,11 +2488,30 @@ bool RasterElementImp::createDefaultPager()
 
 const void* RasterElementImp::getRawData() const
 {
-   return const_cast<RasterElementImp*>(this)->getRawData();
+   return const_cast<RasterElementImp*>(this)->getCubePointer();
 }
 
 void *RasterElementImp::getRawData()
 {
+   // The cube pointer may be used to write the data
+   if (detachSessionBlockPager() == false)
+   {
+      return NULL;
+   }
+
+   void* pData = getCubePointer();
+   if (pData != NULL)
+   {
+      mRawDataExposed = true;
+      markSessionBlocksModified();
+   }
+
+   return pData;
+}
+
+void* RasterElementImp::getCubePointer()
+{
+   mta::MutexLock lock(mPagerMutex);
    if (!mCubePointerAccessor.isValid())
    {
       const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(getDataDescriptor());
@@ -2117,22 +2672,16 @@ LocationType RasterElementImp::convertPixelToGeocoord(LocationType pixel, bool q
 vector<LocationType> RasterElementImp::convertPixelsToGeocoords(
    const vector<LocationType>& pixels, bool quick, bool* pAccurate) const
 {
-   vector<LocationType> geocoords;
-   
+   vector<LocationType> geocoords(pixels.size());
+
    if (pAccurate != NULL)
    {
-      bool bAccurate(false);
-      *pAccurate = true;
-      for (vector<LocationType>::const_iterator it = pixels.begin(); it != pixels.end(); ++it)
-      {
-         geocoords.push_back(convertPixelToGeocoord(*it, quick, &bAccurate));
-         *pAccurate = *pAccurate && bAccurate;
-      }
+      *pAccurate = (pixels.empty() || mpGeoPlugin != NULL);
    }
-   else
+
+   if (mpGeoPlugin != NULL && pixels.empty() == false)
    {
-      transform(pixels.begin(), pixels.end(), back_inserter(geocoords), 
-         boost::bind(&RasterElementImp::convertPixelToGeocoord, this, _1, quick, pAccurate));
+      mpGeoPlugin->pixelsToGeo(&pixels.front(), &geocoords.front(), pixels.size(), quick, pAccurate);
    }
 
    return geocoords;
@@ -2164,22 +2713,16 @@ LocationType RasterElementImp::convertGeocoordToPixel(LocationType geocoord, boo
 vector<LocationType> RasterElementImp::convertGeocoordsToPixels(
    const vector<LocationType>& geocoords, bool quick, bool* pAccurate) const
 {
-   vector<LocationType> pixels;
+   vector<LocationType> pixels(geocoords.size());
 
    if (pAccurate != NULL)
    {
-      bool bAccurate(false);
-      *pAccurate = true;
-      for (vector<LocationType>::const_iterator it = geocoords.begin(); it != geocoords.end(); ++it)
-      {
-         pixels.push_back(convertGeocoordToPixel(*it, quick, &bAccurate));
-         *pAccurate = *pAccurate && bAccurate;
-      }
+      *pAccurate = (geocoords.empty() || mpGeoPlugin != NULL);
    }
-   else
+
+   if (mpGeoPlugin != NULL && geocoords.empty() == false)
    {
-      transform(geocoords.begin(), geocoords.end(), std::back_inserter(pixels), 
-         boost::bind(&RasterElementImp::convertGeocoordToPixel, this, _1, quick, pAccurate));
+      mpGeoPlugin->geosToPixels(&geocoords.front(), &pixels.front(), geocoords.size(), quick, pAccurate);
    }
 
    return pixels;
@@ -14,13 +14,20 @@
 #include "DataAccessor.h"
 #include "DataElementImp.h"
 #include "DimensionDescriptor.h"
+#include "DMutex.h"
 #include "SafePtr.h"
 #include "StatisticsImp.h"
 #include "TypesFile.h"
 #include "ProgressAdapter.h"
 
+#include <string>
 #include <vector>
 
+class InterleaveConverterPager;
+class SessionBlockPager;
+class SessionItemDeserializerImp;
+class SessionItemSerializerImp;
+
 class RasterElementImp : public DataElementImp
 {
 public:
@@ -36,6 +43,7 @@ public:
    virtual void incrementDataAccessor(DataAccessorImpl &da);
    virtual void updateData();
    virtual uint64_t sanitizeData(double value = 0.0);
+   bool isDataModified() const;   // true once updateData() has been called
 
 
    void setTerrain(RasterElement* pTerrain);
@@ -57,9 +65,14 @@ public:
    bool setPager(RasterPager* pPager);
    RasterPager* getPager() const;
 
+   // Discards the data converted to other interleaves which overlaps the given active rows and bands
+   void invalidateConvertedData(unsigned int startRow, unsigned int stopRow, unsigned int startBand,
+      unsigned int stopBand);
+
    const std::string& getTemporaryFilename() const;
    bool serialize(SessionItemSerializer& serializer) const;
    bool deserialize(SessionItemDeserializer &deserializer);
+   void getMappedSessionBlocks(std::vector<std::string>& filenames);   // session files the element still reads
 
    bool toXml(XMLWriter* pXml) const;
    bool fromXml(DOMNode* pDocument, unsigned int version);
@@ -167,20 +180,51 @@ protected:
    };
 
 private:
+   void invalidateConvertedData();
+   void* getCubePointer();
+
+   unsigned int getSessionBlockRows() const;
+   void markSessionBlocksModified();
+   void markSessionBlocksModified(unsigned int startRow, unsigned int stopRow, unsigned int startBand,
+      unsigned int stopBand);
+   bool serializeSessionBlocks(SessionItemSerializerImp& serializer, XMLWriter& xml) const;
+   bool deserializeSessionBlocks(SessionItemDeserializerImp& deserializer, DOMNode* pBlocks);
+   bool createSessionBlockPager(const std::vector<std::string>& filenames, unsigned int rowsPerBlock);
+   bool copySessionBlocks(const std::vector<std::string>& filenames, unsigned int rowsPerBlock,
+      SessionBlockPager* pSource = NULL);
+   bool detachSessionBlockPager();
+   void releaseAccessor(DataAccessorImpl& da);
+
    SafePtr<RasterElement> mpTerrain;
    std::map<DimensionDescriptor, StatisticsImp*> mStatistics;
 
    std::string mTempFilename;
 
+   // Guards replacing the session pager against choosing a pager for a new accessor on another thread
+   mta::DRecursiveMutex mPagerMutex;
    RasterPager* mpPager;
-   RasterPager* mpBipConverterPager;
-   RasterPager* mpBilConverterPager;
-   RasterPager* mpBsqConverterPager;
+   RasterPager* mpRetiredPager;   // session pager replaced by a copy, kept for accessors which still use it
+   InterleaveConverterPager* mpBipConverterPager;
+   InterleaveConverterPager* mpBilConverterPager;
+   InterleaveConverterPager* mpBsqConverterPager;
 
    DataAccessor mCubePointerAccessor;
 
    mutable bool mModified;
 
+   // The shared session blocks holding the cube, where an empty name marks a block modified since the last save.
+   // The names are guarded by the mutex since writable accessors mark their blocks from any thread.  Writable
+   // accessors are counted so that a save does not keep names for blocks an open accessor may still write.
+   mutable mta::DMutex mSessionBlockMutex;
+   mutable std::vector<std::string> mSessionBlocks;
+   mutable unsigned int mSessionBlockChanges;
+   unsigned int mWritableAccessors;
+
+   // Set once the non-const getRawData() has returned the cube pointer.  Writes through the pointer can not be
+   // tracked and the pointer may be kept indefinitely, so from then on every updateData() marks all blocks
+   // modified.  Callers which only read the cube should use the const getRawData(), which does not set this.
+   bool mRawDataExposed;
+
    Georeference* mpGeoPlugin;
 };
 
@@ -0,0 +1,97 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+
+#include "AppConfig.h"
+#include "SessionBlockPage.h"
+
+SessionBlockPage::SessionBlockPage(unsigned int block, char* pData, unsigned int numRows) :
+   mBlock(block),
+   mpData(pData),
+   mNumRows(numRows),
+   mStartRow(0),
+   mBandBlock(0),
+   mWritable(false)
+{
+}
+
+SessionBlockPage::SessionBlockPage(std::vector<char>& data, size_t offset, unsigned int numRows,
+                                   unsigned int startRow, unsigned int bandBlock, bool writable) :
+   mBlock(0),
+   mpData(NULL),
+   mNumRows(numRows),
+   mStartRow(startRow),
+   mBandBlock(bandBlock),
+   mWritable(writable)
+{
+   mCopy.swap(data);
+   if (mCopy.empty() == false)
+   {
+      mpData = &mCopy[offset];
+   }
+}
+
+SessionBlockPage::~SessionBlockPage()
+{
+}
+
+void* SessionBlockPage::getRawData()
+{
+   return mpData;
+}
+
+unsigned int SessionBlockPage::getNumRows()
+{
+   return mNumRows;
+}
+
+unsigned int SessionBlockPage::getNumColumns()
+{
+   return 0;
+}
+
+unsigned int SessionBlockPage::getNumBands()
+{
+   return 0;
+}
+
+unsigned int SessionBlockPage::getInterlineBytes()
+{
+   return 0;
+}
+
+bool SessionBlockPage::isCopy() const
+{
+   return mCopy.empty() == false;
+}
+
+unsigned int SessionBlockPage::getBlock() const
+{
+   return mBlock;
+}
+
+bool SessionBlockPage::isWritable() const
+{
+   return mWritable;
+}
+
+unsigned int SessionBlockPage::getStartRow() const
+{
+   return mStartRow;
+}
+
+unsigned int SessionBlockPage::getBandBlock() const
+{
+   return mBandBlock;
+}
+
+const std::vector<char>& SessionBlockPage::getCopy() const
+{
+   return mCopy;
+}
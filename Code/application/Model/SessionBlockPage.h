@@ -0,0 +1,55 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+
+#ifndef SESSIONBLOCKPAGE_H
+#define SESSIONBLOCKPAGE_H
+
+#include "AppConfig.h"
+#include "RasterPage.h"
+
+#include <vector>
+
+class SessionBlockPage : public RasterPage
+{
+public:
+   // A page within a mapped session block
+   SessionBlockPage(unsigned int block, char* pData, unsigned int numRows);
+
+   // A page holding a copy of rows from several session blocks, which takes the contents of data.
+   // A writable copy is written back to the blocks when the page is released.
+   SessionBlockPage(std::vector<char>& data, size_t offset, unsigned int numRows, unsigned int startRow,
+      unsigned int bandBlock, bool writable);
+   ~SessionBlockPage();
+
+   void* getRawData();
+   unsigned int getNumRows();
+   unsigned int getNumColumns();
+   unsigned int getNumBands();
+   unsigned int getInterlineBytes();
+
+   bool isCopy() const;
+   unsigned int getBlock() const;
+
+   bool isWritable() const;
+   unsigned int getStartRow() const;
+   unsigned int getBandBlock() const;
+   const std::vector<char>& getCopy() const;
+
+private:
+   unsigned int mBlock;
+   char* mpData;
+   unsigned int mNumRows;
+   std::vector<char> mCopy;
+   unsigned int mStartRow;
+   unsigned int mBandBlock;
+   bool mWritable;
+};
+
+#endif
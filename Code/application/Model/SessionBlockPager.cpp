@@ -0,0 +1,386 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+
+#include "AppVersion.h"
+#include "AppVerify.h"
+#include "DataRequest.h"
+#include "FileResource.h"
+#include "MemoryMappedMatrix.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "SessionBlockPage.h"
+#include "SessionBlockPager.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string.h>
+using namespace std;
+
+namespace
+{
+   // Blocks with no leases stay mapped until this many are unused, so accessors which move back and
+   // forth between blocks do not map the same files repeatedly
+   const size_t MAX_UNUSED_BLOCKS = 64;
+}
+
+SessionBlockPager::SessionBlockPager() :
+   mpRaster(NULL),
+   mRowsPerBlock(0),
+   mRowBlocks(0),
+   mRowBytes(0)
+{
+   setName("Session Block Pager");
+   setCopyright("Copyright (2011) by Ball Aerospace & Technologies Corp.");
+   setCreator("Ball Aerospace & Technologies Corp.");
+   setDescription("Provides access to data in the shared blocks of a session");
+   setDescriptorId("{D51B5046-965D-4e79-8E64-DD56F0ED15F8}");
+   setVersion(APP_VERSION_NUMBER);
+   setProductionStatus(APP_IS_PRODUCTION_RELEASE);
+   setShortDescription("Maps restored session data");
+}
+
+SessionBlockPager::~SessionBlockPager()
+{
+   for (map<unsigned int, MappedBlock*>::iterator iter = mMappedBlocks.begin(); iter != mMappedBlocks.end(); ++iter)
+   {
+      delete iter->second->mpMatrix;
+      delete iter->second;
+   }
+}
+
+bool SessionBlockPager::getInputSpecification(PlugInArgList*& pArgList)
+{
+   Service<PlugInManagerServices> pPlugInMgr;
+
+   pArgList = pPlugInMgr->getPlugInArgList();
+   VERIFY(pArgList != NULL);
+
+   VERIFY(pArgList->addArg<RasterElement>("Raster Element"));
+   VERIFY(pArgList->addArg<vector<string> >("Block Files"));
+   VERIFY(pArgList->addArg<unsigned int>("Rows Per Block"));
+
+   return true;
+}
+
+bool SessionBlockPager::execute(PlugInArgList* pInput, PlugInArgList* pOutput)
+{
+   VERIFY(mpRaster == NULL && pInput != NULL);
+
+   mpRaster = pInput->getPlugInArgValue<RasterElement>("Raster Element");
+   vector<string>* pFilenames = pInput->getPlugInArgValue<vector<string> >("Block Files");
+   unsigned int* pRowsPerBlock = pInput->getPlugInArgValue<unsigned int>("Rows Per Block");
+   VERIFY(mpRaster != NULL && pFilenames != NULL && pRowsPerBlock != NULL && *pRowsPerBlock > 0);
+
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   VERIFY(pDescriptor != NULL);
+
+   // BIP and BIL blocks hold every band of their rows, while BSQ blocks hold the rows of a single band
+   mRowsPerBlock = *pRowsPerBlock;
+   mRowBlocks = (pDescriptor->getRowCount() + mRowsPerBlock - 1) / mRowsPerBlock;
+   mRowBytes = static_cast<size_t>(pDescriptor->getColumnCount()) * pDescriptor->getBytesPerElement();
+   unsigned int bandBlocks = 1;
+   if (pDescriptor->getInterleaveFormat() == BSQ)
+   {
+      bandBlocks = pDescriptor->getBandCount();
+   }
+   else
+   {
+      mRowBytes *= pDescriptor->getBandCount();
+   }
+
+   VERIFY(pFilenames->size() == static_cast<size_t>(mRowBlocks) * bandBlocks);
+   mBlockFilenames = *pFilenames;
+
+   return true;
+}
+
+RasterPage* SessionBlockPager::getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+                                       DimensionDescriptor startColumn, DimensionDescriptor startBand)
+{
+   VERIFYRV(mpRaster != NULL, NULL);
+   VERIFYRV(pOriginalRequest != NULL, NULL);
+
+   InterleaveFormatType requestedType = pOriginalRequest->getInterleaveFormat();
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   VERIFYRV(pDescriptor != NULL, NULL);
+   if (pDescriptor->getInterleaveFormat() != requestedType)
+   {
+      return NULL;
+   }
+
+   unsigned int numRows = pDescriptor->getRowCount();
+   unsigned int numColumns = pDescriptor->getColumnCount();
+   unsigned int numBands = pDescriptor->getBandCount();
+   unsigned int bytesPerElement = pDescriptor->getBytesPerElement();
+
+   unsigned int rowNumber = startRow.getActiveNumber();
+   unsigned int colNumber = startColumn.getActiveNumber();
+   unsigned int bandNumber = startBand.getActiveNumber();
+
+   if (rowNumber >= numRows || colNumber >= numColumns || bandNumber >= numBands)
+   {
+      return NULL;
+   }
+
+   size_t offset = 0;
+   unsigned int bandBlock = 0;
+   switch (requestedType)
+   {
+   case BIP:
+      offset = (static_cast<size_t>(colNumber) * numBands + bandNumber) * bytesPerElement;
+      break;
+   case BSQ:
+      offset = static_cast<size_t>(colNumber) * bytesPerElement;
+      bandBlock = bandNumber;
+      break;
+   case BIL:
+      offset = (static_cast<size_t>(bandNumber) * numColumns + colNumber) * bytesPerElement;
+      break;
+   default:
+      return NULL;
+   }
+
+   unsigned int rowInBlock = rowNumber % mRowsPerBlock;
+   unsigned int block = bandBlock * mRowBlocks + rowNumber / mRowsPerBlock;
+   unsigned int blockRows = min(mRowsPerBlock - rowInBlock, numRows - rowNumber);
+   unsigned int concurrentRows = min(max(pOriginalRequest->getConcurrentRows(), 1U), numRows - rowNumber);
+   bool writable = pOriginalRequest->getWritable();
+   if (concurrentRows <= blockRows)
+   {
+      char* pBlock = leaseBlock(block, writable);
+      if (pBlock == NULL)
+      {
+         return NULL;
+      }
+
+      return new SessionBlockPage(block, pBlock + rowInBlock * mRowBytes + offset, blockRows);
+   }
+
+   // The requested rows span several blocks, so they are copied into the page and written back when a writable
+   // page is released
+   vector<char> data(concurrentRows * mRowBytes);
+   for (unsigned int row = 0; row < concurrentRows; row += blockRows)
+   {
+      rowInBlock = (rowNumber + row) % mRowsPerBlock;
+      block = bandBlock * mRowBlocks + (rowNumber + row) / mRowsPerBlock;
+      blockRows = min(mRowsPerBlock - rowInBlock, concurrentRows - row);
+
+      const char* pBlock = leaseBlock(block, false);
+      if (pBlock == NULL)
+      {
+         return NULL;
+      }
+
+      memcpy(&data[row * mRowBytes], pBlock + rowInBlock * mRowBytes, blockRows * mRowBytes);
+      releaseBlock(block);
+   }
+
+   return new SessionBlockPage(data, offset, concurrentRows, rowNumber, bandBlock, writable);
+}
+
+void SessionBlockPager::releasePage(RasterPage* pPage)
+{
+   SessionBlockPage* pBlockPage = dynamic_cast<SessionBlockPage*>(pPage);
+   VERIFYNRV(pBlockPage != NULL);
+
+   if (pBlockPage->isCopy() == false)
+   {
+      releaseBlock(pBlockPage->getBlock());
+   }
+   else if (pBlockPage->isWritable())
+   {
+      const vector<char>& data = pBlockPage->getCopy();
+      unsigned int startRow = pBlockPage->getStartRow();
+      unsigned int numRows = pBlockPage->getNumRows();
+      unsigned int blockRows = 0;
+      for (unsigned int row = 0; row < numRows; row += blockRows)
+      {
+         unsigned int rowInBlock = (startRow + row) % mRowsPerBlock;
+         unsigned int block = pBlockPage->getBandBlock() * mRowBlocks + (startRow + row) / mRowsPerBlock;
+         blockRows = min(mRowsPerBlock - rowInBlock, numRows - row);
+
+         char* pBlock = leaseBlock(block, true);
+         if (pBlock != NULL)
+         {
+            memcpy(pBlock + rowInBlock * mRowBytes, &data[row * mRowBytes], blockRows * mRowBytes);
+            releaseBlock(block);
+         }
+      }
+   }
+
+   delete pBlockPage;
+}
+
+int SessionBlockPager::getSupportedRequestVersion() const
+{
+   return 1;
+}
+
+const vector<string>& SessionBlockPager::getBlockFilenames() const
+{
+   return mBlockFilenames;
+}
+
+unsigned int SessionBlockPager::getRowsPerBlock() const
+{
+   return mRowsPerBlock;
+}
+
+bool SessionBlockPager::copyBlock(unsigned int block, char* pData)
+{
+   VERIFY(pData != NULL);
+
+   const char* pBlock = leaseBlock(block, false);
+   if (pBlock == NULL)
+   {
+      return false;
+   }
+
+   size_t blockBytes = 0;
+   {
+      mta::MutexLock mutex(mMutex);
+      blockBytes = mMappedBlocks[block]->mSize;
+   }
+
+   memcpy(pData, pBlock, blockBytes);
+   releaseBlock(block);
+   return true;
+}
+
+char* SessionBlockPager::leaseBlock(unsigned int block, bool writable)
+{
+   VERIFYRV(block < mBlockFilenames.size(), NULL);
+
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   VERIFYRV(pDescriptor != NULL, NULL);
+
+   //ensure only one thread maps or unmaps a block at a time
+   mta::MutexLock mutex(mMutex);
+
+   map<unsigned int, MappedBlock*>::iterator iter = mMappedBlocks.find(block);
+   if (iter != mMappedBlocks.end())
+   {
+      MappedBlock* pMappedBlock = iter->second;
+      if (pMappedBlock->mLeases++ == 0)
+      {
+         mUnusedBlocks.remove(block);
+      }
+
+      if (writable && pMappedBlock->mWritten == false)
+      {
+         // Pages leased before the copy still point into the mapping, so it is unmapped once the block is no
+         // longer leased.  Those pages keep reading the saved data.
+         if (pMappedBlock->mpMatrix != NULL)
+         {
+            pMappedBlock->mData.assign(pMappedBlock->mpData, pMappedBlock->mpData + pMappedBlock->mSize);
+            pMappedBlock->mpData = &pMappedBlock->mData.front();
+         }
+
+         pMappedBlock->mWritten = true;
+      }
+
+      return pMappedBlock->mpData;
+   }
+
+   while (mUnusedBlocks.size() >= MAX_UNUSED_BLOCKS)
+   {
+      map<unsigned int, MappedBlock*>::iterator unused = mMappedBlocks.find(mUnusedBlocks.front());
+      if (unused != mMappedBlocks.end())
+      {
+         delete unused->second->mpMatrix;
+         delete unused->second;
+         mMappedBlocks.erase(unused);
+      }
+
+      mUnusedBlocks.pop_front();
+   }
+
+   unsigned int rowBlock = block % mRowBlocks;
+   unsigned int blockRows = min(mRowsPerBlock, pDescriptor->getRowCount() - rowBlock * mRowsPerBlock);
+   int64_t blockBytes = static_cast<int64_t>(blockRows) * mRowBytes;
+   const string& filename = mBlockFilenames[block];
+
+   auto_ptr<MappedBlock> pMappedBlock(new MappedBlock);
+   pMappedBlock->mpMatrix = NULL;
+   pMappedBlock->mpData = NULL;
+   pMappedBlock->mSize = static_cast<size_t>(blockBytes);
+   pMappedBlock->mLeases = 1;
+   pMappedBlock->mWritten = false;
+   try
+   {
+      // the block is mapped as a single row of bytes, since only its start is needed
+      pMappedBlock->mpMatrix = new MemoryMappedMatrix(filename, 0, BIP, 1, 1, static_cast<unsigned int>(blockBytes),
+         1, 0, 0, true);
+      if (pMappedBlock->mpMatrix->mapFile() &&
+         pMappedBlock->mpMatrix->getEndOfFile() - pMappedBlock->mpMatrix->getFileSegment(0, 0, 0) == blockBytes)
+      {
+         pMappedBlock->mpData = reinterpret_cast<char*>(pMappedBlock->mpMatrix->getFileSegment(0, 0, 0));
+      }
+   }
+   catch (const out_of_range&)
+   {
+      // fall through and read the block
+   }
+
+   if (pMappedBlock->mpData == NULL)
+   {
+      // 32-bit builds do not map whole files, so the block is read instead
+      delete pMappedBlock->mpMatrix;
+      pMappedBlock->mpMatrix = NULL;
+
+      LargeFileResource file;
+      if (blockBytes <= 0 || !file.open(filename, O_RDONLY | O_BINARY, S_IREAD))
+      {
+         return NULL;
+      }
+
+      pMappedBlock->mData.resize(static_cast<size_t>(blockBytes));
+      if (file.read(&pMappedBlock->mData.front(), blockBytes) != blockBytes)
+      {
+         return NULL;
+      }
+
+      pMappedBlock->mpData = &pMappedBlock->mData.front();
+   }
+   else if (writable)
+   {
+      pMappedBlock->mData.assign(pMappedBlock->mpData, pMappedBlock->mpData + pMappedBlock->mSize);
+      pMappedBlock->mpData = &pMappedBlock->mData.front();
+      delete pMappedBlock->mpMatrix;
+      pMappedBlock->mpMatrix = NULL;
+   }
+
+   pMappedBlock->mWritten = writable;
+   mMappedBlocks[block] = pMappedBlock.get();
+   return pMappedBlock.release()->mpData;
+}
+
+void SessionBlockPager::releaseBlock(unsigned int block)
+{
+   mta::MutexLock mutex(mMutex);
+
+   map<unsigned int, MappedBlock*>::iterator iter = mMappedBlocks.find(block);
+   if (iter != mMappedBlocks.end() && iter->second->mLeases > 0 && --iter->second->mLeases == 0)
+   {
+      MappedBlock* pMappedBlock = iter->second;
+      if (pMappedBlock->mWritten)
+      {
+         delete pMappedBlock->mpMatrix;
+         pMappedBlock->mpMatrix = NULL;
+      }
+      else
+      {
+         mUnusedBlocks.push_back(block);
+      }
+   }
+}
@@ -0,0 +1,78 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+
+#ifndef SESSIONBLOCKPAGER_H
+#define SESSIONBLOCKPAGER_H
+
+#include "DMutex.h"
+#include "RasterPagerShell.h"
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+class MemoryMappedMatrix;
+class RasterElement;
+
+/**
+ * Provides access to raster data stored in the shared blocks of a session.
+ *
+ * Each block file is mapped when a page first needs it, so a restored element does not read its
+ * data until the data is accessed.  The block files are never modified; a block is copied into
+ * memory when a writable page first needs it, and blocks which are never written stay mapped.
+ */
+class SessionBlockPager : public RasterPagerShell
+{
+public:
+   SessionBlockPager();
+   ~SessionBlockPager();
+
+   bool getInputSpecification(PlugInArgList*& pArgList);
+   bool execute(PlugInArgList* pInput, PlugInArgList* pOutput);
+
+   RasterPage* getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow, DimensionDescriptor startColumn,
+      DimensionDescriptor startBand);
+   void releasePage(RasterPage* pPage);
+
+   int getSupportedRequestVersion() const;
+
+   const std::vector<std::string>& getBlockFilenames() const;
+   unsigned int getRowsPerBlock() const;
+   bool copyBlock(unsigned int block, char* pData);   // copies the current contents of a block
+
+private:
+   char* leaseBlock(unsigned int block, bool writable);
+   void releaseBlock(unsigned int block);
+
+   // A block is either mapped or, if it cannot be mapped, read into memory.  A written block holds the only
+   // copy of its data, so it stays in memory until the pager is destroyed.
+   struct MappedBlock
+   {
+      MemoryMappedMatrix* mpMatrix;
+      std::vector<char> mData;
+      char* mpData;
+      size_t mSize;
+      unsigned int mLeases;
+      bool mWritten;
+   };
+
+   RasterElement* mpRaster;
+   std::vector<std::string> mBlockFilenames;
+   unsigned int mRowsPerBlock;
+   unsigned int mRowBlocks;
+   size_t mRowBytes;
+
+   std::map<unsigned int, MappedBlock*> mMappedBlocks;
+   std::list<unsigned int> mUnusedBlocks;   // mapped blocks with no leases, least recently used first
+   mta::DMutex mMutex;
+};
+
+#endif
@@ -640,18 +640,6 @@ void StatisticsImp::calculateStatistics(ComplexComponent component)
 
    StatisticsInput statInput(mBands, dynamic_cast<const RasterElement*>(mpRasterElement),
       component, mStatisticsResolution, mBadValues, mpAoi.get());
-   StatisticsOutput statOutput;
-
-   mta::StatusBarReporter barReporter("Computing statistics", "app", "CF884AA2-A1BF-468d-9609-795DE0F7B7A4");
-
-   std::vector<int> phaseWeights;
-   phaseWeights.push_back(20);
-   phaseWeights.push_back(80);
-   mta::MultiPhaseProgressReporter progressReporter(barReporter, phaseWeights);
-
-   mta::MultiThreadedAlgorithm<StatisticsInput, StatisticsOutput, StatisticsThread> statisticsAlgorithm
-      (getNumRequiredThreads(pDescriptor->getRowCount()), statInput, statOutput, &progressReporter);
-   statisticsAlgorithm.run();
 
    bool bInteger = true;
    EncodingType encoding = pDescriptor->getDataType();
@@ -662,25 +650,26 @@ void StatisticsImp::calculateStatistics(ComplexComponent component)
       bInteger = false;
    }
 
-   progressReporter.setCurrentPhase(1);
+   StatisticsOutput statOutput(bInteger);
 
-   if (statOutput.mMaxMinSet)
-   {
-      HistogramInput histInput(statInput, statOutput);
-      HistogramOutput histOutput(bInteger, statOutput.mMaximum, statOutput.mMinimum);
+   mta::StatusBarReporter barReporter("Computing statistics", "app", "CF884AA2-A1BF-468d-9609-795DE0F7B7A4");
 
-      mta::MultiThreadedAlgorithm<HistogramInput, HistogramOutput, HistogramThread> histogramAlgorithm
-         (getNumRequiredThreads(pDescriptor->getRowCount()), histInput, histOutput, &progressReporter);
+   // the moments and the histogram are computed together, so the data is only read once
+   mta::MultiThreadedAlgorithm<StatisticsInput, StatisticsOutput, StatisticsThread> statisticsAlgorithm
+      (getNumRequiredThreads(pDescriptor->getRowCount()), statInput, statOutput, &barReporter);
+   if (statisticsAlgorithm.run() != mta::SUCCESS)
+   {
+      return;
+   }
 
-      if (histogramAlgorithm.run() == mta::SUCCESS)
-      {
-         setMin(statOutput.mMinimum, component);
-         setMax(statOutput.mMaximum, component);
-         setAverage(statOutput.mAverage, component);
-         setStandardDeviation(statOutput.mStandardDeviation, component);
-         setPercentiles(histOutput.getPercentiles(), component);
-         setHistogram(histOutput.getBinCenters(), histOutput.getBinCounts(), component);
-      }
+   if (statOutput.mMaxMinSet)
+   {
+      setMin(statOutput.mMinimum, component);
+      setMax(statOutput.mMaximum, component);
+      setAverage(statOutput.mAverage, component);
+      setStandardDeviation(statOutput.mStandardDeviation, component);
+      setPercentiles(statOutput.getPercentiles(), component);
+      setHistogram(statOutput.getBinCenters(), statOutput.getBinCounts(), component);
    }
    else
    {
@@ -695,6 +684,147 @@ void StatisticsImp::calculateStatistics(ComplexComponent component)
    }
 }
 
+StreamingHistogram::StreamingHistogram() :
+   mOriginCount(0),
+   mOrigin(0.0),
+   mWidth(0.0),
+   mInverseWidth(0.0),
+   mBase(HISTOGRAM_SIZE) // no bins are allocated until a second distinct value is added
+{}
+
+void StreamingHistogram::addOutOfRange(double value)
+{
+   if (value - value != 0.0)
+   {
+      // infinite and NaN values cannot be binned
+      return;
+   }
+
+   if (mCounts.empty())
+   {
+      if (mOriginCount == 0 || value == mOrigin)
+      {
+         mOrigin = value;
+         ++mOriginCount;
+         return;
+      }
+
+      // choose a bin width so that the first two distinct values span a quarter of the bins
+      int exponent = 0;
+      frexp(fabs(value - mOrigin) * 4.0 / HISTOGRAM_SIZE, &exponent);
+      mWidth = ldexp(1.0, exponent);
+      mInverseWidth = 1.0 / mWidth;
+      mBase = -HISTOGRAM_SIZE / 2;
+      mCounts.resize(HISTOGRAM_SIZE, 0);
+      mCounts[HISTOGRAM_SIZE / 2] = mOriginCount;
+   }
+   else
+   {
+      double index = floor((value - mOrigin) * mInverseWidth);
+      double lowIndex = index;
+      double highIndex = index;
+      for (int bin = 0; bin < HISTOGRAM_SIZE; ++bin)
+      {
+         if (mCounts[bin] != 0)
+         {
+            lowIndex = std::min(lowIndex, mBase + bin);
+            break;
+         }
+      }
+      for (int bin = HISTOGRAM_SIZE - 1; bin >= 0; --bin)
+      {
+         if (mCounts[bin] != 0)
+         {
+            highIndex = std::max(highIndex, mBase + bin);
+            break;
+         }
+      }
+      rebin(lowIndex, highIndex);
+   }
+
+   add(value);
+}
+
+void StreamingHistogram::rebin(double lowIndex, double highIndex)
+{
+   // merge adjacent bins until the indices fit, then center the occupied bins
+   // so that the histogram can grow in either direction before rebinning again
+   double scale = 1.0;
+   while (floor(highIndex * scale) - floor(lowIndex * scale) >= HISTOGRAM_SIZE)
+   {
+      scale *= 0.5;
+   }
+
+   double low = floor(lowIndex * scale);
+   double high = floor(highIndex * scale);
+   double base = low - floor((HISTOGRAM_SIZE - (high - low + 1.0)) / 2.0);
+
+   std::vector<unsigned int> counts(HISTOGRAM_SIZE, 0);
+   for (int bin = 0; bin < HISTOGRAM_SIZE; ++bin)
+   {
+      if (mCounts[bin] != 0)
+      {
+         counts[static_cast<int>(floor((mBase + bin) * scale) - base)] += mCounts[bin];
+      }
+   }
+
+   mCounts.swap(counts);
+   mBase = base;
+   mWidth /= scale;
+   mInverseWidth *= scale;
+}
+
+namespace
+{
+   int getHistogramBin(double value, double minimum, double toBin)
+   {
+      int bin = static_cast<int>((value - minimum) * toBin);
+      if (bin >= HISTOGRAM_SIZE)
+      {
+         bin = HISTOGRAM_SIZE - 1;
+      }
+      else if (bin < 0)
+      {
+         bin = 0;
+      }
+
+      return bin;
+   }
+
+   double getHistogramScale(double minimum, double maximum)
+   {
+      if (maximum != minimum)
+      {
+         return 0.999999999 * (HISTOGRAM_SIZE) / (maximum - minimum);
+      }
+
+      return 0.0;
+   }
+}
+
+void StreamingHistogram::addTo(std::vector<unsigned int>& binCounts, double minimum, double maximum) const
+{
+   double toBin = getHistogramScale(minimum, maximum);
+   if (mCounts.empty())
+   {
+      if (mOriginCount != 0)
+      {
+         binCounts[getHistogramBin(mOrigin, minimum, toBin)] += mOriginCount;
+      }
+      return;
+   }
+
+   for (int bin = 0; bin < HISTOGRAM_SIZE; ++bin)
+   {
+      if (mCounts[bin] != 0)
+      {
+         double center = mOrigin + (mBase + bin + 0.5) * mWidth;
+         center = std::max(minimum, std::min(maximum, center));
+         binCounts[getHistogramBin(center, minimum, toBin)] += mCounts[bin];
+      }
+   }
+}
+
 StatisticsThread::StatisticsThread(const StatisticsInput& input, int threadCount, int threadIndex,
                                    ThreadReporter& reporter) :
    AlgorithmThread(threadIndex, reporter),
@@ -706,7 +836,8 @@ StatisticsThread::StatisticsThread(const StatisticsInput& input, int threadCount
    mMinimum(std::numeric_limits<double>::max()),
    mSum(0.0),
    mSumSquared(0.0),
-   mCount(0)
+   mCount(0),
+   mValueOffset(0)
 {}
 
 void StatisticsThread::run()
@@ -715,34 +846,63 @@ void StatisticsThread::run()
       mInput.mpRasterElement->getDataDescriptor());
    VERIFYNRV(pDescriptor != NULL);
 
-   BitMaskIterator diter(mInput.mpAoi, 0, mRowRange.mFirst, pDescriptor->getColumnCount() - 1, mRowRange.mLast);
-
    mMaxMinSet = false;
+   mMaximum = -std::numeric_limits<double>::max();
+   mMinimum = std::numeric_limits<double>::max();
    mSum = 0.0;
    mSumSquared = 0.0;
    mCount = 0;
+   mHistogram = StreamingHistogram();
 
    EncodingType encoding = pDescriptor->getDataType();
-   ComplexComponent component = mInput.mComplexComponent;
-   unsigned int badValueCount = mInput.mBadValues.size();
-   int firstBadValue = 0;
-   if (badValueCount != 0)
+   switch (encoding)
    {
-      firstBadValue = mInput.mBadValues.front();
+   case INT1UBYTE:
+      mValueCounts.assign(256, 0);
+      mValueOffset = 0;
+      break;
+   case INT1SBYTE:
+      mValueCounts.assign(256, 0);
+      mValueOffset = 128;
+      break;
+   case INT2UBYTES:
+      mValueCounts.assign(65536, 0);
+      mValueOffset = 0;
+      break;
+   case INT2SBYTES:
+      mValueCounts.assign(65536, 0);
+      mValueOffset = 32768;
+      break;
+   default:
+      mValueCounts.clear();
+      mValueOffset = 0;
+      break;
    }
-   std::vector<int>::const_iterator badBegin = mInput.mBadValues.begin();
-   std::vector<int>::const_iterator badEnd = mInput.mBadValues.end();
 
-   int oldPercentDone = -1;
+   BitMaskIterator diter(mInput.mpAoi, 0, mRowRange.mFirst, pDescriptor->getColumnCount() - 1, mRowRange.mLast);
+   if (diter == diter.end())
+   {
+      return;
+   }
 
+   // the selected pixels are the same for every band, so the AOI is only traversed once
+   computeSpans(diter);
+
+   int startRow = diter.getBoundingBoxStartRow();
+   int endRow = diter.getBoundingBoxEndRow();
+   unsigned int bytesPerElement = pDescriptor->getBytesPerElement();
    bool isBip = pDescriptor->getInterleaveFormat() == BIP;
+   int rowCount = endRow - startRow + 1;
+   int totalRows = rowCount * (isBip ? 1 : static_cast<int>(mInput.mBandsToCalculate.size()));
+   int rowsDone = 0;
+   int oldPercentDone = -1;
+
    // Outer band loop not for BIP, will break if BIP
    for (std::vector<DimensionDescriptor>::const_iterator bandIt = mInput.mBandsToCalculate.begin();
         bandIt != mInput.mBandsToCalculate.end(); ++bandIt)
    {
       FactoryResource<DataRequest> pRequest;
-      pRequest->setRows(pDescriptor->getActiveRow(diter.getBoundingBoxStartRow()),
-                        pDescriptor->getActiveRow(diter.getBoundingBoxEndRow()), 0);
+      pRequest->setRows(pDescriptor->getActiveRow(startRow), pDescriptor->getActiveRow(endRow), 0);
       pRequest->setColumns(pDescriptor->getActiveColumn(diter.getBoundingBoxStartColumn()),
                            pDescriptor->getActiveColumn(diter.getBoundingBoxEndColumn()), 0);
       if (isBip)
@@ -754,7 +914,7 @@ void StatisticsThread::run()
       }
       else
       {
-         // BIL is really tricky to use with BitMaskIterator so we convert to BSQ
+         // convert BIL to BSQ so that each row of a band is contiguous
          pRequest->setBands(*bandIt, *bandIt, 1);
          pRequest->setInterleaveFormat(BSQ);
       }
@@ -764,74 +924,197 @@ void StatisticsThread::run()
          return;
       }
 
-      // Iterate the band over the AOI or all bands in the case of BIP
-#pragma message(__FILE__ "(" STRING(__LINE__) ") : warning : This should be changed to for (; fiter != diter.end(); diter += mInput.mResolution)  if/when BitMaskIterator is modified to be an STL iterator (tclarke)")
-      while (diter != diter.end())
+      int sampleOffset = 0;
+      for (int rowIndex = 0; rowIndex < rowCount; ++rowIndex)
       {
-         LocationType loc;
-         diter.getPixelLocation(loc);
-         int percentDone = mRowRange.computePercent(static_cast<int>(loc.mY));
+         int percentDone = (100 * rowsDone++) / totalRows;
          if (percentDone >= oldPercentDone + 25)
          {
             oldPercentDone = percentDone;
             getReporter().reportProgress(getThreadIndex(), percentDone);
          }
 
-         da->toPixel(static_cast<int>(loc.mY), static_cast<int>(loc.mX));
          VERIFYNRV(da.isValid());
-
-         // Inner band loop for BIP, will break for other interleaves
-         for (std::vector<DimensionDescriptor>::const_iterator bipBandIt = mInput.mBandsToCalculate.begin();
-              bipBandIt != mInput.mBandsToCalculate.end(); ++bipBandIt)
+         const char* pRow = reinterpret_cast<const char*>(da->getRow());
+         if (isBip)
          {
-            double temp = ModelServices::getDataValue(encoding,
-               da->getColumn(), component, isBip ? bipBandIt->getActiveNumber() : 0);
-
-            int tempInt = roundDouble(temp);
-            if (badValueCount == 0 || (badValueCount == 1 && tempInt != firstBadValue) || 
-               !std::binary_search(badBegin, badEnd, tempInt))
+            // every band samples the same pixels
+            int bandSampleOffset = sampleOffset;
+            for (std::vector<DimensionDescriptor>::const_iterator bipBandIt = mInput.mBandsToCalculate.begin();
+                 bipBandIt != mInput.mBandsToCalculate.end(); ++bipBandIt)
             {
-               if (!mMaxMinSet)
-               {
-                  mMinimum = mMaximum = temp;
-                  mMaxMinSet = true;
-               }
-               else
-               {
-                  if (temp < mMinimum)
-                  {
-                     mMinimum = temp;
-                  }
-
-                  if (temp > mMaximum)
-                  {
-                     mMaximum = temp;
-                  }
-               }
-
-               mSumSquared += temp*temp;
-               mSum += temp;
-               mCount++;
-               if (!isBip)
-               {
-                  // this inner band loop is only for BIP
-                  break;
-               }
+               bandSampleOffset = sampleOffset;
+               processRow(encoding, pRow + bipBandIt->getActiveNumber() * bytesPerElement, rowIndex,
+                  bytesPerElement, pDescriptor->getBandCount(), bandSampleOffset);
             }
+            sampleOffset = bandSampleOffset;
          }
-
-#pragma message(__FILE__ "(" STRING(__LINE__) ") : warning : Remove this if BitMaskIterator becomes an STL iterator or change it if BitMaskIterator::operator+=(int) is created (tclarke)")
-         for (int cnt = 0; diter != diter.end() && cnt < mInput.mResolution; ++cnt)
+         else
          {
-            diter.nextPixel();
+            processRow(encoding, pRow, rowIndex, bytesPerElement, 1, sampleOffset);
          }
+
+         da->nextRow();
       }
+
       if (isBip)
       {
          // this outer band loop is not for BIP
          break;
       }
    }
+
+   compileValueCounts();
+}
+
+void StatisticsThread::computeSpans(const BitMaskIterator& iter)
+{
+   mSpans.clear();
+   mRowSpans.clear();
+
+   int startColumn = iter.getBoundingBoxStartColumn();
+   std::vector<BitMaskIterator::Span> rowSpans;
+   for (int row = iter.getBoundingBoxStartRow(); row <= iter.getBoundingBoxEndRow(); ++row)
+   {
+      mRowSpans.push_back(mSpans.size());
+      rowSpans.clear();
+      iter.getRowSpans(row, rowSpans);
+      for (std::vector<BitMaskIterator::Span>::const_iterator spanIter = rowSpans.begin();
+         spanIter != rowSpans.end(); ++spanIter)
+      {
+         mSpans.push_back(Span(spanIter->mStartColumn - startColumn, spanIter->mEndColumn - 1 - startColumn));
+      }
+   }
+   mRowSpans.push_back(mSpans.size());
+}
+
+void StatisticsThread::processRow(EncodingType encoding, const char* pRow, int rowIndex,
+                                  unsigned int bytesPerElement, int stride, int& sampleOffset)
+{
+   // Only every mResolution'th selected pixel is used.  The sample offset is the number
+   // of selected pixels to skip before the next sample and carries over between spans.
+   int resolution = std::max(mInput.mResolution, 1);
+   size_t pixelSize = static_cast<size_t>(stride) * bytesPerElement;
+   for (size_t spanIndex = mRowSpans[rowIndex]; spanIndex < mRowSpans[rowIndex + 1]; ++spanIndex)
+   {
+      const Span& span = mSpans[spanIndex];
+      int first = span.mStart + sampleOffset;
+      if (first > span.mEnd)
+      {
+         sampleOffset = first - span.mEnd - 1;
+         continue;
+      }
+
+      int count = (span.mEnd - first) / resolution + 1;
+      sampleOffset = first + count * resolution - span.mEnd - 1;
+
+      const void* pData = pRow + first * pixelSize;
+      switch (encoding)
+      {
+      case INT1UBYTE:
+         countSpan(reinterpret_cast<const unsigned char*>(pData), count, stride * resolution);
+         break;
+      case INT1SBYTE:
+         countSpan(reinterpret_cast<const signed char*>(pData), count, stride * resolution);
+         break;
+      case INT2UBYTES:
+         countSpan(reinterpret_cast<const unsigned short*>(pData), count, stride * resolution);
+         break;
+      case INT2SBYTES:
+         countSpan(reinterpret_cast<const signed short*>(pData), count, stride * resolution);
+         break;
+      default:
+         switchOnComplexEncoding(encoding, accumulateSpan, pData, count, stride * resolution);
+         break;
+      }
+   }
+}
+
+template<typename T>
+void StatisticsThread::accumulateSpan(const T* pData, int count, int stride)
+{
+   ComplexComponent component = mInput.mComplexComponent;
+   const std::vector<int>& badValues = mInput.mBadValues;
+   bool checkBadValues = !badValues.empty();
+
+   double minimum = mMinimum;
+   double maximum = mMaximum;
+   double sum = 0.0;
+   double sumSquared = 0.0;
+   unsigned int validCount = 0;
+   for (int i = 0; i < count; ++i, pData += stride)
+   {
+      double value = ModelServices::getDataValue(*pData, component);
+      if (checkBadValues && std::binary_search(badValues.begin(), badValues.end(), roundDouble(value)))
+      {
+         continue;
+      }
+
+      minimum = std::min(minimum, value);
+      maximum = std::max(maximum, value);
+      sum += value;
+      sumSquared += value * value;
+      ++validCount;
+      mHistogram.add(value);
+   }
+
+   if (validCount > 0)
+   {
+      mMaxMinSet = true;
+      mMinimum = minimum;
+      mMaximum = maximum;
+      mSum += sum;
+      mSumSquared += sumSquared;
+      mCount += validCount;
+   }
+}
+
+template<typename T>
+void StatisticsThread::countSpan(const T* pData, int count, int stride)
+{
+   // bad values are removed from the counts in compileValueCounts()
+   unsigned int* pCounts = &mValueCounts.front() + mValueOffset;
+   for (int i = 0; i < count; ++i, pData += stride)
+   {
+      ++pCounts[*pData];
+   }
+}
+
+void StatisticsThread::compileValueCounts()
+{
+   if (mValueCounts.empty())
+   {
+      return;
+   }
+
+   int valueCount = static_cast<int>(mValueCounts.size());
+   for (std::vector<int>::const_iterator badIt = mInput.mBadValues.begin();
+        badIt != mInput.mBadValues.end(); ++badIt)
+   {
+      int index = *badIt + mValueOffset;
+      if (index >= 0 && index < valueCount)
+      {
+         mValueCounts[index] = 0;
+      }
+   }
+
+   for (int index = 0; index < valueCount; ++index)
+   {
+      unsigned int count = mValueCounts[index];
+      if (count != 0)
+      {
+         double value = index - mValueOffset;
+         if (!mMaxMinSet)
+         {
+            mMinimum = value;
+            mMaxMinSet = true;
+         }
+         mMaximum = value;
+         mSum += count * value;
+         mSumSquared += count * value * value;
+         mCount += count;
+      }
+   }
 }
 
 bool StatisticsThread::isMaxMinSet() const
@@ -864,15 +1147,66 @@ unsigned int StatisticsThread::getCount() const
    return mCount;
 }
 
-StatisticsOutput::StatisticsOutput() :
+const std::vector<unsigned int>& StatisticsThread::getValueCounts() const
+{
+   return mValueCounts;
+}
+
+int StatisticsThread::getValueOffset() const
+{
+   return mValueOffset;
+}
+
+const StreamingHistogram& StatisticsThread::getHistogram() const
+{
+   return mHistogram;
+}
+
+StatisticsOutput::StatisticsOutput(bool isInteger) :
    mMaxMinSet(false),
    mMaximum(-std::numeric_limits<double>::max()),
    mMinimum(std::numeric_limits<double>::max()),
    mAverage(0.0),
-   mStandardDeviation(0.0)
+   mStandardDeviation(0.0),
+   mIsInteger(isInteger)
 {}
 
 bool StatisticsOutput::compileOverallResults(const std::vector<StatisticsThread*>& threads)
+{
+   if (threads.size() == 0)
+   {
+      return false;
+   }
+
+   compileMoments(threads);
+   if (mMaxMinSet)
+   {
+      std::vector<unsigned int> totalBinCounts(HISTOGRAM_SIZE, 0);
+      compileHistogram(threads, totalBinCounts);
+      computeBinCenters();
+      computeResultHistogram(totalBinCounts);
+      computePercentiles(totalBinCounts);
+   }
+
+   return true;
+}
+
+const double* StatisticsOutput::getBinCenters() const
+{
+   return mBinCenters;
+}
+
+const unsigned int* StatisticsOutput::getBinCounts() const
+{
+   return mBinCounts;
+}
+
+const double* StatisticsOutput::getPercentiles() const
+{
+   return mPercentiles;
+}
+
+void StatisticsOutput::compileMoments(const std::vector<StatisticsThread*>& threads)
 {
    mMaxMinSet = false;
    mMaximum = -std::numeric_limits<double>::max();
@@ -880,11 +1214,6 @@ bool StatisticsOutput::compileOverallResults(const std::vector<StatisticsThread*
    mAverage = 0.0;
    mStandardDeviation = 0.0;
 
-   if (threads.size() == 0)
-   {
-      return false;
-   }
-
    double totalSum = 0.0;
    double totalSquaredSum = 0.0;
    unsigned int pointCount = 0;
@@ -918,197 +1247,41 @@ bool StatisticsOutput::compileOverallResults(const std::vector<StatisticsThread*
       double numerator = fabs(pointCount * totalSquaredSum - totalSum * totalSum);
       mStandardDeviation = sqrt((numerator / pointCount) / (pointCount - 1));
    }
-
-   return true;
 }
 
-HistogramThread::HistogramThread(const HistogramInput& input,
-                                 int threadCount,
-                                 int threadIndex,
-                                 mta::ThreadReporter& reporter) :
-   AlgorithmThread(threadIndex, reporter),
-   mInput(input),
-   mCount(0),
-   mRowRange(getThreadRange(threadCount, static_cast<const RasterDataDescriptor*>(
-                                 input.mStatInput.mpRasterElement->getDataDescriptor())->getRowCount())),
-   mBinCounts(HISTOGRAM_SIZE)
-{}
-
-void HistogramThread::run()
+void StatisticsOutput::compileHistogram(const std::vector<StatisticsThread*>& threads,
+                                        std::vector<unsigned int>& totalBinCounts)
 {
-   double range = 1.0;
-   double toBin = 0.0;
-   
-   if (mInput.mStatistics.mMaximum != mInput.mStatistics.mMinimum)
-   {
-      range = mInput.mStatistics.mMaximum - mInput.mStatistics.mMinimum;
-      toBin = 0.999999999 * (HISTOGRAM_SIZE)/range;
-   }
-
-   std::vector<unsigned int>& binCounts = getBinCounts();
-
-   const RasterDataDescriptor* pDescriptor = static_cast<const RasterDataDescriptor*>(
-      mInput.mStatInput.mpRasterElement->getDataDescriptor());
-   VERIFYNRV(pDescriptor != NULL);
-
-   BitMaskIterator diter(mInput.mStatInput.mpAoi, 0, mRowRange.mFirst,
-      pDescriptor->getColumnCount() - 1, mRowRange.mLast);
-
-   bool isBip = pDescriptor->getInterleaveFormat() == BIP;
-   // Outer band loop not for BIP, will break if BIP
-   for (std::vector<DimensionDescriptor>::const_iterator bandIt = mInput.mStatInput.mBandsToCalculate.begin();
-      bandIt != mInput.mStatInput.mBandsToCalculate.end(); ++bandIt)
+   double toBin = getHistogramScale(mMinimum, mMaximum);
+   for (std::vector<StatisticsThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
    {
-      FactoryResource<DataRequest> pRequest;
-      pRequest->setRows(pDescriptor->getActiveRow(diter.getBoundingBoxStartRow()),
-         pDescriptor->getActiveRow(diter.getBoundingBoxEndRow()), 0);
-      pRequest->setColumns(pDescriptor->getActiveColumn(diter.getBoundingBoxStartColumn()),
-         pDescriptor->getActiveColumn(diter.getBoundingBoxEndColumn()), 0);
-      if (isBip)
-      {
-         // request native accessor for efficiency
-         pRequest->setBands(pDescriptor->getActiveBand(0),
-                            pDescriptor->getActiveBand(pDescriptor->getBandCount() - 1),
-                            pDescriptor->getBandCount());
-      }
-      else
-      {
-         // BIL is really tricky to use with BitMaskIterator so we convert to BSQ
-         pRequest->setBands(*bandIt, *bandIt, 1);
-         pRequest->setInterleaveFormat(BSQ);
-      }
-      DataAccessor da(mInput.mStatInput.mpRasterElement->getDataAccessor(pRequest.release()));
-      if (!da.isValid())
+      StatisticsThread* pThread = *iter;
+      if (pThread == NULL)
       {
-         return;
+         continue;
       }
 
-      EncodingType encoding = pDescriptor->getDataType();
-      ComplexComponent component = mInput.mStatInput.mComplexComponent;
-      unsigned int badValueCount = mInput.mStatInput.mBadValues.size();
-      int firstBadValue = 0;
-      if (badValueCount != 0)
+      const std::vector<unsigned int>& valueCounts = pThread->getValueCounts();
+      if (valueCounts.empty())
       {
-         firstBadValue = mInput.mStatInput.mBadValues.front();
+         pThread->getHistogram().addTo(totalBinCounts, mMinimum, mMaximum);
+         continue;
       }
-      std::vector<int>::const_iterator badBegin = mInput.mStatInput.mBadValues.begin();
-      std::vector<int>::const_iterator badEnd = mInput.mStatInput.mBadValues.end();
 
-      int oldPercentDone = -1;
-      // Iterate the band over the AOI or all bands in the case of BIP
-#pragma message(__FILE__ "(" STRING(__LINE__) ") : warning : This should be changed to for (; fiter != diter.end(); diter += mInput.mResolution)  if/when BitMaskIterator is modified to be an STL iterator (tclarke)")
-      while (diter != diter.end())
+      // the value counts are exact, so this matches binning each pixel individually
+      int valueCount = static_cast<int>(valueCounts.size());
+      for (int index = 0; index < valueCount; ++index)
       {
-         LocationType loc;
-         diter.getPixelLocation(loc);
-         int percentDone = mRowRange.computePercent(static_cast<int>(loc.mY));
-         if (percentDone >= oldPercentDone + 25)
-         {
-            oldPercentDone = percentDone;
-            getReporter().reportProgress(getThreadIndex(), percentDone);
-         }
-
-         da->toPixel(static_cast<int>(loc.mY), static_cast<int>(loc.mX));
-         VERIFYNRV(da.isValid());
-
-         // Inner band loop for BIP, will break for other interleaves
-         for (std::vector<DimensionDescriptor>::const_iterator bipBandIt = mInput.mStatInput.mBandsToCalculate.begin();
-              bipBandIt != mInput.mStatInput.mBandsToCalculate.end(); ++bipBandIt)
+         if (valueCounts[index] != 0)
          {
-            double temp = ModelServices::getDataValue(encoding,
-               da->getColumn(), mInput.mStatInput.mComplexComponent,
-               isBip ? bipBandIt->getActiveNumber() : 0);
-
-            int tempInt = roundDouble(temp);
-            if (badValueCount == 0 || (badValueCount == 1 && tempInt != firstBadValue) || 
-               !std::binary_search(badBegin, badEnd, tempInt))
-            {
-               int bin = static_cast<int>((temp-mInput.mStatistics.mMinimum) * toBin);
-               if (bin >= HISTOGRAM_SIZE)
-               {
-                  bin = HISTOGRAM_SIZE - 1;
-               }
-               else if (bin < 0)
-               {
-                  bin = 0;
-               }
-
-               binCounts[bin]++;
-               mCount++;
-            }
-            if (!isBip)
-            {
-               // this inner band loop is only for BIP
-               break;
-            }
-         }
-#pragma message(__FILE__ "(" STRING(__LINE__) ") : warning : Remove this if BitMaskIterator becomes an STL iterator or change it if BitMaskIterator::operator+=(int) is created (tclarke)")
-         for (int cnt = 0; diter != diter.end() && cnt < mInput.mStatInput.mResolution; ++cnt)
-         {
-            diter.nextPixel();
+            double value = index - pThread->getValueOffset();
+            totalBinCounts[getHistogramBin(value, mMinimum, toBin)] += valueCounts[index];
          }
       }
-      if (isBip)
-      {
-         // this outer band loop is not for BIP
-         break;
-      }
-   }
-}
-
-std::vector<unsigned int>& HistogramThread::getBinCounts()
-{
-   return mBinCounts;
-}
-
-bool HistogramOutput::compileOverallResults(const std::vector<HistogramThread*>& threads)
-{
-   std::vector<unsigned int> totalBinCounts(HISTOGRAM_SIZE);
-
-   sumAllThreads(threads, totalBinCounts);
-   computeBinCenters();
-   computeResultHistogram(totalBinCounts);
-   computePercentiles(totalBinCounts);
-
-   return true;
-}
-
-const double* HistogramOutput::getBinCenters() const
-{
-   return mBinCenters;
-}
-
-const unsigned int* HistogramOutput::getBinCounts() const
-{
-   return mBinCounts;
-}
-
-const double* HistogramOutput::getPercentiles() const
-{
-   return mPercentiles;
-}
-
-void HistogramOutput::sumAllThreads(const std::vector<HistogramThread*>& threads,
-                                    std::vector<unsigned int>& totalBinCounts)
-{
-   memset(&totalBinCounts[0], 0, HISTOGRAM_SIZE * sizeof(unsigned int));
-
-   std::vector<HistogramThread*>::const_iterator iter;
-   for (iter = threads.begin(); iter != threads.end(); ++iter)
-   {
-      HistogramThread* pThread = NULL;
-      pThread = *iter;
-      if (pThread != NULL)
-      {
-         const std::vector<unsigned int>& threadBinCounts = pThread->getBinCounts();
-
-         transform(totalBinCounts.begin(), totalBinCounts.end(), 
-            threadBinCounts.begin(), totalBinCounts.begin(), std::plus<unsigned int>());
-      }
    }
 }
 
-void HistogramOutput::computeBinCenters()
+void StatisticsOutput::computeBinCenters()
 {
    double width = 0.0;
    double range = mMaximum - mMinimum;
@@ -1148,7 +1321,7 @@ void HistogramOutput::computeBinCenters()
    }
 }
 
-void HistogramOutput::computeResultHistogram(const std::vector<unsigned int>& totalHistogram)
+void StatisticsOutput::computeResultHistogram(const std::vector<unsigned int>& totalHistogram)
 {
    memset(mBinCounts, 0, 256 * sizeof(unsigned int));
 
@@ -1176,7 +1349,7 @@ void HistogramOutput::computeResultHistogram(const std::vector<unsigned int>& to
    }
 }
 
-void HistogramOutput::computePercentiles(const std::vector<unsigned int>& totalHistogram)
+void StatisticsOutput::computePercentiles(const std::vector<unsigned int>& totalHistogram)
 {
    int bin;
    int pointCount = std::accumulate(totalHistogram.begin(), totalHistogram.end(), 0);
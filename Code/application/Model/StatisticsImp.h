@@ -18,10 +18,13 @@
 #include "ObjectResource.h"
 #include "SafePtr.h"
 #include "Statistics.h"
+#include "TypesFile.h"
 
 #include <map>
+#include <math.h>
 #include <vector>
 
+class BitMaskIterator;
 class RasterElement;
 class RasterElementImp;
 
@@ -127,11 +130,57 @@ public:
    const BitMask* mpAoi;
 };
 
+const int HISTOGRAM_SIZE = 128 * 1024;
+
+/**
+ * Accumulates a histogram of values whose range is not known in advance.
+ *
+ * The bins have a power of two width and the histogram is rebinned by merging
+ * adjacent bins whenever a value falls outside of the current range, so the
+ * data is only read once.  The values always span at least half of the
+ * HISTOGRAM_SIZE bins, so the resolution of the final histogram is within a
+ * factor of two of a histogram computed from the exact minimum and maximum.
+ */
+class StreamingHistogram
+{
+public:
+   StreamingHistogram();
+
+   inline void add(double value)
+   {
+      double index = floor((value - mOrigin) * mInverseWidth) - mBase;
+      if (index >= 0.0 && index < HISTOGRAM_SIZE)
+      {
+         ++mCounts[static_cast<int>(index)];
+      }
+      else
+      {
+         addOutOfRange(value);
+      }
+   }
+
+   /**
+    * Adds the counts to a histogram of HISTOGRAM_SIZE bins spanning [minimum, maximum].
+    */
+   void addTo(std::vector<unsigned int>& binCounts, double minimum, double maximum) const;
+
+private:
+   void addOutOfRange(double value);
+   void rebin(double lowIndex, double highIndex);
+
+   std::vector<unsigned int> mCounts;
+   unsigned int mOriginCount;
+   double mOrigin;
+   double mWidth;
+   double mInverseWidth;
+   double mBase;
+};
+
 class StatisticsThread;
 class StatisticsOutput
 {
 public:
-   StatisticsOutput();
+   StatisticsOutput(bool isInteger);
 
    bool mMaxMinSet;
    double mMaximum;
@@ -139,8 +188,31 @@ public:
    double mAverage;
    double mStandardDeviation;
    bool compileOverallResults(const std::vector<StatisticsThread*>& threads);
+
+   const double* getBinCenters() const;
+   const unsigned int* getBinCounts() const;
+   const double* getPercentiles() const;
+
+private:
+   void compileMoments(const std::vector<StatisticsThread*>& threads);
+   void compileHistogram(const std::vector<StatisticsThread*>& threads, std::vector<unsigned int>& totalBinCounts);
+   void computeBinCenters();
+   void computeResultHistogram(const std::vector<unsigned int>& totalHistogram);
+   void computePercentiles(const std::vector<unsigned int>& totalHistogram);
+
+   double mBinCenters[256];
+   unsigned int mBinCounts[256];
+   double mPercentiles[1001];
+   bool mIsInteger;
 };
 
+/**
+ * Computes the moments and the histogram of a range of rows in a single pass.
+ *
+ * 8 and 16 bit integer data is counted into a table with one entry per possible value,
+ * from which the moments and an exact histogram are derived after all of the threads
+ * finish.  All other data is accumulated directly and binned with a StreamingHistogram.
+ */
 class StatisticsThread : public mta::AlgorithmThread
 {
 public:
@@ -155,7 +227,33 @@ public:
    double getSumSquared() const;
    unsigned int getCount() const;
 
+   /**
+    * Gets the number of occurrences of each value for 8 and 16 bit integer data.
+    *
+    * @return The counts, indexed by value plus getValueOffset(), or an empty vector
+    *         if the data was accumulated with getHistogram().
+    */
+   const std::vector<unsigned int>& getValueCounts() const;
+   int getValueOffset() const;
+   const StreamingHistogram& getHistogram() const;
+
 private:
+   struct Span
+   {
+      Span(int start, int end) : mStart(start), mEnd(end) {}
+      int mStart;
+      int mEnd;
+   };
+
+   void computeSpans(const BitMaskIterator& iter);
+   void processRow(EncodingType encoding, const char* pRow, int rowIndex, unsigned int bytesPerElement,
+      int stride, int& sampleOffset);
+   void compileValueCounts();
+   template<typename T>
+   void accumulateSpan(const T* pData, int count, int stride);
+   template<typename T>
+   void countSpan(const T* pData, int count, int stride);
+
    const StatisticsInput& mInput;
 
    Range mRowRange;
@@ -165,59 +263,13 @@ private:
    double mSum;
    double mSumSquared;
    unsigned int mCount;
-};
-
-class HistogramInput
-{
-public:
-   HistogramInput(const StatisticsInput& statInput, const StatisticsOutput& statOutput) :
-      mStatInput(statInput), mStatistics(statOutput) {}
-   StatisticsInput mStatInput;
-   StatisticsOutput mStatistics;
-};
 
-class HistogramThread;
-const int HISTOGRAM_SIZE = 128 * 1024;
-class HistogramOutput
-{
-public:
-   HistogramOutput(bool isInteger, double maximum, double minimum) : 
-      mIsInteger(isInteger), mMaximum(maximum), mMinimum(minimum) {}
+   std::vector<Span> mSpans;
+   std::vector<size_t> mRowSpans; // index of the first span in each row, plus a terminating index
 
-   bool compileOverallResults(const std::vector<HistogramThread*>& threads);
-   const double* getBinCenters() const;
-   const unsigned int* getBinCounts() const;
-   const double* getPercentiles() const;
-
-private:
-   void sumAllThreads(const std::vector<HistogramThread*>& threads, std::vector<unsigned int>& totalBinCounts);
-   void computeBinCenters();
-   void computeResultHistogram(const std::vector<unsigned int>& totalHistogram);
-   void computePercentiles(const std::vector<unsigned int>& totalHistogram);
-
-   double mBinCenters[256];
-   unsigned int mBinCounts[256];
-   double mPercentiles[1001];
-   bool mIsInteger;
-   double mMaximum;
-   double mMinimum;
-};
-
-class HistogramThread : public mta::AlgorithmThread
-{
-public:
-   HistogramThread(const HistogramInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter);
-
-   void run();
-
-   std::vector<unsigned int>& getBinCounts();
-
-private:
-   const HistogramInput& mInput;
-   unsigned int mCount;
-
-   Range mRowRange;
-   std::vector<unsigned int> mBinCounts;
+   std::vector<unsigned int> mValueCounts;
+   int mValueOffset;
+   StreamingHistogram mHistogram;
 };
 
 #endif
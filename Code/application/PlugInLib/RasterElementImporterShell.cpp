@@ -10,13 +10,16 @@
 #include "AppConfig.h"
 #include "AppVerify.h"
 #include "DimensionDescriptor.h"
+#include "Endian.h"
 #include "FileResource.h"
+#include "Filename.h"
 #include "GcpLayer.h"
 #include "GcpList.h"
 #include "Georeference.h"
 #include "LatLonLayer.h"
 #include "LayerList.h"
 #include "MessageLogResource.h"
+#include "MultiThreadedAlgorithm.h"
 #include "ObjectResource.h"
 #include "PlugInArg.h"
 #include "PlugInArgList.h"
@@ -34,6 +37,7 @@
 #include "StringUtilities.h"
 #include "Undo.h"
 
+#include <algorithm>
 #include <limits>
 using namespace std;
 
@@ -56,6 +60,434 @@ namespace
 
       return selectedDims;
    }
+
+   // Each bulk load thread reads about this many bytes of the file at a time
+   const int64_t RAW_LOAD_READ_SIZE = 4 * 1024 * 1024;
+
+   /**
+    * Describes a raw data file and the chip of it which is loaded into memory.
+    *
+    * The file layout matches MemoryMappedMatrix.  Band files are described as a band sequential file
+    * with one file per band.
+    */
+   struct RawLoadInput
+   {
+      vector<string> mFilenames;
+      bool mBandFiles;
+      InterleaveFormatType mFileInterleave;
+      int64_t mHeaderBytes;
+      int64_t mMinorSize;
+      int64_t mMiddleSize;
+      int64_t mMajorSize;
+      unsigned int mBytesPerElement;
+      EndianType mEndian;
+      size_t mSwapSize;
+      bool mDirectRead;
+
+      vector<unsigned int> mRows;
+      vector<unsigned int> mBands;
+      unsigned int mFirstBand;
+      unsigned int mFirstColumn;
+      unsigned int mColumnStep;
+      unsigned int mColumnCount;
+
+      InterleaveFormatType mChipInterleave;
+      unsigned char* mpChipData;
+      const bool* mpAbortFlag;
+   };
+
+   /**
+    * Reads a contiguous block of chip rows from the file into the chip's memory.  Each thread
+    * has its own file handle, so the reads of different threads are independent.
+    */
+   class RawLoadThread : public mta::AlgorithmThread
+   {
+   public:
+      RawLoadThread(const RawLoadInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter) :
+         mta::AlgorithmThread(threadIndex, reporter),
+         mInput(input),
+         mRowRange(getThreadRange(threadCount, static_cast<int>(input.mRows.size()))),
+         mOpenFile(-1),
+         mSuccess(true)
+      {
+      }
+
+      void run();
+
+      bool isSuccessful() const
+      {
+         return mSuccess;
+      }
+
+   private:
+      bool loadRows(unsigned int bandIndex, unsigned int startRow, unsigned int rowCount);
+      void copyRow(const unsigned char* pFileRow, unsigned int bandIndex, unsigned int chipRow);
+
+      const RawLoadInput& mInput;
+      Range mRowRange;
+      LargeFileResource mFile;
+      int mOpenFile;
+      vector<unsigned char> mBuffer;
+      vector<unsigned char*> mSourceBands;
+      vector<unsigned char*> mChipBands;
+      bool mSuccess;
+   };
+
+   struct RawLoadOutput
+   {
+      bool compileOverallResults(const vector<RawLoadThread*>& threads)
+      {
+         for (vector<RawLoadThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+         {
+            if ((*iter)->isSuccessful() == false)
+            {
+               return false;
+            }
+         }
+         return true;
+      }
+   };
+
+   void RawLoadThread::run()
+   {
+      if (mRowRange.mFirst > mRowRange.mLast)
+      {
+         return;
+      }
+
+      // Band sequential files are read one band at a time, so each pass reads a contiguous range of the file
+      const bool bandSequential = (mInput.mFileInterleave == BSQ);
+      const unsigned int numPasses = bandSequential ? static_cast<unsigned int>(mInput.mBands.size()) : 1;
+      const unsigned int numRows = static_cast<unsigned int>(mRowRange.mLast - mRowRange.mFirst + 1);
+      const int64_t rowStride = bandSequential ? mInput.mMiddleSize : mInput.mMajorSize;
+      const unsigned int rowsPerRead = static_cast<unsigned int>(max(RAW_LOAD_READ_SIZE / rowStride,
+         static_cast<int64_t>(1)));
+
+      int oldPercentDone = -1;
+      for (unsigned int pass = 0; pass < numPasses; ++pass)
+      {
+         for (unsigned int row = 0; row < numRows; row += rowsPerRead)
+         {
+            if (*mInput.mpAbortFlag)
+            {
+               return;
+            }
+
+            int percentDone = static_cast<int>((static_cast<int64_t>(pass) * numRows + row) * 100 /
+               (static_cast<int64_t>(numPasses) * numRows));
+            if (percentDone > oldPercentDone)
+            {
+               oldPercentDone = percentDone;
+               getReporter().reportProgress(getThreadIndex(), percentDone);
+            }
+
+            unsigned int rowCount = min(rowsPerRead, numRows - row);
+            if (loadRows(pass, mRowRange.mFirst + row, rowCount) == false)
+            {
+               mSuccess = false;
+               getReporter().reportError("Could not read the data from the file.");
+               return;
+            }
+         }
+      }
+
+      getReporter().reportProgress(getThreadIndex(), 100);
+   }
+
+   bool RawLoadThread::loadRows(unsigned int bandIndex, unsigned int startRow, unsigned int rowCount)
+   {
+      const RawLoadInput& input = mInput;
+      const bool bandSequential = (input.mFileInterleave == BSQ);
+
+      int fileIndex = (input.mBandFiles == true) ? static_cast<int>(input.mBands[bandIndex]) : 0;
+      if (fileIndex != mOpenFile)
+      {
+         mFile.close();
+         mOpenFile = -1;
+         if (mFile.open(input.mFilenames[fileIndex], O_RDONLY | O_BINARY, S_IREAD) == false)
+         {
+            return false;
+         }
+         mOpenFile = fileIndex;
+      }
+
+      // The part of each file row which holds the selected columns and bands
+      int64_t rowStride = input.mMajorSize;
+      int64_t rowOffset = 0;
+      int64_t rowBytes = 0;
+      unsigned int lastColumn = input.mFirstColumn + (input.mColumnCount - 1) * input.mColumnStep;
+      if (input.mFileInterleave == BIP)
+      {
+         rowOffset = input.mFirstColumn * input.mMiddleSize;
+         rowBytes = (lastColumn - input.mFirstColumn + 1) * input.mMiddleSize;
+      }
+      else if (input.mFileInterleave == BIL)
+      {
+         unsigned int lastBand = *max_element(input.mBands.begin(), input.mBands.end());
+         rowOffset = input.mFirstBand * input.mMiddleSize;
+         rowBytes = (lastBand - input.mFirstBand + 1) * input.mMiddleSize;
+      }
+      else
+      {
+         rowStride = input.mMiddleSize;
+         rowOffset = input.mFirstColumn * input.mMinorSize;
+         if (input.mBandFiles == false)
+         {
+            rowOffset += input.mBands[bandIndex] * input.mMajorSize;
+         }
+         rowBytes = (lastColumn - input.mFirstColumn + 1) * input.mMinorSize;
+      }
+
+      // Consecutive file rows are read together
+      Endian endian(input.mEndian);
+      unsigned int runStart = startRow;
+      const unsigned int endRow = startRow + rowCount;
+      while (runStart < endRow)
+      {
+         unsigned int runEnd = runStart + 1;
+         while (runEnd < endRow && input.mRows[runEnd] == input.mRows[runEnd - 1] + 1)
+         {
+            ++runEnd;
+         }
+
+         const unsigned int runRows = runEnd - runStart;
+         const int64_t offset = input.mHeaderBytes + input.mRows[runStart] * rowStride + rowOffset;
+         const int64_t readBytes = (runRows - 1) * rowStride + rowBytes;
+
+         unsigned char* pRead = NULL;
+         if (input.mDirectRead == true)
+         {
+            // The file rows have the same layout as the chip, so they are read straight into it
+            size_t chipBand = bandSequential ? static_cast<size_t>(bandIndex) * input.mRows.size() : 0;
+            pRead = input.mpChipData + (chipBand + runStart) * rowBytes;
+         }
+         else
+         {
+            mBuffer.resize(static_cast<size_t>(readBytes));
+            pRead = &mBuffer.front();
+         }
+
+         if (mFile.seek(offset, SEEK_SET) != offset || mFile.read(pRead, readBytes) != readBytes)
+         {
+            return false;
+         }
+
+         if (input.mDirectRead == false)
+         {
+            for (unsigned int row = 0; row < runRows; ++row)
+            {
+               unsigned char* pFileRow = pRead + row * rowStride;
+               endian.swapBuffer(pFileRow, input.mSwapSize, static_cast<size_t>(rowBytes) / input.mSwapSize);
+               copyRow(pFileRow, bandIndex, runStart + row);
+            }
+         }
+
+         runStart = runEnd;
+      }
+
+      return true;
+   }
+
+   void RawLoadThread::copyRow(const unsigned char* pFileRow, unsigned int bandIndex, unsigned int chipRow)
+   {
+      // pFileRow points to the part of the row which was read: the first selected column for BIP and
+      // BSQ files, and the first selected band for BIL files
+      const RawLoadInput& input = mInput;
+      const size_t bpe = input.mBytesPerElement;
+      const size_t numChipBands = input.mBands.size();
+
+      size_t chipColumnStride = bpe;
+      size_t chipBandStride = bpe;
+      size_t chipRowStride = input.mColumnCount * numChipBands * bpe;
+      if (input.mChipInterleave == BIP)
+      {
+         chipColumnStride = numChipBands * bpe;
+      }
+      else if (input.mChipInterleave == BIL)
+      {
+         chipBandStride = input.mColumnCount * bpe;
+      }
+      else
+      {
+         chipRowStride = input.mColumnCount * bpe;
+         chipBandStride = chipRowStride * input.mRows.size();
+      }
+
+      unsigned char* pChipRow = input.mpChipData + chipRow * chipRowStride;
+      unsigned char* pSource = const_cast<unsigned char*>(pFileRow);
+      if (input.mFileInterleave == BSQ)
+      {
+         unsigned char* pChip = pChipRow + bandIndex * chipBandStride;
+         RasterUtilities::copyElements(&pSource, input.mColumnStep * input.mMinorSize, &pChip, chipColumnStride,
+            1, input.mColumnCount, input.mBytesPerElement);
+         return;
+      }
+
+      mSourceBands.resize(numChipBands);
+      mChipBands.resize(numChipBands);
+      size_t sourceColumnStride = input.mColumnStep * input.mMiddleSize;
+      if (input.mFileInterleave == BIL)
+      {
+         sourceColumnStride = input.mColumnStep * input.mMinorSize;
+         pSource += input.mFirstColumn * input.mMinorSize;
+      }
+
+      for (size_t i = 0; i < numChipBands; ++i)
+      {
+         if (input.mFileInterleave == BIP)
+         {
+            mSourceBands[i] = pSource + input.mBands[i] * input.mMinorSize;
+         }
+         else
+         {
+            mSourceBands[i] = pSource + (input.mBands[i] - input.mFirstBand) * input.mMiddleSize;
+         }
+         mChipBands[i] = pChipRow + i * chipBandStride;
+      }
+
+      RasterUtilities::copyElements(&mSourceBands.front(), sourceColumnStride, &mChipBands.front(), chipColumnStride,
+         static_cast<unsigned int>(numChipBands), input.mColumnCount, input.mBytesPerElement);
+   }
+
+   /**
+    * Determines whether the chip can be loaded by reading the raw file directly, which requires an
+    * uncompressed file which is read by the memory mapped pager and a chip which is contiguous in memory.
+    */
+   bool initializeRawLoad(const RasterDataDescriptor* pSrcDescriptor, const RasterDataDescriptor* pChipDescriptor,
+      const vector<DimensionDescriptor>& selectedRows, const vector<DimensionDescriptor>& selectedColumns,
+      const vector<DimensionDescriptor>& selectedBands, RawLoadInput& input)
+   {
+      const RasterFileDescriptor* pFileDescriptor =
+         dynamic_cast<const RasterFileDescriptor*>(pSrcDescriptor->getFileDescriptor());
+      if (pFileDescriptor == NULL || selectedRows.empty() || selectedColumns.empty() || selectedBands.empty())
+      {
+         return false;
+      }
+
+      input.mBytesPerElement = pSrcDescriptor->getBytesPerElement();
+      input.mFileInterleave = pFileDescriptor->getInterleaveFormat();
+      input.mChipInterleave = pChipDescriptor->getInterleaveFormat();
+      if (input.mBytesPerElement == 0 || pFileDescriptor->getBitsPerElement() != input.mBytesPerElement * 8 ||
+         input.mFileInterleave.isValid() == false || input.mChipInterleave.isValid() == false)
+      {
+         return false;
+      }
+
+      // Skip factors select evenly spaced columns, which are copied as a single strided run
+      input.mFirstColumn = selectedColumns.front().getActiveNumber();
+      input.mColumnCount = static_cast<unsigned int>(selectedColumns.size());
+      input.mColumnStep = 1;
+      if (selectedColumns.size() > 1)
+      {
+         input.mColumnStep = selectedColumns[1].getActiveNumber() - input.mFirstColumn;
+      }
+      for (unsigned int i = 0; i < input.mColumnCount; ++i)
+      {
+         if (input.mColumnStep == 0 ||
+            selectedColumns[i].getActiveNumber() != input.mFirstColumn + i * input.mColumnStep)
+         {
+            return false;
+         }
+      }
+
+      input.mRows.clear();
+      for (vector<DimensionDescriptor>::const_iterator iter = selectedRows.begin(); iter != selectedRows.end(); ++iter)
+      {
+         input.mRows.push_back(iter->getActiveNumber());
+      }
+
+      input.mBands.clear();
+      for (vector<DimensionDescriptor>::const_iterator iter = selectedBands.begin();
+         iter != selectedBands.end(); ++iter)
+      {
+         input.mBands.push_back(iter->getActiveNumber());
+      }
+      input.mFirstBand = *min_element(input.mBands.begin(), input.mBands.end());
+
+      const unsigned int numBands = pFileDescriptor->getBandCount();
+      const unsigned int numColumns = pFileDescriptor->getColumnCount();
+      const int64_t interlineBytes = pFileDescriptor->getPrelineBytes() + pFileDescriptor->getPostlineBytes();
+      const int64_t interbandBytes = pFileDescriptor->getPrebandBytes() + pFileDescriptor->getPostbandBytes();
+      input.mHeaderBytes = pFileDescriptor->getHeaderBytes() + pFileDescriptor->getPrelineBytes() +
+         pFileDescriptor->getPrebandBytes();
+
+      const vector<const Filename*>& bandFiles = pFileDescriptor->getBandFiles();
+      input.mBandFiles = (bandFiles.empty() == false);
+      input.mFilenames.clear();
+      if (input.mBandFiles == true)
+      {
+         if (bandFiles.size() != numBands)
+         {
+            return false;
+         }
+
+         for (vector<const Filename*>::const_iterator iter = bandFiles.begin(); iter != bandFiles.end(); ++iter)
+         {
+            if (*iter == NULL)
+            {
+               return false;
+            }
+            input.mFilenames.push_back((*iter)->getFullPathAndName());
+         }
+      }
+      else
+      {
+         string filename = pFileDescriptor->getFilename().getFullPathAndName();
+         if (filename.empty() == true)
+         {
+            return false;
+         }
+         input.mFilenames.push_back(filename);
+      }
+
+      // A single band is stored the same way in every interleave
+      const unsigned int fileBands = input.mBandFiles ? 1 : numBands;
+      if (fileBands == 1)
+      {
+         input.mFileInterleave = BSQ;
+      }
+      if (input.mBands.size() == 1)
+      {
+         input.mChipInterleave = BSQ;
+      }
+
+      input.mMinorSize = input.mBytesPerElement;
+      if (input.mFileInterleave == BIP)
+      {
+         input.mMiddleSize = input.mMinorSize * fileBands;
+         input.mMajorSize = input.mMiddleSize * numColumns + interlineBytes;
+      }
+      else if (input.mFileInterleave == BSQ)
+      {
+         input.mMiddleSize = input.mMinorSize * numColumns + interlineBytes;
+         input.mMajorSize = input.mMiddleSize * pFileDescriptor->getRowCount() + interbandBytes;
+      }
+      else
+      {
+         input.mMiddleSize = input.mMinorSize * numColumns;
+         input.mMajorSize = input.mMiddleSize * fileBands + interlineBytes;
+      }
+
+      input.mEndian = pFileDescriptor->getEndian();
+      input.mSwapSize = input.mBytesPerElement;
+      EncodingType dataType = pSrcDescriptor->getDataType();
+      if (dataType == INT4SCOMPLEX || dataType == FLT8COMPLEX)
+      {
+         input.mSwapSize /= 2;
+      }
+
+      // Rows are read straight into the chip when the file rows are laid out exactly like the chip rows
+      bool allBands = (input.mBands.size() == numBands);
+      for (unsigned int i = 0; i < input.mBands.size() && allBands; ++i)
+      {
+         allBands = (input.mBands[i] == i);
+      }
+
+      input.mDirectRead = (input.mEndian == Endian::getSystemEndian() || input.mBytesPerElement == 1) &&
+         input.mColumnStep == 1 && input.mColumnCount == numColumns && interlineBytes == 0 &&
+         input.mFileInterleave == input.mChipInterleave && (input.mFileInterleave == BSQ || allBands == true);
+      return true;
+   }
 }
 
 RasterElementImporterShell::RasterElementImporterShell() :
@@ -566,6 +998,7 @@ bool RasterElementImporterShell::performImport() const
          return checkAbortOrError("Could not create source RasterElement", pStep.get());
       }
 
+      mUsingMemoryMappedPager = false;
       if (createRasterPager(pSourceRaster.get()) == false)
       {
          return checkAbortOrError("Could not create pager for source RasterElement", pStep.get());
@@ -1003,8 +1436,33 @@ bool RasterElementImporterShell::copyData(const RasterElement* pSrcElement) cons
          selectedBands);
    }
 
-   success = success && pSrcElement->copyDataToChip(mpRasterElement, selectedRows, 
-      selectedColumns, selectedBands, mAborted, mpProgress);
+   if (success == false)
+   {
+      return false;
+   }
+
+   // Raw files are read directly by several threads when the imported data is held in memory
+   RawLoadInput input;
+   if (mUsingMemoryMappedPager == true &&
+      initializeRawLoad(pSrcDescriptor, pChipDescriptor, selectedRows, selectedColumns, selectedBands, input) == true)
+   {
+      input.mpChipData = reinterpret_cast<unsigned char*>(mpRasterElement->getRawData());
+      input.mpAbortFlag = &mAborted;
+      if (input.mpChipData != NULL)
+      {
+         RawLoadOutput output;
+         mta::ProgressObjectReporter reporter("Copying data", mpProgress);
+         mta::MultiThreadedAlgorithm<RawLoadInput, RawLoadOutput, RawLoadThread>
+            alg(mta::getNumRequiredThreads(static_cast<unsigned int>(input.mRows.size())), input, output, &reporter);
+         if (alg.run() != mta::SUCCESS || mAborted == true)
+         {
+            return false;
+         }
+
+         return true;
+      }
+   }
 
-   return success;
+   return pSrcElement->copyDataToChip(mpRasterElement, selectedRows, selectedColumns, selectedBands, mAborted,
+      mpProgress);
 }
@@ -404,6 +404,11 @@ protected:
    /**
     *  Copy data from the source element to the imported one.
     *
+    *  If the source element's pager was created by the default
+    *  createRasterPager() and the imported element is held in memory,
+    *  the selected data is read from the file by several threads
+    *  directly into the imported element.
+    *
     *  @param pSrcElement
     *         The source element to copy from.  The active rows, columns,
     *         and bands should be a superset of those being imported.
@@ -62,6 +62,7 @@
 #include "PropertiesTiePointLayer.h"
 #include "PropertiesView.h"
 #include "PropertiesWavelengths.h"
+#include "SessionBlockPager.h"
 
 #include <string>
 #include <vector>
@@ -140,6 +141,7 @@ REGISTER_PLUGIN(OpticksCore, PropertiesSpatialDataView, PropertiesQWidgetWrapper
 REGISTER_PLUGIN(OpticksCore, PropertiesThresholdLayer, PropertiesQWidgetWrapper<PropertiesThresholdLayer>());
 REGISTER_PLUGIN(OpticksCore, PropertiesTiePointLayer, PropertiesQWidgetWrapper<PropertiesTiePointLayer>());
 REGISTER_PLUGIN(OpticksCore, PropertiesView, PropertiesQWidgetWrapper<PropertiesView>());
+REGISTER_PLUGIN_BASIC(OpticksCore, SessionBlockPager);
 
 PlugIn* CoreModuleDescriptor::createInterface(unsigned int plugInNumber)
 {
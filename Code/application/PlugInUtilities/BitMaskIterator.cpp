@@ -16,6 +16,29 @@
 
 using namespace std;
 
+namespace
+{
+   void appendSpan(vector<BitMaskIterator::Span>& spans, int row, int startColumn, int endColumn)
+   {
+      if (startColumn >= endColumn)
+      {
+         return;
+      }
+
+      if (spans.empty() == false && spans.back().mRow == row && spans.back().mEndColumn == startColumn)
+      {
+         spans.back().mEndColumn = endColumn;
+         return;
+      }
+
+      BitMaskIterator::Span span;
+      span.mRow = row;
+      span.mStartColumn = startColumn;
+      span.mEndColumn = endColumn;
+      spans.push_back(span);
+   }
+}
+
 BitMaskIterator::BitMaskIterator(BitMaskIterator, bool) :
    mpBitMask(NULL),
    mX1(0),
@@ -267,19 +290,17 @@ inline void BitMaskIterator::computeCount()
       mPixelCount = getNumRows() * getNumColumns();
       return;
    }
-   mPixelCount = mCurrentPixelCount;
-   unsigned int saveCurrentPixelCount = mCurrentPixelCount;
-   int savePixelX = mCurrentPixelX;
-   int savePixelY = mCurrentPixelY;
-   nextPixel();
-   while ((*this) != end())
+   mPixelCount = 0;
+   vector<Span> spans;
+   for (int row = mY1; row <= mY2; ++row)
    {
-      ++mPixelCount;
-      nextPixel();
+      spans.clear();
+      getRowSpans(row, spans);
+      for (vector<Span>::const_iterator iter = spans.begin(); iter != spans.end(); ++iter)
+      {
+         mPixelCount += iter->mEndColumn - iter->mStartColumn;
+      }
    }
-   mCurrentPixelX = savePixelX;
-   mCurrentPixelY = savePixelY;
-   mCurrentPixelCount = saveCurrentPixelCount;
 }
 
 void BitMaskIterator::getBoundingBox(int& x1, int& y1, int& x2, int& y2) const
@@ -393,3 +414,89 @@ int BitMaskIterator::getPixelColumnLocation() const
 {
    return mCurrentPixelX;
 }
+
+void BitMaskIterator::getRowSpans(int row, vector<Span>& spans) const
+{
+   if (row < mY1 || row > mY2 || mX1 > mX2)
+   {
+      return;
+   }
+
+   if (mpBitMask == NULL)
+   {
+      appendSpan(spans, row, mX1, mX2 + 1);
+      return;
+   }
+
+   // Pixels outside of the bounding box have the outside value, regardless of the mask contents
+   bool outside = mpBitMask->isOutsideSelected();
+   int bbx1 = 0;
+   int bby1 = 0;
+   int bbx2 = 0;
+   int bby2 = 0;
+   mpBitMask->getBoundingBox(bbx1, bby1, bbx2, bby2);
+
+   int maskStart = max(mX1, bbx1);
+   int maskEnd = min(mX2, bbx2) + 1;
+   if (row < bby1 || row > bby2 || maskStart >= maskEnd)
+   {
+      if (outside)
+      {
+         appendSpan(spans, row, mX1, mX2 + 1);
+      }
+
+      return;
+   }
+
+   if (outside)
+   {
+      appendSpan(spans, row, mX1, maskStart);
+   }
+
+   for (int word = maskStart - (maskStart & 0x1f); word < maskEnd; word += 32)
+   {
+      unsigned int values = mpBitMask->getPixels(word, row);
+      if (values == 0)
+      {
+         continue;
+      }
+
+      int column = max(word, maskStart);
+      int last = min(word + 32, maskEnd);
+      if (values == 0xffffffff)
+      {
+         appendSpan(spans, row, column, last);
+         continue;
+      }
+
+      while (column < last)
+      {
+         while (column < last && (values & (0x80000000 >> (column - word))) == 0)
+         {
+            ++column;
+         }
+
+         int runStart = column;
+         while (column < last && (values & (0x80000000 >> (column - word))) != 0)
+         {
+            ++column;
+         }
+
+         appendSpan(spans, row, runStart, column);
+      }
+   }
+
+   if (outside)
+   {
+      appendSpan(spans, row, maskEnd, mX2 + 1);
+   }
+}
+
+void BitMaskIterator::getSpans(vector<Span>& spans) const
+{
+   spans.clear();
+   for (int row = mY1; row <= mY2; ++row)
+   {
+      getRowSpans(row, spans);
+   }
+}
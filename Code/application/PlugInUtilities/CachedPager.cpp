@@ -20,12 +20,71 @@
 #include "PlugInManagerServices.h"
 #include "RasterDataDescriptor.h"
 #include "RasterElement.h"
+#include "ThreadPool.h"
+#include "UtilityServices.h"
+
+#include <limits>
 
 using namespace std;
 
+namespace
+{
+   const unsigned int ALL_BANDS_KEY = numeric_limits<unsigned int>::max();
+}
+
+/**
+ * The pager referenced by its read-ahead tasks.
+ *
+ * stopReadAhead() clears the pager while holding the mutex, so a task which has
+ * already left the queue never calls into a pager which is being destroyed.
+ */
+struct CachedPager::ReadAheadTarget
+{
+   ReadAheadTarget(CachedPager* pPager) :
+      mpPager(pPager)
+   {
+   }
+
+   mta::DMutex mMutex;
+   CachedPager* mpPager;
+};
+
+/**
+ * Fetches a single unit into the cache from a read-ahead thread.
+ */
+class CachedPager::ReadAheadTask : public mta::ThreadPool::Task
+{
+public:
+   ReadAheadTask(boost::shared_ptr<ReadAheadTarget> pTarget, const DataRequest* pOriginalRequest,
+      DimensionDescriptor startRow, DimensionDescriptor startBand) :
+      mpTarget(pTarget),
+      mpRequest(pOriginalRequest->copy()),
+      mStartRow(startRow),
+      mStartBand(startBand)
+   {
+   }
+
+   void run()
+   {
+      mta::MutexLock lock(mpTarget->mMutex);
+      if (mpTarget->mpPager != NULL)
+      {
+         mpTarget->mpPager->getUnit(mpRequest.get(), mStartRow, mStartBand);
+      }
+   }
+
+private:
+   boost::shared_ptr<ReadAheadTarget> mpTarget;
+   FactoryResource<DataRequest> mpRequest;
+   DimensionDescriptor mStartRow;
+   DimensionDescriptor mStartBand;
+};
+
 CachedPager::CachedPager() :
-   mCache(10 * 1024 * 1024),
    mpMutex(new mta::DMutex),
+   mpReadAheadMutex(new mta::DMutex),
+   mpReadAheadPool(NULL),
+   mReadAheadDepth(0),
    mpDescriptor(NULL),
    mpRaster(NULL),
    mBytesPerBand(0),
@@ -36,8 +95,10 @@ CachedPager::CachedPager() :
 }
 
 CachedPager::CachedPager(const size_t cacheSize) :
-   mCache(cacheSize),
    mpMutex(new mta::DMutex),
+   mpReadAheadMutex(new mta::DMutex),
+   mpReadAheadPool(NULL),
+   mReadAheadDepth(0),
    mpDescriptor(NULL),
    mpRaster(NULL),
    mBytesPerBand(0),
@@ -45,10 +106,12 @@ CachedPager::CachedPager(const size_t cacheSize) :
    mBandCount(0),
    mRowCount(0)
 {
+   mCache.setCacheLimit(cacheSize);
 }
 
 CachedPager::~CachedPager()
 {
+   stopReadAhead();
 }
 
 bool CachedPager::getInputSpecification(PlugInArgList *&pArgList)
@@ -108,6 +171,25 @@ bool CachedPager::parseInputArgs(PlugInArgList *pInputArgList)
    mFilename = pFilename->getFullPathAndName();
 
    mCache.initialize(mBytesPerBand, mColumnCount, mBandCount);
+   if (hasSettingCacheSize())
+   {
+      PageCache::setMaximumCacheSize(static_cast<size_t>(getSettingCacheSize()) * 1024 * 1024);
+   }
+
+   // Read-ahead uses the thread pool shared by all modules, so it does not add threads
+   mReadAheadDepth = getReadAheadDepth();
+   if (mReadAheadDepth > 0 && mpReadAheadTarget.get() == NULL)
+   {
+      mpReadAheadPool = Service<UtilityServices>()->getThreadPool();
+      if (mpReadAheadPool == NULL)
+      {
+         mReadAheadDepth = 0;
+      }
+      else
+      {
+         mpReadAheadTarget.reset(new ReadAheadTarget(this));
+      }
+   }
 
    return true;
 }
@@ -128,57 +210,163 @@ RasterPage* CachedPager::getPage(DataRequest *pOriginalRequest,
 
    VERIFYRV(pOriginalRequest != NULL, NULL);
 
+   InterleaveFormatType requestedFormat = pOriginalRequest->getInterleaveFormat();
+   if (requestedFormat != mpDescriptor->getInterleaveFormat())
+   {
+      return NULL;
+   }
+
+   CachedPage::UnitPtr pUnit = getUnit(pOriginalRequest, startRow, startBand);
+   if (pUnit.get() != NULL && mReadAheadDepth > 0)
+   {
+      scheduleReadAhead(pOriginalRequest, startRow, startBand, pUnit);
+   }
+
+   return mCache.createPage(pUnit, requestedFormat, startRow, startColumn, startBand);
+}
+
+CachedPage::UnitPtr CachedPager::getUnit(DataRequest *pOriginalRequest, DimensionDescriptor startRow,
+                                         DimensionDescriptor startBand)
+{
+   // The cache is thread-safe, so cache hits do not wait for another thread's fetchUnit()
+   CachedPage::UnitPtr pUnit = mCache.getUnit(pOriginalRequest, startRow, startBand);
+   if (pUnit.get() != NULL)
+   {
+      return pUnit;
+   }
+
+   // Subclasses are not required to make fetchUnit() thread-safe
    mta::MutexLock lock(*mpMutex);
 
+   // Another thread, or a read-ahead, may have fetched the unit while this one waited for the lock
+   pUnit = mCache.getUnit(pOriginalRequest, startRow, startBand);
+   if (pUnit.get() != NULL)
+   {
+      return pUnit;
+   }
 
    InterleaveFormatType requestedFormat = pOriginalRequest->getInterleaveFormat();
-   DimensionDescriptor stopRow = pOriginalRequest->getStopRow();
-   DimensionDescriptor stopBand = pOriginalRequest->getStopBand();
+   DimensionDescriptor cacheStartBand = startBand;
+   DimensionDescriptor cacheStopBand = pOriginalRequest->getStopBand();
+   if (requestedFormat != BSQ)
+   {
+      cacheStartBand = DimensionDescriptor();
+      cacheStopBand = DimensionDescriptor();
+   }
+
+   FactoryResource<DataRequest> pNewRequest;
+   pNewRequest->setInterleaveFormat(requestedFormat);
+   pNewRequest->setRows(startRow, pOriginalRequest->getStopRow(), getUnitRowCount(pOriginalRequest, startRow));
+   // Get full columns
+   pNewRequest->setBands(cacheStartBand, cacheStopBand);
+
+   pNewRequest->polish(mpDescriptor);
+   if (pNewRequest->validate(mpDescriptor) == true)
+   {
+      pUnit = fetchUnit(pNewRequest.get());
+      mCache.insertUnit(pUnit);
+   }
+
+   return pUnit;
+}
+
+unsigned int CachedPager::getUnitRowCount(DataRequest *pOriginalRequest, DimensionDescriptor startRow) const
+{
    unsigned int concurrentBands = pOriginalRequest->getConcurrentBands();
+   if (pOriginalRequest->getInterleaveFormat() != BSQ)
+   {
+      concurrentBands = mBandCount;
+   }
 
-   if (requestedFormat != mpDescriptor->getInterleaveFormat())
+   // get a bunch more rows if you can to prevent a cache miss
+   unsigned int concurrentRows = std::max(pOriginalRequest->getConcurrentRows(),
+      static_cast<unsigned int>(getChunkSize() / (concurrentBands * mColumnCount * mBytesPerBand)));
+   return std::min(concurrentRows,
+      pOriginalRequest->getStopRow().getActiveNumber() - startRow.getActiveNumber() + 1);
+}
+
+void CachedPager::scheduleReadAhead(DataRequest *pOriginalRequest, DimensionDescriptor startRow,
+                                    DimensionDescriptor startBand, CachedPage::UnitPtr pUnit)
+{
+   unsigned int bandKey = ALL_BANDS_KEY;
+   if (pOriginalRequest->getInterleaveFormat() == BSQ)
    {
-      return NULL;
+      bandKey = startBand.getActiveNumber();
    }
 
-   CachedPage::UnitPtr pUnit = mCache.getUnit(pOriginalRequest, startRow, startBand);
+   unsigned int row = startRow.getActiveNumber();
+   unsigned int unitStopRow = pUnit->getStartRow().getActiveNumber() + pUnit->getConcurrentRows();
+   unsigned int stopRow = pOriginalRequest->getStopRow().getActiveNumber();
 
-   DimensionDescriptor cacheStartBand = startBand;
-   DimensionDescriptor cacheStopBand = stopBand;
-   if (pUnit.get() == NULL) // cache miss
+   mta::MutexLock lock(*mpReadAheadMutex);
+   if (mReadAheadDepth == 0 || mpReadAheadPool == NULL)
+   {
+      return;
+   }
+
+   // A DataAccessor requests its next page at the row following its current page, so a request
+   // starting where the previously returned unit ended indicates a sequential scan.
+   map<unsigned int, unsigned int>::iterator pSequentialRow = mSequentialRows.find(bandKey);
+   bool sequential = (pSequentialRow != mSequentialRows.end() && pSequentialRow->second == row);
+   mSequentialRows[bandKey] = unitStopRow;
+
+   unsigned int& readAheadRow = mReadAheadRows[bandKey];
+   if (sequential == false)
    {
-      if (requestedFormat != BSQ)
+      readAheadRow = unitStopRow;
+      return;
+   }
+
+   // Queue the units following this one, skipping any which have already been queued
+   unsigned int nextRow = unitStopRow;
+   for (unsigned int i = 0; i < mReadAheadDepth && nextRow <= stopRow; ++i)
+   {
+      unsigned int rowCount = getUnitRowCount(pOriginalRequest, mpDescriptor->getActiveRow(nextRow));
+      if (nextRow >= readAheadRow)
       {
-         cacheStartBand = DimensionDescriptor();
-         cacheStopBand = DimensionDescriptor();
-         concurrentBands = mBandCount;
+         if (mpReadAheadPool->queueTask(mta::ThreadPool::TaskPtr(new ReadAheadTask(mpReadAheadTarget,
+            pOriginalRequest, mpDescriptor->getActiveRow(nextRow), startBand)), this) == false)
+         {
+            // the pool has been stopped during application shutdown
+            mReadAheadDepth = 0;
+            return;
+         }
+         readAheadRow = nextRow + rowCount;
       }
+      nextRow += rowCount;
+   }
+}
 
-      // get a bunch more rows if you can to prevent a cache miss
-      unsigned int concurrentRows = std::max(pOriginalRequest->getConcurrentRows(),
-         static_cast<unsigned int>(getChunkSize() / (concurrentBands * mColumnCount * mBytesPerBand)));
-      concurrentRows = std::min(concurrentRows, stopRow.getActiveNumber() - startRow.getActiveNumber() + 1);
+unsigned int CachedPager::getReadAheadDepth() const
+{
+   return 0;
+}
 
-      FactoryResource<DataRequest> pNewRequest;
-      pNewRequest->setInterleaveFormat(requestedFormat);
-      pNewRequest->setRows(startRow, stopRow, concurrentRows);
-      // Get full columns
-      pNewRequest->setBands(cacheStartBand, cacheStopBand);
+void CachedPager::stopReadAhead()
+{
+   mta::ThreadPool* pPool = NULL;
+   boost::shared_ptr<ReadAheadTarget> pTarget;
+   {
+      mta::MutexLock lock(*mpReadAheadMutex);
+      mReadAheadDepth = 0;
+      pPool = mpReadAheadPool;
+      pTarget = mpReadAheadTarget;
+   }
 
-      pNewRequest->polish(mpDescriptor);
-      if (pNewRequest->validate(mpDescriptor) == true)
+   if (pTarget.get() != NULL)
+   {
+      // waits for a unit which is being read ahead
       {
-         pUnit = fetchUnit(pNewRequest.get());
+         mta::MutexLock lock(pTarget->mMutex);
+         pTarget->mpPager = NULL;
       }
-   }
 
-   return mCache.createPage(pUnit, requestedFormat, startRow, startColumn, startBand);
+      pPool->cancelTasks(this);
+   }
 }
 
 void CachedPager::releasePage(RasterPage *pPage)
 {
-   mta::MutexLock lock(*mpMutex);
-
    delete dynamic_cast<CachedPage*>(pPage);
 }
 
@@ -12,6 +12,8 @@
 
 #include "LocationType.h"
 
+#include <vector>
+
 class BitMask;
 class RasterElement;
 
@@ -38,6 +40,29 @@ class RasterElement;
 class BitMaskIterator
 {
 public:
+   /**
+    * A run of consecutive selected pixels within a row.
+    *
+    * @see     getRowSpans(), getSpans()
+    */
+   struct Span
+   {
+      /**
+       * The zero-based row containing the run.
+       */
+      int mRow;
+
+      /**
+       * The zero-based column of the first selected pixel in the run.
+       */
+      int mStartColumn;
+
+      /**
+       * The zero-based column following the last selected pixel in the run.
+       */
+      int mEndColumn;
+   };
+
    /**
     * Constructs a BitMaskIterator with given extents.
     *
@@ -404,6 +429,37 @@ public:
     */
    int getPixelColumnLocation() const;
 
+   /**
+    * Gets the runs of selected pixels within a row of the extents.
+    *
+    * The runs are found 32 pixels at a time using BitMask::getPixels(), so
+    * this is much faster than querying each pixel of the row.  Algorithms can
+    * process each run as a contiguous block of data instead of testing every
+    * pixel for selection.
+    *
+    * @param   row
+    *          The zero-based row for which to get the runs.  No runs are added
+    *          if the row is outside of the bounding box.
+    * @param   spans
+    *          The runs of the row are appended to this vector in column order.
+    *          Adjacent runs are never added, so each run is bounded by
+    *          unselected pixels or the bounding box.
+    *
+    * @see     getSpans(), getBoundingBox()
+    */
+   void getRowSpans(int row, std::vector<Span>& spans) const;
+
+   /**
+    * Gets the runs of selected pixels within the extents.
+    *
+    * @param   spans
+    *          Populated with the runs of every row in the bounding box, in row
+    *          and column order.  Any existing contents are removed.
+    *
+    * @see     getRowSpans()
+    */
+   void getSpans(std::vector<Span>& spans) const;
+
 private:
    BitMaskIterator(BitMaskIterator, bool);
    bool getPixel() const;
@@ -10,6 +10,7 @@
 #ifndef CACHEDPAGE_H
 #define CACHEDPAGE_H
 
+#include "CacheBudget.h"
 #include "DimensionDescriptor.h"
 #include "RasterPage.h"
 
@@ -25,7 +26,7 @@
 class CachedPage : public RasterPage
 {
 public:
-   class CacheUnit
+   class CacheUnit : public CacheBudget::Entry
    {
    public:
       /**
@@ -13,10 +13,13 @@
 #include <string>
 
 #include "CachedPage.h"
+#include "ConfigurationSettings.h"
 #include "PageCache.h"
 #include "RasterPagerShell.h"
 #include "RasterPage.h"
 
+#include <boost/shared_ptr.hpp>
+#include <map>
 #include <memory>
 
 class RasterDataDescriptor;
@@ -24,6 +27,7 @@ class RasterElement;
 namespace mta
 {
    class DMutex;
+   class ThreadPool;
 }
 
 /**
@@ -39,6 +43,9 @@ namespace mta
 class CachedPager : public RasterPagerShell
 {
 public:
+   SETTING(CacheSize, CachedPager, unsigned int, 256)
+   SETTING(ReadAheadDepth, CachedPager, unsigned int, 2)
+
    /**
     * The name to use for the raster element argument.
     *
@@ -66,7 +73,9 @@ public:
    /**
     * Creates a CachedPager PlugIn.
     *
-    * Sets cache size to 10 MB. Sets writable flag to false.
+    * Pages are cached in a PageCache which shares its memory budget with every
+    * other cached pager.  The budget is set from getSettingCacheSize().
+    * Sets writable flag to false.
     *
     * Subclasses need to override private pure virtual methods to
     * open the file and get a block from that file.
@@ -76,13 +85,18 @@ public:
    /**
     * Creates a CachedPager PlugIn.
     *
-    * Sets cache size to cacheSize bytes. Sets writable flag to false.
+    * Sets writable flag to false.
     *
     * Subclasses need to override private pure virtual methods to
     * open the file and get a block from that file.
     *
     * @param cacheSize
-    *        Number of bytes in the page cache.
+    *        The maximum number of bytes this pager may cache.  The pager's
+    *        pages are also charged against the memory budget shared by all
+    *        cached pagers, whose size is set from getSettingCacheSize(), so
+    *        this only further limits the pager.
+    *
+    * @see PageCache::setCacheLimit()
     */
    CachedPager(const size_t cacheSize);
 
@@ -304,9 +318,59 @@ protected:
     */
    virtual double getChunkSize() const;
 
+   /**
+    *  Returns the number of units to read ahead during a sequential scan.
+    *
+    *  When a DataAccessor moves through the rows of a data set in order, the
+    *  pager detects the sequential access and calls fetchUnit() for the next
+    *  units in the thread pool returned by UtilityServices::getThreadPool(), so
+    *  that decoding overlaps with the caller's processing.  This method is
+    *  called once from parseInputArgs().
+    *
+    *  Since fetchUnit() is then called from another thread, a subclass which
+    *  returns a non-zero value must call stopReadAhead() at the beginning of its
+    *  destructor, before any resources used by fetchUnit() are released.
+    *
+    *  @return  The number of units to read ahead, or 0 to disable read-ahead.
+    *           Default implementation returns 0, since fetchUnit() is not
+    *           required to be callable from another thread.  Subclasses which
+    *           support read-ahead will typically return
+    *           getSettingReadAheadDepth(), which defaults to 2.
+    *
+    *  @see     stopReadAhead()
+    */
+   virtual unsigned int getReadAheadDepth() const;
+
+   /**
+    *  Stops reading ahead.
+    *
+    *  Any queued read-ahead requests are discarded, and this method waits for
+    *  a read-ahead which is in progress to finish.  fetchUnit() will not be
+    *  called from another thread once this method returns.
+    *
+    *  @see     getReadAheadDepth()
+    */
+   void stopReadAhead();
+
 private:
+   struct ReadAheadTarget;
+   class ReadAheadTask;
+   friend class ReadAheadTask;
+
+   CachedPage::UnitPtr getUnit(DataRequest *pOriginalRequest, DimensionDescriptor startRow,
+      DimensionDescriptor startBand);
+   unsigned int getUnitRowCount(DataRequest *pOriginalRequest, DimensionDescriptor startRow) const;
+   void scheduleReadAhead(DataRequest *pOriginalRequest, DimensionDescriptor startRow,
+      DimensionDescriptor startBand, CachedPage::UnitPtr pUnit);
+
    PageCache mCache;
    std::auto_ptr<mta::DMutex> mpMutex;
+   std::auto_ptr<mta::DMutex> mpReadAheadMutex;
+   mta::ThreadPool* mpReadAheadPool;
+   boost::shared_ptr<ReadAheadTarget> mpReadAheadTarget;
+   unsigned int mReadAheadDepth;
+   std::map<unsigned int, unsigned int> mSequentialRows;
+   std::map<unsigned int, unsigned int> mReadAheadRows;
    std::string mFilename;
    RasterDataDescriptor* mpDescriptor;
    RasterElement* mpRaster;
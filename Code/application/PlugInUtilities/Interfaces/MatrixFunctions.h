@@ -16,6 +16,8 @@
 #include <math.h>
 #include <memory>
 
+class BitMask;
+class Progress;
 class RasterElement;
 
 /**
@@ -415,6 +417,69 @@ namespace MatrixFunctions
     */
    bool invertRasterElement(RasterElement* pDestination, const RasterElement* pSource);
 
+   /**
+    *  Calculates the covariance matrix of the bands of a RasterElement.
+    *
+    *  The band means and the covariances are accumulated together in a single pass through the data.
+    *  The rows are divided between multiple threads which each add blocks of pixels to a partial matrix.
+    *  Each block is centered on its own mean before it is added, and the partial results are merged
+    *  with the pairwise update of Chan, Golub and LeVeque, so precision is not lost when the means
+    *  are large compared to the variances.
+    *
+    *  @param   pMatrix
+    *           A pointer to the location to store the covariance matrix.
+    *           This location must be allocated and freed by the caller of this function.
+    *           This location must be able to contain (numBands * numBands) doubles, which are
+    *           set to the full symmetric matrix.
+    *           This parameter cannot be \b NULL.
+    *
+    *  @param   pRaster
+    *           The RasterElement containing the data.
+    *           Complex data is not supported.
+    *           This parameter cannot be \b NULL.
+    *
+    *  @param   pMask
+    *           The pixels to use in the calculation.
+    *           If this parameter is \b NULL, the pixels are sampled with \c rowFactor and \c columnFactor.
+    *
+    *  @param   rowFactor
+    *           The interval between sampled rows.  This is ignored if \c pMask is not \b NULL.
+    *           Values less than 1 are treated as 1.
+    *
+    *  @param   columnFactor
+    *           The interval between sampled columns.  This is ignored if \c pMask is not \b NULL.
+    *           Values less than 1 are treated as 1.
+    *
+    *  @param   pProgress
+    *           The Progress to which to report.
+    *           If this parameter is \b NULL, progress will not be reported.
+    *
+    *  @param   pAbortFlag
+    *           Calculation stops when the flag is set.
+    *           This parameter can be \b NULL.
+    *
+    *  @param   pMeans
+    *           A pointer to the location to store the numBands band means.
+    *           This location must be allocated and freed by the caller of this function.
+    *           If this parameter is \b NULL, the means will not be returned.
+    *
+    *  @return True if the operation succeeded, false if the inputs are invalid, no pixels were used
+    *          or the calculation was aborted.
+    */
+   bool computeCovarianceMatrix(double* pMatrix, const RasterElement* pRaster, const BitMask* pMask = NULL,
+      int rowFactor = 1, int columnFactor = 1, Progress* pProgress = NULL, const bool* pAbortFlag = NULL,
+      double* pMeans = NULL);
+
+   /**
+    *  This method is similar to computeCovarianceMatrix(), except the second moment matrix, which is
+    *  not centered on the band means, is calculated.
+    *
+    *  @copydoc computeCovarianceMatrix()
+    */
+   bool computeSecondMomentMatrix(double* pMatrix, const RasterElement* pRaster, const BitMask* pMask = NULL,
+      int rowFactor = 1, int columnFactor = 1, Progress* pProgress = NULL, const bool* pAbortFlag = NULL,
+      double* pMeans = NULL);
+
    /**
     *  Compares two matrices for equality.
     *
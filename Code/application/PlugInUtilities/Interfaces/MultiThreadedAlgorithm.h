@@ -14,7 +14,6 @@
 #include <vector>
 #include <math.h>
 #include "bmutex.h"
-#include "bthread.h"
 #include "bthread_signal.h"
 #include "DMutex.h"
 #include "EnumWrapper.h"
@@ -34,10 +33,21 @@ class MessageLogMgr;
 namespace mta // Multi-Threaded Algorithm
 {
 
+/**
+* Get the number of worker threads which run the threads of an algorithm.
+*
+* @return The number of threads in UtilityServices::getThreadPool(), or 1 if
+*         the pool is not running.
+*/
+unsigned int getWorkerCount();
+
 /**
 * Calculate the required number of threads for the data to be processed.
 * Using this prevents some oddities involving empty worker threads.
 *
+* The data is divided into several threads per worker so that the work can be
+* balanced between the workers.
+*
 * @param dataSize
 *        Size of the data to be processed by multiple threads.
 * @return The number of threads required to process the data.
@@ -127,54 +137,84 @@ public:
 };
 
 /**
- * Communicates between a processing thread and the main thread.
+ * An integer which can be read and modified by several threads without a lock.
  */
-class MultiThreadReporter : public ThreadReporter
+class AtomicCounter
 {
 public:
    /**
-    * Messages sent between threads.
+    * Constructor.
+    *
+    * @param value
+    *        The initial value.
     */
-   enum ReportTypeEnum
-   {
-      THREAD_NO_REPORT = 0x0,
-      THREAD_PROGRESS = 0x1,
-      THREAD_ERROR = 0x2,
-      THREAD_COMPLETE = 0x4,
-      THREAD_WORK = 0x8
-   };
+   explicit AtomicCounter(int value = 0);
+
+   /**
+    * Copy constructor.
+    *
+    * @param counter
+    *        The other
+    */
+   AtomicCounter(const AtomicCounter& counter);
 
    /**
-    * @EnumWrapper MultiThreadReporter::ReportTypeEnum.
+    * Assignment operator.
+    *
+    * @param counter
+    *        The other
+    * @return This counter.
     */
-   typedef EnumWrapper<ReportTypeEnum> ReportType;
+   AtomicCounter& operator=(const AtomicCounter& counter);
 
    /**
-    * Constructor.
+    * Access the value.
     *
-    * @param threadCount
-    *        The number of threads to executre.
-    * @param pResult
-    *        The result of execution will be stored here.
-    * @param mutexA
-    *        The first mutex used to coordinate the threads.
-    * @param signalA
-    *        The first signal used to coordinate the threads.
-    * @param mutexB
-    *        The second mutex used to coordinate the threads.
-    * @param signalB
-    *        The second signal used to coordinate the threads.
-    */
-   MultiThreadReporter(int threadCount, Result* pResult, BMutex& mutexA, BThreadSignal& signalA, BMutex& mutexB,
-      BThreadSignal& signalB);
+    * @return The current value.
+    */
+   int get() const;
 
    /**
-    * Copy constructor.
+    * Add to the value.
     *
-    * @param reporter
-    *        The other
+    * @param delta
+    *        The amount to add.  This may be negative.
+    * @return The new value.
+    */
+   int add(int delta);
+
+   /**
+    * Replace the value.
+    *
+    * @param value
+    *        The new value.
+    * @return The previous value.
+    */
+   int exchange(int value);
+
+private:
+   volatile long mValue;
+};
+
+/**
+ * Communicates between the threads of an algorithm and the thread which runs the algorithm.
+ *
+ * Progress is kept in atomic counters, so reporting progress never blocks a thread.
+ * Errors, commands and the completion of the last thread wake the running thread,
+ * which waits in processReports().
+ */
+class MultiThreadReporter : public ThreadReporter
+{
+public:
+   /**
+    * Constructor.
+    *
+    * The thread which creates the reporter is the main thread for runInMainThread().
+    *
+    * @param threadCount
+    *        The number of threads to execute.
     */
-   MultiThreadReporter(MultiThreadReporter& reporter);
+   MultiThreadReporter(int threadCount);
 
    /**
     * @copydoc ThreadReporter::reportProgress()
@@ -192,9 +232,9 @@ public:
    Result reportError(std::string errorText);
 
    /**
-    * Get the current thread's progress.
+    * Get the overall progress of the threads.
     *
-    * @return Percent complete for the current thread.
+    * @return Average percent complete for all threads.
     */
    int getProgress() const;
 
@@ -210,51 +250,58 @@ public:
    
    /**
     * @copydoc ThreadReporter::runInMainThread()
+    *
+    * The calling thread waits until the command has run.  Commands are not run
+    * once an error has been reported.
     */
    void runInMainThread(ThreadCommand& command);
 
    /**
-    * Set the type of report.
+    * Access the result of execution.
     *
-    * @param type
-    *        The report type.
+    * @return ::FAILURE once an error has been reported, ::SUCCESS otherwise.
     */
-   void setReportType(ReportType type);
+   Result getResult() const;
 
    /**
-    * Access the report type.
+    * Indicate that a thread has finished running or will not be run.
     *
-    * @return The report type.
+    * This is called by queueAlgorithmThreads() and must be the last use of the reporter by that thread.
     */
-   unsigned int getReportType() const;
-   
+   void threadFinished();
+
    /**
-    * Access the current thread command.
+    * Wait for a report from the threads and run any command sent with runInMainThread().
     *
-    * @return The current thread command.
+    * This must be called from the main thread.
+    *
+    * @param timeout
+    *        The maximum time to wait in milliseconds.  If this is zero, pending reports
+    *        are processed without waiting.
+    * @return True if all threads have finished.
     */
-   ThreadCommand* getThreadCommand();
+   bool processReports(unsigned int timeout);
 
 private:
-   BMutex& mMutexA;
-   BThreadSignal& mSignalA;
-   BMutex& mMutexB;
-   BThreadSignal& mSignalB;
-   Result* mpResult;
-   std::vector<int> mThreadProgress;
+   MultiThreadReporter(const MultiThreadReporter& reporter);
+   MultiThreadReporter& operator=(const MultiThreadReporter& reporter);
+
+   int mThreadCount;
+   std::vector<AtomicCounter> mThreadProgress;
+   AtomicCounter mTotalProgress;
+   AtomicCounter mFailed;
+   pthread_t mMainThread;
+
+   mutable DMutex mMutex;
+   DThreadSignal mReportSignal;
+   DThreadSignal mCommandSignal;
+   Result mResult;
    std::string mErrorMessage;
-   unsigned int mReportType;
    ThreadCommand* mpThreadCommand;
-   mutable DMutex mReporterMutex;
-   mutable DMutex mSignalMutex;
-
-   Result signalMainThread(ThreadCommand& reportStatus, ReportType type);
+   int mFinishedCount;
+   bool mReportPending;
 };
 
-// this pragma shushes a compiler warning regarding the initialization
-// of the mThreadHandle with 'this'
-#pragma warning (disable: 4355)
-
 /**
  * Base class for an algorithm thread.
  */
@@ -272,7 +319,6 @@ public:
    AlgorithmThread(int threadIndex, ThreadReporter& reporter) : 
       mpAlgorithmMutex(NULL),
       mReporter(reporter), 
-      mThreadHandle(static_cast<void*>(this),  reinterpret_cast<void*>(AlgorithmThread::threadFunction)), 
       mThreadIndex(threadIndex) {}
 
    /**
@@ -284,11 +330,10 @@ public:
    AlgorithmThread(const AlgorithmThread& thread) : 
       mpAlgorithmMutex(thread.mpAlgorithmMutex),
       mReporter(thread.mReporter), 
-      mThreadHandle(static_cast<void*>(this),  reinterpret_cast<void*>(AlgorithmThread::threadFunction)),
       mThreadIndex(thread.mThreadIndex) {}
 
    /**
-    * The function executed by the underlying threading system.
+    * The function executed by the thread pool for each thread.
     *
     * @param pThreadData
     *        The data for the thread being executed.
@@ -300,20 +345,6 @@ public:
     */
    virtual void run() = 0;
 
-   /**
-    * Launch the thread.
-    *
-    * @return False if there was an error.
-    */
-   bool launch();
-
-   /**
-    * Wait for thread compltion.
-    *
-    * @return False if there was an error.
-    */
-   bool wait();
-
    /**
     * Perform an action in the main thread.
     *
@@ -406,10 +437,45 @@ protected:
 private:
    DMutex* mpAlgorithmMutex;
    ThreadReporter& mReporter;
-   BThread mThreadHandle;
    int mThreadIndex;
 };
 
+/**
+ * Queue the threads of an algorithm in UtilityServices::getThreadPool().
+ *
+ * The threads are queued in a group identified by the reporter, which is told when each
+ * thread finishes with MultiThreadReporter::threadFinished(), including threads which are
+ * removed from the queue without running.  When the pool is not running, the threads are
+ * run in the calling thread before this function returns.
+ *
+ * @param threads
+ *        The threads to run.  These must not be destroyed until the reporter has been
+ *        told that they finished.
+ * @param reporter
+ *        The reporter shared by the threads.
+ */
+void queueAlgorithmThreads(const std::vector<AlgorithmThread*>& threads, MultiThreadReporter& reporter);
+
+/**
+ * Remove the queued threads of an algorithm.  Threads which are running are not affected.
+ *
+ * @param reporter
+ *        The reporter which was passed to queueAlgorithmThreads().
+ */
+void cancelAlgorithmThreads(MultiThreadReporter& reporter);
+
+/**
+ * Run one queued thread of an algorithm in the calling thread.
+ *
+ * This only runs a thread when called from a thread of the pool, which allows an algorithm
+ * to be run from within a pool task without occupying a worker that its threads need.
+ *
+ * @param reporter
+ *        The reporter which was passed to queueAlgorithmThreads().
+ * @return True if a thread was run.
+ */
+bool runQueuedAlgorithmThread(MultiThreadReporter& reporter);
+
 /** \page multithreadedhowto Writing a multi-threaded algorithm
  * Use this template to make a thread class.
  * @code
@@ -433,6 +499,12 @@ private:
  *    // put per-thread information into member data here
  * };
  * @endcode
+ *
+ * The threads are run by the application's thread pool, so a thread object is a unit of work
+ * rather than an operating system thread.  Algorithm threads are queued ahead of background work such
+ * as overview and tile generation.  Dividing the data into more threads than there are processors,
+ * as getNumRequiredThreads() does, lets a worker that finishes early pick up another queued thread
+ * instead of idling while a slow one completes.
  */
 
 /**
@@ -592,7 +664,10 @@ private:
 };
 
 /**
- * An algorithm which distributes work between multiply threads. (SIMD)
+ * An algorithm which distributes work between multiple threads. (SIMD)
+ *
+ * The threads are queued with queueAlgorithmThreads() and the calling thread waits for them,
+ * reporting progress and running commands sent with ThreadReporter::runInMainThread().
  */
 template<class AlgInput, class AlgOutput, class AlgThread>
 class MultiThreadedAlgorithm
@@ -602,7 +677,7 @@ public:
     * Constructor.
     *
     * @param threadCount
-    *        Number of threads to create.
+    *        Number of threads to create.  This may be larger than getWorkerCount().
     * @param input
     *        Algorithm input.
     * @param output
@@ -639,8 +714,6 @@ private:
    Result createThreads(int threadCount);
    Result startAllThreads();
    Result waitForThreadsToComplete();
-   int processCurrentReports(int percentDone);
-   int processReport(unsigned int currentType, int percentDone);
    Result compileResults();
 
    Result mCurrentStatus;
@@ -649,10 +722,6 @@ private:
    std::vector<AlgThread*> mThreads;
    MultiThreadReporter* mpThreadReporter;
    ProgressReporter* mpProgressReporter;
-   DMutex mMutexA;
-   DThreadSignal mSignalA;
-   DMutex mMutexB;
-   DThreadSignal mSignalB;
    std::string mErrorText;
 };
 
@@ -665,7 +734,7 @@ MultiThreadedAlgorithm<AlgInput, AlgOutput, AlgThread>::MultiThreadedAlgorithm(i
    mpThreadReporter(NULL),
    mpProgressReporter(pReporter)
 {
-   mpThreadReporter = new MultiThreadReporter(threadCount, &mCurrentStatus, mMutexA, mSignalA, mMutexB, mSignalB);
+   mpThreadReporter = new MultiThreadReporter(threadCount);
    createThreads(threadCount);
 }
 
@@ -696,7 +765,6 @@ Result MultiThreadedAlgorithm<AlgInput, AlgOutput, AlgThread>::createThreads(int
       pThread = new AlgThread(mInput, threadCount, i, *mpThreadReporter);
       if (pThread != NULL)
       {
-         pThread->setAlgorithmMutex(&mMutexA);
          mThreads.push_back(pThread);
       }
    }
@@ -706,104 +774,57 @@ Result MultiThreadedAlgorithm<AlgInput, AlgOutput, AlgThread>::createThreads(int
 template<class AlgInput, class AlgOutput, class AlgThread>
 Result MultiThreadedAlgorithm<AlgInput, AlgOutput, AlgThread>::startAllThreads()
 {
-   typename std::vector<AlgThread*>::iterator iter;
-
-   mMutexA.MutexLock();
-   mMutexB.MutexLock();
-
-   for (iter = mThreads.begin(); iter != mThreads.end(); ++iter)
+   if (mThreads.empty())
    {
-      (*iter)->launch();
+      mErrorText = mpThreadReporter->getErrorText();
+      mCurrentStatus = FAILURE;
+      return mCurrentStatus;
    }
+
+   std::vector<AlgorithmThread*> threads(mThreads.begin(), mThreads.end());
+   queueAlgorithmThreads(threads, *mpThreadReporter);
    return SUCCESS;
 }
 
 template<class AlgInput, class AlgOutput, class AlgThread>
 Result MultiThreadedAlgorithm<AlgInput, AlgOutput, AlgThread>::waitForThreadsToComplete()
 {
+   const unsigned int progressInterval = 100; // milliseconds
    bool doneProcessing = false;
    int percentDone = 0;
 
-   mMutexB.MutexUnlock();
    while (!doneProcessing)
    {
-      mSignalA.ThreadSignalWait(&mMutexA);
+      // when this algorithm is itself running in a worker, help with its threads instead of blocking
+      unsigned int timeout = runQueuedAlgorithmThread(*mpThreadReporter) ? 0 : progressInterval;
+      doneProcessing = mpThreadReporter->processReports(timeout);
 
-      percentDone = processCurrentReports(percentDone);
-      doneProcessing = (percentDone == 100 || mCurrentStatus != SUCCESS);
-      if (doneProcessing)
+      int progress = mpThreadReporter->getProgress();
+      if (progress != percentDone)
       {
-         mMutexA.MutexUnlock();
-
-         typename std::vector<AlgThread*>::iterator iter;
-         for (iter = mThreads.begin(); iter != mThreads.end(); ++iter)
+         percentDone = progress;
+         if (mpProgressReporter != NULL)
          {
-            (*iter)->wait();
+            mpProgressReporter->reportProgress(percentDone);
          }
       }
-   }
-
-   return mCurrentStatus;
-}
 
-template<class AlgInput, class AlgOutput, class AlgThread>
-int MultiThreadedAlgorithm<AlgInput, AlgOutput, AlgThread>::processCurrentReports(int percentDone)
-{
-   mMutexB.MutexLock();
-
-   int type = mpThreadReporter->getReportType();
-   unsigned int currentType = MultiThreadReporter::THREAD_WORK;
-   while (currentType != 0)
-   {
-      if (type & currentType)
+      if (mCurrentStatus == SUCCESS && mpThreadReporter->getResult() != SUCCESS)
       {
-         percentDone = processReport(currentType, percentDone);
-      }
-      currentType /= 2;
-   }
-
-   mpThreadReporter->setReportType(MultiThreadReporter::THREAD_NO_REPORT);
-
-   mSignalB.ThreadSignalActivate();
-   mMutexB.MutexUnlock();
-
-   return percentDone;
-}
-
-template<class AlgInput, class AlgOutput, class AlgThread>
-int MultiThreadedAlgorithm<AlgInput, AlgOutput, AlgThread>::processReport(unsigned int currentType, int percentDone)
-{
-   switch (currentType)
-   {
-      case MultiThreadReporter::THREAD_NO_REPORT:
-         break;
-      case MultiThreadReporter::THREAD_COMPLETE:
-      case MultiThreadReporter::THREAD_PROGRESS:
-         percentDone = mpThreadReporter->getProgress();
-         if (mpProgressReporter != NULL)
-         {
-            mpProgressReporter->reportProgress(percentDone);
-         }
-         break;
-      case MultiThreadReporter::THREAD_ERROR:
-         if (mpProgressReporter != NULL)
-         {
-            mpProgressReporter->reportError(mpThreadReporter->getErrorText().c_str());
-         }
-         mErrorText = mpThreadReporter->getErrorText().c_str();
          mCurrentStatus = FAILURE;
-         break;
-      case MultiThreadReporter::THREAD_WORK:
-         if (mpThreadReporter->getThreadCommand() != NULL)
+         mErrorText = mpThreadReporter->getErrorText();
+         if (mpProgressReporter != NULL)
          {
-            mpThreadReporter->getThreadCommand()->run();
+            mpProgressReporter->reportError(mErrorText);
          }
-         break;
-      default:
-         break;
+
+         // threads which have not started are discarded and running threads
+         // see the failure in their next progress report
+         cancelAlgorithmThreads(*mpThreadReporter);
+      }
    }
 
-   return percentDone;
+   return mCurrentStatus;
 }
 
 template<class AlgInput, class AlgOutput, class AlgThread>
@@ -10,16 +10,18 @@
 #ifndef PAGECACHE_H
 #define PAGECACHE_H
 
-#include <list>
+#include <map>
+#include <utility>
 
-#include <boost/shared_array.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
 #include "CachedPage.h"
 #include "DimensionDescriptor.h"
-#include "LocationType.h"
+#include "DMutex.h"
 
 #include "TypesFile.h"
 
+class CacheBudget;
 class DataRequest;
 
 /**
@@ -29,9 +31,22 @@ class DataRequest;
  * For example, a multi-threaded algorithm could get a DataAccessor to odd
  * and even rows. These two threads would be able to share the same page.
  *
- * When clearing units from the cache, it simply removed the oldest units
- * from the cache.  It is possible that a CachedPage still holds a reference
- * to the released unit.  Since the units are consistently referred to with
+ * Each PageCache indexes its units by band and start row, so finding the unit
+ * which contains a requested row is logarithmic in the number of cached units
+ * instead of linear.  The index is split into shards which are locked
+ * independently, so threads reading different bands of a BSQ data set do not
+ * contend with each other, and cache hits never wait on a cache miss that is
+ * being read from disk.
+ *
+ * All PageCache objects in the application share the memory budget returned by
+ * UtilityServices::getCacheBudget(), which can be queried and changed with
+ * getMaximumCacheSize() and setMaximumCacheSize().  When the budget is exceeded,
+ * the least recently used units are released, regardless of which cache or
+ * plug-in module they belong to.  Opening additional data sets therefore does
+ * not increase the amount of memory used for caching.
+ *
+ * It is possible that a CachedPage still holds a reference
+ * to a released unit.  Since the units are consistently referred to with
  * shared_ptrs, the actual memory will not be released until the last page
  * is destroyed.  This does, however, allow duplicate units -- one that the cache
  * knows about, and one that a lingering CachedPage references.
@@ -42,40 +57,85 @@ public:
    /**
     * Creates a thread-safe LRU PageCache.
     *
-    * @param  maxCacheSize
-    *         The maximum size of the cache in bytes.
+    * The cache uses the application-wide memory budget.
+    *
+    * @see setMaximumCacheSize()
     */
-   PageCache(const size_t maxCacheSize = 20000000);
+   PageCache();
 
    /**
     * Destroys the thread-safe LRU PageCache.
+    *
+    * Any units held by this cache are removed from the application-wide budget.
     */
    ~PageCache();
 
+   /**
+    * Sets the maximum number of bytes which may be held by all caches in the application.
+    *
+    * If the new size is smaller than the number of bytes currently cached, the least
+    * recently used units are released immediately.
+    *
+    * @param  maxCacheSize
+    *         The maximum size of all caches combined, in bytes.
+    */
+   static void setMaximumCacheSize(size_t maxCacheSize);
+
+   /**
+    * Gets the maximum number of bytes which may be held by all caches in the application.
+    *
+    * @return The maximum size of all caches combined, in bytes.
+    */
+   static size_t getMaximumCacheSize();
+
+   /**
+    * Gets the number of bytes currently held by all caches in the application.
+    *
+    * @return The size of all caches combined, in bytes.
+    */
+   static size_t getTotalCacheSize();
+
+   /**
+    * Limits the number of bytes which may be held by this cache.
+    *
+    * The limit applies in addition to the application-wide budget.  When this
+    * cache exceeds its limit, its own least recently used units are released.
+    *
+    * @param  cacheLimit
+    *         The maximum size of this cache, in bytes, or 0 to only limit the
+    *         cache by the application-wide budget.
+    */
+   void setCacheLimit(size_t cacheLimit);
+
    /**
     * Fetches a unit from the cache.
     *
     * See RasterPager::getPage() for details on the parameters.
+    * The unit is marked as most recently used.
     *
     * @return A CacheUnit object containing the startRow, startColumn, and startBand,
     *         and containing and least concurrentRows number of rows, concurrentColumns number
-    *         of columns, and concurrentBands number of bands.
+    *         of columns, and concurrentBands number of bands.  An empty pointer is
+    *         returned if no such unit is cached.
     */
    CachedPage::UnitPtr getUnit(DataRequest *pOriginalRequest,
-      DimensionDescriptor startRow, 
+      DimensionDescriptor startRow,
       DimensionDescriptor startBand);
 
    /**
-    * An STL list of PagePtr.
+    * Adds a unit to the cache.
     *
-    * This list is provided in such a fashion so that calling std::list<UnitPtr>::erase()
-    * on an iterator will also delete the CacheUnit properly if it is the last
-    * reference.
+    * The unit is marked as most recently used and is charged against the
+    * application-wide budget.  Least recently used units are released as needed
+    * to remain within the budget.
+    *
+    * @param  pUnit
+    *         The unit to add.  If this is \c NULL, this method does nothing.
     */
-   typedef std::list<CachedPage::UnitPtr> UnitList;
+   void insertUnit(CachedPage::UnitPtr pUnit);
 
    /**
-    * Initializes member variables of the cache & resets hit/miss counts.
+    * Initializes member variables of the cache.
     *
     * This must be done after construction of the cache.
     *
@@ -93,7 +153,8 @@ public:
     * Create a CachedPage for the given cache unit.
     *
     * @param  pUnit
-    *         The unit to create the page for.
+    *         The unit to create the page for.  This should have been obtained
+    *         from getUnit() or added with insertUnit().
     * @param  requestedFormat
     *         The format of the page provided.
     * @param  startRow
@@ -107,18 +168,44 @@ public:
     *         takes ownership over the created page.
     */
    CachedPage *createPage(CachedPage::UnitPtr pUnit, InterleaveFormatType requestedFormat,
-      DimensionDescriptor startRow, DimensionDescriptor startColumn, DimensionDescriptor startBand);
+      DimensionDescriptor startRow, DimensionDescriptor startColumn, DimensionDescriptor startBand) const;
+
+private:
+   PageCache(const PageCache& rhs);
+   PageCache& operator=(const PageCache& rhs);
 
-protected:
-   const size_t MAX_CACHE_SIZE;
-   UnitList mUnits;
-   std::string mFilename;
-   size_t mCacheSize;
+   /**
+    * Index key: the active band number (or ALL_BANDS_KEY), then the start row.
+    */
+   typedef std::pair<unsigned int, unsigned int> UnitKey;
+
+   /**
+    * The index only holds weak references.  The application-wide LRU list owns the
+    * units, so an eviction frees the memory without taking any shard locks.
+    * Expired entries are removed from the index lazily.
+    */
+   typedef std::map<UnitKey, boost::weak_ptr<CachedPage::CacheUnit> > UnitIndex;
+
+   struct Shard
+   {
+      Shard();
+
+      mta::DMutex mMutex;
+      UnitIndex mUnits;
+      unsigned int mMaxUnitRows;
+   };
+
+   static const unsigned int ALL_BANDS_KEY;
+   static const unsigned int SHARD_COUNT = 16;
+
+   static unsigned int getBandKey(DimensionDescriptor band);
+   Shard& getShard(unsigned int bandKey);
+
+   CacheBudget* mpBudget;
+   Shard mShards[SHARD_COUNT];
    int mBytesPerBand;
    int mColumnCount;
    int mBandCount;
-
-   void enforceCacheSize();
 };
 
 #endif
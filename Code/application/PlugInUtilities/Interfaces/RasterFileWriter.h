@@ -0,0 +1,135 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef RASTERFILEWRITER_H
+#define RASTERFILEWRITER_H
+
+#include "DMutex.h"
+
+#include <vector>
+
+class LargeFileResource;
+class RasterSubsetReader;
+
+namespace mta
+{
+   class ThreadPool;
+}
+
+/**
+ * Writes the data read by a RasterSubsetReader to a raw data file.
+ *
+ * The data is divided into blocks of rows.  Each block is gathered into one of two large staging
+ * buffers and written in the application's thread pool while the next block is gathered into the other
+ * buffer.
+ * BIP and BIL blocks are written with a single write, and BSQ blocks with one write per band.
+ *
+ * The file contains only the data, with no header, in the interleave format of the reader.
+ */
+class RasterFileWriter
+{
+public:
+   /**
+    * Creates a writer.
+    *
+    * @param reader
+    *        The reader of the data to write.  The reader must exist for the life of the writer.
+    * @param file
+    *        The open file to which the data is written.  The file must not be accessed until
+    *        finish() is called.
+    */
+   RasterFileWriter(RasterSubsetReader& reader, LargeFileResource& file);
+
+   /**
+    * Cancels any writes which have not finished.
+    *
+    * @see cancel()
+    */
+   ~RasterFileWriter();
+
+   /**
+    * Gets the number of blocks of data.
+    *
+    * @return The number of blocks which must be written to write all of the data.
+    */
+   unsigned int getBlockCount() const;
+
+   /**
+    * Gets the number of rows in a block.
+    *
+    * @return The number of rows in each block, except for the last block, which may have fewer rows.
+    */
+   unsigned int getRowsPerBlock() const;
+
+   /**
+    * Reads a block of data and queues it to be written to the file.
+    *
+    * @param block
+    *        The zero-based index of the block.
+    *
+    * @return \c True if the block was read and queued, or \c false if the data could not be read
+    *         or a previous block could not be written.
+    *
+    * @see hasWriteError()
+    */
+   bool writeBlock(unsigned int block);
+
+   /**
+    * Waits until all of the queued blocks have been written.
+    *
+    * @return \c True if all blocks were written successfully, otherwise \c false.
+    */
+   bool finish();
+
+   /**
+    * Discards any writes which have not been started and waits for the current write.
+    *
+    * This must be called before the file is closed if writing stops before finish() is called.
+    */
+   void cancel();
+
+   /**
+    * Queries whether a block could not be written to the file.
+    *
+    * @return \c True if a write has failed, otherwise \c false.
+    */
+   bool hasWriteError() const;
+
+private:
+   RasterFileWriter(const RasterFileWriter& rhs);
+   RasterFileWriter& operator=(const RasterFileWriter& rhs);
+
+   class WriteTask;
+   void writeBuffer(unsigned int buffer, unsigned int startRow, unsigned int rowCount);
+
+   /**
+    * Holds a block until it has been written.  The failure flag is only set by the buffer's write
+    * task and only read after waiting for the task.
+    */
+   struct StagingBuffer
+   {
+      std::vector<char> mData;
+      bool mFailed;
+   };
+
+   RasterSubsetReader& mReader;
+   LargeFileResource& mFile;
+   size_t mBandRowBytes;
+   size_t mRowBytes;
+   unsigned int mRowsPerBlock;
+   StagingBuffer mBuffers[2];
+   unsigned int mNextBuffer;
+   bool mWriteError;
+   mta::ThreadPool* mpPool;
+
+   // The writes of both buffers may run at the same time, so each seek and write is locked
+   mta::DMutex mFileMutex;
+};
+
+#endif
@@ -0,0 +1,170 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef RASTERSUBSETREADER_H
+#define RASTERSUBSETREADER_H
+
+#include "DataAccessor.h"
+#include "DimensionDescriptor.h"
+#include "TypesFile.h"
+
+#include <vector>
+
+class RasterElement;
+
+/**
+ * Reads a subset of a raster element into memory in the order of an interleave format.
+ *
+ * This is the gathering stage used by exporters.  The data is read through the raster element's own
+ * interleave, so no interleave conversion is done by the pager, and the requested rows, columns and
+ * bands are copied into the caller's buffer with RasterUtilities::copyElements().  Evenly spaced columns,
+ * such as those of a skip factor, are copied as a single strided run.
+ */
+class RasterSubsetReader
+{
+public:
+   /**
+    * Creates a reader for a subset of a raster element.
+    *
+    * @param pRaster
+    *        The raster element to read.
+    * @param rows
+    *        The active rows to read.  The rows must be in increasing order.
+    * @param columns
+    *        The active columns to read.  The columns must be in increasing order.
+    * @param bands
+    *        The active bands to read.
+    * @param interleave
+    *        The interleave format in which the data is stored in the caller's buffer.
+    */
+   RasterSubsetReader(RasterElement* pRaster, const std::vector<DimensionDescriptor>& rows,
+      const std::vector<DimensionDescriptor>& columns, const std::vector<DimensionDescriptor>& bands,
+      InterleaveFormatType interleave);
+
+   /**
+    * Gets the number of rows in the subset.
+    *
+    * @return The number of rows.
+    */
+   unsigned int getRowCount() const;
+
+   /**
+    * Gets the number of columns in the subset.
+    *
+    * @return The number of columns.
+    */
+   unsigned int getColumnCount() const;
+
+   /**
+    * Gets the number of bands in the subset.
+    *
+    * @return The number of bands.
+    */
+   unsigned int getBandCount() const;
+
+   /**
+    * Gets the size of an element.
+    *
+    * @return The number of bytes in each element.
+    */
+   unsigned int getBytesPerElement() const;
+
+   /**
+    * Gets the interleave format of the data read into the caller's buffer.
+    *
+    * @return The interleave format of the subset.
+    */
+   InterleaveFormatType getInterleaveFormat() const;
+
+   /**
+    * Reads rows of every band in the subset.
+    *
+    * @param startRow
+    *        The index in the subset of the first row to read.
+    * @param rowCount
+    *        The number of rows to read.
+    * @param pBuffer
+    *        The buffer to receive the data, which must hold \c rowCount rows of every band.
+    *
+    * @return \c True if the data was read, or \c false if the data could not be accessed.
+    *
+    * @see read(unsigned int, unsigned int, unsigned int, unsigned int, void*)
+    */
+   bool read(unsigned int startRow, unsigned int rowCount, void* pBuffer);
+
+   /**
+    * Reads rows of a range of bands.
+    *
+    * The buffer holds only the given rows and bands, stored in the reader's interleave format.
+    * For BSQ, this is \c rowCount rows of the first band followed by the same rows of the next band.
+    *
+    * @param startRow
+    *        The index in the subset of the first row to read.
+    * @param rowCount
+    *        The number of rows to read.
+    * @param startBand
+    *        The index in the subset of the first band to read.
+    * @param bandCount
+    *        The number of bands to read.
+    * @param pBuffer
+    *        The buffer to receive the data.
+    *
+    * @return \c True if the data was read, or \c false if the data could not be accessed.
+    */
+   bool read(unsigned int startRow, unsigned int rowCount, unsigned int startBand, unsigned int bandCount,
+      void* pBuffer);
+
+private:
+   RasterSubsetReader(const RasterSubsetReader& rhs);
+   RasterSubsetReader& operator=(const RasterSubsetReader& rhs);
+
+   /**
+    * The number of bytes between consecutive rows, bands and columns of the data.
+    */
+   struct Strides
+   {
+      size_t mRow;
+      size_t mBand;
+      size_t mColumn;
+   };
+
+   bool readInterleavedRows(unsigned int startRow, unsigned int rowCount, unsigned int startBand,
+      unsigned int bandCount, const Strides& strides, unsigned char* pBuffer);
+   bool readBandRows(unsigned int startRow, unsigned int rowCount, unsigned int startBand,
+      unsigned int bandCount, const Strides& strides, unsigned char* pBuffer);
+   void copyRuns(unsigned char* const* pSrc, size_t srcStride, unsigned char* const* pDst, size_t dstStride,
+      unsigned int bandCount);
+
+   /**
+    * Evenly spaced columns which are copied together.
+    */
+   struct ColumnRun
+   {
+      unsigned int mIndex;
+      unsigned int mSourceColumn;
+      unsigned int mStep;
+      unsigned int mCount;
+   };
+
+   RasterElement* mpRaster;
+   std::vector<DimensionDescriptor> mRows;
+   std::vector<DimensionDescriptor> mBands;
+   std::vector<ColumnRun> mColumnRuns;
+   unsigned int mColumnCount;
+   unsigned int mBytesPerElement;
+   InterleaveFormatType mInterleave;
+   InterleaveFormatType mSourceInterleave;
+   size_t mSourceColumnStride;
+   size_t mSourceBandStride;
+   std::vector<DataAccessor> mAccessors;
+   std::vector<unsigned char*> mSourceRuns;
+   std::vector<unsigned char*> mBufferRuns;
+};
+
+#endif
@@ -619,6 +619,32 @@ namespace RasterUtilities
     */
    size_t bytesInEncoding(EncodingType encoding);
 
+   /**
+    * Copies a row of elements for each of several bands.
+    *
+    * Consecutive columns of a band are \c srcStride bytes apart in the source and \c dstStride
+    * bytes apart in the destination, so this can subset, interleave or deinterleave the data.
+    * Strided copies are processed a tile of columns at a time, so the cache lines read for one
+    * band are still cached when the next band is copied.
+    *
+    * @param pSrc
+    *        The first source element of each band.
+    * @param srcStride
+    *        The number of bytes between consecutive source columns.
+    * @param pDst
+    *        The first destination element of each band.
+    * @param dstStride
+    *        The number of bytes between consecutive destination columns.
+    * @param bands
+    *        The number of bands to copy, which is the size of \c pSrc and \c pDst.
+    * @param columns
+    *        The number of columns to copy in each band.
+    * @param bytesPerElement
+    *        The size of each element.
+    */
+   void copyElements(unsigned char* const* pSrc, size_t srcStride, unsigned char* const* pDst, size_t dstStride,
+      unsigned int bands, unsigned int columns, unsigned int bytesPerElement);
+
    /**
     * Returns the band names for the given descriptor.  This
     * method will query the #SPECIAL_METADATA_NAME / #BAND_METADATA_NAME / #NAMES_METADATA_NAME 
@@ -0,0 +1,206 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include "DMutex.h"
+
+#include <boost/shared_ptr.hpp>
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+
+class BThread;
+
+namespace mta
+{
+   /**
+    * A persistent set of worker threads which execute queued tasks.
+    *
+    * Unlike MultiThreadedAlgorithm, the caller does not wait for the tasks,
+    * so the pool is suitable for short or frequent background work such as
+    * read-ahead.  Tasks are executed in the order in which they are queued,
+    * except that priority tasks are executed before any other queued task.
+    * All tasks share one queue per priority and there is no work stealing, so
+    * background work should be split into tasks which do not hold a thread for
+    * long.
+    *
+    * Each task may be associated with a group, which is an arbitrary pointer
+    * (typically the object which queued the task).  A group's tasks can be
+    * cancelled or waited upon without affecting other groups.
+    *
+    * The application creates a single pool when it starts, which is shared by
+    * all modules and is available from UtilityServices::getThreadPool().  Plug-ins
+    * should queue their work there instead of creating their own pool, so that
+    * the number of busy threads does not exceed the number of processors.  The
+    * methods are virtual so that calls from a plug-in module execute the code of
+    * the module which created the pool.  A plug-in must cancel or wait for its
+    * tasks before it is unloaded.
+    */
+   class ThreadPool
+   {
+   public:
+      /**
+       * A unit of work executed by the pool.
+       */
+      class Task
+      {
+      public:
+         /**
+          * Destroys the task.
+          */
+         virtual ~Task() {}
+
+         /**
+          * Performs the work.  This is called in one of the pool's threads.
+          */
+         virtual void run() = 0;
+      };
+
+      /**
+       * Tasks are shared between the queue and the caller.
+       */
+      typedef boost::shared_ptr<Task> TaskPtr;
+
+      /**
+       * Creates the pool and launches its threads.
+       *
+       * @param threadCount
+       *        The number of worker threads.  At least one thread is always created.
+       */
+      explicit ThreadPool(unsigned int threadCount);
+
+      /**
+       * Stops the pool.
+       *
+       * @see stop()
+       */
+      virtual ~ThreadPool();
+
+      /**
+       * Gets the number of worker threads.
+       *
+       * @return The number of worker threads, or 0 if the pool has been stopped.
+       */
+      virtual unsigned int getThreadCount() const;
+
+      /**
+       * Adds a task to the end of the queue.
+       *
+       * @param pTask
+       *        The task to run.  If this is \c NULL, this method does nothing.
+       * @param pGroup
+       *        The group to which the task belongs.
+       *
+       * @return \c True if the task was queued, or \c false if \em pTask is \c NULL
+       *         or the pool has been stopped.  A caller which needs the work done
+       *         should run the task itself if it was not queued.
+       */
+      virtual bool queueTask(TaskPtr pTask, const void* pGroup = NULL);
+
+      /**
+       * Removes all queued tasks in a group and waits for the group's running tasks to finish.
+       *
+       * This must not be called from a task in the same group.
+       *
+       * @param pGroup
+       *        The group to cancel.
+       */
+      virtual void cancelTasks(const void* pGroup);
+
+      /**
+       * Waits until no tasks in a group are queued or running.
+       *
+       * This must not be called from a task in the same group.
+       *
+       * @param pGroup
+       *        The group to wait for.
+       */
+      virtual void waitForTasks(const void* pGroup);
+
+      /**
+       * Discards all queued tasks, waits for running tasks and destroys the threads.
+       *
+       * Tasks are no longer queued once this method has been called.  This must
+       * not be called from a task.
+       */
+      virtual void stop();
+
+      /**
+       * Removes all queued tasks in a group without waiting for its running tasks.
+       *
+       * Unlike cancelTasks(), this may be called by a thread which the group's
+       * running tasks are waiting for.
+       *
+       * @param pGroup
+       *        The group whose queued tasks are removed.
+       */
+      virtual void removeTasks(const void* pGroup);
+
+      /**
+       * Runs one of a group's queued tasks in the calling thread.
+       *
+       * A task which waits for other tasks in the pool should call this while it
+       * waits, so that it helps with the work instead of occupying a thread which
+       * the work needs.  Nothing is run when the caller is not one of the pool's
+       * threads.
+       *
+       * @param pGroup
+       *        The group whose task is run.
+       *
+       * @return \c True if a task was run.
+       */
+      virtual bool runQueuedTask(const void* pGroup);
+
+      /**
+       * Adds a task to the end of the priority queue.
+       *
+       * Priority tasks are started before any task queued with queueTask(), but
+       * do not interrupt running tasks.  This is intended for work which a caller
+       * is waiting for, such as the threads of a MultiThreadedAlgorithm.
+       *
+       * @param pTask
+       *        The task to run.  If this is \c NULL, this method does nothing.
+       * @param pGroup
+       *        The group to which the task belongs.
+       *
+       * @return \c True if the task was queued, or \c false if \em pTask is \c NULL
+       *         or the pool has been stopped.  A caller which needs the work done
+       *         should run the task itself if it was not queued.
+       */
+      virtual bool queuePriorityTask(TaskPtr pTask, const void* pGroup = NULL);
+
+   private:
+      ThreadPool(const ThreadPool& rhs);
+      ThreadPool& operator=(const ThreadPool& rhs);
+
+      static void threadFunction(ThreadPool* pPool);
+      void processTasks();
+      void runTask(std::pair<const void*, TaskPtr>& task);
+      bool isPoolThread() const;
+      bool isGroupQueued(const void* pGroup) const;
+      bool isGroupRunning(const void* pGroup) const;
+
+      typedef std::pair<const void*, TaskPtr> QueuedTask;
+
+      std::vector<BThread*> mThreads;
+      std::vector<pthread_t> mThreadIds;
+      std::deque<QueuedTask> mPriorityTasks;
+      std::deque<QueuedTask> mTasks;
+      std::map<const void*, unsigned int> mRunningCounts;
+      mutable DMutex mMutex;
+      DThreadSignal mTaskQueued;
+      DThreadSignal mTaskFinished;
+      bool mStopping;
+   };
+}
+
+#endif
@@ -451,6 +451,22 @@ public:
     *        (this should not occur on any modern computer)
     */
    std::string writeToString();
+
+   /**
+    * Write a DOM tree as XML to a Xerces format target.
+    *
+    * The XML is passed to the target as it is generated, so large documents
+    * can be written to a file without first being copied into a string.
+    *
+    * @param target
+    *        The format target which receives the XML.
+    *
+    * @return \c True if the entire DOM tree was written, \c false otherwise.
+    *
+    * @throw XmlBase::XmlException
+    *        When Xerces is not able to generate the XML.
+    */
+   bool writeToTarget(XERCES_CPP_NAMESPACE_QUALIFIER XMLFormatTarget& target);
    //@}
 
    //@{
@@ -8,16 +8,23 @@
  */
 
 #include "AppVerify.h"
+#include "BitMaskIterator.h"
 #include "DataAccessor.h"
 #include "DataAccessorImpl.h"
+#include "DataRequest.h"
 #include "MatrixFunctions.h"
+#include "MultiThreadedAlgorithm.h"
+#include "ObjectResource.h"
 #include "RasterDataDescriptor.h"
 #include "RasterElement.h"
 #include "Resource.h"
+#include "switchOnEncoding.h"
 #include "TypesFile.h"
 
+#include <algorithm>
 #include <limits>
 #include <memory>
+#include <vector>
 #include <string.h>
 #include <ossim/matrix/newmat.h>
 #include <ossim/matrix/newmatap.h>
@@ -356,3 +363,428 @@ bool MatrixFunctions::solveLinearEquation(double* pResult, const double** pLhs,
    memcpy(pResult, pData, resultVector.Storage() * sizeof(pData[0]));
    return true;
 }
+
+namespace
+{
+   // Pixels are converted and added to the moments in blocks of this many pixels
+   const unsigned int MOMENT_BLOCK_PIXELS = 64;
+
+   // The upper triangle is updated in tiles of this many bands square so that the tile stays in the cache
+   // while every pixel in a block is added to it
+   const unsigned int MOMENT_BAND_TILE = 32;
+
+   template<typename T>
+   void convertPixels(T*, const char* pSource, unsigned int count, unsigned int stride, unsigned int numBands,
+      double* pDestination)
+   {
+      for (unsigned int pixel = 0; pixel < count; ++pixel)
+      {
+         const T* pPixel = reinterpret_cast<const T*>(pSource + pixel * stride);
+         for (unsigned int band = 0; band < numBands; ++band)
+         {
+            *pDestination++ = static_cast<double>(pPixel[band]);
+         }
+      }
+   }
+
+   /**
+    *  Merges the means of one set of pixels into the moments of another.
+    *
+    *  The scatter matrix of the other set must already have been added to \c pScatter.  This adds the
+    *  term which accounts for the difference between the means of the two sets to the upper triangle.
+    */
+   void mergeMeans(double& count, double* pMeans, double* pScatter, double otherCount, const double* pOtherMeans,
+      unsigned int numBands, double* pDelta)
+   {
+      if (otherCount == 0.0)
+      {
+         return;
+      }
+
+      const double total = count + otherCount;
+      const double weight = count * otherCount / total;
+      const double meanWeight = otherCount / total;
+      for (unsigned int band = 0; band < numBands; ++band)
+      {
+         pDelta[band] = pOtherMeans[band] - pMeans[band];
+      }
+
+      for (unsigned int row = 0; row < numBands; ++row)
+      {
+         const double scaled = pDelta[row] * weight;
+         double* pRow = pScatter + row * numBands;
+         for (unsigned int column = row; column < numBands; ++column)
+         {
+            pRow[column] += scaled * pDelta[column];
+         }
+      }
+
+      for (unsigned int band = 0; band < numBands; ++band)
+      {
+         pMeans[band] += pDelta[band] * meanWeight;
+      }
+
+      count = total;
+   }
+
+   struct MomentInput
+   {
+      const RasterElement* mpRaster;
+      const BitMask* mpMask;
+      unsigned int mRowFactor;
+      unsigned int mColumnFactor;
+      const bool* mpAbortFlag;
+   };
+
+   /**
+    *  Accumulates the count, means and scatter matrix of the pixels in a range of rows.
+    */
+   class MomentThread : public mta::AlgorithmThread
+   {
+   public:
+      MomentThread(const MomentInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter);
+
+      void run();
+
+      double getCount() const
+      {
+         return mCount;
+      }
+
+      const vector<double>& getMeans() const
+      {
+         return mMeans;
+      }
+
+      const vector<double>& getScatter() const
+      {
+         return mScatter;
+      }
+
+   private:
+      void addPixels(const char* pPixels, unsigned int count, unsigned int stride);
+      void addBlock();
+
+      const MomentInput& mInput;
+      Range mRowRange;
+      EncodingType mEncoding;
+      unsigned int mNumBands;
+      double mCount;
+      vector<double> mMeans;
+      vector<double> mScatter;
+      vector<double> mBlock;
+      vector<double> mBlockMeans;
+      vector<double> mDelta;
+      unsigned int mBlockCount;
+   };
+
+   class MomentOutput
+   {
+   public:
+      MomentOutput() :
+         mCount(0.0)
+      {
+      }
+
+      bool compileOverallResults(const vector<MomentThread*>& threads);
+
+      double mCount;
+      vector<double> mMeans;
+      vector<double> mScatter;
+   };
+
+   MomentThread::MomentThread(const MomentInput& input, int threadCount, int threadIndex,
+                              mta::ThreadReporter& reporter) :
+      AlgorithmThread(threadIndex, reporter),
+      mInput(input),
+      mNumBands(0),
+      mCount(0.0),
+      mBlockCount(0)
+   {
+      const RasterDataDescriptor* pDescriptor =
+         static_cast<const RasterDataDescriptor*>(input.mpRaster->getDataDescriptor());
+      int sampledRows = static_cast<int>((pDescriptor->getRowCount() + input.mRowFactor - 1) / input.mRowFactor);
+      mRowRange = getThreadRange(threadCount, sampledRows);
+   }
+
+   void MomentThread::run()
+   {
+      const RasterDataDescriptor* pDescriptor =
+         dynamic_cast<const RasterDataDescriptor*>(mInput.mpRaster->getDataDescriptor());
+      VERIFYNRV(pDescriptor != NULL);
+      if (mRowRange.mFirst > mRowRange.mLast)
+      {
+         return;
+      }
+
+      const unsigned int numColumns = pDescriptor->getColumnCount();
+      mEncoding = pDescriptor->getDataType();
+      mNumBands = pDescriptor->getBandCount();
+      mCount = 0.0;
+      mMeans.assign(mNumBands, 0.0);
+      mScatter.assign(mNumBands * mNumBands, 0.0);
+      mBlock.resize(MOMENT_BLOCK_PIXELS * mNumBands);
+      mBlockMeans.resize(mNumBands);
+      mDelta.resize(mNumBands);
+      mBlockCount = 0;
+
+      const unsigned int startRow = mRowRange.mFirst * mInput.mRowFactor;
+      const unsigned int stopRow = mRowRange.mLast * mInput.mRowFactor;
+      FactoryResource<DataRequest> pRequest;
+      pRequest->setInterleaveFormat(BIP);
+      pRequest->setRows(pDescriptor->getActiveRow(startRow), pDescriptor->getActiveRow(stopRow), 1);
+      pRequest->setColumns(pDescriptor->getActiveColumn(0), pDescriptor->getActiveColumn(numColumns - 1),
+         numColumns);
+      pRequest->setBands(pDescriptor->getActiveBand(0), pDescriptor->getActiveBand(mNumBands - 1), mNumBands);
+      DataAccessor accessor = mInput.mpRaster->getDataAccessor(pRequest.release());
+      if (accessor.isValid() == false)
+      {
+         getReporter().reportError("Unable to access the data.");
+         return;
+      }
+
+      const unsigned int pixelSize = mNumBands * pDescriptor->getBytesPerElement();
+      const unsigned int sampledColumns = (numColumns + mInput.mColumnFactor - 1) / mInput.mColumnFactor;
+      BitMaskIterator iter(mInput.mpMask, 0, startRow, numColumns - 1, stopRow);
+      vector<BitMaskIterator::Span> spans;
+      int oldPercentDone = -1;
+      for (int rowIndex = mRowRange.mFirst; rowIndex <= mRowRange.mLast; ++rowIndex)
+      {
+         if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+         {
+            return;
+         }
+
+         int percentDone = mRowRange.computePercent(rowIndex);
+         if (percentDone != oldPercentDone)
+         {
+            oldPercentDone = percentDone;
+            getReporter().reportProgress(getThreadIndex(), percentDone);
+         }
+
+         const int row = rowIndex * static_cast<int>(mInput.mRowFactor);
+         if (mInput.mpMask == NULL)
+         {
+            accessor->toPixel(row, 0);
+            VERIFYNRV(accessor.isValid());
+            addPixels(reinterpret_cast<const char*>(accessor->getColumn()), sampledColumns,
+               pixelSize * mInput.mColumnFactor);
+         }
+         else
+         {
+            spans.clear();
+            iter.getRowSpans(row, spans);
+            for (vector<BitMaskIterator::Span>::const_iterator span = spans.begin(); span != spans.end(); ++span)
+            {
+               accessor->toPixel(row, span->mStartColumn);
+               VERIFYNRV(accessor.isValid());
+               addPixels(reinterpret_cast<const char*>(accessor->getColumn()),
+                  static_cast<unsigned int>(span->mEndColumn - span->mStartColumn), pixelSize);
+            }
+         }
+      }
+
+      addBlock();
+      getReporter().reportProgress(getThreadIndex(), 100);
+   }
+
+   void MomentThread::addPixels(const char* pPixels, unsigned int count, unsigned int stride)
+   {
+      while (count > 0)
+      {
+         const unsigned int blockPixels = std::min(count, MOMENT_BLOCK_PIXELS - mBlockCount);
+         double* pDestination = &mBlock[mBlockCount * mNumBands];
+         switchOnEncoding(mEncoding, convertPixels, NULL, pPixels, blockPixels, stride, mNumBands, pDestination);
+
+         mBlockCount += blockPixels;
+         count -= blockPixels;
+         pPixels += blockPixels * stride;
+         if (mBlockCount == MOMENT_BLOCK_PIXELS)
+         {
+            addBlock();
+         }
+      }
+   }
+
+   void MomentThread::addBlock()
+   {
+      if (mBlockCount == 0)
+      {
+         return;
+      }
+
+      const unsigned int numBands = mNumBands;
+      double* pBlock = &mBlock.front();
+      double* pBlockMeans = &mBlockMeans.front();
+      double* pScatter = &mScatter.front();
+
+      // center the block on its own mean so that the products do not lose precision
+      std::fill(mBlockMeans.begin(), mBlockMeans.end(), 0.0);
+      for (unsigned int pixel = 0; pixel < mBlockCount; ++pixel)
+      {
+         const double* pPixel = pBlock + pixel * numBands;
+         for (unsigned int band = 0; band < numBands; ++band)
+         {
+            pBlockMeans[band] += pPixel[band];
+         }
+      }
+
+      const double inverseCount = 1.0 / mBlockCount;
+      for (unsigned int band = 0; band < numBands; ++band)
+      {
+         pBlockMeans[band] *= inverseCount;
+      }
+
+      for (unsigned int pixel = 0; pixel < mBlockCount; ++pixel)
+      {
+         double* pPixel = pBlock + pixel * numBands;
+         for (unsigned int band = 0; band < numBands; ++band)
+         {
+            pPixel[band] -= pBlockMeans[band];
+         }
+      }
+
+      // symmetric rank-k update of the upper triangle, one tile at a time
+      for (unsigned int rowTile = 0; rowTile < numBands; rowTile += MOMENT_BAND_TILE)
+      {
+         const unsigned int rowEnd = std::min(rowTile + MOMENT_BAND_TILE, numBands);
+         for (unsigned int columnTile = rowTile; columnTile < numBands; columnTile += MOMENT_BAND_TILE)
+         {
+            const unsigned int columnEnd = std::min(columnTile + MOMENT_BAND_TILE, numBands);
+            for (unsigned int pixel = 0; pixel < mBlockCount; ++pixel)
+            {
+               const double* pPixel = pBlock + pixel * numBands;
+               for (unsigned int row = rowTile; row < rowEnd; ++row)
+               {
+                  const double value = pPixel[row];
+                  double* pRow = pScatter + row * numBands;
+                  for (unsigned int column = std::max(row, columnTile); column < columnEnd; ++column)
+                  {
+                     pRow[column] += value * pPixel[column];
+                  }
+               }
+            }
+         }
+      }
+
+      mergeMeans(mCount, &mMeans.front(), pScatter, mBlockCount, pBlockMeans, numBands, &mDelta.front());
+      mBlockCount = 0;
+   }
+
+   bool MomentOutput::compileOverallResults(const vector<MomentThread*>& threads)
+   {
+      vector<double> delta;
+      for (vector<MomentThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+      {
+         const MomentThread* pThread = *iter;
+         if (pThread == NULL || pThread->getCount() == 0.0)
+         {
+            continue;
+         }
+
+         if (mCount == 0.0)
+         {
+            mCount = pThread->getCount();
+            mMeans = pThread->getMeans();
+            mScatter = pThread->getScatter();
+            delta.resize(mMeans.size());
+            continue;
+         }
+
+         const vector<double>& scatter = pThread->getScatter();
+         for (vector<double>::size_type index = 0; index < mScatter.size(); ++index)
+         {
+            mScatter[index] += scatter[index];
+         }
+
+         mergeMeans(mCount, &mMeans.front(), &mScatter.front(), pThread->getCount(), &pThread->getMeans().front(),
+            static_cast<unsigned int>(mMeans.size()), &delta.front());
+      }
+
+      return true;
+   }
+
+   bool computeMoments(double* pMatrix, const RasterElement* pRaster, const BitMask* pMask, int rowFactor,
+      int columnFactor, Progress* pProgress, const bool* pAbortFlag, double* pMeans, bool centered)
+   {
+      if (pMatrix == NULL || pRaster == NULL)
+      {
+         return false;
+      }
+
+      const RasterDataDescriptor* pDescriptor =
+         dynamic_cast<const RasterDataDescriptor*>(pRaster->getDataDescriptor());
+      if (pDescriptor == NULL)
+      {
+         return false;
+      }
+
+      const unsigned int numRows = pDescriptor->getRowCount();
+      const unsigned int numColumns = pDescriptor->getColumnCount();
+      const unsigned int numBands = pDescriptor->getBandCount();
+      const EncodingType encoding = pDescriptor->getDataType();
+      if (numRows == 0 || numColumns == 0 || numBands == 0 ||
+         encoding == INT4SCOMPLEX || encoding == FLT8COMPLEX)
+      {
+         return false;
+      }
+
+      MomentInput input;
+      input.mpRaster = pRaster;
+      input.mpMask = pMask;
+      input.mRowFactor = (pMask == NULL && rowFactor > 1) ? rowFactor : 1;
+      input.mColumnFactor = (pMask == NULL && columnFactor > 1) ? columnFactor : 1;
+      input.mpAbortFlag = pAbortFlag;
+
+      MomentOutput output;
+      mta::ProgressObjectReporter reporter(centered ? "Computing Covariance Matrix..." :
+         "Computing Second Moment Matrix...", pProgress);
+      unsigned int sampledRows = (numRows + input.mRowFactor - 1) / input.mRowFactor;
+      mta::MultiThreadedAlgorithm<MomentInput, MomentOutput, MomentThread> algorithm(
+         mta::getNumRequiredThreads(sampledRows), input, output, &reporter);
+      if (algorithm.run() != mta::SUCCESS)
+      {
+         return false;
+      }
+
+      if ((pAbortFlag != NULL && *pAbortFlag) || output.mCount == 0.0)
+      {
+         return false;
+      }
+
+      for (unsigned int row = 0; row < numBands; ++row)
+      {
+         for (unsigned int column = row; column < numBands; ++column)
+         {
+            double value = output.mScatter[row * numBands + column] / output.mCount;
+            if (centered == false)
+            {
+               value += output.mMeans[row] * output.mMeans[column];
+            }
+
+            pMatrix[row * numBands + column] = value;
+            pMatrix[column * numBands + row] = value;
+         }
+      }
+
+      if (pMeans != NULL)
+      {
+         std::copy(output.mMeans.begin(), output.mMeans.end(), pMeans);
+      }
+
+      return true;
+   }
+}
+
+bool MatrixFunctions::computeCovarianceMatrix(double* pMatrix, const RasterElement* pRaster, const BitMask* pMask,
+   int rowFactor, int columnFactor, Progress* pProgress, const bool* pAbortFlag, double* pMeans)
+{
+   return computeMoments(pMatrix, pRaster, pMask, rowFactor, columnFactor, pProgress, pAbortFlag, pMeans, true);
+}
+
+bool MatrixFunctions::computeSecondMomentMatrix(double* pMatrix, const RasterElement* pRaster,
+   const BitMask* pMask, int rowFactor, int columnFactor, Progress* pProgress, const bool* pAbortFlag,
+   double* pMeans)
+{
+   return computeMoments(pMatrix, pRaster, pMask, rowFactor, columnFactor, pProgress, pAbortFlag, pMeans, false);
+}
@@ -7,16 +7,114 @@
  * http://www.gnu.org/licenses/lgpl.html
  */
 
+#include "AppConfig.h"
 #include "MultiThreadedAlgorithm.h"
 #include "MessageLogMgrImp.h"
 #include "Progress.h"
+#include "ThreadPool.h"
 #include "Units.h"
+#include "UtilityServices.h"
+
+#if defined(WIN_API)
+#include <intrin.h>
+#pragma intrinsic(_InterlockedCompareExchange, _InterlockedExchange, _InterlockedExchangeAdd)
+#elif defined(SOLARIS)
+#include <atomic.h>
+#endif
 
 using namespace mta;
 
+namespace
+{
+   // Threads queued per worker, so a worker that finishes early picks up another
+   // thread from the queue instead of idling while a slow one completes
+   const unsigned int THREADS_PER_WORKER = 4;
+
+   // Runs one thread of an algorithm in the pool.  The reporter is told that the thread
+   // finished even when the task is discarded without running, such as when the
+   // algorithm is cancelled or the pool is stopped.
+   class AlgorithmTask : public ThreadPool::Task
+   {
+   public:
+      AlgorithmTask(AlgorithmThread* pThread, MultiThreadReporter& reporter) :
+         mpThread(pThread),
+         mReporter(reporter),
+         mFinished(false)
+      {
+      }
+
+      ~AlgorithmTask()
+      {
+         finish();
+      }
+
+      void run()
+      {
+         AlgorithmThread::threadFunction(mpThread);
+         finish();
+      }
+
+   private:
+      AlgorithmTask(const AlgorithmTask& rhs);
+      AlgorithmTask& operator=(const AlgorithmTask& rhs);
+
+      void finish()
+      {
+         if (mFinished == false)
+         {
+            mFinished = true;
+            mReporter.threadFinished();
+         }
+      }
+
+      AlgorithmThread* mpThread;
+      MultiThreadReporter& mReporter;
+      bool mFinished;
+   };
+}
+
+unsigned int mta::getWorkerCount()
+{
+   ThreadPool* pPool = Service<UtilityServices>()->getThreadPool();
+   if (pPool == NULL)
+   {
+      return 1;
+   }
+
+   return std::max(pPool->getThreadCount(), 1U);
+}
+
+void mta::queueAlgorithmThreads(const std::vector<AlgorithmThread*>& threads, MultiThreadReporter& reporter)
+{
+   ThreadPool* pPool = Service<UtilityServices>()->getThreadPool();
+   for (std::vector<AlgorithmThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+   {
+      ThreadPool::TaskPtr pTask(new AlgorithmTask(*iter, reporter));
+      if (pPool == NULL || pPool->queuePriorityTask(pTask, &reporter) == false)
+      {
+         pTask->run();
+      }
+   }
+}
+
+void mta::cancelAlgorithmThreads(MultiThreadReporter& reporter)
+{
+   ThreadPool* pPool = Service<UtilityServices>()->getThreadPool();
+   if (pPool != NULL)
+   {
+      pPool->removeTasks(&reporter);
+   }
+}
+
+bool mta::runQueuedAlgorithmThread(MultiThreadReporter& reporter)
+{
+   ThreadPool* pPool = Service<UtilityServices>()->getThreadPool();
+   return pPool != NULL && pPool->runQueuedTask(&reporter);
+}
+
 unsigned int mta::getNumRequiredThreads(unsigned int dataSize)
 {
-   unsigned int threadCount = ConfigurationSettings::getSettingThreadCount();
+   unsigned int threadCount = getWorkerCount() * THREADS_PER_WORKER;
    // if there are more threads than rows in the data set, we need to clamp
    // the number of threads so we don't have idle threads.
    threadCount = std::min(threadCount, dataSize);
@@ -34,242 +132,229 @@ unsigned int mta::getNumRequiredThreads(unsigned int dataSize)
    return threadCount;
 }
 
+//------------ AtomicCounter ---------------//
+
+AtomicCounter::AtomicCounter(int value) :
+   mValue(value)
+{
+}
+
+AtomicCounter::AtomicCounter(const AtomicCounter& counter) :
+   mValue(counter.get())
+{
+}
+
+AtomicCounter& AtomicCounter::operator=(const AtomicCounter& counter)
+{
+   if (&counter != this)
+   {
+      exchange(counter.get());
+   }
+   return *this;
+}
+
+int AtomicCounter::get() const
+{
+   volatile long* pValue = const_cast<volatile long*>(&mValue);
+#if defined(WIN_API)
+   return _InterlockedCompareExchange(pValue, 0, 0);
+#elif defined(SOLARIS)
+   return static_cast<int>(atomic_add_long_nv(reinterpret_cast<volatile ulong_t*>(pValue), 0));
+#else
+   return static_cast<int>(__sync_add_and_fetch(pValue, 0));
+#endif
+}
+
+int AtomicCounter::add(int delta)
+{
+#if defined(WIN_API)
+   return _InterlockedExchangeAdd(&mValue, delta) + delta;
+#elif defined(SOLARIS)
+   return static_cast<int>(atomic_add_long_nv(reinterpret_cast<volatile ulong_t*>(&mValue), delta));
+#else
+   return static_cast<int>(__sync_add_and_fetch(&mValue, delta));
+#endif
+}
+
+int AtomicCounter::exchange(int value)
+{
+#if defined(WIN_API)
+   return _InterlockedExchange(&mValue, value);
+#elif defined(SOLARIS)
+   return static_cast<int>(atomic_swap_ulong(reinterpret_cast<volatile ulong_t*>(&mValue), value));
+#else
+   __sync_synchronize();
+   return static_cast<int>(__sync_lock_test_and_set(&mValue, value));
+#endif
+}
+
 //------------ MultiThreadReporter ---------------//
 
 /*
-   The interplay between the thread reporter (via signalMainThread) and the
-   main thread's waitForThreadsToComplete method is as follows:
-
-   Main Thread                         Thread Reporter::signalMainThread
-   -----------                         ---------------
-   Lock mutex a
-   Start Threads
-                     ** Time 1 **
-   Wait on signal a (unlocks mutex a)  (Thread Starts)
-                     ** Time 2 **
-                                       Lock mutex a
-                                       Unlock mutex a
-                                       Set info for main thread
-                                       Lock mutex b
-                                       Send signal a
-                     ** Time 3 **
-   Wake up (locks mutex a)
-                                       Wait on signal b (unlocks mutex b)
-                     ** Time 4 **
-   Lock mutex b
-   Get info from thread reporter
-   Do work
-   Send signal b
-                     ** Time 5 **
-   Unlock mutex b                      Wake up (locks mutex b)
-                                       Unlock mutex b
-   Loop
+   Threads report progress by updating their own counter and the total without
+   taking a lock, so the main thread polls the progress.  The main thread only
+   sleeps on mReportSignal, which is sent when a thread reports an error, when a
+   thread needs a command run in the main thread and when the last thread finishes.
+   A thread which sent a command sleeps on mCommandSignal until the main thread
+   has run it.
 */
 
-struct ProgressFunctor : public ThreadCommand
+MultiThreadReporter::MultiThreadReporter(int threadCount) :
+   mThreadCount(threadCount),
+   mThreadProgress(std::max(threadCount, 0)),
+   mMainThread(pthread_self()),
+   mResult(SUCCESS),
+   mpThreadCommand(NULL),
+   mFinishedCount(0),
+   mReportPending(false)
 {
-   ProgressFunctor(int *pProgressValue, int percent) : 
-      mpProgressValue(pProgressValue), mPercent(percent) {}
-   void run()
-   {
-      *mpProgressValue = mPercent;
-   }
-private:
-   int* mpProgressValue;
-   int mPercent;
-};
-struct CompletionFunctor : public ProgressFunctor
-{
-   CompletionFunctor(int *pProgressValue) : ProgressFunctor(pProgressValue, 100) {}
-};
-struct ErrorFunctor : public ThreadCommand
-{
-   ErrorFunctor(std::string errorText, std::string& errorMessage, Result *pResult) : 
-      mErrorText(errorText), mMessage(errorMessage), mpResult(pResult) {}
-   void run()
-   {
-      mMessage = mErrorText;
-      *mpResult = FAILURE;
-   }
-private:
-   std::string mErrorText;
-   std::string& mMessage;
-   Result* mpResult;
-};
-struct WorkFunctor : public ThreadCommand
-{
-   WorkFunctor(ThreadCommand*&pCommand, ThreadCommand& command) : 
-      mpCommand(pCommand), mCommand(command) {}
-   void run()
-   {
-      mpCommand = &mCommand;
-   }
-private:
-   ThreadCommand*& mpCommand;
-   ThreadCommand& mCommand;
-};
-
-MultiThreadReporter::MultiThreadReporter(int threadCount, Result* pResult, 
-        BMutex &mutexA, BThreadSignal& signalA, BMutex &mutexB, BThreadSignal& signalB) : 
-   mMutexA(mutexA), mSignalA(signalA), mMutexB(mutexB), mSignalB(signalB), 
-   mpResult(pResult), mThreadProgress(threadCount), 
-   mReportType(THREAD_NO_REPORT), mpThreadCommand(NULL)
-{
-   if (threadCount == 0 && pResult != NULL)
+   if (threadCount <= 0)
    {
-      *mpResult = FAILURE;
+      mResult = FAILURE;
+      mFailed.exchange(1);
       mErrorMessage = "Error: Thread count = 0";
    }
 }
 
-MultiThreadReporter::MultiThreadReporter(MultiThreadReporter &reporter) :
-   mMutexA(reporter.mMutexA), mSignalA(reporter.mSignalA), mMutexB(reporter.mMutexB), mSignalB(reporter.mSignalB), 
-   mpResult(reporter.mpResult), mThreadProgress(reporter.mThreadProgress), mErrorMessage(reporter.mErrorMessage),
-   mReportType(reporter.mReportType), mpThreadCommand(NULL)
-{
-   Result result = *mpResult;
-}
-
 Result MultiThreadReporter::reportProgress(int threadIndex, int percentDone)
 {
-   Result result = SUCCESS;
-   if (percentDone != mThreadProgress[threadIndex])
+   if (threadIndex >= 0 && threadIndex < mThreadCount)
    {
-      ProgressFunctor cmd(&mThreadProgress[threadIndex], percentDone);
-      result = signalMainThread(cmd, THREAD_PROGRESS);
+      int previous = mThreadProgress[threadIndex].exchange(percentDone);
+      if (previous != percentDone)
+      {
+         mTotalProgress.add(percentDone - previous);
+      }
    }
-   return result;
+
+   return (mFailed.get() == 0) ? SUCCESS : FAILURE;
 }
 
 Result MultiThreadReporter::reportError(std::string errorText)
 {
-   ErrorFunctor cmd(errorText, mErrorMessage, mpResult);
-   return signalMainThread(cmd, THREAD_ERROR);
+   MutexLock lock(mMutex);
+   if (mResult == SUCCESS)
+   {
+      mErrorMessage = errorText;
+      mResult = FAILURE;
+      mFailed.exchange(1);
+      mReportPending = true;
+      mReportSignal.ThreadSignalActivate();
+   }
+
+   return mResult;
 }
 
 Result MultiThreadReporter::reportCompletion(int threadIndex)
 {
-   CompletionFunctor cmd(&mThreadProgress[threadIndex]);
-   return signalMainThread(cmd, THREAD_COMPLETE);
+   return reportProgress(threadIndex, 100);
 }
 
 void MultiThreadReporter::runInMainThread(ThreadCommand &command)
 {
-   WorkFunctor cmd(mpThreadCommand, command);
-   signalMainThread(cmd, THREAD_WORK);
+   if (pthread_equal(mMainThread, pthread_self()) != 0)
+   {
+      command.run();
+      return;
+   }
+
+   MutexLock lock(mMutex);
+   while (mpThreadCommand != NULL)
+   {
+      mCommandSignal.ThreadSignalWait(&mMutex);
+   }
+
+   if (mResult != SUCCESS)
+   {
+      return;
+   }
+
+   mpThreadCommand = &command;
+   mReportPending = true;
+   mReportSignal.ThreadSignalActivate();
+   while (mpThreadCommand == &command)
+   {
+      mCommandSignal.ThreadSignalWait(&mMutex);
+   }
 }
 
-void MultiThreadReporter::setReportType(ReportType type)
+Result MultiThreadReporter::getResult() const
 {
-   mReportType = type;
+   MutexLock lock(mMutex);
+   return mResult;
 }
 
-unsigned int MultiThreadReporter::getReportType() const
+void MultiThreadReporter::threadFinished()
 {
-   return mReportType;
+   // the count is changed with the mutex held so the main thread cannot see the last
+   // thread finish and destroy the reporter before the mutex is released
+   MutexLock lock(mMutex);
+   if (++mFinishedCount >= mThreadCount)
+   {
+      mReportPending = true;
+      mReportSignal.ThreadSignalActivate();
+   }
 }
 
-ThreadCommand* MultiThreadReporter::getThreadCommand()
+bool MultiThreadReporter::processReports(unsigned int timeout)
 {
-   return mpThreadCommand;
+   MutexLock lock(mMutex);
+   if (timeout > 0 && mReportPending == false && mFinishedCount < mThreadCount)
+   {
+      mReportSignal.ThreadSignalTimedWait(&mMutex, timeout);
+   }
+   mReportPending = false;
+
+   if (mpThreadCommand != NULL)
+   {
+      ThreadCommand* pCommand = mpThreadCommand;
+      mMutex.MutexUnlock();
+      pCommand->run();
+      mMutex.MutexLock();
+
+      mpThreadCommand = NULL;
+      mCommandSignal.ThreadSignalBroadcast();
+   }
+
+   return mFinishedCount >= mThreadCount;
 }
 
 int MultiThreadReporter::getProgress() const 
 { 
-   MutexLock lock(mReporterMutex);
-   int total = std::accumulate(mThreadProgress.begin(), mThreadProgress.end(), 0) / mThreadProgress.size(); 
-   return total;
+   if (mThreadCount <= 0)
+   {
+      return 0;
+   }
+   return mTotalProgress.get() / mThreadCount;
 }
 
 int MultiThreadReporter::getProgress(int threadIndex) const 
 { 
-   MutexLock lock(mReporterMutex);
-   return mThreadProgress[threadIndex];
+   if (threadIndex < 0 || threadIndex >= mThreadCount)
+   {
+      return 0;
+   }
+   return mThreadProgress[threadIndex].get();
 }
 
 std::string MultiThreadReporter::getErrorText() const 
 { 
-   MutexLock lock(mReporterMutex);
+   MutexLock lock(mMutex);
    return mErrorMessage; 
 }
 
-Result MultiThreadReporter::signalMainThread(ThreadCommand& reportStatus, ReportType type)
-{
-   MutexLock lock(mSignalMutex);
-
-   Result currentResult = SUCCESS;
-   if (mpResult != NULL)
-   {
-      currentResult = *mpResult;
-   }
-
-   if (currentResult == SUCCESS)
-   {
-      {
-         MutexLock reporterLock(mReporterMutex);
-         reportStatus.run();
-      }
-      mReportType |= type;
-      if (mpResult != NULL)
-      {
-         currentResult = *mpResult;
-      }
-
-      { // scope the lock
-         // ensures that the main thread is in its ThreadSignalWait
-         mMutexA.MutexLock();
-         mMutexA.MutexUnlock();
-
-         MutexLock lockB(mMutexB);
-         mSignalA.ThreadSignalActivate(); // wake up main thread
-         if (type != THREAD_COMPLETE)
-         {
-            mSignalB.ThreadSignalWait(&mMutexB); // wait for main thread to say its done
-         }
-      }
-
-      // clear the work command - this must be done while mSignalMutex is owned
-      if (type == THREAD_WORK)
-      {
-         mpThreadCommand = NULL;
-      }
-   }
-
-   return currentResult;
-}
-
 //------------ AlgorithmThread ---------------//
 
 void AlgorithmThread::threadFunction(AlgorithmThread *pThreadData)
 {
    pThreadData->waitForAlgorithmLoop();
    pThreadData->run();
-   if (pThreadData->getReporter().getErrorText() == "")
+
+   ThreadReporter& reporter = pThreadData->getReporter();
+   if (reporter.getErrorText().empty() && reporter.getProgress(pThreadData->getThreadIndex()) != 100)
    {
-      if (pThreadData->getReporter().getProgress(pThreadData->getThreadIndex()) != 100)
-      {
-         pThreadData->getReporter().reportProgress(pThreadData->getThreadIndex(), 100);
-      }
+      reporter.reportCompletion(pThreadData->getThreadIndex());
    }
-   if (pThreadData->getReporter().getErrorText() == "")
-   {
-      if (pThreadData->getReporter().getProgress(pThreadData->getThreadIndex()) != 100)
-      {
-         pThreadData->getReporter().reportCompletion(pThreadData->getThreadIndex());
-      }
-   }
-}
-
-bool AlgorithmThread::launch()
-{
-   mThreadHandle.ThreadLaunch();
-   return true;
-}
-
-bool AlgorithmThread::wait()
-{
-   mThreadHandle.ThreadWait();
-   return true;
 }
 
 AlgorithmThread::Range AlgorithmThread::getThreadRange(int threadCount, int dataSize) const
@@ -8,28 +8,69 @@
  */
 
 #include "AppVerify.h"
+#include "CacheBudget.h"
 #include "DataRequest.h"
 #include "PageCache.h"
 #include "TypesFile.h"
+#include "UtilityServices.h"
 
-#include <algorithm>
-#include <boost/bind.hpp>
-#include <sstream>
+#include <limits>
 using namespace std;
 
-PageCache::PageCache(const size_t maxCacheSize) :
-   MAX_CACHE_SIZE(maxCacheSize),
-   mCacheSize(0)
+const unsigned int PageCache::ALL_BANDS_KEY = numeric_limits<unsigned int>::max();
+
+PageCache::Shard::Shard() :
+   mMaxUnitRows(0)
+{
+}
+
+PageCache::PageCache() :
+   mpBudget(Service<UtilityServices>()->getCacheBudget())
 {
    initialize(0, 0, 0);
 }
 
 PageCache::~PageCache()
 {
+   mpBudget->removeOwner(this);
+}
+
+void PageCache::setMaximumCacheSize(size_t maxCacheSize)
+{
+   Service<UtilityServices>()->getCacheBudget()->setMaximumSize(maxCacheSize);
+}
+
+size_t PageCache::getMaximumCacheSize()
+{
+   return Service<UtilityServices>()->getCacheBudget()->getMaximumSize();
+}
+
+size_t PageCache::getTotalCacheSize()
+{
+   return Service<UtilityServices>()->getCacheBudget()->getTotalSize();
+}
+
+void PageCache::setCacheLimit(size_t cacheLimit)
+{
+   mpBudget->setOwnerMaximumSize(this, cacheLimit);
+}
+
+unsigned int PageCache::getBandKey(DimensionDescriptor band)
+{
+   if (band.isActiveNumberValid() == false)
+   {
+      return ALL_BANDS_KEY;
+   }
+   return band.getActiveNumber();
+}
+
+PageCache::Shard& PageCache::getShard(unsigned int bandKey)
+{
+   return mShards[bandKey % SHARD_COUNT];
 }
 
 CachedPage::UnitPtr PageCache::getUnit(DataRequest *pOriginalRequest,
-   DimensionDescriptor startRow, 
+   DimensionDescriptor startRow,
    DimensionDescriptor startBand)
 {
    CachedPage::UnitPtr pUnit;
@@ -44,33 +85,76 @@ CachedPage::UnitPtr PageCache::getUnit(DataRequest *pOriginalRequest,
    {
       band = startBand;
    }
-   UnitList ::iterator ppMatchingUnit = find_if (mUnits.begin(), mUnits.end(), 
-      boost::bind(&CachedPage::CacheUnit::matches, _1, startRow, concurrentRows, band));
 
-   if (ppMatchingUnit != mUnits.end()) // cache hit
+   unsigned int bandKey = getBandKey(band);
+   unsigned int row = startRow.getActiveNumber();
+   Shard& shard = getShard(bandKey);
    {
-      pUnit = (*ppMatchingUnit);
+      mta::MutexLock lock(shard.mMutex);
+
+      // Walk backwards from the last unit starting at or before the requested row.  Units
+      // never span more than mMaxUnitRows rows, so the walk stops as soon as one could not
+      // reach the requested row.
+      UnitIndex::iterator pEntry = shard.mUnits.upper_bound(UnitKey(bandKey, row));
+      while (pEntry != shard.mUnits.begin())
+      {
+         --pEntry;
+         if (pEntry->first.first != bandKey || pEntry->first.second + shard.mMaxUnitRows <= row)
+         {
+            break;
+         }
+
+         CachedPage::UnitPtr pCandidate = pEntry->second.lock();
+         if (pCandidate.get() == NULL)
+         {
+            // evicted; drop the stale index entry
+            shard.mUnits.erase(pEntry++);
+            continue;
+         }
+
+         if (pCandidate->matches(startRow, concurrentRows, band))
+         {
+            pUnit = pCandidate;
+            break;
+         }
+      }
+   }
 
-      // Remove from the list -- it will be re-added to the end in createPage()
-      mUnits.erase(ppMatchingUnit);
-      mCacheSize -= pUnit->getSize();
+   if (pUnit.get() != NULL && mpBudget->touch(pUnit.get()) == false)
+   {
+      // evicted between the lookup and the touch, so re-charge it against the budget
+      mpBudget->insert(this, pUnit);
    }
 
    return pUnit;
 }
 
+void PageCache::insertUnit(CachedPage::UnitPtr pUnit)
+{
+   if (pUnit.get() == NULL)
+   {
+      return;
+   }
+
+   unsigned int bandKey = getBandKey(pUnit->getBand());
+   Shard& shard = getShard(bandKey);
+   {
+      mta::MutexLock lock(shard.mMutex);
+      shard.mUnits[UnitKey(bandKey, pUnit->getStartRow().getActiveNumber())] = pUnit;
+      shard.mMaxUnitRows = max(shard.mMaxUnitRows, pUnit->getConcurrentRows());
+   }
+
+   mpBudget->insert(this, pUnit);
+}
+
 CachedPage *PageCache::createPage(CachedPage::UnitPtr pUnit, InterleaveFormatType requestedFormat,
-   DimensionDescriptor startRow, DimensionDescriptor startColumn, DimensionDescriptor startBand)
+   DimensionDescriptor startRow, DimensionDescriptor startColumn, DimensionDescriptor startBand) const
 {
    if (pUnit.get() == NULL)
    {
       return NULL;
    }
 
-   mUnits.push_back(pUnit);
-   mCacheSize += pUnit->getSize();
-   enforceCacheSize();
-
    int columnOffset = mColumnCount*(startRow.getActiveNumber()-pUnit->getStartRow().getActiveNumber());
    unsigned int offset = 0;
    if (requestedFormat == BIP)
@@ -98,15 +182,6 @@ CachedPage *PageCache::createPage(CachedPage::UnitPtr pUnit, InterleaveFormatTyp
    return new CachedPage(pUnit, offset, startRow);
 }
 
-void PageCache::enforceCacheSize()
-{
-   while (mCacheSize > MAX_CACHE_SIZE && !mUnits.empty())
-   {
-      mCacheSize -= mUnits.front()->getSize();
-      mUnits.pop_front();
-   }
-}
-
 void PageCache::initialize(int bytesPerBand, int columnCount, int bandCount)
 {
    mBytesPerBand = bytesPerBand;
@@ -0,0 +1,198 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "FileResource.h"
+#include "RasterFileWriter.h"
+#include "RasterSubsetReader.h"
+#include "ThreadPool.h"
+#include "UtilityServices.h"
+
+#include <algorithm>
+
+namespace
+{
+   // Blocks are sized to fill a staging buffer of about this many bytes
+   const size_t STAGING_BUFFER_SIZE = 16 * 1024 * 1024;
+}
+
+/**
+ * Writes a staging buffer to the file from the application's thread pool.
+ */
+class RasterFileWriter::WriteTask : public mta::ThreadPool::Task
+{
+public:
+   WriteTask(RasterFileWriter* pWriter, unsigned int buffer, unsigned int startRow, unsigned int rowCount) :
+      mpWriter(pWriter),
+      mBuffer(buffer),
+      mStartRow(startRow),
+      mRowCount(rowCount)
+   {
+   }
+
+   void run()
+   {
+      mpWriter->writeBuffer(mBuffer, mStartRow, mRowCount);
+   }
+
+private:
+   RasterFileWriter* mpWriter;
+   unsigned int mBuffer;
+   unsigned int mStartRow;
+   unsigned int mRowCount;
+};
+
+RasterFileWriter::RasterFileWriter(RasterSubsetReader& reader, LargeFileResource& file) :
+   mReader(reader),
+   mFile(file),
+   mBandRowBytes(static_cast<size_t>(reader.getColumnCount()) * reader.getBytesPerElement()),
+   mRowBytes(mBandRowBytes * reader.getBandCount()),
+   mRowsPerBlock(1),
+   mNextBuffer(0),
+   mWriteError(false),
+   mpPool(Service<UtilityServices>()->getThreadPool())
+{
+   if (mRowBytes > 0)
+   {
+      size_t rowsPerBlock = std::max(STAGING_BUFFER_SIZE / mRowBytes, static_cast<size_t>(1));
+      mRowsPerBlock = static_cast<unsigned int>(std::min(rowsPerBlock,
+         static_cast<size_t>(std::max(reader.getRowCount(), 1U))));
+   }
+
+   for (unsigned int i = 0; i < 2; ++i)
+   {
+      mBuffers[i].mFailed = false;
+   }
+}
+
+RasterFileWriter::~RasterFileWriter()
+{
+   cancel();
+}
+
+unsigned int RasterFileWriter::getBlockCount() const
+{
+   return (mReader.getRowCount() + mRowsPerBlock - 1) / mRowsPerBlock;
+}
+
+unsigned int RasterFileWriter::getRowsPerBlock() const
+{
+   return mRowsPerBlock;
+}
+
+bool RasterFileWriter::writeBlock(unsigned int block)
+{
+   VERIFY(block < getBlockCount());
+
+   // Wait until the previous block in this buffer has been written before reusing it
+   StagingBuffer& buffer = mBuffers[mNextBuffer];
+   if (mpPool != NULL)
+   {
+      mpPool->waitForTasks(&buffer);
+   }
+
+   if (buffer.mFailed == true)
+   {
+      mWriteError = true;
+   }
+
+   if (mWriteError == true)
+   {
+      return false;
+   }
+
+   unsigned int startRow = block * mRowsPerBlock;
+   unsigned int rowCount = std::min(mRowsPerBlock, mReader.getRowCount() - startRow);
+   if (buffer.mData.empty() == true)
+   {
+      buffer.mData.resize(mRowsPerBlock * mRowBytes);
+   }
+
+   if (mRowBytes > 0 && mReader.read(startRow, rowCount, &buffer.mData.front()) == false)
+   {
+      return false;
+   }
+
+   // The block is written in this thread when the pool is not running
+   mta::ThreadPool::TaskPtr pTask(new WriteTask(this, mNextBuffer, startRow, rowCount));
+   if (mpPool == NULL || mpPool->queueTask(pTask, &buffer) == false)
+   {
+      pTask->run();
+   }
+
+   mNextBuffer = 1 - mNextBuffer;
+   return true;
+}
+
+bool RasterFileWriter::finish()
+{
+   for (unsigned int i = 0; i < 2; ++i)
+   {
+      if (mpPool != NULL)
+      {
+         mpPool->waitForTasks(&mBuffers[i]);
+      }
+
+      if (mBuffers[i].mFailed == true)
+      {
+         mWriteError = true;
+      }
+   }
+
+   return mWriteError == false;
+}
+
+void RasterFileWriter::cancel()
+{
+   for (unsigned int i = 0; i < 2 && mpPool != NULL; ++i)
+   {
+      mpPool->cancelTasks(&mBuffers[i]);
+   }
+}
+
+bool RasterFileWriter::hasWriteError() const
+{
+   return mWriteError;
+}
+
+void RasterFileWriter::writeBuffer(unsigned int buffer, unsigned int startRow, unsigned int rowCount)
+{
+   StagingBuffer& staging = mBuffers[buffer];
+   if (staging.mFailed == true || rowCount == 0 || mRowBytes == 0)
+   {
+      return;
+   }
+
+   const char* pData = &staging.mData.front();
+   mta::MutexLock lock(mFileMutex);
+   if (mReader.getInterleaveFormat() == BSQ)
+   {
+      // Each band of the block is contiguous in both the buffer and the file
+      int64_t bandBytes = static_cast<int64_t>(rowCount) * mBandRowBytes;
+      int64_t bandFileBytes = static_cast<int64_t>(mReader.getRowCount()) * mBandRowBytes;
+      for (unsigned int band = 0; band < mReader.getBandCount(); ++band)
+      {
+         int64_t offset = band * bandFileBytes + static_cast<int64_t>(startRow) * mBandRowBytes;
+         if (mFile.seek(offset, SEEK_SET) != offset || mFile.write(pData + band * bandBytes, bandBytes) != bandBytes)
+         {
+            staging.mFailed = true;
+            return;
+         }
+      }
+   }
+   else
+   {
+      int64_t offset = static_cast<int64_t>(startRow) * mRowBytes;
+      int64_t blockBytes = static_cast<int64_t>(rowCount) * mRowBytes;
+      if (mFile.seek(offset, SEEK_SET) != offset || mFile.write(pData, blockBytes) != blockBytes)
+      {
+         staging.mFailed = true;
+      }
+   }
+}
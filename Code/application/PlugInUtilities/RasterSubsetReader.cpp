@@ -0,0 +1,260 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "ObjectResource.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterSubsetReader.h"
+#include "RasterUtilities.h"
+
+#include <algorithm>
+
+namespace
+{
+   // BSQ data is read through one accessor per band, so bands are gathered this many at a time
+   const unsigned int BAND_GROUP_SIZE = 16;
+}
+
+RasterSubsetReader::RasterSubsetReader(RasterElement* pRaster, const std::vector<DimensionDescriptor>& rows,
+                                       const std::vector<DimensionDescriptor>& columns,
+                                       const std::vector<DimensionDescriptor>& bands,
+                                       InterleaveFormatType interleave) :
+   mpRaster(pRaster),
+   mRows(rows),
+   mBands(bands),
+   mColumnCount(static_cast<unsigned int>(columns.size())),
+   mBytesPerElement(0),
+   mInterleave(interleave),
+   mSourceColumnStride(0),
+   mSourceBandStride(0)
+{
+   if (mpRaster != NULL)
+   {
+      const RasterDataDescriptor* pDescriptor =
+         dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+      if (pDescriptor != NULL)
+      {
+         mBytesPerElement = pDescriptor->getBytesPerElement();
+         mSourceInterleave = pDescriptor->getInterleaveFormat();
+      }
+   }
+
+   for (unsigned int i = 0; i < mColumnCount; ++i)
+   {
+      unsigned int column = columns[i].getActiveNumber();
+      if (mColumnRuns.empty() == false)
+      {
+         ColumnRun& run = mColumnRuns.back();
+         if (run.mCount == 1 && column > run.mSourceColumn)
+         {
+            run.mStep = column - run.mSourceColumn;
+            run.mCount = 2;
+            continue;
+         }
+
+         if (run.mCount > 1 && column == run.mSourceColumn + run.mCount * run.mStep)
+         {
+            ++run.mCount;
+            continue;
+         }
+      }
+
+      ColumnRun run;
+      run.mIndex = i;
+      run.mSourceColumn = column;
+      run.mStep = 1;
+      run.mCount = 1;
+      mColumnRuns.push_back(run);
+   }
+}
+
+unsigned int RasterSubsetReader::getRowCount() const
+{
+   return static_cast<unsigned int>(mRows.size());
+}
+
+unsigned int RasterSubsetReader::getColumnCount() const
+{
+   return mColumnCount;
+}
+
+unsigned int RasterSubsetReader::getBandCount() const
+{
+   return static_cast<unsigned int>(mBands.size());
+}
+
+unsigned int RasterSubsetReader::getBytesPerElement() const
+{
+   return mBytesPerElement;
+}
+
+InterleaveFormatType RasterSubsetReader::getInterleaveFormat() const
+{
+   return mInterleave;
+}
+
+bool RasterSubsetReader::read(unsigned int startRow, unsigned int rowCount, void* pBuffer)
+{
+   return read(startRow, rowCount, 0, getBandCount(), pBuffer);
+}
+
+bool RasterSubsetReader::read(unsigned int startRow, unsigned int rowCount, unsigned int startBand,
+                              unsigned int bandCount, void* pBuffer)
+{
+   VERIFY(mpRaster != NULL && mBytesPerElement > 0 && mInterleave.isValid() && mSourceInterleave.isValid());
+   VERIFY(pBuffer != NULL && startRow + rowCount <= mRows.size() && startBand + bandCount <= mBands.size());
+   if (rowCount == 0 || bandCount == 0 || mColumnCount == 0)
+   {
+      return true;
+   }
+
+   // Strides of the data in the caller's buffer
+   Strides strides;
+   strides.mColumn = mBytesPerElement;
+   strides.mBand = mBytesPerElement;
+   strides.mRow = static_cast<size_t>(mColumnCount) * bandCount * mBytesPerElement;
+   if (mInterleave == BIP)
+   {
+      strides.mColumn = static_cast<size_t>(bandCount) * mBytesPerElement;
+   }
+   else if (mInterleave == BIL)
+   {
+      strides.mBand = static_cast<size_t>(mColumnCount) * mBytesPerElement;
+   }
+   else
+   {
+      strides.mRow = static_cast<size_t>(mColumnCount) * mBytesPerElement;
+      strides.mBand = strides.mRow * rowCount;
+   }
+
+   unsigned char* pData = reinterpret_cast<unsigned char*>(pBuffer);
+   if (mSourceInterleave == BSQ)
+   {
+      return readBandRows(startRow, rowCount, startBand, bandCount, strides, pData);
+   }
+
+   return readInterleavedRows(startRow, rowCount, startBand, bandCount, strides, pData);
+}
+
+bool RasterSubsetReader::readInterleavedRows(unsigned int startRow, unsigned int rowCount, unsigned int startBand,
+                                             unsigned int bandCount, const Strides& strides, unsigned char* pBuffer)
+{
+   // BIP and BIL rows hold every band, so one accessor is kept for all of the reads
+   if (mAccessors.empty())
+   {
+      FactoryResource<DataRequest> pRequest;
+      pRequest->setInterleaveFormat(mSourceInterleave);
+      pRequest->setRows(mRows.front(), mRows.back(), 1);
+      DataAccessor accessor = mpRaster->getDataAccessor(pRequest.release());
+      if (accessor.isValid() == false)
+      {
+         return false;
+      }
+
+      mSourceColumnStride = mBytesPerElement;
+      mSourceBandStride = mBytesPerElement;
+      if (mSourceInterleave == BIP)
+      {
+         mSourceColumnStride = accessor->getRowSize() / accessor->getConcurrentColumns();
+      }
+      else
+      {
+         mSourceBandStride = accessor->getConcurrentColumns() * mBytesPerElement;
+      }
+
+      mAccessors.push_back(accessor);
+   }
+
+   DataAccessor& accessor = mAccessors.front();
+   std::vector<unsigned char*> sourceRows(bandCount);
+   std::vector<unsigned char*> bufferRows(bandCount);
+   for (unsigned int row = 0; row < rowCount; ++row)
+   {
+      accessor->toPixel(mRows[startRow + row].getActiveNumber(), 0);
+      if (accessor.isValid() == false)
+      {
+         return false;
+      }
+
+      unsigned char* pRow = reinterpret_cast<unsigned char*>(accessor->getRow());
+      for (unsigned int i = 0; i < bandCount; ++i)
+      {
+         sourceRows[i] = pRow + mBands[startBand + i].getActiveNumber() * mSourceBandStride;
+         bufferRows[i] = pBuffer + row * strides.mRow + i * strides.mBand;
+      }
+
+      copyRuns(&sourceRows[0], mSourceColumnStride, &bufferRows[0], strides.mColumn, bandCount);
+   }
+
+   return true;
+}
+
+bool RasterSubsetReader::readBandRows(unsigned int startRow, unsigned int rowCount, unsigned int startBand,
+                                      unsigned int bandCount, const Strides& strides, unsigned char* pBuffer)
+{
+   std::vector<unsigned char*> sourceRows(BAND_GROUP_SIZE);
+   std::vector<unsigned char*> bufferRows(BAND_GROUP_SIZE);
+   for (unsigned int group = 0; group < bandCount; group += BAND_GROUP_SIZE)
+   {
+      unsigned int groupCount = std::min(BAND_GROUP_SIZE, bandCount - group);
+
+      std::vector<DataAccessor> accessors;
+      for (unsigned int i = 0; i < groupCount; ++i)
+      {
+         const DimensionDescriptor& band = mBands[startBand + group + i];
+
+         FactoryResource<DataRequest> pRequest;
+         pRequest->setInterleaveFormat(BSQ);
+         pRequest->setRows(mRows[startRow], mRows[startRow + rowCount - 1], 1);
+         pRequest->setBands(band, band, 1);
+         accessors.push_back(mpRaster->getDataAccessor(pRequest.release()));
+      }
+
+      for (unsigned int row = 0; row < rowCount; ++row)
+      {
+         for (unsigned int i = 0; i < groupCount; ++i)
+         {
+            DataAccessor& accessor = accessors[i];
+            accessor->toPixel(mRows[startRow + row].getActiveNumber(), 0);
+            if (accessor.isValid() == false)
+            {
+               return false;
+            }
+
+            sourceRows[i] = reinterpret_cast<unsigned char*>(accessor->getRow());
+            bufferRows[i] = pBuffer + row * strides.mRow + (group + i) * strides.mBand;
+         }
+
+         copyRuns(&sourceRows[0], mBytesPerElement, &bufferRows[0], strides.mColumn, groupCount);
+      }
+   }
+
+   return true;
+}
+
+void RasterSubsetReader::copyRuns(unsigned char* const* pSrc, size_t srcStride, unsigned char* const* pDst,
+                                  size_t dstStride, unsigned int bandCount)
+{
+   mSourceRuns.resize(bandCount);
+   mBufferRuns.resize(bandCount);
+   for (std::vector<ColumnRun>::const_iterator iter = mColumnRuns.begin(); iter != mColumnRuns.end(); ++iter)
+   {
+      for (unsigned int i = 0; i < bandCount; ++i)
+      {
+         mSourceRuns[i] = pSrc[i] + iter->mSourceColumn * srcStride;
+         mBufferRuns[i] = pDst[i] + iter->mIndex * dstStride;
+      }
+
+      RasterUtilities::copyElements(&mSourceRuns[0], iter->mStep * srcStride, &mBufferRuns[0], dstStride,
+         bandCount, iter->mCount, mBytesPerElement);
+   }
+}
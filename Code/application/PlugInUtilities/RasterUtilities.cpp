@@ -31,6 +31,7 @@
 #include <algorithm>
 #include <boost/bind.hpp>
 #include <sstream>
+#include <string.h>
 
 namespace
 {
@@ -493,6 +494,121 @@ size_t RasterUtilities::bytesInEncoding(EncodingType encoding)
    return 0;
 }
 
+namespace
+{
+   // The source and destination elements touched by one tile of a transpose fit in the L1 cache
+   const size_t TILE_SIZE = 16 * 1024;
+
+   template<typename T>
+   bool isAligned(unsigned char* const* pPointers, unsigned int count, size_t stride)
+   {
+      if (stride % sizeof(T) != 0)
+      {
+         return false;
+      }
+
+      for (unsigned int i = 0; i < count; ++i)
+      {
+         if (reinterpret_cast<size_t>(pPointers[i]) % sizeof(T) != 0)
+         {
+            return false;
+         }
+      }
+
+      return true;
+   }
+
+   template<typename T>
+   void copyTiles(unsigned char* const* pSrc, size_t srcStride, unsigned char* const* pDst, size_t dstStride,
+      unsigned int bands, unsigned int columns, unsigned int tileColumns)
+   {
+      const size_t srcStep = srcStride / sizeof(T);
+      const size_t dstStep = dstStride / sizeof(T);
+      for (unsigned int tile = 0; tile < columns; tile += tileColumns)
+      {
+         const unsigned int count = std::min(tileColumns, columns - tile);
+         for (unsigned int band = 0; band < bands; ++band)
+         {
+            const T* pS = reinterpret_cast<const T*>(pSrc[band]) + tile * srcStep;
+            T* pD = reinterpret_cast<T*>(pDst[band]) + tile * dstStep;
+            for (unsigned int col = 0; col < count; ++col)
+            {
+               pD[col * dstStep] = pS[col * srcStep];
+            }
+         }
+      }
+   }
+
+   void copyTiles(unsigned char* const* pSrc, size_t srcStride, unsigned char* const* pDst, size_t dstStride,
+      unsigned int bands, unsigned int columns, unsigned int tileColumns, unsigned int bytesPerElement)
+   {
+      for (unsigned int tile = 0; tile < columns; tile += tileColumns)
+      {
+         const unsigned int count = std::min(tileColumns, columns - tile);
+         for (unsigned int band = 0; band < bands; ++band)
+         {
+            const unsigned char* pS = pSrc[band] + tile * srcStride;
+            unsigned char* pD = pDst[band] + tile * dstStride;
+            for (unsigned int col = 0; col < count; ++col)
+            {
+               memcpy(pD, pS, bytesPerElement);
+               pS += srcStride;
+               pD += dstStride;
+            }
+         }
+      }
+   }
+}
+
+void RasterUtilities::copyElements(unsigned char* const* pSrc, size_t srcStride, unsigned char* const* pDst,
+                                    size_t dstStride, unsigned int bands, unsigned int columns,
+                                    unsigned int bytesPerElement)
+{
+   if (srcStride == bytesPerElement && dstStride == bytesPerElement)
+   {
+      for (unsigned int band = 0; band < bands; ++band)
+      {
+         memcpy(pDst[band], pSrc[band], columns * bytesPerElement);
+      }
+
+      return;
+   }
+
+   const unsigned int tileColumns = static_cast<unsigned int>(
+      std::max<size_t>(8, TILE_SIZE / std::max(srcStride, dstStride)));
+   switch (bytesPerElement)
+   {
+   case 1:
+      copyTiles<unsigned char>(pSrc, srcStride, pDst, dstStride, bands, columns, tileColumns);
+      return;
+   case 2:
+      if (isAligned<uint16_t>(pSrc, bands, srcStride) && isAligned<uint16_t>(pDst, bands, dstStride))
+      {
+         copyTiles<uint16_t>(pSrc, srcStride, pDst, dstStride, bands, columns, tileColumns);
+         return;
+      }
+      break;
+   case 4:
+      if (isAligned<uint32_t>(pSrc, bands, srcStride) && isAligned<uint32_t>(pDst, bands, dstStride))
+      {
+         copyTiles<uint32_t>(pSrc, srcStride, pDst, dstStride, bands, columns, tileColumns);
+         return;
+      }
+      break;
+   case 8:
+      if (isAligned<uint64_t>(pSrc, bands, srcStride) && isAligned<uint64_t>(pDst, bands, dstStride))
+      {
+         copyTiles<uint64_t>(pSrc, srcStride, pDst, dstStride, bands, columns, tileColumns);
+         return;
+      }
+      break;
+   default:
+      break;
+   }
+
+   copyTiles(pSrc, srcStride, pDst, dstStride, bands, columns, tileColumns, bytesPerElement);
+}
+
 RasterDataDescriptor* RasterUtilities::generateRasterDataDescriptor(const std::string& name, DataElement* pParent,
                                                                     unsigned int rows, unsigned int columns,
                                                                     EncodingType encoding, ProcessingLocation location)
@@ -0,0 +1,266 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "bthread.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+using namespace mta;
+using namespace std;
+
+namespace
+{
+   typedef pair<const void*, ThreadPool::TaskPtr> QueuedTask;
+
+   void removeGroup(deque<QueuedTask>& tasks, const void* pGroup, vector<ThreadPool::TaskPtr>& removed)
+   {
+      for (deque<QueuedTask>::iterator iter = tasks.begin(); iter != tasks.end();)
+      {
+         if (iter->first == pGroup)
+         {
+            removed.push_back(iter->second);
+            iter = tasks.erase(iter);
+         }
+         else
+         {
+            ++iter;
+         }
+      }
+   }
+
+   bool takeGroupTask(deque<QueuedTask>& tasks, const void* pGroup, QueuedTask& task)
+   {
+      for (deque<QueuedTask>::iterator iter = tasks.begin(); iter != tasks.end(); ++iter)
+      {
+         if (iter->first == pGroup)
+         {
+            task = *iter;
+            tasks.erase(iter);
+            return true;
+         }
+      }
+      return false;
+   }
+
+   bool hasGroup(const deque<QueuedTask>& tasks, const void* pGroup)
+   {
+      for (deque<QueuedTask>::const_iterator iter = tasks.begin(); iter != tasks.end(); ++iter)
+      {
+         if (iter->first == pGroup)
+         {
+            return true;
+         }
+      }
+      return false;
+   }
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount) :
+   mStopping(false)
+{
+   threadCount = max(threadCount, 1U);
+   for (unsigned int i = 0; i < threadCount; ++i)
+   {
+      BThread* pThread = new BThread(static_cast<void*>(this), reinterpret_cast<void*>(ThreadPool::threadFunction));
+      mThreads.push_back(pThread);
+      pThread->ThreadLaunch();
+   }
+}
+
+ThreadPool::~ThreadPool()
+{
+   stop();
+}
+
+unsigned int ThreadPool::getThreadCount() const
+{
+   MutexLock lock(mMutex);
+   return mThreads.size();
+}
+
+bool ThreadPool::queueTask(TaskPtr pTask, const void* pGroup)
+{
+   if (pTask.get() == NULL)
+   {
+      return false;
+   }
+
+   MutexLock lock(mMutex);
+   if (mStopping)
+   {
+      return false;
+   }
+
+   mTasks.push_back(QueuedTask(pGroup, pTask));
+   mTaskQueued.ThreadSignalActivate();
+   return true;
+}
+
+void ThreadPool::cancelTasks(const void* pGroup)
+{
+   vector<TaskPtr> cancelled; // destroyed after the lock is released
+   MutexLock lock(mMutex);
+   removeGroup(mPriorityTasks, pGroup, cancelled);
+   removeGroup(mTasks, pGroup, cancelled);
+
+   while (isGroupRunning(pGroup))
+   {
+      mTaskFinished.ThreadSignalWait(&mMutex);
+   }
+}
+
+void ThreadPool::waitForTasks(const void* pGroup)
+{
+   MutexLock lock(mMutex);
+   while (isGroupQueued(pGroup) || isGroupRunning(pGroup))
+   {
+      mTaskFinished.ThreadSignalWait(&mMutex);
+   }
+}
+
+void ThreadPool::stop()
+{
+   vector<BThread*> threads;
+   deque<QueuedTask> cancelled; // destroyed after the lock is released
+   deque<QueuedTask> cancelledPriority;
+   {
+      MutexLock lock(mMutex);
+      mStopping = true;
+      cancelled.swap(mTasks);
+      cancelledPriority.swap(mPriorityTasks);
+      threads.swap(mThreads);
+      mTaskQueued.ThreadSignalBroadcast();
+      mTaskFinished.ThreadSignalBroadcast();
+   }
+
+   for (vector<BThread*>::iterator iter = threads.begin(); iter != threads.end(); ++iter)
+   {
+      (*iter)->ThreadWait();
+      delete *iter;
+   }
+
+   MutexLock lock(mMutex);
+   mThreadIds.clear();
+}
+
+void ThreadPool::removeTasks(const void* pGroup)
+{
+   vector<TaskPtr> removed; // destroyed after the lock is released
+   MutexLock lock(mMutex);
+   removeGroup(mPriorityTasks, pGroup, removed);
+   removeGroup(mTasks, pGroup, removed);
+}
+
+bool ThreadPool::runQueuedTask(const void* pGroup)
+{
+   MutexLock lock(mMutex);
+   if (isPoolThread() == false)
+   {
+      return false;
+   }
+
+   QueuedTask task;
+   if (takeGroupTask(mPriorityTasks, pGroup, task) || takeGroupTask(mTasks, pGroup, task))
+   {
+      runTask(task);
+      return true;
+   }
+
+   return false;
+}
+
+bool ThreadPool::queuePriorityTask(TaskPtr pTask, const void* pGroup)
+{
+   if (pTask.get() == NULL)
+   {
+      return false;
+   }
+
+   MutexLock lock(mMutex);
+   if (mStopping)
+   {
+      return false;
+   }
+
+   mPriorityTasks.push_back(QueuedTask(pGroup, pTask));
+   mTaskQueued.ThreadSignalActivate();
+   return true;
+}
+
+void ThreadPool::threadFunction(ThreadPool* pPool)
+{
+   if (pPool != NULL)
+   {
+      pPool->processTasks();
+   }
+}
+
+void ThreadPool::processTasks()
+{
+   MutexLock lock(mMutex);
+   mThreadIds.push_back(pthread_self());
+   while (true)
+   {
+      while (mPriorityTasks.empty() && mTasks.empty() && mStopping == false)
+      {
+         mTaskQueued.ThreadSignalWait(&mMutex);
+      }
+      if (mStopping)
+      {
+         break;
+      }
+
+      deque<QueuedTask>& tasks = mPriorityTasks.empty() ? mTasks : mPriorityTasks;
+      QueuedTask task = tasks.front();
+      tasks.pop_front();
+      runTask(task);
+   }
+}
+
+void ThreadPool::runTask(QueuedTask& task)
+{
+   // called with the mutex locked
+   ++mRunningCounts[task.first];
+
+   mMutex.MutexUnlock();
+   task.second->run();
+   task.second.reset();
+   mMutex.MutexLock();
+
+   map<const void*, unsigned int>::iterator count = mRunningCounts.find(task.first);
+   if (count != mRunningCounts.end() && --(count->second) == 0)
+   {
+      mRunningCounts.erase(count);
+   }
+   mTaskFinished.ThreadSignalBroadcast();
+}
+
+bool ThreadPool::isPoolThread() const
+{
+   pthread_t self = pthread_self();
+   for (vector<pthread_t>::const_iterator iter = mThreadIds.begin(); iter != mThreadIds.end(); ++iter)
+   {
+      if (pthread_equal(*iter, self) != 0)
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+bool ThreadPool::isGroupQueued(const void* pGroup) const
+{
+   return hasGroup(mPriorityTasks, pGroup) || hasGroup(mTasks, pGroup);
+}
+
+bool ThreadPool::isGroupRunning(const void* pGroup) const
+{
+   return mRunningCounts.find(pGroup) != mRunningCounts.end();
+}
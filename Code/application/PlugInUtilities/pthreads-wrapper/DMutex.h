@@ -41,6 +41,36 @@ namespace mta
       }
    };
 
+   /**
+    * A DMutex which may be locked again by the thread which holds it.
+    * It must be unlocked once for each time it was locked.
+    */
+   class DRecursiveMutex : public BMutex
+   {
+   public:
+      /**
+       * Create and initialize the DRecursiveMutex.
+       */
+      DRecursiveMutex()
+      {
+         MutexCreate();
+
+         pthread_mutexattr_t attributes;
+         pthread_mutexattr_init(&attributes);
+         pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+         pthread_mutex_init(GetMutexID(), &attributes);
+         pthread_mutexattr_destroy(&attributes);
+      }
+
+      /**
+       * Destroy the DRecursiveMutex.
+       */
+      ~DRecursiveMutex()
+      {
+         MutexDestroy();
+      }
+   };
+
    /**
     * DThreadSignal is a Resource equivalent to a BThreadSignal.
     *
@@ -10,8 +10,15 @@
 
 
 #include <assert.h>
+#include "AppConfig.h"
 #include "bthread_signal.h"
 
+#if defined(WIN_API)
+#include <sys/timeb.h>
+#else
+#include <sys/time.h>
+#endif
+
 BThreadSignal::BThreadSignal()
 {
    mThreadSignalID = NULL;
@@ -61,6 +68,15 @@ bool BThreadSignal::ThreadSignalActivate()
    return true;
 }
 
+bool BThreadSignal::ThreadSignalBroadcast()
+{
+   assert (mThreadSignalID != NULL);
+
+   pthread_cond_broadcast(mThreadSignalID);
+
+   return true;
+}
+
 bool BThreadSignal::ThreadSignalWait(void *mutexData)
 {
    assert (mThreadSignalID != NULL);
@@ -72,3 +88,34 @@ bool BThreadSignal::ThreadSignalWait(void *mutexData)
 
    return true;
 }
+
+bool BThreadSignal::ThreadSignalTimedWait(void *mutexData, unsigned int milliseconds)
+{
+   assert (mThreadSignalID != NULL);
+   assert (mutexData != NULL);
+
+   BMutex *data = (BMutex *) mutexData;
+
+   // pthread_cond_timedwait takes an absolute time
+   struct timespec deadline;
+#if defined(WIN_API)
+   struct __timeb64 now;
+   _ftime64_s(&now);
+   deadline.tv_sec = static_cast<long>(now.time);
+   deadline.tv_nsec = now.millitm * 1000000;
+#else
+   struct timeval now;
+   gettimeofday(&now, NULL);
+   deadline.tv_sec = now.tv_sec;
+   deadline.tv_nsec = now.tv_usec * 1000;
+#endif
+   deadline.tv_sec += milliseconds / 1000;
+   deadline.tv_nsec += (milliseconds % 1000) * 1000000;
+   if (deadline.tv_nsec >= 1000000000)
+   {
+      deadline.tv_sec += 1;
+      deadline.tv_nsec -= 1000000000;
+   }
+
+   return pthread_cond_timedwait(mThreadSignalID, data->GetMutexID(), &deadline) == 0;
+}
@@ -22,7 +22,19 @@ class BThreadSignal : public ThreadSignal
       bool ThreadSignalInit ();
       bool ThreadSignalDestroy ();
       bool ThreadSignalWait (void *mutexData);
+      /**
+       * Wait for the signal or until a timeout elapses.
+       *
+       * @param mutexData
+       *          the BMutex which is locked by the caller
+       * @param milliseconds
+       *          the maximum time to wait
+       *
+       * @return true if the signal was received, false if the wait timed out
+       */
+      bool ThreadSignalTimedWait (void *mutexData, unsigned int milliseconds);
       bool ThreadSignalActivate ();
+      bool ThreadSignalBroadcast ();
 
    private:
       pthread_cond_t *mThreadSignalID;
@@ -15,6 +15,7 @@
 class Mutex
 {
    public:
+      virtual ~Mutex() {}
       virtual bool MutexCreate() = 0;
       virtual bool MutexInit() = 0;
       virtual bool MutexLock() = 0;
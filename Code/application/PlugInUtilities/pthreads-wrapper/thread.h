@@ -19,6 +19,7 @@
 class Thread
 {
    public:
+      virtual ~Thread() {}
       virtual bool ThreadInit () = 0; 
       virtual bool ThreadLaunch() = 0;
       virtual bool ThreadWait() = 0;
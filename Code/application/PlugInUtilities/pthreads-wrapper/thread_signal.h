@@ -13,6 +13,7 @@
 class ThreadSignal
 {
    public:
+      virtual ~ThreadSignal() {}
       virtual bool ThreadSignalCreate() = 0;
       virtual bool ThreadSignalInit() = 0;
       virtual bool ThreadSignalDestroy() = 0;
@@ -11,8 +11,6 @@
 #include "XercesIncludes.h"
 #include "xmlwriter.h"
 
-#include <memory>
-
 XERCES_CPP_NAMESPACE_USE
 
 XMLWriter::XMLWriter(const char* pRootElementName, MessageLog* pLog, bool useNamespace) :
@@ -299,6 +297,18 @@ void XMLWriter::writeToFile(FILE* pFp)
 }
 
 std::string XMLWriter::writeToString()
+{
+   MemBufFormatTarget byteStream;
+   std::string buf;
+   if (writeToTarget(byteStream) && byteStream.getRawBuffer() != NULL)
+   {
+      buf = std::string(reinterpret_cast<const char*>(byteStream.getRawBuffer()));
+   }
+
+   return buf;
+}
+
+bool XMLWriter::writeToTarget(XMLFormatTarget& target)
 {
    DOMLSSerializer* pSerializer = NULL;
    DOMLSOutput* pOutput = NULL;
@@ -311,8 +321,7 @@ std::string XMLWriter::writeToString()
       pOutput = mpImpl->createLSOutput();
       pOutput->setEncoding(XMLUni::fgUTF8EncodingString);
 
-      std::auto_ptr<MemBufFormatTarget> pByteStream(new MemBufFormatTarget);
-      pOutput->setByteStream(pByteStream.get());
+      pOutput->setByteStream(&target);
 
       if (pConfig->canSetParameter(XMLUni::fgDOMWRTDiscardDefaultContent, false))
       {
@@ -334,15 +343,11 @@ std::string XMLWriter::writeToString()
          pConfig->setParameter(XMLUni::fgDOMXMLDeclaration, true);
       }
 
-      std::string buf;
-      if (pSerializer->write(mpDoc, pOutput) && pByteStream->getRawBuffer() != NULL)
-      {
-         buf = std::string(reinterpret_cast<const char*>(pByteStream->getRawBuffer()));
-      }
+      bool success = pSerializer->write(mpDoc, pOutput);
 
       pOutput->release();
       pSerializer->release();
-      return buf;
+      return success;
    }
    catch (const XMLException& exc)
    {
@@ -239,6 +239,17 @@ bool BandMath::getInputSpecification(PlugInArgList*& pArgList)
       pArg->setDefaultValue(&temp);
       pArg->setDescription("True causes band math to use degrees; false uses radians (default).");
       pArgList->addArg(*pArg);
+
+      string invalidValues = "Default";
+      pArg = mpPluginManager->getPlugInArg();
+      VERIFY(pArg != NULL);
+      pArg->setName("Invalid Values");
+      pArg->setType("string");
+      pArg->setDefaultValue(&invalidValues);
+      pArg->setDescription("How values which cannot be evaluated, such as a division by zero, are handled. "
+         "\"Default\" sets a pixel which divides by zero to zero and fails the operation for any other value; "
+         "\"Zero\" or \"NaN\" stores that value in the pixel and continues; \"Abort\" fails the operation.");
+      pArgList->addArg(*pArg);
    }
 
    return true;
@@ -285,6 +296,7 @@ bool BandMath::initialize()
    mbGuiIsNeeded = false;
    mbDegrees = false;
    mbAsLayerOnExistingView = false;
+   mErrorPolicy = BMATH_DEFAULT;
 
    // Other necessary things
    mstrProgressString = "";
@@ -344,8 +356,8 @@ bool BandMath::execute(PlugInArgList* pInputArgList, PlugInArgList* pOutputArgLi
       }
    }
 
-   char errorVal[80];
-   int errorCode = -1;  
+   string errorMessage;
+   int errorCode = -1;
 
    if (mbInteractive)
    {
@@ -363,6 +375,7 @@ bool BandMath::execute(PlugInArgList* pInputArgList, PlugInArgList* pOutputArgLi
       mbDegrees = frmASIT.isDegrees();
       mbCubeMath = frmASIT.isMultiCube();
       mbAsLayerOnExistingView = frmASIT.isResultsMatrix();
+      mErrorPolicy = frmASIT.getErrorPolicy();
    }
    else
    {
@@ -388,92 +401,32 @@ bool BandMath::execute(PlugInArgList* pInputArgList, PlugInArgList* pOutputArgLi
       mpStep = pResultStep.get();
       pResultStep->addProperty("Expression", mExpression);
 
-      FactoryResource<DataRequest> pReturnRequest;
-      pReturnRequest->setInterleaveFormat(BIP);
-      pReturnRequest->setWritable(true);
-      DataAccessor returnDa = mpResultData->getDataAccessor(pReturnRequest.release());
-      if (!returnDa.isValid())
+      vector<RasterElement*> cubes;
+      if (mbCubeMath)
       {
-         mstrProgressString = "Could not access the result data.";
-         meGabbiness = ERRORS;
-         displayErrorMessage();
-         return false;
+         cubes = mCubesList;
       }
-
-      if (!mbCubeMath)
+      else
       {
-         FactoryResource<DataRequest> pCubeRequest;
-         pCubeRequest->setInterleaveFormat(BIP);
-         DataAccessor cubeDa = mpCube->getDataAccessor(pCubeRequest.release());
-         if (!cubeDa.isValid())
-         {
-            mstrProgressString = "Reading this cube format is not supported.";
-            meGabbiness = ERRORS;
-            displayErrorMessage();
-            return false;
-         }
-
-         vector<DataAccessor> accessors(1, cubeDa);
-         vector<EncodingType> types(1, pDescriptor->getDataType());
-
-         char* mutableExpression = new char[mExpression.size() + 1];
-         strcpy(mutableExpression, mExpression.c_str());
-
-         errorCode = eval(mpProgress, accessors, types, mCubeRows, mCubeColumns,
-            mCubeBands, mutableExpression, returnDa, mbDegrees, errorVal, mbCubeMath, mbInteractive);
-
-         delete [] mutableExpression;
+         cubes.push_back(mpCube);
       }
-      else // cube math
-      {
-         EncodingType type = pDescriptor->getDataType();
 
-         vector<DataAccessor> accessors;
-         vector<EncodingType> dataTypes;
-         for (unsigned int i = 0; i < mCubesList.size(); ++i)
-         {
-            FactoryResource<DataRequest> pRequest;
-            pRequest->setInterleaveFormat(BIP);
-            DataAccessor daCube = mCubesList[i]->getDataAccessor(pRequest.release());
-            accessors.push_back(daCube);
-            const RasterDataDescriptor* pDdCube = dynamic_cast<RasterDataDescriptor*>(mCubesList.at(i)->
-               getDataDescriptor());
-            if (pDdCube != NULL)
-            {
-               dataTypes.push_back(pDdCube->getDataType());
-            }
-            else
-            {
-               mstrProgressString = "Could not get data description for cube.";
-               meGabbiness = ERRORS;
-               displayErrorMessage();
-               return false;
-            }
-         }
+      char* mutableExpression = new char[mExpression.size() + 1];
+      strcpy(mutableExpression, mExpression.c_str());
 
-         char* mutableExpression = new char[mExpression.size() + 1];
-         strcpy(mutableExpression, mExpression.c_str());
+      errorCode = eval(mpProgress, cubes, mCubeRows, mCubeColumns, mCubeBands, mutableExpression,
+         mpResultData, mbDegrees, errorMessage, mbCubeMath, mErrorPolicy);
 
-         errorCode = eval(mpProgress, accessors, dataTypes, mCubeRows,
-            mCubeColumns, mCubeBands, mutableExpression, returnDa,
-            mbDegrees, errorVal, mbCubeMath, mbInteractive);
-
-         delete [] mutableExpression;
-      }
+      delete [] mutableExpression;
 
       if (errorCode != 0)
       {
          mbError = true;
          if (errorCode == -1)
          {
-            mstrProgressString = errorVal;
+            mstrProgressString = errorMessage;
             meGabbiness = ERRORS;
          }
-         else if (errorCode == -2)
-         {
-            mstrProgressString = "BandMath was cancelled due to an error in the input expression.";
-            meGabbiness = ABORT;
-         }
          else
          {
             mstrProgressString = "Unknown error has occured while executing BandMath.";
@@ -483,6 +436,17 @@ bool BandMath::execute(PlugInArgList* pInputArgList, PlugInArgList* pOutputArgLi
          return false;
       }
 
+      if (!errorMessage.empty())
+      {
+         // some values could not be evaluated, but the error policy allowed the operation to continue
+         meGabbiness = WARNING;
+         if (mpProgress != NULL)
+         {
+            mpProgress->updateProgress(errorMessage, 100, WARNING);
+         }
+         pResultStep->addProperty("Warning", errorMessage);
+      }
+
       pResultStep->finalize(Message::Success);
    }
    mpStep = pStep.get();
@@ -654,6 +618,36 @@ bool BandMath::parse(PlugInArgList* pArgInList, PlugInArgList* pArgOutList)
             return false;
          }
       }
+
+      //   get the Invalid Values policy--------------------------------------------------------
+      if (pArgInList->getArg("Invalid Values", pArg) && (pArg != NULL))
+      {
+         string* pTmp = pArg->getPlugInArgValue<string>();
+         if (pTmp != NULL)
+         {
+            if (*pTmp == "Default")
+            {
+               mErrorPolicy = BMATH_DEFAULT;
+            }
+            else if (*pTmp == "Zero")
+            {
+               mErrorPolicy = BMATH_SET_TO_ZERO;
+            }
+            else if (*pTmp == "NaN")
+            {
+               mErrorPolicy = BMATH_SET_TO_NAN;
+            }
+            else if (*pTmp == "Abort")
+            {
+               mErrorPolicy = BMATH_ABORT;
+            }
+            else
+            {
+               mstrProgressString = "Invalid Values input argument must be Default, Zero, NaN or Abort.";
+               return false;
+            }
+         }
+      }
    }
 
    return true;
@@ -63,6 +63,7 @@ private:
    bool mbDegrees;
    bool mbCubeMath;
    bool mbAsLayerOnExistingView;
+   BMathErrorPolicy mErrorPolicy;
 
    std::vector<RasterElement*> mCubesList;
 
@@ -60,11 +60,31 @@ FrmBM::FrmBM(const RasterDataDescriptor* pDescriptor, const vector<RasterElement
    pCubeLayout->addWidget(rbBand);
    pCubeLayout->addWidget(rbCube);
 
+   // Invalid values
+   QGroupBox* pInvalidGroup = new QGroupBox("Invalid Values", this);
+
+   bgInvalid = new QButtonGroup(pInvalidGroup);
+
+   rbInvalidZero = new QRadioButton("Zero", pInvalidGroup);
+   rbInvalidNan = new QRadioButton("NaN", pInvalidGroup);
+   rbInvalidAbort = new QRadioButton("Abort", pInvalidGroup);
+   bgInvalid->addButton(rbInvalidZero, BMATH_SET_TO_ZERO);
+   bgInvalid->addButton(rbInvalidNan, BMATH_SET_TO_NAN);
+   bgInvalid->addButton(rbInvalidAbort, BMATH_ABORT);
+
+   QHBoxLayout* pInvalidLayout = new QHBoxLayout(pInvalidGroup);
+   pInvalidLayout->setMargin(10);
+   pInvalidLayout->setSpacing(5);
+   pInvalidLayout->addWidget(rbInvalidZero);
+   pInvalidLayout->addWidget(rbInvalidNan);
+   pInvalidLayout->addWidget(rbInvalidAbort);
+
    QHBoxLayout* pRadioLayout = new QHBoxLayout();
    pRadioLayout->setMargin(0);
    pRadioLayout->setSpacing(10);
    pRadioLayout->addWidget(pUnitsGroup);
    pRadioLayout->addWidget(pCubeGroup);
+   pRadioLayout->addWidget(pInvalidGroup);
 
    // Operators
    QGroupBox* pOperatorsGroup = new QGroupBox("Operators", this);
@@ -434,6 +454,7 @@ FrmBM::FrmBM(const RasterDataDescriptor* pDescriptor, const vector<RasterElement
    lisBands->clear();
    rbRadians->setChecked(true);
    rbBand->setChecked(true);
+   rbInvalidZero->setChecked(true);
    setCubeList(0);
 
    resize(minimumSize());
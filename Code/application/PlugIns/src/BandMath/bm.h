@@ -20,6 +20,8 @@
 #include <QtGui/QRadioButton>
 #include <QtGui/QTextEdit>
 
+#include "bmathfuncs.h"
+
 #include <vector>
 
 class RasterElement;
@@ -37,6 +39,7 @@ public:
    bool isDegrees() const;
    bool isMultiCube() const;
    bool isResultsMatrix() const;
+   BMathErrorPolicy getErrorPolicy() const;
 
 protected slots:
    virtual void setBinaryOps(bool bVal);
@@ -66,6 +69,12 @@ private:
    QRadioButton* rbCube;
    QCheckBox* cbResults;
 
+   // Invalid values
+   QButtonGroup* bgInvalid;
+   QRadioButton* rbInvalidZero;
+   QRadioButton* rbInvalidNan;
+   QRadioButton* rbInvalidAbort;
+
    // Operators
    QButtonGroup* bgOperators;
    QPushButton* btnPlus;
@@ -112,6 +112,11 @@ bool FrmBM::isResultsMatrix() const
    return bResultsMatrix;
 }
 
+BMathErrorPolicy FrmBM::getErrorPolicy() const
+{
+   return static_cast<BMathErrorPolicy>(bgInvalid->checkedId());
+}
+
 void FrmBM::clear()
 {
    int i;
@@ -9,11 +9,287 @@
 
 #include "AppConfig.h"
 #include "BandMath.h"
-#include "mbox.h"
+#include "bmathprogram.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "MultiThreadedAlgorithm.h"
+#include "ObjectResource.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
 #include "RasterUtilities.h"
 
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <time.h>
+
 using namespace std;
 
+namespace
+{
+   // in addition to the errors detected by the program, a result which is not a number is an error
+   const int INVALID_RESULT = BMathProgram::COMPLEX_VALUE + 1;
+   const int ERROR_TYPE_COUNT = INVALID_RESULT + 1;
+
+   const char* getErrorDescription(int errorType)
+   {
+      switch (errorType)
+      {
+      case BMathProgram::DIVIDE_BY_ZERO:
+         return "The band math operation attempted to divide by zero.";
+      case BMathProgram::UNDEFINED_VALUE:
+         return "The band math operation encountered an undefined value.";
+      case BMathProgram::COMPLEX_VALUE:
+         return "The band math operation resulted in an invalid complex number.";
+      case INVALID_RESULT:
+         return "The band math operation resulted in a floating point error.";
+      default:
+         break;
+      }
+
+      return "";
+   }
+
+   struct BandMathInput
+   {
+      BandMathInput() :
+         mpProgram(NULL),
+         mpResult(NULL),
+         mRows(0),
+         mColumns(0),
+         mBandCount(1),
+         mErrorPolicy(BMATH_SET_TO_ZERO),
+         mpAbortFlag(NULL)
+      {}
+
+      const BMathProgram* mpProgram;
+      vector<RasterElement*> mCubes;
+      RasterElement* mpResult;
+      int mRows;
+      int mColumns;
+      int mBandCount;
+      BMathErrorPolicy mErrorPolicy;
+      volatile bool* mpAbortFlag;
+   };
+
+   /**
+    * Evaluates the expression for a contiguous block of rows.
+    *
+    * Each thread has its own accessors and registers, so the threads do not
+    * share any mutable state except for the abort flag.
+    */
+   class BandMathThread : public mta::AlgorithmThread
+   {
+   public:
+      BandMathThread(const BandMathInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter);
+      void run();
+
+      bool isDataAvailable() const;
+      unsigned int getErrorCount(int errorType) const;
+      int getAbortError() const;
+
+   private:
+      void recordError(int errorType);
+
+      const BandMathInput& mInput;
+      mta::AlgorithmThread::Range mRowRange;
+      bool mDataAvailable;
+      unsigned int mErrorCounts[ERROR_TYPE_COUNT];
+      int mAbortError;
+   };
+
+   struct BandMathOutput
+   {
+      BandMathOutput();
+      bool compileOverallResults(const vector<BandMathThread*>& threads);
+
+      bool mDataAvailable;
+      unsigned int mErrorCounts[ERROR_TYPE_COUNT];
+      int mAbortError;
+   };
+
+   BandMathThread::BandMathThread(const BandMathInput& input, int threadCount, int threadIndex,
+                                  mta::ThreadReporter& reporter) :
+      mta::AlgorithmThread(threadIndex, reporter),
+      mInput(input),
+      mRowRange(getThreadRange(threadCount, input.mRows)),
+      mDataAvailable(true),
+      mAbortError(BMathProgram::NONE)
+   {
+      fill(mErrorCounts, mErrorCounts + ERROR_TYPE_COUNT, 0);
+   }
+
+   void BandMathThread::run()
+   {
+      // each thread has its own random number generator, seeded differently for each thread
+      unsigned int randomSeed = static_cast<unsigned int>(time(NULL)) +
+         2654435761U * static_cast<unsigned int>(getThreadIndex());
+
+      const RasterDataDescriptor* pResultDescriptor =
+         static_cast<const RasterDataDescriptor*>(mInput.mpResult->getDataDescriptor());
+      FactoryResource<DataRequest> pResultRequest;
+      pResultRequest->setInterleaveFormat(BIP);
+      pResultRequest->setRows(pResultDescriptor->getActiveRow(mRowRange.mFirst),
+         pResultDescriptor->getActiveRow(mRowRange.mLast));
+      pResultRequest->setWritable(true);
+      DataAccessor resultAccessor = mInput.mpResult->getDataAccessor(pResultRequest.release());
+
+      vector<DataAccessor> cubeAccessors;
+      for (vector<RasterElement*>::const_iterator iter = mInput.mCubes.begin(); iter != mInput.mCubes.end(); ++iter)
+      {
+         const RasterDataDescriptor* pDescriptor =
+            static_cast<const RasterDataDescriptor*>((*iter)->getDataDescriptor());
+         FactoryResource<DataRequest> pRequest;
+         pRequest->setInterleaveFormat(BIP);
+         pRequest->setRows(pDescriptor->getActiveRow(mRowRange.mFirst), pDescriptor->getActiveRow(mRowRange.mLast));
+         cubeAccessors.push_back((*iter)->getDataAccessor(pRequest.release()));
+      }
+
+      const int columns = mInput.mColumns;
+      const int bandCount = mInput.mBandCount;
+      const float badValue = (mInput.mErrorPolicy == BMATH_SET_TO_NAN) ?
+         numeric_limits<float>::quiet_NaN() : 0.0f;
+
+      vector<double> registers;
+      mInput.mpProgram->initializeRegisters(registers);
+      unsigned char errors[BMathProgram::BLOCK_SIZE];
+      vector<const void*> cubeRows(cubeAccessors.size());
+
+      int oldPercentDone = -1;
+      for (int row = mRowRange.mFirst; row <= mRowRange.mLast; ++row)
+      {
+         if (*mInput.mpAbortFlag)
+         {
+            return;
+         }
+
+         int percentDone = mRowRange.computePercent(row);
+         if (percentDone > oldPercentDone)
+         {
+            oldPercentDone = percentDone;
+            getReporter().reportProgress(getThreadIndex(), percentDone);
+         }
+
+         if (!resultAccessor.isValid())
+         {
+            mDataAvailable = false;
+            *mInput.mpAbortFlag = true;
+            return;
+         }
+
+         float* pReturnRow = reinterpret_cast<float*>(resultAccessor->getRow());
+         for (unsigned int cubeNum = 0; cubeNum < cubeAccessors.size(); ++cubeNum)
+         {
+            if (!cubeAccessors[cubeNum].isValid())
+            {
+               mDataAvailable = false;
+               *mInput.mpAbortFlag = true;
+               return;
+            }
+            cubeRows[cubeNum] = cubeAccessors[cubeNum]->getRow();
+         }
+
+         for (int startColumn = 0; startColumn < columns; startColumn += BMathProgram::BLOCK_SIZE)
+         {
+            int count = min(static_cast<int>(BMathProgram::BLOCK_SIZE), columns - startColumn);
+            for (int bandNum = 0; bandNum < bandCount; ++bandNum)
+            {
+               const double* pValues = mInput.mpProgram->evaluate(cubeRows, startColumn, count, bandNum,
+                  registers, randomSeed, errors);
+               for (int j = 0; j < count; ++j)
+               {
+                  float* pReturnValue = pReturnRow + (startColumn + j) * bandCount;
+                  float newValue = static_cast<float>(pValues[j]);
+
+                  int errorType = errors[j];
+                  if (errorType == BMathProgram::NONE && RasterUtilities::isBad(newValue))
+                  {
+                     errorType = INVALID_RESULT;
+                  }
+
+                  if (errorType != BMathProgram::NONE)
+                  {
+                     recordError(errorType);
+                     if (mInput.mErrorPolicy == BMATH_ABORT || (mInput.mErrorPolicy == BMATH_DEFAULT &&
+                        errorType != BMathProgram::DIVIDE_BY_ZERO))
+                     {
+                        mAbortError = errorType;
+                        *mInput.mpAbortFlag = true;
+                        return;
+                     }
+
+                     fill(pReturnValue, pReturnValue + bandCount, badValue); // clear the point
+                     continue;
+                  }
+
+                  pReturnValue[bandNum] = newValue;
+               }
+            }
+         }
+
+         resultAccessor->nextRow();
+         for (unsigned int cubeNum = 0; cubeNum < cubeAccessors.size(); ++cubeNum)
+         {
+            cubeAccessors[cubeNum]->nextRow();
+         }
+      }
+   }
+
+   bool BandMathThread::isDataAvailable() const
+   {
+      return mDataAvailable;
+   }
+
+   unsigned int BandMathThread::getErrorCount(int errorType) const
+   {
+      return mErrorCounts[errorType];
+   }
+
+   int BandMathThread::getAbortError() const
+   {
+      return mAbortError;
+   }
+
+   void BandMathThread::recordError(int errorType)
+   {
+      ++mErrorCounts[errorType];
+   }
+
+   BandMathOutput::BandMathOutput() :
+      mDataAvailable(true),
+      mAbortError(BMathProgram::NONE)
+   {
+      fill(mErrorCounts, mErrorCounts + ERROR_TYPE_COUNT, 0);
+   }
+
+   bool BandMathOutput::compileOverallResults(const vector<BandMathThread*>& threads)
+   {
+      // the threads are in row order, so the first failure reported is the earliest one in the data
+      for (vector<BandMathThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+      {
+         const BandMathThread* pThread = *iter;
+         if (pThread == NULL)
+         {
+            continue;
+         }
+
+         mDataAvailable = mDataAvailable && pThread->isDataAvailable();
+         for (int errorType = 0; errorType < ERROR_TYPE_COUNT; ++errorType)
+         {
+            mErrorCounts[errorType] += pThread->getErrorCount(errorType);
+         }
+         if (mAbortError == BMathProgram::NONE)
+         {
+            mAbortError = pThread->getAbortError();
+         }
+      }
+
+      return true;
+   }
+}
+
 int ParseExp(char* exp, int bands, char* DelimString, int cubes)
 {
    //return if no string was passed in
@@ -934,9 +1210,8 @@ int OpParams(char* ops, char* val)
    return retval;
 }
 
-int eval(Progress* pProgress, vector<DataAccessor>& dataCubes, const vector<EncodingType>& types,
-         int rows, int columns, int bands, char* exp, DataAccessor returnAccessor, bool degrees, char* error,
-         bool cubeMath, bool interactive)
+int eval(Progress* pProgress, const vector<RasterElement*>& cubes, int rows, int columns, int bands, char* exp,
+         RasterElement* pResult, bool degrees, string& message, bool cubeMath, BMathErrorPolicy errorPolicy)
 {
    int stringSize = strlen(exp)*2;
    if (stringSize < 80)
@@ -946,10 +1221,11 @@ int eval(Progress* pProgress, vector<DataAccessor>& dataCubes, const vector<Enco
 
    char* pString = new char[stringSize];
 
-   int iError = ParseExp(exp, bands, pString, dataCubes.size());
+   int iError = ParseExp(exp, bands, pString, cubes.size());
    if (iError)
    {
-      strcpy(error, pString);
+      message = pString;
+      delete [] pString;
       return -1;
    }
 
@@ -1003,13 +1279,17 @@ int eval(Progress* pProgress, vector<DataAccessor>& dataCubes, const vector<Enco
    pItems = NULL;
    pString = NULL;
 
-   bool dispDZMes = true;
-   bool dispUDMes = true;
-   bool dispCMMes = true;
-
-   int j;
+   // compile the expression once instead of walking the tree for every pixel
+   vector<EncodingType> types;
+   for (vector<RasterElement*>::const_iterator iter = cubes.begin(); iter != cubes.end(); ++iter)
+   {
+      types.push_back(static_cast<const RasterDataDescriptor*>((*iter)->getDataDescriptor())->getDataType());
+   }
 
-   srand(time(NULL));
+   vector<unsigned int> bandCounts(cubes.size(), static_cast<unsigned int>(bands));
+   BMathProgram program(pTree, types, bandCounts, degrees);
+   delete pTree;
+   pTree = NULL;
 
    int bandCount = 1;
    if (cubeMath)
@@ -1017,508 +1297,59 @@ int eval(Progress* pProgress, vector<DataAccessor>& dataCubes, const vector<Enco
       bandCount = bands;
    }
 
-   float* pReturnValue = NULL;
-   void* pCubeValue = NULL;
-   vector<void*> cubeValues(dataCubes.size());
-
-   for (i = 0; i < rows; i++)
-   {
-      for (j = 0; j < columns; j++)
-      {
-         pReturnValue = reinterpret_cast<float*>(returnAccessor->getColumn());
-         for (unsigned int cubeNum = 0; cubeNum < dataCubes.size(); ++cubeNum)
-         {
-            cubeValues[cubeNum] = dataCubes[cubeNum]->getColumn();
-         }
-
-         for (int bandNum = 0; bandNum < bandCount; ++bandNum)
-         {
-            try
-            {
-               float newValue = static_cast<float>(pTree->eval(cubeValues, bandNum, types));
-               if (RasterUtilities::isBad(newValue))
-               {
-                  throw out_of_range("The value is out of range");
-               }
-
-               pReturnValue[bandNum] = newValue;
-            }
-            catch (DivZero)
-            {
-               if (interactive == true)
-               {
-                  if (dispDZMes)
-                  {
-                     MBox mb("Warning", "Warning bandmathfuncs003: Divide By Zero\nSelect 'OK' to continue, \n"
-                        "all bad values will be set to 0.  \nOr 'Cancel' to cancel the operation.",
-                        MB_OK_CANCEL_ALWAYS, NULL);
-
-                     if (mb.exec() == QDialog::Rejected)
-                     {
-                        return -2;
-                     }
-                     else if (mb.cbAlways->isChecked())
-                     {
-                        dispDZMes = false;
-                     }
-                  }
-               }
-               else
-               {
-                  if (dispDZMes)
-                  {
-                     if (pProgress != NULL)
-                     {
-                        pProgress->updateProgress("The band math operation attempted to divide by zero. "
-                           "Operation will continue and bad values will be set to 0.", 100 * i / rows, WARNING);
-                     }
-                     dispDZMes = false;
-                  }
-               }
-
-               memset(pReturnValue, 0, bandCount * sizeof(float)); // clear the point
-            }
-            catch (Undefined)
-            {
-               if (interactive == true)
-               {
-                  if (dispUDMes)
-                  {
-                     MBox mb("Warning", "Warning bandmathfuncs001: Undefined Value\n"
-                        "Select 'OK' to continue, \nall bad values will be set to 0.  \n"
-                        "Or 'Cancel' to cancel the operation.",
-                        MB_OK_CANCEL_ALWAYS, NULL);
+   BandMathInput input;
+   input.mpProgram = &program;
+   input.mCubes = cubes;
+   input.mpResult = pResult;
+   input.mRows = rows;
+   input.mColumns = columns;
+   input.mBandCount = bandCount;
+   input.mErrorPolicy = errorPolicy;
 
-                     if (mb.exec() == QDialog::Rejected)
-                     {
-                        return -2;
-                     }
-                     else if (mb.cbAlways->isChecked())
-                     {
-                        dispUDMes = false;
-                     }
-                  }
-               }
-               else
-               {
-                  strcpy(error, "The band math operation encountered an undefined value.");
-                  return -1;
-               }
+   volatile bool abort = false;
+   input.mpAbortFlag = &abort;
 
-               memset(pReturnValue, 0, bandCount * sizeof(float)); // clear the point
-            }
-            catch (Complex)
-            {
-               if (interactive == true)
-               {
-                  if (dispCMMes)
-                  {
-                     MBox mb("Warning", "Warning bandmathfuncs002: Math Operation Resulted in a Complex Number\n"
-                        "Select 'OK' to continue, \nall bad values will be set to 0.\n"
-                        "Or 'Cancel' to cancel the operation.",
-                        MB_OK_CANCEL_ALWAYS, NULL);
-
-                     if (mb.exec() == QDialog::Rejected)
-                     {
-                        return -2;
-                     }
-                     else if (mb.cbAlways->isChecked())
-                     {
-                        dispCMMes = false;
-                     }
-                  }
-               }
-               else
-               {
-                  strcpy(error, "The band math operation resulted in an invalid complex number.");
-                  return -1;
-               }
-
-               memset(pReturnValue, 0, bandCount * sizeof(float)); // clear the point
-            }
-
-            catch (NoData)
-            {
-               strcpy(error, "The band math operation could not be perfomed because the data is not available.");
-               return -1;
-            }
-
-            catch (...)
-            {
-               strcpy(error, "The band math operation resulted in a floating point error.");
-               return -1;
-            }
-         }
-         returnAccessor->nextColumn();
-         for (unsigned int cubeNum = 0; cubeNum < dataCubes.size(); ++cubeNum)
-         {
-            dataCubes[cubeNum]->nextColumn();
-         }
-      }
-      returnAccessor->nextRow();
-      for (unsigned int cubeNum = 0; cubeNum < dataCubes.size(); ++cubeNum)
-      {
-         dataCubes[cubeNum]->nextRow();
-      }
-
-      if (pProgress != NULL)
+   BandMathOutput output;
+   mta::ProgressObjectReporter reporter("Band Math", pProgress);
+   mta::MultiThreadedAlgorithm<BandMathInput, BandMathOutput, BandMathThread>
+      alg(mta::getNumRequiredThreads(rows), input, output, &reporter);
+   if (alg.run() != mta::SUCCESS)
+   {
+      message = alg.getErrorText();
+      if (message.empty())
       {
-         pProgress->updateProgress("Band Math", 100 * i / rows, NORMAL);
+         message = "The band math operation failed.";
       }
+      return -1;
    }
 
-   return 0;
-}
-
-double doubleFromEncoding(EncodingType encoding, void* data, int offset)
-{
-   if (data == NULL)
-   {
-      return 0.0;
-   }
-
-   switch (encoding)
-   {
-   case INT1SBYTE:
-      return reinterpret_cast<signed char*>(data)[offset];
-   case INT1UBYTE:
-      return reinterpret_cast<unsigned char*>(data)[offset];
-   case INT2SBYTES:
-      return reinterpret_cast<signed short*>(data)[offset];
-   case INT2UBYTES:
-      return reinterpret_cast<unsigned short*>(data)[offset];
-   case INT4SBYTES:
-      return reinterpret_cast<signed int*>(data)[offset];
-   case INT4UBYTES:
-      return reinterpret_cast<unsigned int*>(data)[offset];
-   case FLT4BYTES:
-      return reinterpret_cast<float*>(data)[offset];
-   case FLT8BYTES:
-      return reinterpret_cast<double*>(data)[offset];
-   default:
-      break;
-   }
-
-   return 0.0;
-}
-
-double DataNode::eval(vector<void*>& data, int band, const vector<EncodingType>& types)
-{
-   if (data.empty() || data.size() != types.size() || Opera == NULL)
+   if (!output.mDataAvailable)
    {
-      return 0.0;
+      message = "The band math operation could not be perfomed because the data is not available.";
+      return -1;
    }
 
-   if (!isOperator)
-   {
-      if (!strcmp(Opera, "pi") || !strcmp(Opera, "PI") || !strcmp(Opera, "Pi"))
-      {
-         return PI;
-      }
-
-      if (!strcmp(Opera, "e") || !strcmp(Opera, "E"))
-      {
-         return exp(1.0);
-      }
-
-      if ((Opera[0] == 'b') || (Opera[0] == 'B'))
-      {
-         int bandOperation = atoi(&Opera[1]) - 1;
-         return doubleFromEncoding(types[0], data[0], bandOperation);
-      }
-
-      if ((Opera[0] == 'c') || (Opera[0] == 'C'))
-      {
-         int cube = atoi(&Opera[1]) - 1;
-
-         if (data.size() > static_cast<unsigned int>(cube))
-         {
-            return doubleFromEncoding(types[cube], data[cube], band);
-         }
-         return 0.0;
-      }
-      return atof(Opera);
-   }
-   if (!strcmp(Opera, "("))
-   {
-      return Right->eval(data, band, types);
-   }
-   if (!strcmp(Opera, "+"))
-   {
-      return Left->eval(data, band, types) + Right->eval(data, band, types);
-   }
-   if (!strcmp(Opera, "-"))
-   {
-      return Left->eval(data, band, types) - Right->eval(data, band, types);
-   }
-   if (!strcmp(Opera, "*"))
+   if (output.mAbortError != BMathProgram::NONE)
    {
-      return Left->eval(data, band, types) * Right->eval(data, band, types);
+      message = getErrorDescription(output.mAbortError);
+      return -1;
    }
-   if (!strcmp(Opera, "/"))
-   {
-      double resRight = Right->eval(data, band, types);
-      if (resRight == 0)
-      {
-         throw DivZero();
-      }
 
-      return Left->eval(data, band, types) / resRight;
-   }
-   if (!strcmp(Opera, "^"))
+   unsigned int errorCount = accumulate(output.mErrorCounts, output.mErrorCounts + ERROR_TYPE_COUNT, 0U);
+   if (errorCount > 0)
    {
-      double resLeft = Left->eval(data, band, types);
-      double resRight = Right->eval(data, band, types);
-
-      if (resLeft == 0 && resRight <= 0)
-      {
-         throw DivZero();
-      }
-      if (resLeft < 0)
+      stringstream buf;
+      buf << errorCount << " value(s) could not be evaluated and were set to " <<
+         (errorPolicy == BMATH_SET_TO_NAN ? "NaN" : "zero") << ":";
+      for (int errorType = BMathProgram::NONE + 1; errorType < ERROR_TYPE_COUNT; ++errorType)
       {
-         double inter;
-         double frac = modf(resRight, &inter);
-         if (frac)
+         if (output.mErrorCounts[errorType] > 0)
          {
-            throw Complex();
+            buf << "\n" << output.mErrorCounts[errorType] << " - " << getErrorDescription(errorType);
          }
       }
-      return pow(resLeft, resRight);
-   }
-   if (!strcmp(Opera, "sqrt"))
-   {
-      double resRight = Right->eval(data, band, types);
-      if (resRight <= 0)
-      {
-         throw Complex();
-      }
-      return sqrt(resRight);
-   }
-   if (!strcmp(Opera, "sin"))
-   {
-      if (degrees)
-      {
-         return sin(D_TO_R_MULT*Right->eval(data, band, types));
-      }
-
-      return sin(Right->eval(data, band, types));
-   }
-   if (!strcmp(Opera, "cos"))
-   {
-      if (degrees)
-      {
-         return cos(D_TO_R_MULT*Right->eval(data, band, types));
-      }
-
-      return cos(Right->eval(data, band, types));
-   }
-   if (!strcmp(Opera, "tan"))
-   {
-      if (degrees)
-      {
-         return tan(D_TO_R_MULT*Right->eval(data, band, types));
-      }
-
-      return tan(Right->eval(data, band, types));
-   }
-   if (!strcmp(Opera, "log"))
-   {
-      double resRight = Right->eval(data, band, types);
-      if (resRight <= 0)
-      {
-         throw Undefined();
-      }
-      return log(resRight);
-   }
-   if (!strcmp(Opera, "log10"))
-   {
-      double resRight = Right->eval(data, band, types);
-      if (resRight <= 0)
-      {
-         throw Undefined();
-      }
-      return log10(resRight);
-   }
-   if (!strcmp(Opera, "log2"))
-   {
-      double resRight = Right->eval(data, band, types);
-      if (resRight <= 0)
-      {
-         throw Undefined();
-      }
-      return log(resRight)/log(2.0);
-   }
-   if (!strcmp(Opera, "exp"))
-   {
-      return exp(Right->eval(data, band, types));
-   }
-   if (!strcmp(Opera, "abs"))
-   {
-      return fabs(Right->eval(data, band, types));
-   }
-   if (!strcmp(Opera, "asin"))
-   {
-      double resRight = Right->eval(data, band, types);
-      if (resRight < -1 || resRight > 1)
-      {
-         throw Complex();
-      }
-
-      if (degrees)
-      {
-         return R_TO_D_MULT * asin(resRight);
-      }
-
-      return asin(resRight);
-   }
-   if (!strcmp(Opera, "acos"))
-   {
-      double resRight = Right->eval(data, band, types);
-      if (resRight < -1 || resRight > 1)
-      {
-         throw Complex();
-      }
-
-      if (degrees)
-      {
-         return R_TO_D_MULT * acos(resRight);
-      }
-
-      return acos(resRight);
-   }
-   if (!strcmp(Opera, "atan"))
-   {
-      if (degrees)
-      {
-         return R_TO_D_MULT * atan(Right->eval(data, band, types));
-      }
-
-      return atan(Right->eval(data, band, types));
-   }
-   if (!strcmp(Opera, "sinh"))
-   {
-      if (degrees)
-      {
-         return sinh(D_TO_R_MULT*Right->eval(data, band, types));
-      }
-
-      return sinh(Right->eval(data, band, types));
-   }
-   if (!strcmp(Opera, "cosh"))
-   {
-      if (degrees)
-      {
-         return cosh(D_TO_R_MULT*Right->eval(data, band, types));
-      }
-
-      return cosh(Right->eval(data, band, types));
-   }
-   if (!strcmp(Opera, "tanh"))
-   {
-      if (degrees)
-      {
-         return tanh(D_TO_R_MULT*Right->eval(data, band, types));
-      }
-
-      return tanh(Right->eval(data, band, types));
-   }
-   if (!strcmp(Opera, "csc"))
-   {
-      if (degrees)
-      {
-         return 1/sin(D_TO_R_MULT*Right->eval(data, band, types));
-      }
-
-      return 1/sin(Right->eval(data, band, types));
-   }
-   if (!strcmp(Opera, "sec"))
-   {
-      if (degrees)
-      {
-         return 1/cos(D_TO_R_MULT*Right->eval(data, band, types));
-      }
-
-      return 1/cos(Right->eval(data, band, types));
+      message = buf.str();
    }
-   if (!strcmp(Opera, "cot"))
-   {
-      if (degrees)
-      {
-         return 1/tan(D_TO_R_MULT*Right->eval(data, band, types));
-      }
 
-      return 1/tan(Right->eval(data, band, types));
-   }
-   if (!strcmp(Opera, "acsc"))
-   {
-      double resRight = 1 / Right->eval(data, band, types);
-      if (resRight < -1 || resRight > 1)
-      {
-         throw Complex();
-      }
-
-      if (degrees)
-      {
-         return R_TO_D_MULT * asin(resRight);
-      }
-
-      return asin(resRight);
-   }
-   if (!strcmp(Opera, "asec"))
-   {
-      double resRight = 1 / Right->eval(data, band, types);
-      if (resRight < -1 || resRight > 1)
-      {
-         throw Complex();
-      }
-
-      if (degrees)
-      {
-         return R_TO_D_MULT * acos(resRight);
-      }
-
-      return acos(resRight);
-   }
-   if (!strcmp(Opera, "acot"))
-   {
-      if (degrees)
-      {
-         return R_TO_D_MULT * atan(1/Right->eval(data, band, types));
-      }
-
-      return atan(1/Right->eval(data, band, types));
-   }
-   if (!strcmp(Opera, "csch"))
-   {
-      if (degrees)
-      {
-         return 1/sinh(D_TO_R_MULT*Right->eval(data, band, types));
-      }
-
-      return 1/sinh(Right->eval(data, band, types));
-   }
-   if (!strcmp(Opera, "sech"))
-   {
-      if (degrees)
-      {
-         return 1/cosh(D_TO_R_MULT*Right->eval(data, band, types));
-      }
-
-      return 1/cosh(Right->eval(data, band, types));
-   }
-   if (!strcmp(Opera, "coth"))
-   {
-      if (degrees)
-      {
-         return 1/tanh(D_TO_R_MULT*Right->eval(data, band, types));
-      }
-
-      return 1/tanh(Right->eval(data, band, types));
-   }
-   if (!strcmp(Opera, "rand"))
-   {
-      return GRand()*Right->eval(data, band, types);
-   }
-
-   return 0.0;
+   return 0;
 }
@@ -16,11 +16,12 @@
 #include <math.h>
 #include <ctype.h>
 
+#include <string>
 #include <vector>
 
 #include "Progress.h"
-#include "DataAccessor.h"
-#include "DataAccessorImpl.h"
+
+class RasterElement;
 
 #define D_TO_R_MULT     0.017453292519943295
 #define R_TO_D_MULT     57.295779513082321
@@ -28,11 +29,6 @@
 #define MAX_OP_LENGTH   5   // set to length of the longest Operator string
 #define SEP             '@'
 
-class DivZero {};
-class Undefined {};
-class Complex {};
-class NoData {};
-
 bool ParseIsOp(char* ops, char* val);
 int OpParams(char* ops, char* val);
 int ParseExp(char* exp, int bands, char* DelimString, int cubes = 0);
@@ -40,10 +36,20 @@ char* ValRight(char* exp, int pos);
 char* ValLeft(char* exp, int pos);
 bool IsOp(char* ops, char* val);
 int OpPres(char* ops, char* val);
-inline double GRand();
-inline double SingleRand();
+inline double GRand(unsigned int& seed);
+inline double SingleRand(unsigned int& seed);
 
-inline double doubleFromEncoding(EncodingType encoding, void* data, int offset = 0);
+/**
+ * Determines what is stored for a pixel which cannot be evaluated, such as a
+ * division by zero or the square root of a negative number.
+ */
+enum BMathErrorPolicy
+{
+   BMATH_SET_TO_ZERO,   // every band of the pixel is set to zero
+   BMATH_SET_TO_NAN,    // every band of the pixel is set to NaN
+   BMATH_ABORT,         // the operation fails
+   BMATH_DEFAULT        // a division by zero sets the pixel to zero; any other error fails the operation
+};
 
 class DataNode
 {
@@ -75,8 +81,6 @@ public:
       }
    }
 
-   double eval(std::vector<void*>& data, int band, const std::vector<EncodingType>& types);
-
    bool degrees;
    bool isOperator;
    char* Opera;
@@ -97,25 +101,44 @@ private:
 
 DataNode* BuildTreeFromInfix(char* ops, char* exp, int* offsetTable, int NumElems, bool degrees);
 
-int eval(Progress* pProgress, std::vector<DataAccessor>& dataCubes,
-         const std::vector<EncodingType>& types, int rows, int columns,
-         int bands, char* exp, DataAccessor returnAccessor, bool degrees,
-         char* error, bool cubeMath, bool interactive);
-
-inline double GRand()
+/**
+ * Evaluates an expression for every pixel.
+ *
+ * The rows are divided between several threads.  Pixels which cannot be
+ * evaluated are handled according to the error policy and counted, so no
+ * user interaction is required while the expression is evaluated.
+ *
+ * @return 0 on success, in which case message may describe pixels which could
+ *         not be evaluated, or -1 on failure, in which case message describes
+ *         the error.
+ */
+int eval(Progress* pProgress, const std::vector<RasterElement*>& cubes, int rows, int columns,
+         int bands, char* exp, RasterElement* pResult, bool degrees,
+         std::string& message, bool cubeMath, BMathErrorPolicy errorPolicy);
+
+/**
+ * Returns a normally distributed random number with a mean of 0 and a standard deviation of 1.
+ *
+ * @param seed
+ *        The state of the generator, which is updated.  Each thread uses its own state,
+ *        since the state of rand() is shared by all threads on some runtimes.
+ */
+inline double GRand(unsigned int& seed)
 {
-  return sqrt(-2 * log(SingleRand())) * cos(2.0 * acos(-1.0) * SingleRand());
+  return sqrt(-2 * log(SingleRand(seed))) * cos(2.0 * acos(-1.0) * SingleRand(seed));
 }
 
-inline double SingleRand()
+/**
+ * Returns a uniformly distributed random number in the open interval (0, 1).
+ *
+ * @param seed
+ *        The state of the generator, which is updated.
+ */
+inline double SingleRand(unsigned int& seed)
 {
-   double value = static_cast<double>(rand() + 1) / RAND_MAX;
-   while (value <= 0 || value >= 1)
-   {
-     value = static_cast<double>(rand() + 1) / RAND_MAX;
-   }
-
-   return value;
+   // linear congruential generator, with the constants from Numerical Recipes
+   seed = 1664525U * seed + 1013904223U;
+   return (static_cast<double>(seed) + 1.0) / 4294967297.0;
 }
 
 #endif
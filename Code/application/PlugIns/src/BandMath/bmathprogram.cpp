@@ -0,0 +1,792 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppConfig.h"
+#include "bmathfuncs.h"
+#include "bmathprogram.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace
+{
+   template<typename T>
+   void loadValues(const void* pRow, int first, int stride, int count, double* pValues)
+   {
+      const T* pData = reinterpret_cast<const T*>(pRow) + first;
+      for (int i = 0; i < count; ++i)
+      {
+         pValues[i] = pData[i * stride];
+      }
+   }
+
+   void loadZeros(const void* pRow, int first, int stride, int count, double* pValues)
+   {
+      fill(pValues, pValues + count, 0.0);
+   }
+
+   inline void setError(unsigned char* pErrors, int index, BMathProgram::ErrorType error)
+   {
+      if (pErrors[index] == BMathProgram::NONE)
+      {
+         pErrors[index] = static_cast<unsigned char>(error);
+      }
+   }
+}
+
+BMathProgram::BMathProgram(const DataNode* pTree, const vector<EncodingType>& types,
+                           const vector<unsigned int>& bandCounts, bool degrees) :
+   mTypes(types),
+   mBandCounts(bandCounts),
+   mDegrees(degrees),
+   mRegisterCount(0),
+   mResult(-1)
+{
+   mBandCounts.resize(mTypes.size(), 1);
+   mResult = compile(pTree);
+   mFreeRegisters.clear();
+}
+
+void BMathProgram::initializeRegisters(vector<double>& registers) const
+{
+   registers.assign(static_cast<size_t>(mRegisterCount) * BLOCK_SIZE, 0.0);
+   for (vector<pair<int, double> >::const_iterator iter = mConstants.begin(); iter != mConstants.end(); ++iter)
+   {
+      double* pRegister = &registers[iter->first * BLOCK_SIZE];
+      fill(pRegister, pRegister + BLOCK_SIZE, iter->second);
+   }
+}
+
+const double* BMathProgram::evaluate(const vector<const void*>& rows, int startColumn, int count, int band,
+                                     vector<double>& registers, unsigned int& randomSeed,
+                                     unsigned char* pErrors) const
+{
+   count = min(count, static_cast<int>(BLOCK_SIZE));
+   fill(pErrors, pErrors + count, static_cast<unsigned char>(NONE));
+
+   double* pRegisters = &registers.front();
+   for (vector<Instruction>::const_iterator iter = mInstructions.begin(); iter != mInstructions.end(); ++iter)
+   {
+      const Instruction& instruction = *iter;
+      double* pDest = pRegisters + instruction.mDestination * BLOCK_SIZE;
+      const double* pLeft = pRegisters + max(instruction.mLeft, 0) * BLOCK_SIZE;
+      const double* pRight = pRegisters + max(instruction.mRight, 0) * BLOCK_SIZE;
+
+      // Error checks read the operands before the result is stored, since the
+      // destination may be the same register as one of the operands.
+      int i = 0;
+      switch (instruction.mOpCode)
+      {
+      case LOAD_BAND:
+         instruction.mLoad(rows[instruction.mCube], startColumn * mBandCounts[instruction.mCube] + instruction.mOffset,
+            mBandCounts[instruction.mCube], count, pDest);
+         break;
+      case LOAD_CUBE:
+         instruction.mLoad(rows[instruction.mCube], startColumn * mBandCounts[instruction.mCube] + band,
+            mBandCounts[instruction.mCube], count, pDest);
+         break;
+      case ADD:
+         for (i = 0; i < count; ++i)
+         {
+            pDest[i] = pLeft[i] + pRight[i];
+         }
+         break;
+      case SUBTRACT:
+         for (i = 0; i < count; ++i)
+         {
+            pDest[i] = pLeft[i] - pRight[i];
+         }
+         break;
+      case MULTIPLY:
+         for (i = 0; i < count; ++i)
+         {
+            pDest[i] = pLeft[i] * pRight[i];
+         }
+         break;
+      case CHECK_DIVISOR:
+         for (i = 0; i < count; ++i)
+         {
+            if (pLeft[i] == 0)
+            {
+               setError(pErrors, i, DIVIDE_BY_ZERO);
+            }
+         }
+         break;
+      case DIVIDE:
+         // the divisor was checked by a preceding CHECK_DIVISOR instruction
+         for (i = 0; i < count; ++i)
+         {
+            pDest[i] = pLeft[i] / pRight[i];
+         }
+         break;
+      case POWER:
+         for (i = 0; i < count; ++i)
+         {
+            double inter;
+            if (pLeft[i] == 0 && pRight[i] <= 0)
+            {
+               setError(pErrors, i, DIVIDE_BY_ZERO);
+            }
+            else if (pLeft[i] < 0 && modf(pRight[i], &inter) != 0)
+            {
+               setError(pErrors, i, COMPLEX_VALUE);
+            }
+            pDest[i] = pow(pLeft[i], pRight[i]);
+         }
+         break;
+      case SQRT:
+         for (i = 0; i < count; ++i)
+         {
+            if (pLeft[i] <= 0)
+            {
+               setError(pErrors, i, COMPLEX_VALUE);
+            }
+         }
+         for (i = 0; i < count; ++i)
+         {
+            pDest[i] = sqrt(pLeft[i]);
+         }
+         break;
+      case SIN:
+         for (i = 0; i < count; ++i)
+         {
+            pDest[i] = sin(pLeft[i]);
+         }
+         break;
+      case COS:
+         for (i = 0; i < count; ++i)
+         {
+            pDest[i] = cos(pLeft[i]);
+         }
+         break;
+      case TAN:
+         for (i = 0; i < count; ++i)
+         {
+            pDest[i] = tan(pLeft[i]);
+         }
+         break;
+      case LOG:
+      case LOG10:
+      case LOG2:
+         for (i = 0; i < count; ++i)
+         {
+            if (pLeft[i] <= 0)
+            {
+               setError(pErrors, i, UNDEFINED_VALUE);
+            }
+         }
+         if (instruction.mOpCode == LOG10)
+         {
+            for (i = 0; i < count; ++i)
+            {
+               pDest[i] = log10(pLeft[i]);
+            }
+         }
+         else if (instruction.mOpCode == LOG2)
+         {
+            double ln2 = log(2.0);
+            for (i = 0; i < count; ++i)
+            {
+               pDest[i] = log(pLeft[i]) / ln2;
+            }
+         }
+         else
+         {
+            for (i = 0; i < count; ++i)
+            {
+               pDest[i] = log(pLeft[i]);
+            }
+         }
+         break;
+      case EXP:
+         for (i = 0; i < count; ++i)
+         {
+            pDest[i] = exp(pLeft[i]);
+         }
+         break;
+      case ABS:
+         for (i = 0; i < count; ++i)
+         {
+            pDest[i] = fabs(pLeft[i]);
+         }
+         break;
+      case ASIN:
+      case ACOS:
+         for (i = 0; i < count; ++i)
+         {
+            if (pLeft[i] < -1 || pLeft[i] > 1)
+            {
+               setError(pErrors, i, COMPLEX_VALUE);
+            }
+         }
+         if (instruction.mOpCode == ASIN)
+         {
+            for (i = 0; i < count; ++i)
+            {
+               pDest[i] = asin(pLeft[i]);
+            }
+         }
+         else
+         {
+            for (i = 0; i < count; ++i)
+            {
+               pDest[i] = acos(pLeft[i]);
+            }
+         }
+         break;
+      case ATAN:
+         for (i = 0; i < count; ++i)
+         {
+            pDest[i] = atan(pLeft[i]);
+         }
+         break;
+      case SINH:
+         for (i = 0; i < count; ++i)
+         {
+            pDest[i] = sinh(pLeft[i]);
+         }
+         break;
+      case COSH:
+         for (i = 0; i < count; ++i)
+         {
+            pDest[i] = cosh(pLeft[i]);
+         }
+         break;
+      case TANH:
+         for (i = 0; i < count; ++i)
+         {
+            pDest[i] = tanh(pLeft[i]);
+         }
+         break;
+      case RECIPROCAL:
+         for (i = 0; i < count; ++i)
+         {
+            pDest[i] = 1 / pLeft[i];
+         }
+         break;
+      case RAND:
+         for (i = 0; i < count; ++i)
+         {
+            pDest[i] = GRand(randomSeed) * pLeft[i];
+         }
+         break;
+      default:
+         break;
+      }
+   }
+
+   return pRegisters + mResult * BLOCK_SIZE;
+}
+
+int BMathProgram::compile(const DataNode* pNode)
+{
+   if (pNode == NULL || pNode->Opera == NULL || mTypes.empty())
+   {
+      return addConstant(0.0);
+   }
+
+   const char* pOpera = pNode->Opera;
+   if (!pNode->isOperator)
+   {
+      if (!strcmp(pOpera, "pi") || !strcmp(pOpera, "PI") || !strcmp(pOpera, "Pi"))
+      {
+         return addConstant(PI);
+      }
+
+      if (!strcmp(pOpera, "e") || !strcmp(pOpera, "E"))
+      {
+         return addConstant(exp(1.0));
+      }
+
+      if ((pOpera[0] == 'b') || (pOpera[0] == 'B'))
+      {
+         int bandOperation = atoi(&pOpera[1]) - 1;
+         if (bandOperation < 0 || bandOperation >= static_cast<int>(mBandCounts[0]))
+         {
+            return addConstant(0.0);
+         }
+         return emitLoad(LOAD_BAND, 0, bandOperation);
+      }
+
+      if ((pOpera[0] == 'c') || (pOpera[0] == 'C'))
+      {
+         int cube = atoi(&pOpera[1]) - 1;
+         if (cube < 0 || cube >= static_cast<int>(mTypes.size()))
+         {
+            return addConstant(0.0);
+         }
+         return emitLoad(LOAD_CUBE, cube, 0);
+      }
+
+      return addConstant(atof(pOpera));
+   }
+
+   if (!strcmp(pOpera, "("))
+   {
+      return compile(pNode->Right);
+   }
+
+   OpCode binaryOpCode = ADD;
+   bool isBinary = true;
+   if (!strcmp(pOpera, "+"))
+   {
+      binaryOpCode = ADD;
+   }
+   else if (!strcmp(pOpera, "-"))
+   {
+      binaryOpCode = SUBTRACT;
+   }
+   else if (!strcmp(pOpera, "*"))
+   {
+      binaryOpCode = MULTIPLY;
+   }
+   else if (!strcmp(pOpera, "/"))
+   {
+      binaryOpCode = DIVIDE;
+   }
+   else if (!strcmp(pOpera, "^"))
+   {
+      binaryOpCode = POWER;
+   }
+   else
+   {
+      isBinary = false;
+   }
+
+   if (binaryOpCode == DIVIDE)
+   {
+      // The divisor is evaluated and checked before the dividend, so a division by zero
+      // takes precedence over an error in the dividend.
+      int right = emitDivisorCheck(compile(pNode->Right));
+      int left = compile(pNode->Left);
+      return emitBinary(binaryOpCode, left, right);
+   }
+
+   if (isBinary)
+   {
+      int left = compile(pNode->Left);
+      int right = compile(pNode->Right);
+      return emitBinary(binaryOpCode, left, right);
+   }
+
+   // Trigonometric functions in degrees convert their argument to radians,
+   // and inverse functions convert their result to degrees.
+   int operand = compile(pNode->Right);
+   int toDegrees = -1;
+   if (mDegrees)
+   {
+      if (!strcmp(pOpera, "sin") || !strcmp(pOpera, "cos") || !strcmp(pOpera, "tan") ||
+         !strcmp(pOpera, "sinh") || !strcmp(pOpera, "cosh") || !strcmp(pOpera, "tanh") ||
+         !strcmp(pOpera, "csc") || !strcmp(pOpera, "sec") || !strcmp(pOpera, "cot") ||
+         !strcmp(pOpera, "csch") || !strcmp(pOpera, "sech") || !strcmp(pOpera, "coth"))
+      {
+         operand = emitBinary(MULTIPLY, addConstant(D_TO_R_MULT), operand);
+      }
+      else if (!strcmp(pOpera, "asin") || !strcmp(pOpera, "acos") || !strcmp(pOpera, "atan") ||
+         !strcmp(pOpera, "acsc") || !strcmp(pOpera, "asec") || !strcmp(pOpera, "acot"))
+      {
+         toDegrees = addConstant(R_TO_D_MULT);
+      }
+   }
+
+   int result = -1;
+   if (!strcmp(pOpera, "sqrt"))
+   {
+      result = emitUnary(SQRT, operand);
+   }
+   else if (!strcmp(pOpera, "sin"))
+   {
+      result = emitUnary(SIN, operand);
+   }
+   else if (!strcmp(pOpera, "cos"))
+   {
+      result = emitUnary(COS, operand);
+   }
+   else if (!strcmp(pOpera, "tan"))
+   {
+      result = emitUnary(TAN, operand);
+   }
+   else if (!strcmp(pOpera, "log"))
+   {
+      result = emitUnary(LOG, operand);
+   }
+   else if (!strcmp(pOpera, "log10"))
+   {
+      result = emitUnary(LOG10, operand);
+   }
+   else if (!strcmp(pOpera, "log2"))
+   {
+      result = emitUnary(LOG2, operand);
+   }
+   else if (!strcmp(pOpera, "exp"))
+   {
+      result = emitUnary(EXP, operand);
+   }
+   else if (!strcmp(pOpera, "abs"))
+   {
+      result = emitUnary(ABS, operand);
+   }
+   else if (!strcmp(pOpera, "asin"))
+   {
+      result = emitUnary(ASIN, operand);
+   }
+   else if (!strcmp(pOpera, "acos"))
+   {
+      result = emitUnary(ACOS, operand);
+   }
+   else if (!strcmp(pOpera, "atan"))
+   {
+      result = emitUnary(ATAN, operand);
+   }
+   else if (!strcmp(pOpera, "sinh"))
+   {
+      result = emitUnary(SINH, operand);
+   }
+   else if (!strcmp(pOpera, "cosh"))
+   {
+      result = emitUnary(COSH, operand);
+   }
+   else if (!strcmp(pOpera, "tanh"))
+   {
+      result = emitUnary(TANH, operand);
+   }
+   else if (!strcmp(pOpera, "csc"))
+   {
+      result = emitUnary(RECIPROCAL, emitUnary(SIN, operand));
+   }
+   else if (!strcmp(pOpera, "sec"))
+   {
+      result = emitUnary(RECIPROCAL, emitUnary(COS, operand));
+   }
+   else if (!strcmp(pOpera, "cot"))
+   {
+      result = emitUnary(RECIPROCAL, emitUnary(TAN, operand));
+   }
+   else if (!strcmp(pOpera, "acsc"))
+   {
+      result = emitUnary(ASIN, emitUnary(RECIPROCAL, operand));
+   }
+   else if (!strcmp(pOpera, "asec"))
+   {
+      result = emitUnary(ACOS, emitUnary(RECIPROCAL, operand));
+   }
+   else if (!strcmp(pOpera, "acot"))
+   {
+      result = emitUnary(ATAN, emitUnary(RECIPROCAL, operand));
+   }
+   else if (!strcmp(pOpera, "csch"))
+   {
+      result = emitUnary(RECIPROCAL, emitUnary(SINH, operand));
+   }
+   else if (!strcmp(pOpera, "sech"))
+   {
+      result = emitUnary(RECIPROCAL, emitUnary(COSH, operand));
+   }
+   else if (!strcmp(pOpera, "coth"))
+   {
+      result = emitUnary(RECIPROCAL, emitUnary(TANH, operand));
+   }
+   else if (!strcmp(pOpera, "rand"))
+   {
+      result = emitUnary(RAND, operand);
+   }
+   else
+   {
+      // unknown operators evaluate to zero
+      releaseRegister(operand);
+      return addConstant(0.0);
+   }
+
+   if (toDegrees >= 0)
+   {
+      result = emitBinary(MULTIPLY, toDegrees, result);
+   }
+
+   return result;
+}
+
+int BMathProgram::emitLoad(OpCode opCode, int cube, int offset)
+{
+   Instruction instruction;
+   instruction.mOpCode = opCode;
+   instruction.mDestination = allocateRegister();
+   instruction.mLeft = -1;
+   instruction.mRight = -1;
+   instruction.mCube = cube;
+   instruction.mOffset = offset;
+
+   switch (mTypes[cube])
+   {
+   case INT1SBYTE:
+      instruction.mLoad = loadValues<signed char>;
+      break;
+   case INT1UBYTE:
+      instruction.mLoad = loadValues<unsigned char>;
+      break;
+   case INT2SBYTES:
+      instruction.mLoad = loadValues<signed short>;
+      break;
+   case INT2UBYTES:
+      instruction.mLoad = loadValues<unsigned short>;
+      break;
+   case INT4SBYTES:
+      instruction.mLoad = loadValues<signed int>;
+      break;
+   case INT4UBYTES:
+      instruction.mLoad = loadValues<unsigned int>;
+      break;
+   case FLT4BYTES:
+      instruction.mLoad = loadValues<float>;
+      break;
+   case FLT8BYTES:
+      instruction.mLoad = loadValues<double>;
+      break;
+   default:
+      instruction.mLoad = loadZeros;
+      break;
+   }
+
+   mInstructions.push_back(instruction);
+   return instruction.mDestination;
+}
+
+int BMathProgram::emitUnary(OpCode opCode, int operand)
+{
+   if (opCode != RAND && isConstant(operand))
+   {
+      double value = 0.0;
+      if (evaluateConstant(opCode, getConstant(operand), 0.0, value))
+      {
+         return addConstant(value);
+      }
+   }
+
+   releaseRegister(operand);
+
+   Instruction instruction;
+   instruction.mOpCode = opCode;
+   instruction.mDestination = allocateRegister();
+   instruction.mLeft = operand;
+   instruction.mRight = -1;
+   instruction.mLoad = NULL;
+   instruction.mCube = -1;
+   instruction.mOffset = 0;
+   mInstructions.push_back(instruction);
+   return instruction.mDestination;
+}
+
+int BMathProgram::emitBinary(OpCode opCode, int left, int right)
+{
+   if (isConstant(left) && isConstant(right))
+   {
+      double value = 0.0;
+      if (evaluateConstant(opCode, getConstant(left), getConstant(right), value))
+      {
+         return addConstant(value);
+      }
+   }
+
+   releaseRegister(left);
+   releaseRegister(right);
+
+   Instruction instruction;
+   instruction.mOpCode = opCode;
+   instruction.mDestination = allocateRegister();
+   instruction.mLeft = left;
+   instruction.mRight = right;
+   instruction.mLoad = NULL;
+   instruction.mCube = -1;
+   instruction.mOffset = 0;
+   mInstructions.push_back(instruction);
+   return instruction.mDestination;
+}
+
+int BMathProgram::emitDivisorCheck(int divisor)
+{
+   if (isConstant(divisor) && getConstant(divisor) != 0)
+   {
+      return divisor;
+   }
+
+   // the check does not modify the divisor, so its destination is the divisor's register
+   Instruction instruction;
+   instruction.mOpCode = CHECK_DIVISOR;
+   instruction.mDestination = divisor;
+   instruction.mLeft = divisor;
+   instruction.mRight = -1;
+   instruction.mLoad = NULL;
+   instruction.mCube = -1;
+   instruction.mOffset = 0;
+   mInstructions.push_back(instruction);
+   return divisor;
+}
+
+int BMathProgram::addConstant(double value)
+{
+   // constant registers are never reused, so they only need to be filled once
+   int reg = mRegisterCount++;
+   mConstants.push_back(make_pair(reg, value));
+   return reg;
+}
+
+int BMathProgram::allocateRegister()
+{
+   if (mFreeRegisters.empty())
+   {
+      return mRegisterCount++;
+   }
+
+   int reg = mFreeRegisters.back();
+   mFreeRegisters.pop_back();
+   return reg;
+}
+
+void BMathProgram::releaseRegister(int reg)
+{
+   if (reg >= 0 && !isConstant(reg) && find(mFreeRegisters.begin(), mFreeRegisters.end(), reg) == mFreeRegisters.end())
+   {
+      mFreeRegisters.push_back(reg);
+   }
+}
+
+bool BMathProgram::isConstant(int reg) const
+{
+   for (vector<pair<int, double> >::const_iterator iter = mConstants.begin(); iter != mConstants.end(); ++iter)
+   {
+      if (iter->first == reg)
+      {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+double BMathProgram::getConstant(int reg) const
+{
+   for (vector<pair<int, double> >::const_iterator iter = mConstants.begin(); iter != mConstants.end(); ++iter)
+   {
+      if (iter->first == reg)
+      {
+         return iter->second;
+      }
+   }
+
+   return 0.0;
+}
+
+bool BMathProgram::evaluateConstant(OpCode opCode, double left, double right, double& result)
+{
+   // Sub-expressions which would produce an error are not folded, so that the
+   // error is reported for every pixel when the program is evaluated.
+   double inter;
+   switch (opCode)
+   {
+   case ADD:
+      result = left + right;
+      break;
+   case SUBTRACT:
+      result = left - right;
+      break;
+   case MULTIPLY:
+      result = left * right;
+      break;
+   case DIVIDE:
+      if (right == 0)
+      {
+         return false;
+      }
+      result = left / right;
+      break;
+   case POWER:
+      if ((left == 0 && right <= 0) || (left < 0 && modf(right, &inter) != 0))
+      {
+         return false;
+      }
+      result = pow(left, right);
+      break;
+   case SQRT:
+      if (left <= 0)
+      {
+         return false;
+      }
+      result = sqrt(left);
+      break;
+   case SIN:
+      result = sin(left);
+      break;
+   case COS:
+      result = cos(left);
+      break;
+   case TAN:
+      result = tan(left);
+      break;
+   case LOG:
+      if (left <= 0)
+      {
+         return false;
+      }
+      result = log(left);
+      break;
+   case LOG10:
+      if (left <= 0)
+      {
+         return false;
+      }
+      result = log10(left);
+      break;
+   case LOG2:
+      if (left <= 0)
+      {
+         return false;
+      }
+      result = log(left) / log(2.0);
+      break;
+   case EXP:
+      result = exp(left);
+      break;
+   case ABS:
+      result = fabs(left);
+      break;
+   case ASIN:
+      if (left < -1 || left > 1)
+      {
+         return false;
+      }
+      result = asin(left);
+      break;
+   case ACOS:
+      if (left < -1 || left > 1)
+      {
+         return false;
+      }
+      result = acos(left);
+      break;
+   case ATAN:
+      result = atan(left);
+      break;
+   case SINH:
+      result = sinh(left);
+      break;
+   case COSH:
+      result = cosh(left);
+      break;
+   case TANH:
+      result = tanh(left);
+      break;
+   case RECIPROCAL:
+      result = 1 / left;
+      break;
+   default:
+      return false;
+   }
+
+   return true;
+}
@@ -0,0 +1,172 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef BMATHPROGRAM_H
+#define BMATHPROGRAM_H
+
+#include "TypesFile.h"
+
+#include <utility>
+#include <vector>
+
+class DataNode;
+
+/**
+ * A band math expression compiled into a flat list of instructions.
+ *
+ * The expression tree is compiled once.  Each instruction then operates on a
+ * block of up to BLOCK_SIZE pixels held in a register, so the operators are
+ * dispatched once per block instead of once per pixel and the arithmetic loops
+ * can be vectorized by the compiler.  Sub-expressions which only contain
+ * constants are folded when the program is compiled, and the loads from each
+ * cube are specialized for the cube's data type.
+ *
+ * A program is not modified by evaluate(), so a single program may be shared
+ * by several threads as long as each thread uses its own registers.
+ */
+class BMathProgram
+{
+public:
+   /**
+    * The errors which can occur when evaluating a pixel.
+    */
+   enum ErrorType
+   {
+      NONE = 0,
+      DIVIDE_BY_ZERO,
+      UNDEFINED_VALUE,
+      COMPLEX_VALUE
+   };
+
+   /**
+    * The maximum number of pixels evaluated by one call to evaluate().
+    */
+   static const int BLOCK_SIZE = 256;
+
+   /**
+    * Compiles an expression tree.
+    *
+    * @param pTree
+    *        The tree built by BuildTreeFromInfix().
+    * @param types
+    *        The data type of each cube.
+    * @param bandCounts
+    *        The number of bands in each cube.  The cubes are accessed in BIP.
+    * @param degrees
+    *        True if the trigonometric functions use degrees.
+    */
+   BMathProgram(const DataNode* pTree, const std::vector<EncodingType>& types,
+      const std::vector<unsigned int>& bandCounts, bool degrees);
+
+   /**
+    * Creates the registers used to evaluate the program.
+    *
+    * The constant registers are initialized, so this only needs to be called
+    * once for each thread which evaluates the program.
+    *
+    * @param registers
+    *        Populated with the registers.
+    */
+   void initializeRegisters(std::vector<double>& registers) const;
+
+   /**
+    * Evaluates the program for a block of pixels in one row.
+    *
+    * @param rows
+    *        A pointer to the first pixel of the row in each cube.
+    * @param startColumn
+    *        The column of the first pixel to evaluate.
+    * @param count
+    *        The number of pixels to evaluate.  This may not exceed BLOCK_SIZE.
+    * @param band
+    *        The band which is being calculated in cube math.
+    * @param registers
+    *        The registers created by initializeRegisters().
+    * @param randomSeed
+    *        The state of the generator used by the rand() operator, which is updated.
+    *        Each thread should use its own seed.
+    * @param pErrors
+    *        Populated with the first ErrorType which occurred for each pixel.
+    *        Operands are evaluated from left to right, except that a divisor is
+    *        evaluated and checked before its dividend, which is the order in
+    *        which the tree evaluator reported errors.  This must hold at least
+    *        count values.
+    *
+    * @return The values of the pixels.  The values of pixels with an error are undefined.
+    */
+   const double* evaluate(const std::vector<const void*>& rows, int startColumn, int count, int band,
+      std::vector<double>& registers, unsigned int& randomSeed, unsigned char* pErrors) const;
+
+private:
+   enum OpCode
+   {
+      LOAD_BAND,
+      LOAD_CUBE,
+      ADD,
+      SUBTRACT,
+      MULTIPLY,
+      CHECK_DIVISOR,
+      DIVIDE,
+      POWER,
+      SQRT,
+      SIN,
+      COS,
+      TAN,
+      LOG,
+      LOG10,
+      LOG2,
+      EXP,
+      ABS,
+      ASIN,
+      ACOS,
+      ATAN,
+      SINH,
+      COSH,
+      TANH,
+      RECIPROCAL,
+      RAND
+   };
+
+   typedef void (*LoadFunction)(const void* pRow, int first, int stride, int count, double* pValues);
+
+   struct Instruction
+   {
+      OpCode mOpCode;
+      int mDestination;
+      int mLeft;
+      int mRight;
+      LoadFunction mLoad;
+      int mCube;
+      int mOffset;
+   };
+
+   int compile(const DataNode* pNode);
+   int emitLoad(OpCode opCode, int cube, int offset);
+   int emitUnary(OpCode opCode, int operand);
+   int emitBinary(OpCode opCode, int left, int right);
+   int emitDivisorCheck(int divisor);
+   int addConstant(double value);
+   int allocateRegister();
+   void releaseRegister(int reg);
+   bool isConstant(int reg) const;
+   double getConstant(int reg) const;
+   static bool evaluateConstant(OpCode opCode, double left, double right, double& result);
+
+   std::vector<EncodingType> mTypes;
+   std::vector<unsigned int> mBandCounts;
+   bool mDegrees;
+
+   std::vector<Instruction> mInstructions;
+   std::vector<std::pair<int, double> > mConstants; // register and value
+   std::vector<int> mFreeRegisters;
+   int mRegisterCount;
+   int mResult;
+};
+
+#endif
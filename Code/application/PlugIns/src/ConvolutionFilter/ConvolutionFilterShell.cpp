@@ -35,12 +35,265 @@
 #include <QtGui/QInputDialog>
 #include <QtGui/QMessageBox>
 
+#include <algorithm>
+#include <math.h>
+
 namespace
 {
    template<typename T>
-   void assignResult(T* pPixel, double value)
+   void assignResult(T* pRow, const double* pValues, int count)
+   {
+      for (int i = 0; i < count; ++i)
+      {
+         pRow[i] = static_cast<T>(pValues[i]);
+      }
+   }
+
+   template<typename T>
+   void convertRow(const T* pData, int count, double* pValues)
+   {
+      for (int i = 0; i < count; ++i)
+      {
+         pValues[i] = ModelServices::getDataValue(pData[i], COMPLEX_MAGNITUDE);
+      }
+   }
+
+   /**
+    * Adds the correlation of a row with a set of weights to the output.
+    *
+    * pInput must contain count + tapCount - 1 values.  The loop over the
+    * columns is innermost so the compiler can vectorize it.
+    */
+   void correlateRow(const double* pInput, const double* pWeights, int tapCount, int count, double* pOutput)
+   {
+      for (int tap = 0; tap < tapCount; ++tap)
+      {
+         const double weight = pWeights[tap];
+         if (weight == 0.0)
+         {
+            continue;
+         }
+
+         const double* pTapInput = pInput + tap;
+         for (int i = 0; i < count; ++i)
+         {
+            pOutput[i] += weight * pTapInput[i];
+         }
+      }
+   }
+
+   /**
+    * Determines whether a kernel is the outer product of a column and a row (i.e. has rank one).
+    *
+    * @return True if the kernel is separable, in which case the column and row are populated.
+    */
+   bool separateKernel(const NEWMAT::Matrix& kernel, std::vector<double>& column, std::vector<double>& row)
+   {
+      const int rows = kernel.Nrows();
+      const int columns = kernel.Ncols();
+
+      // use the largest element as the pivot to minimize rounding
+      int pivotRow = 1;
+      int pivotColumn = 1;
+      double maxValue = 0.0;
+      for (int r = 1; r <= rows; ++r)
+      {
+         for (int c = 1; c <= columns; ++c)
+         {
+            if (fabs(kernel(r, c)) > maxValue)
+            {
+               maxValue = fabs(kernel(r, c));
+               pivotRow = r;
+               pivotColumn = c;
+            }
+         }
+      }
+      if (maxValue == 0.0)
+      {
+         return false;
+      }
+
+      column.resize(rows);
+      row.resize(columns);
+      for (int r = 1; r <= rows; ++r)
+      {
+         column[r - 1] = kernel(r, pivotColumn);
+      }
+      for (int c = 1; c <= columns; ++c)
+      {
+         row[c - 1] = kernel(pivotRow, c) / kernel(pivotRow, pivotColumn);
+      }
+
+      const double tolerance = maxValue * 1e-12;
+      for (int r = 1; r <= rows; ++r)
+      {
+         for (int c = 1; c <= columns; ++c)
+         {
+            if (fabs(kernel(r, c) - column[r - 1] * row[c - 1]) > tolerance)
+            {
+               column.clear();
+               row.clear();
+               return false;
+            }
+         }
+      }
+
+      return true;
+   }
+
+   /**
+    * Kernels which need at least this many multiplications per pixel when
+    * applied directly are convolved in the frequency domain instead.
+    */
+   const int FFT_MIN_TAPS = 31 * 31;
+
+   /**
+    * A radix-2 complex FFT of a fixed size.
+    */
+   class Fft
+   {
+   public:
+      explicit Fft(int size) :
+         mSize(size),
+         mReversed(size),
+         mTwiddles(size / 2)
+      {
+         int bits = 0;
+         while ((1 << bits) < size)
+         {
+            ++bits;
+         }
+         for (int i = 0; i < size; ++i)
+         {
+            int reversed = 0;
+            for (int bit = 0; bit < bits; ++bit)
+            {
+               reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+            }
+            mReversed[i] = reversed;
+         }
+
+         const double pi = 3.14159265358979323846;
+         for (int i = 0; i < size / 2; ++i)
+         {
+            mTwiddles[i] = std::polar(1.0, -2.0 * pi * i / size);
+         }
+      }
+
+      /**
+       * Transforms data in place.  The inverse transform is not scaled.
+       */
+      void transform(std::complex<double>* pData, bool inverse) const
+      {
+         for (int i = 0; i < mSize; ++i)
+         {
+            if (i < mReversed[i])
+            {
+               std::swap(pData[i], pData[mReversed[i]]);
+            }
+         }
+
+         for (int length = 2; length <= mSize; length *= 2)
+         {
+            const int half = length / 2;
+            const int step = mSize / length;
+            for (int start = 0; start < mSize; start += length)
+            {
+               for (int i = 0; i < half; ++i)
+               {
+                  std::complex<double> twiddle = mTwiddles[i * step];
+                  if (inverse)
+                  {
+                     twiddle = std::conj(twiddle);
+                  }
+
+                  std::complex<double> odd = pData[start + i + half] * twiddle;
+                  pData[start + i + half] = pData[start + i] - odd;
+                  pData[start + i] += odd;
+               }
+            }
+         }
+      }
+
+   private:
+      int mSize;
+      std::vector<int> mReversed;
+      std::vector<std::complex<double> > mTwiddles;
+   };
+
+   /**
+    * Transforms a row-major tile in place.
+    *
+    * Only the first activeRows rows are transformed by the row pass.  For a
+    * forward transform the remaining rows must be zero; for an inverse
+    * transform the remaining rows are not needed by the caller.
+    */
+   void transformTile(std::vector<std::complex<double> >& tile, const Fft& rowFft, const Fft& columnFft,
+      int rows, int columns, int activeRows, bool inverse)
    {
-      *pPixel = static_cast<T>(value);
+      std::vector<std::complex<double> > column(rows);
+      if (!inverse)
+      {
+         for (int row = 0; row < activeRows; ++row)
+         {
+            rowFft.transform(&tile[row * columns], false);
+         }
+      }
+
+      for (int col = 0; col < columns; ++col)
+      {
+         for (int row = 0; row < rows; ++row)
+         {
+            column[row] = tile[row * columns + col];
+         }
+         columnFft.transform(&column[0], inverse);
+         for (int row = 0; row < rows; ++row)
+         {
+            tile[row * columns + col] = column[row];
+         }
+      }
+
+      if (inverse)
+      {
+         for (int row = 0; row < activeRows; ++row)
+         {
+            rowFft.transform(&tile[row * columns], true);
+         }
+      }
+   }
+
+   /**
+    * Removes the rounding error of the transforms from a value which is within
+    * that error of an integer, so integer results are truncated the same way as
+    * when the kernel is applied directly.
+    */
+   double removeRoundingError(double value)
+   {
+      double nearest = floor(value + 0.5);
+      return (fabs(value - nearest) <= 1e-9 * std::max(1.0, fabs(value))) ? nearest : value;
+   }
+
+   /**
+    * Gets the FFT size used for a kernel dimension.
+    *
+    * The size is a power of two about four times the kernel size, so most of
+    * each tile produces valid results, but no larger than the data requires.
+    */
+   int getFftSize(int kernelSize, int dataSize)
+   {
+      int size = 1;
+      while (size < 4 * kernelSize)
+      {
+         size *= 2;
+      }
+
+      int maxSize = 1;
+      while (maxSize < dataSize + kernelSize - 1)
+      {
+         maxSize *= 2;
+      }
+
+      return std::min(size, maxSize);
    }
 }
 
@@ -97,8 +350,59 @@ bool ConvolutionFilterShell::execute(PlugInArgList* pInArgList, PlugInArgList* p
       mProgress.report("Invalid kernel.", 0, ERRORS, true);
       return false;
    }
+
+   // the taps are summed with the kernel as given and each sum is divided by the kernel size once,
+   // so integer results are truncated the same way as summing the taps in a single loop
+   mInput.mWeights.resize(mInput.mKernel.Storage());
+   for (int r = 0; r < mInput.mKernel.Nrows(); ++r)
+   {
+      for (int c = 0; c < mInput.mKernel.Ncols(); ++c)
+      {
+         mInput.mWeights[r * mInput.mKernel.Ncols() + c] = mInput.mKernel(r + 1, c + 1);
+      }
+   }
+
+   // a separable kernel is applied as a horizontal and a vertical pass
+   mInput.mColumnWeights.clear();
+   mInput.mRowWeights.clear();
+   if (mInput.mKernel.Nrows() > 1 && mInput.mKernel.Ncols() > 1)
+   {
+      separateKernel(mInput.mKernel, mInput.mColumnWeights, mInput.mRowWeights);
+   }
    BitMaskIterator iterChecker((mpAoi == NULL) ? NULL : mpAoi->getSelectedPoints(), 0, 0,
       mInput.mpDescriptor->getColumnCount() - 1, mInput.mpDescriptor->getRowCount() - 1);
+
+   // large kernels are convolved with FFTs of overlapping tiles
+   int directTaps = mInput.mColumnWeights.empty() ? mInput.mKernel.Storage() :
+      mInput.mKernel.Nrows() + mInput.mKernel.Ncols();
+   mInput.mFftRows = 0;
+   mInput.mFftColumns = 0;
+   mInput.mKernelSpectrum.clear();
+   if (directTaps >= FFT_MIN_TAPS)
+   {
+      mInput.mFftRows = getFftSize(mInput.mKernel.Nrows(), iterChecker.getNumSelectedRows());
+      mInput.mFftColumns = getFftSize(mInput.mKernel.Ncols(), iterChecker.getNumSelectedColumns());
+
+      // the transform of the kernel is conjugated so multiplying by it correlates the
+      // tile with the kernel, which matches the direct implementation
+      const double scale = 1.0 / (mInput.mFftRows * mInput.mFftColumns);
+      mInput.mKernelSpectrum.resize(mInput.mFftRows * mInput.mFftColumns);
+      for (int r = 0; r < mInput.mKernel.Nrows(); ++r)
+      {
+         for (int c = 0; c < mInput.mKernel.Ncols(); ++c)
+         {
+            mInput.mKernelSpectrum[r * mInput.mFftColumns + c] = mInput.mWeights[r * mInput.mKernel.Ncols() + c];
+         }
+      }
+      transformTile(mInput.mKernelSpectrum, Fft(mInput.mFftColumns), Fft(mInput.mFftRows),
+         mInput.mFftRows, mInput.mFftColumns, mInput.mKernel.Nrows(), false);
+      for (std::vector<std::complex<double> >::iterator value = mInput.mKernelSpectrum.begin();
+         value != mInput.mKernelSpectrum.end(); ++value)
+      {
+         *value = std::conj(*value) * scale;
+      }
+   }
+
    EncodingType resultType = mInput.mpDescriptor->getDataType();
    if (resultType == INT4SCOMPLEX)
    {
@@ -301,7 +605,7 @@ void ConvolutionFilterShell::ConvolutionFilterThread::run()
 template<class T>
 void ConvolutionFilterShell::ConvolutionFilterThread::convolve(const T*)
 {
-   int numResultsCols = mInput.mpIterCheck->getNumSelectedColumns();
+   mResultColumns = mInput.mpIterCheck->getNumSelectedColumns();
    if (mInput.mpResult == NULL)
    {
       return;
@@ -311,15 +615,16 @@ void ConvolutionFilterShell::ConvolutionFilterThread::convolve(const T*)
       mInput.mpResult->getDataDescriptor());
 
    // account for AOIs which extend outside the dataset
-   int maxRowNum = static_cast<int>(mInput.mpDescriptor->getRowCount()) - 1;
+   mMaxRowNum = static_cast<int>(mInput.mpDescriptor->getRowCount()) - 1;
+   int maxColumnNum = static_cast<int>(mInput.mpDescriptor->getColumnCount()) - 1;
    mRowRange.mFirst = std::max(0, mRowRange.mFirst);
-   mRowRange.mLast = std::min(mRowRange.mLast, maxRowNum);
+   mRowRange.mLast = std::min(mRowRange.mLast, mMaxRowNum);
 
    FactoryResource<DataRequest> pResultRequest;
    pResultRequest->setRows(pResultDescriptor->getActiveRow(mRowRange.mFirst),
       pResultDescriptor->getActiveRow(mRowRange.mLast));
    pResultRequest->setColumns(pResultDescriptor->getActiveColumn(0),
-      pResultDescriptor->getActiveColumn(numResultsCols - 1));
+      pResultDescriptor->getActiveColumn(mResultColumns - 1));
    pResultRequest->setWritable(true);
    DataAccessor resultAccessor = mInput.mpResult->getDataAccessor(pResultRequest.release());
    if (!resultAccessor.isValid())
@@ -327,84 +632,309 @@ void ConvolutionFilterShell::ConvolutionFilterThread::convolve(const T*)
       return;
    }
 
-   int index = numResultsCols * mRowRange.mFirst;
-   int oldPercentDone = -1;
-   int rowOffset = static_cast<int>(mInput.mpIterCheck->getOffset().mY);
-   int startRow = mRowRange.mFirst + rowOffset;
-   int stopRow = mRowRange.mLast + rowOffset;
+   mPercentDone = -1;
+   mRowOffset = static_cast<int>(mInput.mpIterCheck->getOffset().mY);
+   mStartRow = mRowRange.mFirst + mRowOffset;
+   mStopRow = mRowRange.mLast + mRowOffset;
 
-   int columnOffset = static_cast<int>(mInput.mpIterCheck->getOffset().mX);
-   int startColumn = columnOffset;
-   int stopColumn = numResultsCols + columnOffset - 1;
+   mStartColumn = static_cast<int>(mInput.mpIterCheck->getOffset().mX);
+   int stopColumn = mResultColumns + mStartColumn - 1;
 
    int yshift = (mInput.mKernel.Nrows() - 1) / 2;
    int xshift = (mInput.mKernel.Ncols() - 1) / 2;
 
+   // read every column the kernel touches; neighbors outside the data set are clamped to the edge
+   mFirstColumn = std::max(0, mStartColumn - xshift);
+   int lastColumn = std::min(maxColumnNum, stopColumn + xshift);
+
    FactoryResource<DataRequest> pRequest;
    pRequest->setInterleaveFormat(BSQ);
-   pRequest->setRows(mInput.mpDescriptor->getActiveRow(std::max(0, startRow - yshift)),
-      mInput.mpDescriptor->getActiveRow(std::min(maxRowNum, stopRow + mInput.mKernel.Nrows() - yshift)));
-   pRequest->setColumns(mInput.mpDescriptor->getActiveColumn(startColumn),
-      mInput.mpDescriptor->getActiveColumn(stopColumn));
+   pRequest->setRows(mInput.mpDescriptor->getActiveRow(std::max(0, mStartRow - yshift)),
+      mInput.mpDescriptor->getActiveRow(std::min(mMaxRowNum, mStopRow + yshift)));
+   pRequest->setColumns(mInput.mpDescriptor->getActiveColumn(mFirstColumn),
+      mInput.mpDescriptor->getActiveColumn(lastColumn));
    pRequest->setBands(mInput.mpDescriptor->getActiveBand(mInput.mBand),
-      mInput.mpDescriptor->getActiveRow(mInput.mBand));
+      mInput.mpDescriptor->getActiveBand(mInput.mBand));
    DataAccessor accessor = mInput.mpRaster->getDataAccessor(pRequest.release());
    if (!accessor.isValid())
    {
       return;
    }
 
-   Service<ModelServices> pModel;
-   for (int row_index = startRow; row_index <= stopRow; ++row_index)
+   // Each input row is converted to double once and padded with the clamped edge
+   // columns, so the taps are contiguous and never need to be clamped.
+   int paddedColumns = mResultColumns + mInput.mKernel.Ncols() - 1;
+   mInputRow.resize(lastColumn - mFirstColumn + 1);
+   mPaddedIndices.resize(paddedColumns);
+   for (int i = 0; i < paddedColumns; ++i)
    {
-      int percentDone = mRowRange.computePercent(row_index - rowOffset);
-      if (percentDone > oldPercentDone)
+      mPaddedIndices[i] = std::min(std::max(0, mStartColumn - xshift + i), maxColumnNum) - mFirstColumn;
+   }
+
+   if (mInput.mFftRows > 0)
+   {
+      convolveTiles<T>(accessor, resultAccessor);
+   }
+   else
+   {
+      convolveRows<T>(accessor, resultAccessor);
+   }
+}
+
+template<class T>
+void ConvolutionFilterShell::ConvolutionFilterThread::convolveRows(DataAccessor& accessor,
+                                                                   DataAccessor& resultAccessor)
+{
+   // The last kernelRows rows are kept in a ring buffer.  For a separable kernel,
+   // the ring holds the rows after the horizontal pass instead.
+   const bool separable = !mInput.mRowWeights.empty();
+   int kernelRows = mInput.mKernel.Nrows();
+   int kernelColumns = mInput.mKernel.Ncols();
+   int yshift = (kernelRows - 1) / 2;
+   int paddedColumns = static_cast<int>(mPaddedIndices.size());
+   int ringColumns = separable ? mResultColumns : paddedColumns;
+   std::vector<double> paddedRow(paddedColumns);
+   std::vector<double> ring(kernelRows * ringColumns);
+   std::vector<double> resultRow(mResultColumns);
+   const double kernelSize = mInput.mKernel.Storage();
+
+   // the separated weights may not multiply back to the kernel exactly
+   EncodingType resultType = static_cast<const RasterDataDescriptor*>(
+      mInput.mpResult->getDataDescriptor())->getDataType();
+   const bool removeError = separable && resultType != FLT4BYTES && resultType != FLT8BYTES;
+
+   // rows are identified by their unclamped row number relative to the first row in the ring
+   int firstRingRow = mStartRow - yshift;
+   int nextRingRow = firstRingRow;
+
+   for (int row_index = mStartRow; row_index <= mStopRow; ++row_index)
+   {
+      if (!reportRow(row_index))
       {
-         oldPercentDone = percentDone;
-         getReporter().reportProgress(getThreadIndex(), percentDone);
+         break;
       }
-      if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+
+      for (; nextRingRow <= row_index - yshift + kernelRows - 1; ++nextRingRow)
+      {
+         if (!readRow<T>(accessor, nextRingRow, &paddedRow[0]))
+         {
+            return;
+         }
+
+         double* pRingRow = &ring[((nextRingRow - firstRingRow) % kernelRows) * ringColumns];
+         if (separable)
+         {
+            std::fill(pRingRow, pRingRow + ringColumns, 0.0);
+            correlateRow(&paddedRow[0], &mInput.mRowWeights[0], kernelColumns, mResultColumns, pRingRow);
+         }
+         else
+         {
+            std::copy(paddedRow.begin(), paddedRow.end(), pRingRow);
+         }
+      }
+
+      std::fill(resultRow.begin(), resultRow.end(), 0.0);
+      for (int kernelrow = 0; kernelrow < kernelRows; ++kernelrow)
+      {
+         const double* pRingRow =
+            &ring[((row_index - yshift + kernelrow - firstRingRow) % kernelRows) * ringColumns];
+         if (separable)
+         {
+            correlateRow(pRingRow, &mInput.mColumnWeights[kernelrow], 1, mResultColumns, &resultRow[0]);
+         }
+         else
+         {
+            correlateRow(pRingRow, &mInput.mWeights[kernelrow * kernelColumns], kernelColumns, mResultColumns,
+               &resultRow[0]);
+         }
+      }
+
+      for (int col = 0; col < mResultColumns; ++col)
+      {
+         resultRow[col] /= kernelSize;
+         if (removeError)
+         {
+            resultRow[col] = removeRoundingError(resultRow[col]);
+         }
+      }
+
+      if (!writeRow(resultAccessor, &resultRow[0], row_index))
+      {
+         return;
+      }
+   }
+}
+
+template<class T>
+void ConvolutionFilterShell::ConvolutionFilterThread::convolveTiles(DataAccessor& accessor,
+                                                                    DataAccessor& resultAccessor)
+{
+   // Overlap-save: each tile is correlated with the kernel by multiplying the transforms.
+   // Only the part of the result which does not wrap around the tile is kept, so the
+   // input tiles overlap by the kernel size minus one.
+   int kernelRows = mInput.mKernel.Nrows();
+   int kernelColumns = mInput.mKernel.Ncols();
+   int yshift = (kernelRows - 1) / 2;
+   int fftRows = mInput.mFftRows;
+   int fftColumns = mInput.mFftColumns;
+   int tileRows = fftRows - kernelRows + 1;
+   int tileColumns = fftColumns - kernelColumns + 1;
+   int paddedColumns = static_cast<int>(mPaddedIndices.size());
+
+   EncodingType resultType = static_cast<const RasterDataDescriptor*>(
+      mInput.mpResult->getDataDescriptor())->getDataType();
+   const bool integerResult = (resultType != FLT4BYTES && resultType != FLT8BYTES);
+   const double kernelSize = mInput.mKernel.Storage();
+
+   Fft rowFft(fftColumns);
+   Fft columnFft(fftRows);
+   std::vector<double> paddedRows(fftRows * paddedColumns);
+   std::vector<std::complex<double> > tile(fftRows * fftColumns);
+   std::vector<double> resultRows(tileRows * mResultColumns);
+
+   for (int tileRow = mStartRow; tileRow <= mStopRow; tileRow += tileRows)
+   {
+      if (!reportRow(tileRow))
       {
          break;
       }
 
-      for (int col_index = startColumn; col_index <= stopColumn; ++col_index)
+      int rowCount = std::min(tileRows, mStopRow - tileRow + 1);
+      int inputRows = rowCount + kernelRows - 1;
+      for (int i = 0; i < inputRows; ++i)
+      {
+         if (!readRow<T>(accessor, tileRow - yshift + i, &paddedRows[i * paddedColumns]))
+         {
+            return;
+         }
+      }
+
+      // the kernel is real, so two adjacent tiles are transformed together: one as the
+      // real part and one as the imaginary part
+      for (int tileColumn = 0; tileColumn < mResultColumns; tileColumn += 2 * tileColumns)
       {
-         double accum = 0.0;
-         if (mInput.mpIterCheck->getPixel(col_index, row_index))
+         std::fill(tile.begin(), tile.end(), std::complex<double>());
+         for (int row = 0; row < inputRows; ++row)
          {
-            for (int kernelrow = 0; kernelrow < mInput.mKernel.Nrows(); kernelrow++)
+            const double* pPaddedRow = &paddedRows[row * paddedColumns];
+            std::complex<double>* pTileRow = &tile[row * fftColumns];
+            for (int col = 0; col < fftColumns; ++col)
             {
-               int neighbor_row = row_index - yshift + kernelrow;
-               int real_row = std::min(std::max(0, neighbor_row),
-                  static_cast<int>(mInput.mpDescriptor->getRowCount()) - 1);
-               for (int kernelcol = 0; kernelcol < mInput.mKernel.Ncols(); kernelcol++)
-               {
-                  int neighbor_col = col_index - xshift + kernelcol;
-                  int real_col = std::min(std::max(0, neighbor_col),
-                     static_cast<int>(mInput.mpDescriptor->getColumnCount()) - 1);
-                  accessor->toPixel(real_row, real_col);
-                  if (accessor.isValid() == false)
-                  {
-                     return;
-                  }
+               int realColumn = tileColumn + col;
+               int imaginaryColumn = realColumn + tileColumns;
+               pTileRow[col] = std::complex<double>(
+                  realColumn < paddedColumns ? pPaddedRow[realColumn] : 0.0,
+                  imaginaryColumn < paddedColumns ? pPaddedRow[imaginaryColumn] : 0.0);
+            }
+         }
+
+         transformTile(tile, rowFft, columnFft, fftRows, fftColumns, inputRows, false);
+         for (int i = 0; i < fftRows * fftColumns; ++i)
+         {
+            tile[i] *= mInput.mKernelSpectrum[i];
+         }
+         transformTile(tile, rowFft, columnFft, fftRows, fftColumns, rowCount, true);
 
-                  double val = 0.0;
-                  pModel->getDataValue<T>(reinterpret_cast<T*>(accessor->getColumn()), COMPLEX_MAGNITUDE, 0, val);
-                  accum += mInput.mKernel(kernelrow+1, kernelcol+1) * val / mInput.mKernel.Storage();
+         for (int i = 0; i < rowCount * fftColumns; ++i)
+         {
+            tile[i] /= kernelSize;
+            if (integerResult)
+            {
+               tile[i] = std::complex<double>(removeRoundingError(tile[i].real()),
+                  removeRoundingError(tile[i].imag()));
+            }
+         }
+
+         for (int row = 0; row < rowCount; ++row)
+         {
+            const std::complex<double>* pTileRow = &tile[row * fftColumns];
+            double* pResultRow = &resultRows[row * mResultColumns];
+            for (int col = 0; col < tileColumns; ++col)
+            {
+               int realColumn = tileColumn + col;
+               int imaginaryColumn = realColumn + tileColumns;
+               if (realColumn < mResultColumns)
+               {
+                  pResultRow[realColumn] = pTileRow[col].real();
+               }
+               if (imaginaryColumn < mResultColumns)
+               {
+                  pResultRow[imaginaryColumn] = pTileRow[col].imag();
                }
             }
          }
-         if (resultAccessor.isValid() == false)
+      }
+
+      for (int row = 0; row < rowCount; ++row)
+      {
+         if (!writeRow(resultAccessor, &resultRows[row * mResultColumns], tileRow + row))
          {
             return;
          }
+      }
+   }
+}
 
-         switchOnEncoding(pResultDescriptor->getDataType(), assignResult, resultAccessor->getColumn(), accum);
-         resultAccessor->nextColumn();
+template<class T>
+bool ConvolutionFilterShell::ConvolutionFilterThread::readRow(DataAccessor& accessor, int row, double* pPaddedRow)
+{
+   int real_row = std::min(std::max(0, row), mMaxRowNum);
+   accessor->toPixel(real_row, mFirstColumn);
+   if (accessor.isValid() == false)
+   {
+      return false;
+   }
+
+   convertRow(reinterpret_cast<const T*>(accessor->getColumn()), static_cast<int>(mInputRow.size()), &mInputRow[0]);
+   for (std::vector<int>::size_type i = 0; i < mPaddedIndices.size(); ++i)
+   {
+      pPaddedRow[i] = mInputRow[mPaddedIndices[i]];
+   }
+
+   return true;
+}
+
+bool ConvolutionFilterShell::ConvolutionFilterThread::writeRow(DataAccessor& resultAccessor, double* pResultRow,
+                                                               int row)
+{
+   if (!mInput.mpIterCheck->useAllPixels())
+   {
+      // clear the unselected pixels between the runs of selected pixels
+      mSpans.clear();
+      mInput.mpIterCheck->getRowSpans(row, mSpans);
+      int col = 0;
+      for (std::vector<BitMaskIterator::Span>::const_iterator iter = mSpans.begin(); iter != mSpans.end(); ++iter)
+      {
+         int startCol = std::min(std::max(iter->mStartColumn - mStartColumn, col), mResultColumns);
+         std::fill(pResultRow + col, pResultRow + startCol, 0.0);
+         col = std::min(std::max(iter->mEndColumn - mStartColumn, col), mResultColumns);
       }
-      resultAccessor->nextRow();
+      std::fill(pResultRow + col, pResultRow + mResultColumns, 0.0);
    }
+
+   if (resultAccessor.isValid() == false)
+   {
+      return false;
+   }
+
+   const RasterDataDescriptor* pResultDescriptor = static_cast<const RasterDataDescriptor*>(
+      mInput.mpResult->getDataDescriptor());
+   switchOnEncoding(pResultDescriptor->getDataType(), assignResult, resultAccessor->getRow(), pResultRow,
+      mResultColumns);
+   resultAccessor->nextRow();
+   return true;
+}
+
+bool ConvolutionFilterShell::ConvolutionFilterThread::reportRow(int row)
+{
+   int percentDone = mRowRange.computePercent(row - mRowOffset);
+   if (percentDone > mPercentDone)
+   {
+      mPercentDone = percentDone;
+      getReporter().reportProgress(getThreadIndex(), percentDone);
+   }
+
+   return mInput.mpAbortFlag == NULL || *mInput.mpAbortFlag == false;
 }
 
 bool ConvolutionFilterShell::ConvolutionFilterThreadOutput::compileOverallResults(
@@ -11,13 +11,17 @@
 #define CONVOLUTIONFILTERSHELL_H
 
 #include "AlgorithmShell.h"
+#include "BitMaskIterator.h"
 #include "MultiThreadedAlgorithm.h"
 #include "ProgressTracker.h"
 
 #include <ossim/matrix/newmat.h>
 
+#include <complex>
+#include <vector>
+
 class AoiElement;
-class BitMaskIterator;
+class DataAccessor;
 class RasterDataDescriptor;
 class RasterElement;
 
@@ -51,7 +55,9 @@ protected:
             mpResult(NULL),
             mpAbortFlag(NULL),
             mpIterCheck(NULL),
-            mBand(0)
+            mBand(0),
+            mFftRows(0),
+            mFftColumns(0)
       {}
 
       const RasterElement* mpRaster;
@@ -61,6 +67,33 @@ protected:
       const BitMaskIterator* mpIterCheck;
       unsigned int mBand;
       NEWMAT::Matrix mKernel;
+
+      /**
+       * The kernel in row-major order.  The sum of the taps is divided by the
+       * number of elements in the kernel once for each result.
+       */
+      std::vector<double> mWeights;
+
+      /**
+       * If the kernel is separable, the weights applied down each column
+       * and along each row.  Both are empty if the kernel is not separable.
+       */
+      std::vector<double> mColumnWeights;
+      std::vector<double> mRowWeights;
+
+      /**
+       * The size of the tiles transformed when the kernel is large enough that
+       * convolving in the frequency domain is faster.  Both are zero if the
+       * kernel is applied directly.
+       */
+      int mFftRows;
+      int mFftColumns;
+
+      /**
+       * The conjugate of the transform of the kernel, scaled for the inverse
+       * transform but not divided by the kernel size.  This has mFftRows * mFftColumns values.
+       */
+      std::vector<std::complex<double> > mKernelSpectrum;
    };
 
    ProgressTracker mProgress;
@@ -78,8 +111,27 @@ protected:
 
    private:
       template<typename T> void convolve(const T*);
+      template<typename T> void convolveRows(DataAccessor& accessor, DataAccessor& resultAccessor);
+      template<typename T> void convolveTiles(DataAccessor& accessor, DataAccessor& resultAccessor);
+      template<typename T> bool readRow(DataAccessor& accessor, int row, double* pPaddedRow);
+      bool writeRow(DataAccessor& resultAccessor, double* pResultRow, int row);
+      bool reportRow(int row);
+
       const ConvolutionFilterThreadInput& mInput;
       mta::AlgorithmThread::Range mRowRange;
+
+      // the area processed by the thread, in the coordinates of the input data set
+      int mStartRow;
+      int mStopRow;
+      int mStartColumn;
+      int mResultColumns;
+      int mFirstColumn;
+      int mMaxRowNum;
+      int mRowOffset;
+      int mPercentDone;
+      std::vector<int> mPaddedIndices;
+      std::vector<double> mInputRow;
+      std::vector<BitMaskIterator::Span> mSpans;
    };
 
    struct ConvolutionFilterThreadOutput
@@ -29,7 +29,6 @@
 #include "RasterUtilities.h"
 #include "Covariance.h"
 #include "CovarianceGui.h"
-#include "switchOnEncoding.h"
 #include "TypeConverter.h"
 
 #include <algorithm>
@@ -38,328 +37,6 @@
 using namespace std;
 
 const string CovarianceAlgorithm::mExpectedFileHeader = "Covariance Matrix File v1.1\n";
-static bool** CopySelectedPixels(const bool** pSelectedPixels, int xsize, int ysize);
-static void DeleteSelectedPixels(bool** pSelectedPixels);
-
-struct MaskInput
-{
-   double* pMatrix;
-   int numRows;
-   int numCols;
-   int numBands;
-   Progress* pProgress;
-   const bool* pAbortFlag;
-   const bool** pSelectedPixels;
-   int boundingBoxX1;
-   int boundingBoxY1;
-   int boundingBoxX2;
-   int boundingBoxY2;
-   const BitMask* mpMask;
-
-};
-
-template<class T>
-T* GetRowPtr(T* raw, int numCols, int numBands, int row, int col)
-{
-   return raw + numBands * (row *numCols + col);
-}
-
-template<class T>
-void ComputeFactoredCov(T* pData, RasterElement* pRaster, double* pMatrix,
-                        Progress* pProgress, const bool* pAbortFlag,
-                        int rowFactor, int columnFactor)
-{
-   if (pRaster == NULL)
-   {
-      return;
-   }
-   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(pRaster->getDataDescriptor());
-   if (pDescriptor == NULL)
-   {
-      return;
-   }
-
-   unsigned int numRows = pDescriptor->getRowCount();
-   unsigned int numCols = pDescriptor->getColumnCount();
-   unsigned int numBands = pDescriptor->getBandCount();
-   unsigned int row, col;
-   unsigned int band1, band2;
-   unsigned int lCount = 0;
-
-   T *pPixel = NULL;
-   vector<double> averages(numBands, 0);
-   double* pAverage = &averages.front();
-
-   if (rowFactor < 1)
-   {
-      rowFactor = 1;
-   }
-   if (columnFactor < 1)
-   {
-      columnFactor = 1;
-   }
-
-   memset(pMatrix, 0, sizeof(double) * numBands * numBands);
-
-   // calculate average spectrum
-   float progScale = 100.0f * static_cast<float>(rowFactor)/static_cast<float>(numRows);
-   FactoryResource<DataRequest> pRequest;
-   pRequest->setInterleaveFormat(BIP);
-
-   DataAccessor accessor = pRaster->getDataAccessor(pRequest.release());
-
-   T* pDataColumn(NULL);
-   for (row = 0; row < numRows; row += rowFactor)
-   {
-      if (pProgress != NULL)
-      {
-         if ((pAbortFlag == NULL) || !(*pAbortFlag))
-         {
-            pProgress->updateProgress ("Computing Average Signature...", int(progScale*row), NORMAL);
-         }
-         else
-         {
-            break;
-         }
-      }
-      for (col = 0; col < numCols; col += columnFactor)
-      {
-         accessor->toPixel(row, col);
-         VERIFYNRV(accessor.isValid());
-         ++lCount;
-         pPixel = reinterpret_cast<T*>(accessor->getColumn());
-
-         for (band1 = 0; band1 < numBands; ++band1)
-         {
-            pAverage[band1] += *pPixel;
-            ++pPixel;
-         }
-      }
-   }
-
-
-   // check if aborted
-   if ((pAbortFlag == NULL) || !(*pAbortFlag))
-   {
-      for (band1 = 0; band1 < numBands; ++band1)
-      {
-         pAverage[band1] /= lCount;
-      }
-
-      // compute the covariance
-      FactoryResource<DataRequest> pRequest2;
-      pRequest2->setInterleaveFormat(BIP);
-      accessor = pRaster->getDataAccessor(pRequest2.release());
-
-      for (row = 0; row < numRows; row += rowFactor)
-      {
-         if (pProgress != NULL)
-         {
-            if ((pAbortFlag == NULL) || !(*pAbortFlag))
-            {
-               pProgress->updateProgress("Computing Covariance Matrix...", int(progScale * row), NORMAL);
-            }
-            else
-            {
-               break;
-            }
-         }
-         for (col = 0; col < numCols; col += columnFactor)
-         {
-            accessor->toPixel(row, col);
-            VERIFYNRV(accessor.isValid());
-            double* pMatrixRow = pMatrix;
-            double* pMatrixColumn = NULL;
-            pPixel = reinterpret_cast<T*>(accessor->getColumn());
-
-            for (band2 = 0; band2 < numBands; ++band2, pMatrixRow += (numBands + 1))
-            {
-               pData = pPixel;
-               pMatrixColumn = pMatrixRow;
-               for (band1 = band2; band1 < numBands; ++band1)
-               {
-                  *pMatrixColumn += (*pData - pAverage[band1]) * (*pPixel - pAverage[band2]);
-                  ++pData;
-                  ++pMatrixColumn;
-               }
-               ++pPixel;
-            }
-         }
-      }
-   }
-
-   // check if aborted
-   if ((pAbortFlag == NULL) || !(*pAbortFlag))
-   {
-      for (band2 = 0; band2 < numBands; ++band2)
-      {
-         for (band1 = band2; band1 < numBands; ++band1)
-         {
-            pMatrix[band2 * numBands + band1] /= lCount;
-         }
-      }
-
-      for (band2 = 0; band2 < numBands; ++band2)
-      {
-         for (band1 = band2 + 1; band1 < numBands; ++band1)
-         {
-            pMatrix[band1 * numBands + band2] = pMatrix[band2 * numBands + band1];
-         }
-      }
-   }
-
-   if (pProgress != NULL)
-   {
-      if ((pAbortFlag == NULL) || !(*pAbortFlag))
-      {
-         pProgress->updateProgress("Covariance Matrix Complete", 100, NORMAL);
-      }
-      else
-      {
-         pProgress->updateProgress("Aborted computing Covariance Matrix", 0, ABORT);
-      }
-   }
-}
-
-template<class T>
-void ComputeMaskedCvm(T* pData, MaskInput* pInput, RasterElement* pRaster)
-{
-   if (pRaster == NULL)
-   {
-      return;
-   }
-
-   const RasterDataDescriptor* pDescriptor = dynamic_cast<RasterDataDescriptor*>(pRaster->getDataDescriptor());
-   if (pDescriptor == NULL)
-   {
-      return;
-   }
-   unsigned int numBands = pDescriptor->getBandCount();
-   int lCount = 0;
-   T* pPixel = NULL;
-
-   vector<double> averages(numBands, 0);
-   double* pAverage = &averages.front();
-   memset(pInput->pMatrix, 0, sizeof(double) * pInput->numBands * pInput->numBands);
-   FactoryResource<DataRequest> pRequest;
-   pRequest->setInterleaveFormat(BIP);
-   DataAccessor accessor = pRaster->getDataAccessor(pRequest.release());
-   BitMaskIterator it(pInput->mpMask, pRaster);
-   int numPixels = it.getCount();
-   LocationType loc;
-   float progScale = 100.0f / numPixels;
-   int progSave = 0;
-   while (it != it.end())
-   {
-      it.getPixelLocation(loc);
-      accessor->toPixel(loc.mY, loc.mX);
-      VERIFYNRV(accessor.isValid());
-      if (pInput->pProgress != NULL &&
-          progSave != static_cast<int>(progScale * lCount))
-      {
-         if ((pInput->pAbortFlag == NULL) || !(*pInput->pAbortFlag))
-         {
-            progSave = static_cast<int>(progScale * lCount);
-            pInput->pProgress->updateProgress("Computing Covariance Matrix...",
-               progSave, NORMAL);
-         }
-         else
-         {
-            break;
-         }
-      }
-      pPixel = reinterpret_cast<T*>(accessor->getColumn());
-      ++lCount;
-      ++it;
-      for (unsigned int band1 = 0; band1 < numBands; ++band1)
-      {
-         pAverage[band1] += *pPixel;
-         ++pPixel;
-      }
-   }
-
-   for (unsigned int band1 = 0; band1 < numBands; ++band1)
-   {
-      pAverage[band1] /= lCount;
-   }
-
-
-   // calculate covariance matrix
-   accessor = pRaster->getDataAccessor(pRequest->copy());
-   it.firstPixel();
-   lCount = 0;
-   progSave = 0;
-   while (it != it.end())
-   {
-      if (pInput->pProgress != NULL &&
-          progSave != static_cast<int>(progScale * lCount))
-      {
-         if ((pInput->pAbortFlag == NULL) || !(*pInput->pAbortFlag))
-         {
-            progSave = static_cast<int>(progScale * lCount);
-            pInput->pProgress->updateProgress("Computing Covariance Matrix...",
-               progSave, NORMAL);
-         }
-         else
-         {
-            break;
-         }
-      }
-      it.getPixelLocation(loc);
-      accessor->toPixel(loc.mY, loc.mX);
-
-      VERIFYNRV(accessor.isValid());
-      double* pMatrixRow = pInput->pMatrix;
-      double* pMatrixColumn = NULL;
-      pPixel = reinterpret_cast<T*>(accessor->getColumn());
-
-      for (unsigned int band2 = 0; band2 < numBands; ++band2, pMatrixRow += (numBands + 1))
-      {
-         pData = pPixel;
-         pMatrixColumn = pMatrixRow;
-         for (unsigned int band1 = band2; band1 < numBands; ++band1)
-         {
-            *pMatrixColumn += (*pData - pAverage[band1]) * (*pPixel - pAverage[band2]);
-            ++pData;
-            ++pMatrixColumn;
-         }
-         ++pPixel;
-      }
-      ++lCount;
-      ++it;
-   }
-
-   // check if aborted
-   if ((pInput->pAbortFlag == NULL) || !(*pInput->pAbortFlag))
-   {
-      for (unsigned int band2 = 0; band2 < numBands; ++band2)
-      {
-         for (unsigned int band1 = band2; band1 < numBands; ++band1)
-         {
-            pInput->pMatrix[band2 * numBands + band1] /= lCount;
-         }
-      }
-
-      for (unsigned int band2 = 0; band2 < numBands; ++band2)
-      {
-         for (unsigned int band1 = band2; band1 < numBands; ++band1)
-         {
-            pInput->pMatrix[band1 * numBands + band2] = pInput->pMatrix[band2 * numBands + band1];
-         }
-      }
-   }
-   if (pInput->pProgress != NULL)
-   {
-      if ((pInput->pAbortFlag == NULL) || !(*pInput->pAbortFlag))
-      {
-         pInput->pProgress->updateProgress("Covariance Matrix Complete", 99, NORMAL);
-      }
-      else
-      {
-         pInput->pProgress->updateProgress("Aborted computing Covariance Matrix", 0, ABORT);
-      }
-   }
-}
 
 REGISTER_PLUGIN_BASIC(OpticksCovariance, Covariance);
 
@@ -598,11 +275,7 @@ bool CovarianceAlgorithm::processAll()
 
    const RasterDataDescriptor* pDescriptor = NULL;
    const char* pCubeName = NULL;
-   void* pData = NULL;
-   unsigned int numRows(0);
-   unsigned int numColumns(0);
    unsigned int numBands(0);
-   EncodingType eType;
 
    RasterElement* pRasterElement = getRasterElement();
    if (pRasterElement == NULL)
@@ -624,8 +297,6 @@ bool CovarianceAlgorithm::processAll()
       return false;
    }
 
-   numRows = pDescriptor->getRowCount();
-   numColumns = pDescriptor->getColumnCount();
    numBands = pDescriptor->getBandCount();
 
    { // scope the accessor
@@ -672,65 +343,41 @@ bool CovarianceAlgorithm::processAll()
 
       if (loadedFromFile == false)                        // need to compute cvm
       {
-         eType = pDescriptor->getDataType();
-
          // check that entire data block of element is in memory
          VERIFY(pCvmElement->getRawData() != NULL);
-         if (mInput.mpAoi == NULL)
-         {
-            switchOnEncoding(eType, ComputeFactoredCov, pData, pRasterElement, 
-               static_cast<double*>(pCvmElement->getRawData()), getProgress(), 
-               &mAbortFlag, mInput.mRowFactor, mInput.mColumnFactor);
-         }
-         else
+         const BitMask* pMask = NULL;
+         if (mInput.mpAoi != NULL)
          {
-            const BitMask* pMask = mInput.mpAoi->getSelectedPoints();
+            pMask = mInput.mpAoi->getSelectedPoints();
             if (pMask == NULL)
             {
                reportProgress(ERRORS, 0, "Error getting mask from AOI");
                return false;
             }
-            else // pMask != NULL
+
+            BitMaskIterator it(pMask, pRasterElement);
+            if (it.getCount() == 0)
             {
-               BitMaskIterator it(pMask, pRasterElement);
-               if (it.getCount() == 0)
-               {
-                  reportProgress(ERRORS, 0, "Error getting selected pixels from AOI");
-                  return false;
-               }
-               else
-               {
-                  int x1 = 0;
-                  int y1 = 0;
-                  int x2 = 0;
-                  int y2 = 0;
-                  pMask->getBoundingBox(x1, y1, x2, y2);
-                  const bool** pSelectedPixels = const_cast<BitMask*>(pMask)->getRegion(x1, y1, x2, y2);
-                  MaskInput input;
-                  input.pMatrix = static_cast<double*>(pCvmElement->getRawData());
-                  input.numRows = numRows;
-                  input.numCols = numColumns;
-                  input.numBands = numBands;
-                  input.pProgress = getProgress();
-                  input.pAbortFlag = &mAbortFlag;
-                  input.pSelectedPixels = pSelectedPixels;
-                  input.mpMask = pMask;
-                  input.boundingBoxX1 = x1;
-                  input.boundingBoxX2 = x2;
-                  input.boundingBoxY1 = y1;
-                  input.boundingBoxY2 = y2;
-
-                  switchOnEncoding(eType, ComputeMaskedCvm, pData, &input, pRasterElement);
-               }
+               reportProgress(ERRORS, 0, "Error getting selected pixels from AOI");
+               return false;
             }
          }
 
+         bool success = MatrixFunctions::computeCovarianceMatrix(static_cast<double*>(pCvmElement->getRawData()),
+            pRasterElement, pMask, mInput.mRowFactor, mInput.mColumnFactor, getProgress(), &mAbortFlag);
          if (mAbortFlag)
          {
             reportProgress(ABORT, 0, "Aborted creation of Covariance Matrix");
             return false;
          }
 
+         if (success == false)
+         {
+            reportProgress(ERRORS, 0, "Error computing Covariance Matrix.");
+            return false;
+         }
+
+         reportProgress(NORMAL, 100, "Covariance Matrix Complete");
          writeMatrixToDisk(mCvmFile, pCvmElement.get());
       }
    }
@@ -16,8 +16,6 @@
 #include "AppVerify.h"
 #include "AppVersion.h"
 #include "Classification.h"
-#include "DataAccessorImpl.h"
-#include "DataRequest.h"
 #include "DimensionDescriptor.h"
 #include "Endian.h"
 #include "EnviExporter.h"
@@ -32,6 +30,8 @@
 #include "RasterElement.h"
 #include "RasterDataDescriptor.h"
 #include "RasterFileDescriptor.h"
+#include "RasterFileWriter.h"
+#include "RasterSubsetReader.h"
 #include "RasterUtilities.h"
 #include "SpecialMetadata.h"
 #include "TypesFile.h"
@@ -1077,13 +1077,9 @@ bool EnviExporter::exportDataFile() const
       return false;
    }
 
-   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
-   VERIFY(pDescriptor != NULL);
-
    const vector<DimensionDescriptor>& exportRows = mpFileDescriptor->getRows();
    const vector<DimensionDescriptor>& exportColumns = mpFileDescriptor->getColumns();
    const vector<DimensionDescriptor>& exportBands = mpFileDescriptor->getBands();
-   unsigned int bytesPerElement = pDescriptor->getBytesPerElement();
 
    string progressText = "Exporting the data file...";
    if (mpProgress != NULL)
@@ -1091,631 +1087,75 @@ bool EnviExporter::exportDataFile() const
       mpProgress->updateProgress(progressText, 0, NORMAL);
    }
 
-   int rowIndex = 0;
    InterleaveFormatType interleave = mpFileDescriptor->getInterleaveFormat();
-   if (interleave == BIP)
+   if (interleave != BIP && interleave != BSQ && interleave != BIL)
    {
-      if (exportBands.size() == pDescriptor->getBandCount())   // All bands
+      string message = "The interleave format of the data set is not supported.";
+      if (mpProgress != NULL)
       {
-         if (exportColumns.size() ==
-            exportColumns.back().getActiveNumber() - exportColumns.front().getActiveNumber() + 1)
-         {
-            // Export a full contiguous row at a time
-            FactoryResource<DataRequest> pDataRequest;
-            pDataRequest->setInterleaveFormat(BIP);
-            pDataRequest->setRows(exportRows.front(), exportRows.back(), 1);
-            pDataRequest->setColumns(exportColumns.front(), exportColumns.back(), exportColumns.size());
-
-            DataAccessor dataAccessor = mpRaster->getDataAccessor(pDataRequest.release());
-            if (dataAccessor.isValid() == false)
-            {
-               string message = "The data in the data set could not be accessed.";
-               if (mpProgress != NULL)
-               {
-                  mpProgress->updateProgress(message, 0, ERRORS);
-               }
-
-               pStep->finalize(Message::Failure, message);
-               dataFile.close();
-               remove(headerFilename.c_str());
-               remove(dataFilename.c_str());
-               return false;
-            }
-
-            vector<DimensionDescriptor>::const_iterator iter;
-            for (iter = exportRows.begin(); iter != exportRows.end(); ++iter)
-            {
-               if (isAborted() == true)
-               {
-                  string message = "ENVI export aborted!";
-                  if (mpProgress != NULL)
-                  {
-                     mpProgress->updateProgress(message, 0, ABORT);
-                  }
-
-                  pStep->finalize(Message::Abort);
-                  dataFile.close();
-                  remove(headerFilename.c_str());
-                  remove(dataFilename.c_str());
-                  return false;
-               }
-
-               DimensionDescriptor row = *iter;
-               dataAccessor->toPixel(row.getActiveNumber(), exportColumns.front().getActiveNumber());
-               if (dataAccessor.isValid() == false)
-               {
-                  string message = "An error occurred when reading the data from the data set.";
-                  if (mpProgress != NULL)
-                  {
-                     mpProgress->updateProgress(message, 0, ERRORS);
-                  }
-
-                  pStep->finalize(Message::Failure, message);
-                  dataFile.close();
-                  remove(headerFilename.c_str());
-                  remove(dataFilename.c_str());
-                  return false;
-               }
-
-               void* pData = dataAccessor->getRow();
-               dataFile.write(pData, bytesPerElement * exportBands.size() * exportColumns.size());
-
-               if (mpProgress != NULL)
-               {
-                  mpProgress->updateProgress(progressText, (rowIndex++ * 100) / exportRows.size(), NORMAL);
-               }
-            }
-         }
-         else
-         {
-            // Export one full pixel at a time
-            FactoryResource<DataRequest> pDataRequest;
-            pDataRequest->setInterleaveFormat(BIP);
-            pDataRequest->setRows(exportRows.front(), exportRows.back(), 1);
-            pDataRequest->setColumns(exportColumns.front(), exportColumns.back(), 1);
-
-            DataAccessor dataAccessor = mpRaster->getDataAccessor(pDataRequest.release());
-            if (dataAccessor.isValid() == false)
-            {
-               string message = "The data in the data set could not be accessed.";
-               if (mpProgress != NULL)
-               {
-                  mpProgress->updateProgress(message, 0, ERRORS);
-               }
-
-               pStep->finalize(Message::Failure, message);
-               dataFile.close();
-               remove(headerFilename.c_str());
-               remove(dataFilename.c_str());
-               return false;
-            }
-
-            vector<DimensionDescriptor>::const_iterator rowIter;
-            for (rowIter = exportRows.begin(); rowIter != exportRows.end(); ++rowIter)
-            {
-               if (isAborted() == true)
-               {
-                  string message = "ENVI export aborted!";
-                  if (mpProgress != NULL)
-                  {
-                     mpProgress->updateProgress(message, 0, ABORT);
-                  }
-
-                  pStep->finalize(Message::Abort);
-                  dataFile.close();
-                  remove(headerFilename.c_str());
-                  remove(dataFilename.c_str());
-                  return false;
-               }
-
-               vector<DimensionDescriptor>::const_iterator colIter;
-               for (colIter = exportColumns.begin(); colIter != exportColumns.end(); ++colIter)
-               {
-                  DimensionDescriptor row = *rowIter;
-                  DimensionDescriptor column = *colIter;
-                  dataAccessor->toPixel(row.getActiveNumber(), column.getActiveNumber());
-                  if (dataAccessor.isValid() == false)
-                  {
-                     string message = "An error occurred when reading the data from the data set.";
-                     if (mpProgress != NULL)
-                     {
-                        mpProgress->updateProgress(message, 0, ERRORS);
-                     }
-
-                     pStep->finalize(Message::Failure, message);
-                     dataFile.close();
-                     remove(headerFilename.c_str());
-                     remove(dataFilename.c_str());
-                     return false;
-                  }
-
-                  void* pData = dataAccessor->getColumn();
-                  dataFile.write(pData, bytesPerElement * exportBands.size());
-               }
-
-               if (mpProgress != NULL)
-               {
-                  mpProgress->updateProgress(progressText, (rowIndex++ * 100) / exportRows.size(), NORMAL);
-               }
-            }
-         }
+         mpProgress->updateProgress(message, 0, ERRORS);
       }
-      else
-      {
-         // Slowest possible copy, one pixel at a time
-         FactoryResource<DataRequest> pDataRequest;
-         pDataRequest->setInterleaveFormat(BIP);
-         pDataRequest->setRows(exportRows.front(), exportRows.back(), 1);
-         pDataRequest->setColumns(exportColumns.front(), exportColumns.back(), 1);
-
-         DataAccessor dataAccessor = mpRaster->getDataAccessor(pDataRequest.release());
-         if (dataAccessor.isValid() == false)
-         {
-            string message = "The data in the data set could not be accessed.";
-            if (mpProgress != NULL)
-            {
-               mpProgress->updateProgress(message, 0, ERRORS);
-            }
-
-            pStep->finalize(Message::Failure, message);
-            dataFile.close();
-            remove(headerFilename.c_str());
-            remove(dataFilename.c_str());
-            return false;
-         }
-
-         vector<DimensionDescriptor>::const_iterator rowIter;
-         for (rowIter = exportRows.begin(); rowIter != exportRows.end(); ++rowIter)
-         {
-            if (isAborted() == true)
-            {
-               string message = "ENVI export aborted!";
-               if (mpProgress != NULL)
-               {
-                  mpProgress->updateProgress(message, 0, ABORT);
-               }
-
-               pStep->finalize(Message::Abort);
-               dataFile.close();
-               remove(headerFilename.c_str());
-               remove(dataFilename.c_str());
-               return false;
-            }
-
-            vector<DimensionDescriptor>::const_iterator colIter;
-            for (colIter = exportColumns.begin(); colIter != exportColumns.end(); ++colIter)
-            {
-               DimensionDescriptor row = *rowIter;
-               DimensionDescriptor column = *colIter;
-               dataAccessor->toPixel(row.getActiveNumber(), column.getActiveNumber());
-               if (dataAccessor.isValid() == false)
-               {
-                  string message = "An error occurred when reading the data from the data set.";
-                  if (mpProgress != NULL)
-                  {
-                     mpProgress->updateProgress(message, 0, ERRORS);
-                  }
 
-                  pStep->finalize(Message::Failure, message);
-                  dataFile.close();
-                  remove(headerFilename.c_str());
-                  remove(dataFilename.c_str());
-                  return false;
-               }
-
-               char* pData = reinterpret_cast<char*>(dataAccessor->getColumn());
+      pStep->finalize(Message::Failure, message);
+      dataFile.close();
+      remove(headerFilename.c_str());
+      remove(dataFilename.c_str());
+      return false;
+   }
 
-               vector<DimensionDescriptor>::const_iterator bandIter;
-               for (bandIter = exportBands.begin(); bandIter != exportBands.end(); ++bandIter)
-               {
-                  DimensionDescriptor band = *bandIter;
-                  dataFile.write(pData + bytesPerElement * (band.getActiveNumber()), bytesPerElement);
-               }
-            }
+   // Gather blocks of rows in the export interleave and write each block with as few writes as possible
+   RasterSubsetReader reader(mpRaster, exportRows, exportColumns, exportBands, interleave);
+   RasterFileWriter writer(reader, dataFile);
 
-            if (mpProgress != NULL)
-            {
-               mpProgress->updateProgress(progressText, (rowIndex++ * 100) / exportRows.size(), NORMAL);
-            }
-         }
-      }
-   }
-   else if (interleave == BSQ)
+   unsigned int blockCount = writer.getBlockCount();
+   for (unsigned int block = 0; block < blockCount; ++block)
    {
-      if (exportColumns.size() == exportColumns.back().getActiveNumber() - exportColumns.front().getActiveNumber() + 1)
+      if (isAborted() == true)
       {
-         vector<DimensionDescriptor>::const_iterator bandIter;
-         for (bandIter = exportBands.begin(); bandIter != exportBands.end(); ++bandIter)
+         string message = "ENVI export aborted!";
+         if (mpProgress != NULL)
          {
-            DimensionDescriptor band = *bandIter;
-
-            // Export a full contiguous row at a time
-            FactoryResource<DataRequest> pDataRequest;
-            pDataRequest->setInterleaveFormat(BSQ);
-            pDataRequest->setRows(exportRows.front(), exportRows.back(), 1);
-            pDataRequest->setColumns(exportColumns.front(), exportColumns.back(), exportColumns.size());
-            pDataRequest->setBands(band, band, 1);
-
-            DataAccessor dataAccessor = mpRaster->getDataAccessor(pDataRequest.release());
-            if (dataAccessor.isValid() == false)
-            {
-               string message = "The data in the data set could not be accessed.";
-               if (mpProgress != NULL)
-               {
-                  mpProgress->updateProgress(message, 0, ERRORS);
-               }
-
-               pStep->finalize(Message::Failure, message);
-               dataFile.close();
-               remove(headerFilename.c_str());
-               remove(dataFilename.c_str());
-               return false;
-            }
-
-            vector<DimensionDescriptor>::const_iterator rowIter;
-            for (rowIter = exportRows.begin(); rowIter != exportRows.end(); ++rowIter)
-            {
-               if (isAborted() == true)
-               {
-                  string message = "ENVI export aborted!";
-                  if (mpProgress != NULL)
-                  {
-                     mpProgress->updateProgress(message, 0, ABORT);
-                  }
-
-                  pStep->finalize(Message::Abort);
-                  dataFile.close();
-                  remove(headerFilename.c_str());
-                  remove(dataFilename.c_str());
-                  return false;
-               }
-
-               if (dataAccessor.isValid() == false)
-               {
-                  string message = "An error occurred when reading the data from the data set.";
-                  if (mpProgress != NULL)
-                  {
-                     mpProgress->updateProgress(message, 0, ERRORS);
-                  }
-
-                  pStep->finalize(Message::Failure, message);
-                  dataFile.close();
-                  remove(headerFilename.c_str());
-                  remove(dataFilename.c_str());
-                  return false;
-               }
-
-               void* pData = dataAccessor->getRow();
-               dataFile.write(pData, exportColumns.size() * bytesPerElement);
-
-               dataAccessor->nextRow();
-
-               if (mpProgress != NULL)
-               {
-                  mpProgress->updateProgress(progressText,
-                     (rowIndex++ * 100) / (exportRows.size() * exportBands.size()), NORMAL);
-               }
-            }
+            mpProgress->updateProgress(message, 0, ABORT);
          }
-      }
-      else
-      {
-         vector<DimensionDescriptor>::const_iterator bandIter;
-         for (bandIter = exportBands.begin(); bandIter != exportBands.end(); ++bandIter)
-         {
-            DimensionDescriptor band = *bandIter;
-
-            // Slowest possible copy, one pixel at a time
-            FactoryResource<DataRequest> pDataRequest;
-            pDataRequest->setInterleaveFormat(BSQ);
-            pDataRequest->setRows(exportRows.front(), exportRows.back(), 1);
-            pDataRequest->setColumns(exportColumns.front(), exportColumns.back(), 1);
-            pDataRequest->setBands(band, band, 1);
-
-            DataAccessor dataAccessor = mpRaster->getDataAccessor(pDataRequest.release());
-            if (dataAccessor.isValid() == false)
-            {
-               string message = "The data in the data set could not be accessed.";
-               if (mpProgress != NULL)
-               {
-                  mpProgress->updateProgress(message, 0, ERRORS);
-               }
-
-               pStep->finalize(Message::Failure, message);
-               dataFile.close();
-               remove(headerFilename.c_str());
-               remove(dataFilename.c_str());
-               return false;
-            }
-
-            vector<DimensionDescriptor>::const_iterator rowIter;
-            for (rowIter = exportRows.begin(); rowIter != exportRows.end(); ++rowIter)
-            {
-               if (isAborted() == true)
-               {
-                  string message = "ENVI export aborted!";
-                  if (mpProgress != NULL)
-                  {
-                     mpProgress->updateProgress(message, 0, ABORT);
-                  }
-
-                  pStep->finalize(Message::Abort);
-                  dataFile.close();
-                  remove(headerFilename.c_str());
-                  remove(dataFilename.c_str());
-                  return false;
-               }
 
-               DimensionDescriptor row = *rowIter;
-
-               vector<DimensionDescriptor>::const_iterator columnIter;
-               for (columnIter = exportColumns.begin(); columnIter != exportColumns.end(); ++columnIter)
-               {
-                  DimensionDescriptor column = *columnIter;
-
-                  dataAccessor->toPixel(row.getActiveNumber(), column.getActiveNumber());
-                  if (dataAccessor.isValid() == false)
-                  {
-                     string message = "An error occurred when reading the data from the data set.";
-                     if (mpProgress != NULL)
-                     {
-                        mpProgress->updateProgress(message, 0, ERRORS);
-                     }
-
-                     pStep->finalize(Message::Failure, message);
-                     dataFile.close();
-                     remove(headerFilename.c_str());
-                     remove(dataFilename.c_str());
-                     return false;
-                  }
-
-                  void* pData = dataAccessor->getColumn();
-                  dataFile.write(pData, bytesPerElement);
-               }
-
-               if (mpProgress != NULL)
-               {
-                  mpProgress->updateProgress(progressText,
-                     (rowIndex++ * 100) / (exportRows.size() * exportBands.size()), NORMAL);
-               }
-            }
-         }
+         pStep->finalize(Message::Abort);
+         writer.cancel();
+         dataFile.close();
+         remove(headerFilename.c_str());
+         remove(dataFilename.c_str());
+         return false;
       }
-   }
-   else if (interleave == BIL)
-   {
-      if (exportColumns.size() == pDescriptor->getColumnCount() &&
-         (exportBands.size() == exportBands.back().getActiveNumber() - exportBands.front().getActiveNumber() + 1))
+
+      if (writer.writeBlock(block) == false)
       {
-         // Export a full contiguous row at a time
-         FactoryResource<DataRequest> pDataRequest;
-         pDataRequest->setInterleaveFormat(BIL);
-         pDataRequest->setRows(exportRows.front(), exportRows.back(), 1);
-         pDataRequest->setColumns(exportColumns.front(), exportColumns.back(), exportColumns.size());
-         pDataRequest->setBands(exportBands.front(), exportBands.back(), exportBands.size());
-
-         DataAccessor dataAccessor = mpRaster->getDataAccessor(pDataRequest.release());
-         if (dataAccessor.isValid() == false)
+         string message = "An error occurred when reading the data from the data set.";
+         if (writer.hasWriteError() == true)
          {
-            string message = "The data in the data set could not be accessed.";
-            if (mpProgress != NULL)
-            {
-               mpProgress->updateProgress(message, 0, ERRORS);
-            }
-
-            pStep->finalize(Message::Failure, message);
-            dataFile.close();
-            remove(headerFilename.c_str());
-            remove(dataFilename.c_str());
-            return false;
+            message = "An error occurred when writing the data file.";
          }
 
-         for (vector<DimensionDescriptor>::const_iterator iter = exportRows.begin(); iter != exportRows.end(); ++iter)
+         if (mpProgress != NULL)
          {
-            if (isAborted() == true)
-            {
-               string message = "ENVI export aborted!";
-               if (mpProgress != NULL)
-               {
-                  mpProgress->updateProgress(message, 0, ABORT);
-               }
-
-               pStep->finalize(Message::Abort);
-               dataFile.close();
-               remove(headerFilename.c_str());
-               remove(dataFilename.c_str());
-               return false;
-            }
-
-            DimensionDescriptor row = *iter;
-            dataAccessor->toPixel(row.getActiveNumber(), exportColumns.front().getActiveNumber());
-            if (dataAccessor.isValid() == false)
-            {
-               string message = "An error occurred when reading the data from the data set.";
-               if (mpProgress != NULL)
-               {
-                  mpProgress->updateProgress(message, 0, ERRORS);
-               }
-
-               pStep->finalize(Message::Failure, message);
-               dataFile.close();
-               remove(headerFilename.c_str());
-               remove(dataFilename.c_str());
-               return false;
-            }
-
-            void* pData = dataAccessor->getRow();
-            dataFile.write(pData, bytesPerElement * exportBands.size() * exportColumns.size());
-
-            if (mpProgress != NULL)
-            {
-               mpProgress->updateProgress(progressText, (rowIndex++ * 100) / exportRows.size(), NORMAL);
-            }
+            mpProgress->updateProgress(message, 0, ERRORS);
          }
-      }
-      else if (exportColumns.size() ==
-         exportColumns.back().getActiveNumber() - exportColumns.front().getActiveNumber() + 1)
-      {
-         // Export a row from a single band at a time
-         vector<DimensionDescriptor>::const_iterator rowIter;
-         for (rowIter = exportRows.begin(); rowIter != exportRows.end(); ++rowIter)
-         {
-            if (isAborted() == true)
-            {
-               string message = "ENVI export aborted!";
-               if (mpProgress != NULL)
-               {
-                  mpProgress->updateProgress(message, 0, ABORT);
-               }
-
-               pStep->finalize(Message::Abort);
-               dataFile.close();
-               remove(headerFilename.c_str());
-               remove(dataFilename.c_str());
-               return false;
-            }
-
-            DimensionDescriptor row = *rowIter;
-
-            vector<DimensionDescriptor>::const_iterator bandIter;
-            for (bandIter = exportBands.begin(); bandIter != exportBands.end(); ++bandIter)
-            {
-               DimensionDescriptor band = *bandIter;
-
-               FactoryResource<DataRequest> pDataRequest;
-               pDataRequest->setInterleaveFormat(BIL);
-               pDataRequest->setRows(row, row, 1);
-               pDataRequest->setColumns(exportColumns.front(), exportColumns.back(), exportColumns.size());
-               pDataRequest->setBands(band, band, 1);
-
-               DataAccessor dataAccessor = mpRaster->getDataAccessor(pDataRequest.release());
-               if (dataAccessor.isValid() == false)
-               {
-                  string message = "The data in the data set could not be accessed.";
-                  if (mpProgress != NULL)
-                  {
-                     mpProgress->updateProgress(message, 0, ERRORS);
-                  }
-
-                  pStep->finalize(Message::Failure, message);
-                  dataFile.close();
-                  remove(headerFilename.c_str());
-                  remove(dataFilename.c_str());
-                  return false;
-               }
 
-               dataAccessor->toPixel(row.getActiveNumber(), exportColumns.front().getActiveNumber());
-               if (dataAccessor.isValid() == false)
-               {
-                  string message = "An error occurred when reading the data from the data set.";
-                  if (mpProgress != NULL)
-                  {
-                     mpProgress->updateProgress(message, 0, ERRORS);
-                  }
-
-                  pStep->finalize(Message::Failure, message);
-                  dataFile.close();
-                  remove(headerFilename.c_str());
-                  remove(dataFilename.c_str());
-                  return false;
-               }
-
-               void* pData = dataAccessor->getColumn();
-               dataFile.write(pData, exportColumns.size() * bytesPerElement);
-            }
-
-            if (mpProgress != NULL)
-            {
-               mpProgress->updateProgress(progressText, (rowIndex++ * 100) / exportRows.size(), NORMAL);
-            }
-         }
+         pStep->finalize(Message::Failure, message);
+         writer.cancel();
+         dataFile.close();
+         remove(headerFilename.c_str());
+         remove(dataFilename.c_str());
+         return false;
       }
-      else
-      {
-         // Slowest possible copy, one pixel at a time
-         vector<DimensionDescriptor>::const_iterator rowIter;
-         for (rowIter = exportRows.begin(); rowIter != exportRows.end(); ++rowIter)
-         {
-            if (isAborted() == true)
-            {
-               string message = "ENVI export aborted!";
-               if (mpProgress != NULL)
-               {
-                  mpProgress->updateProgress(message, 0, ABORT);
-               }
 
-               pStep->finalize(Message::Abort);
-               dataFile.close();
-               remove(headerFilename.c_str());
-               remove(dataFilename.c_str());
-               return false;
-            }
-
-            DimensionDescriptor row = *rowIter;
-
-            vector<DimensionDescriptor>::const_iterator bandIter;
-            for (bandIter = exportBands.begin(); bandIter != exportBands.end(); ++bandIter)
-            {
-               DimensionDescriptor band = *bandIter;
-
-               FactoryResource<DataRequest> pDataRequest;
-               pDataRequest->setInterleaveFormat(BIL);
-               pDataRequest->setRows(row, row, 1);
-               pDataRequest->setColumns(exportColumns.front(), exportColumns.back(), 1);
-               pDataRequest->setBands(band, band, 1);
-
-               DataAccessor dataAccessor = mpRaster->getDataAccessor(pDataRequest.release());
-               if (dataAccessor.isValid() == false)
-               {
-                  string message = "The data in the data set could not be accessed.";
-                  if (mpProgress != NULL)
-                  {
-                     mpProgress->updateProgress(message, 0, ERRORS);
-                  }
-
-                  pStep->finalize(Message::Failure, message);
-                  dataFile.close();
-                  remove(headerFilename.c_str());
-                  remove(dataFilename.c_str());
-                  return false;
-               }
-
-               vector<DimensionDescriptor>::const_iterator columnIter;
-               for (columnIter = exportColumns.begin(); columnIter != exportColumns.end(); ++columnIter)
-               {
-                  DimensionDescriptor column = *columnIter;
-
-                  dataAccessor->toPixel(row.getActiveNumber(), column.getActiveNumber());
-                  if (dataAccessor.isValid() == false)
-                  {
-                     string message = "An error occurred when reading the data from the data set.";
-                     if (mpProgress != NULL)
-                     {
-                        mpProgress->updateProgress(message, 0, ERRORS);
-                     }
-
-                     pStep->finalize(Message::Failure, message);
-                     dataFile.close();
-                     remove(headerFilename.c_str());
-                     remove(dataFilename.c_str());
-                     return false;
-                  }
-
-                  void* pData = dataAccessor->getColumn();
-                  dataFile.write(pData, bytesPerElement);
-               }
-            }
-
-            if (mpProgress != NULL)
-            {
-               mpProgress->updateProgress(progressText, (rowIndex++ * 100) / exportRows.size(), NORMAL);
-            }
-         }
+      if (mpProgress != NULL)
+      {
+         mpProgress->updateProgress(progressText, (block * 100) / blockCount, NORMAL);
       }
    }
-   else
+
+   if (writer.finish() == false)
    {
-      string message = "The interleave format of the data set is not supported.";
+      string message = "An error occurred when writing the data file.";
       if (mpProgress != NULL)
       {
          mpProgress->updateProgress(message, 0, ERRORS);
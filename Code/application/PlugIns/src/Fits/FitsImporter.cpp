@@ -813,6 +813,12 @@ FitsRasterPager::FitsRasterPager()
 
 FitsRasterPager::~FitsRasterPager()
 {
+   stopReadAhead();
+}
+
+unsigned int FitsRasterPager::getReadAheadDepth() const
+{
+   return CachedPager::getSettingReadAheadDepth();
 }
 
 bool FitsRasterPager::openFile(const std::string& filename)
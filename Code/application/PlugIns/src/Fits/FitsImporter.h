@@ -69,6 +69,9 @@ public:
    FitsRasterPager();
    virtual ~FitsRasterPager();
 
+protected:
+   virtual unsigned int getReadAheadDepth() const;
+
 private:
    virtual bool openFile(const std::string& filename);
    virtual CachedPage::UnitPtr fetchUnit(DataRequest* pOriginalRequest);
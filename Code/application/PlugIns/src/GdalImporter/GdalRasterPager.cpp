@@ -94,6 +94,7 @@ GdalRasterPager::GdalRasterPager() : mpDataset(NULL)
 
 GdalRasterPager::~GdalRasterPager()
 {
+   stopReadAhead();
 }
 
 bool GdalRasterPager::getInputSpecification(PlugInArgList*& pArgList)
@@ -120,6 +121,11 @@ bool GdalRasterPager::parseInputArgs(PlugInArgList *pInputArgList)
    return true;
 }
 
+unsigned int GdalRasterPager::getReadAheadDepth() const
+{
+   return CachedPager::getSettingReadAheadDepth();
+}
+
 bool GdalRasterPager::openFile(const std::string& filename)
 {
    if (mDatasetName.empty())
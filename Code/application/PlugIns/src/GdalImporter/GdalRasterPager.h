@@ -21,6 +21,9 @@ public:
    virtual bool getInputSpecification(PlugInArgList*& pArgList);
    virtual bool parseInputArgs(PlugInArgList* pInputArgList);
 
+protected:
+   virtual unsigned int getReadAheadDepth() const;
+
 private:
    virtual bool openFile(const std::string& filename);
    virtual CachedPage::UnitPtr fetchUnit(DataRequest* pOriginalRequest);
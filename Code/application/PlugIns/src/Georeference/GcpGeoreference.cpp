@@ -18,6 +18,7 @@
 #include "MatrixFunctions.h"
 #include "MessageLogResource.h"
 #include "ModelServices.h"
+#include "MultiThreadedAlgorithm.h"
 #include "PlugInArg.h"
 #include "PlugInArgList.h"
 #include "PlugInManagerServices.h"
@@ -31,6 +32,7 @@
 #include "xmlreader.h"
 #include "xmlwriter.h"
 
+#include <algorithm>
 #include <list>
 #include <sstream>
 
@@ -43,6 +45,186 @@ static double sAnchorFractions[] = {-0.25, 0.25, 0.75, 1.25};
 static int sNumAnchorFractions = sizeof(sAnchorFractions) / sizeof(sAnchorFractions[0]);
 static int sNumAnchors = sNumAnchorFractions * sNumAnchorFractions;
 
+namespace
+{
+   // Points are evaluated in groups of independent lanes so that the compiler can vectorize the
+   // polynomial evaluation, and converted in blocks of points so that large arrays are split across threads
+   const unsigned int POLYNOMIAL_LANES = 8;
+   const unsigned int POLYNOMIAL_BLOCK_POINTS = 4096;
+
+   /**
+    * Evaluates a pair of polynomials for up to POLYNOMIAL_LANES points.  The coefficients are ordered
+    * by increasing power of y and then increasing power of x, so each power of y is a polynomial in x
+    * and the whole polynomial is evaluated with nested Horner schemes.
+    */
+   void evaluatePolynomialLanes(const LocationType* pPositions, LocationType* pTransformed, unsigned int numPoints,
+      const double* pXCoeffs, const double* pYCoeffs, int order)
+   {
+      double xValues[POLYNOMIAL_LANES];
+      double yValues[POLYNOMIAL_LANES];
+      double xResults[POLYNOMIAL_LANES];
+      double yResults[POLYNOMIAL_LANES];
+      double xTerms[POLYNOMIAL_LANES];
+      double yTerms[POLYNOMIAL_LANES];
+
+      // read every point before writing any result so the conversion can be done in place
+      for (unsigned int lane = 0; lane < POLYNOMIAL_LANES; ++lane)
+      {
+         xValues[lane] = (lane < numPoints ? pPositions[lane].mX : 0.0);
+         yValues[lane] = (lane < numPoints ? pPositions[lane].mY : 0.0);
+         xResults[lane] = 0.0;
+         yResults[lane] = 0.0;
+      }
+
+      for (int yPower = order; yPower >= 0; --yPower)
+      {
+         int xOrder = order - yPower;
+         int offset = yPower * (order + 1) - yPower * (yPower - 1) / 2;
+         const double* pXRow = pXCoeffs + offset;
+         const double* pYRow = pYCoeffs + offset;
+
+         for (unsigned int lane = 0; lane < POLYNOMIAL_LANES; ++lane)
+         {
+            xTerms[lane] = pXRow[xOrder];
+            yTerms[lane] = pYRow[xOrder];
+         }
+         for (int xPower = xOrder - 1; xPower >= 0; --xPower)
+         {
+            const double xCoeff = pXRow[xPower];
+            const double yCoeff = pYRow[xPower];
+            for (unsigned int lane = 0; lane < POLYNOMIAL_LANES; ++lane)
+            {
+               xTerms[lane] = xTerms[lane] * xValues[lane] + xCoeff;
+               yTerms[lane] = yTerms[lane] * xValues[lane] + yCoeff;
+            }
+         }
+         for (unsigned int lane = 0; lane < POLYNOMIAL_LANES; ++lane)
+         {
+            xResults[lane] = xResults[lane] * yValues[lane] + xTerms[lane];
+            yResults[lane] = yResults[lane] * yValues[lane] + yTerms[lane];
+         }
+      }
+
+      for (unsigned int lane = 0; lane < numPoints; ++lane)
+      {
+         pTransformed[lane].mX = xResults[lane];
+         pTransformed[lane].mY = yResults[lane];
+      }
+   }
+
+   bool isInsideScene(const LocationType& pixel, double numRows, double numColumns)
+   {
+      return pixel.mX >= 0.0 && pixel.mX <= numColumns && pixel.mY >= 0.0 && pixel.mY <= numRows;
+   }
+
+   /**
+    * Evaluates the polynomial for count points.  If pAccurate is not NULL, it is set to \c false if any of
+    * the pixels is outside the scene; the pixels are the input positions when checkInput is \c true
+    * and the transformed positions otherwise.
+    */
+   void evaluatePolynomialRange(const LocationType* pPositions, LocationType* pTransformed, size_t count,
+      const double* pXCoeffs, const double* pYCoeffs, int order, bool checkInput, double numRows,
+      double numColumns, bool* pAccurate)
+   {
+      bool accurate = true;
+      for (size_t i = 0; i < count; i += POLYNOMIAL_LANES)
+      {
+         unsigned int numPoints = static_cast<unsigned int>(min<size_t>(POLYNOMIAL_LANES, count - i));
+         if (pAccurate != NULL && checkInput)
+         {
+            for (unsigned int lane = 0; lane < numPoints; ++lane)
+            {
+               accurate = accurate && isInsideScene(pPositions[i + lane], numRows, numColumns);
+            }
+         }
+
+         evaluatePolynomialLanes(pPositions + i, pTransformed + i, numPoints, pXCoeffs, pYCoeffs, order);
+
+         if (pAccurate != NULL && !checkInput)
+         {
+            for (unsigned int lane = 0; lane < numPoints; ++lane)
+            {
+               accurate = accurate && isInsideScene(pTransformed[i + lane], numRows, numColumns);
+            }
+         }
+      }
+
+      if (pAccurate != NULL)
+      {
+         *pAccurate = accurate;
+      }
+   }
+
+   struct PolynomialInput
+   {
+      const LocationType* mpPositions;
+      LocationType* mpTransformed;
+      size_t mCount;
+      const double* mpXCoeffs;
+      const double* mpYCoeffs;
+      int mOrder;
+      bool mCheckAccuracy;
+      bool mCheckInput;
+      double mNumRows;
+      double mNumColumns;
+   };
+
+   class PolynomialThread : public mta::AlgorithmThread
+   {
+   public:
+      PolynomialThread(const PolynomialInput& input, int threadCount, int threadIndex,
+         mta::ThreadReporter& reporter) :
+         mta::AlgorithmThread(threadIndex, reporter),
+         mInput(input),
+         mBlockRange(getThreadRange(threadCount,
+            static_cast<int>((input.mCount + POLYNOMIAL_BLOCK_POINTS - 1) / POLYNOMIAL_BLOCK_POINTS))),
+         mAccurate(true)
+      {
+      }
+
+      void run()
+      {
+         if (mBlockRange.mFirst <= mBlockRange.mLast)
+         {
+            size_t first = static_cast<size_t>(mBlockRange.mFirst) * POLYNOMIAL_BLOCK_POINTS;
+            size_t last = min(mInput.mCount, static_cast<size_t>(mBlockRange.mLast + 1) * POLYNOMIAL_BLOCK_POINTS);
+            evaluatePolynomialRange(mInput.mpPositions + first, mInput.mpTransformed + first, last - first,
+               mInput.mpXCoeffs, mInput.mpYCoeffs, mInput.mOrder, mInput.mCheckInput, mInput.mNumRows,
+               mInput.mNumColumns, mInput.mCheckAccuracy ? &mAccurate : NULL);
+         }
+      }
+
+      bool isAccurate() const
+      {
+         return mAccurate;
+      }
+
+   private:
+      const PolynomialInput& mInput;
+      Range mBlockRange;
+      bool mAccurate;
+   };
+
+   struct PolynomialOutput
+   {
+      PolynomialOutput() :
+         mAccurate(true)
+      {
+      }
+
+      bool compileOverallResults(const vector<PolynomialThread*>& threads)
+      {
+         for (vector<PolynomialThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+         {
+            mAccurate = mAccurate && (*iter)->isAccurate();
+         }
+         return true;
+      }
+
+      bool mAccurate;
+   };
+}
+
 GcpGeoreference::GcpGeoreference() :
    mpGui(NULL),
    mpRaster(NULL),
@@ -377,26 +559,28 @@ static LocationType solveLinearEquations(LocationType size1, LocationType size2,
 
 LocationType GcpGeoreference::geoToPixel(LocationType geocoord, bool* pAccurate) const
 {
-   LocationType pixcoord = evaluatePolynomial(geocoord, mXCoefficients, mYCoefficients, mReverseOrder);
-   if (pAccurate != NULL)
-   {
-      bool outsideCols = pixcoord.mX < 0.0 || pixcoord.mX > static_cast<double>(mNumColumns);
-      bool outsideRows = pixcoord.mY < 0.0 || pixcoord.mY > static_cast<double>(mNumRows);
-      *pAccurate = !(outsideCols || outsideRows);
-   }
-
+   LocationType pixcoord;
+   geosToPixels(&geocoord, &pixcoord, 1, false, pAccurate);
    return pixcoord;
 }
 
 LocationType GcpGeoreference::pixelToGeo(LocationType pixel, bool* pAccurate) const
 {
-   if (pAccurate != NULL)
-   {
-      bool outsideCols = pixel.mX < 0.0 || pixel.mX > static_cast<double>(mNumColumns);
-      bool outsideRows = pixel.mY < 0.0 || pixel.mY > static_cast<double>(mNumRows);
-      *pAccurate = !(outsideCols || outsideRows);
-   }
-  return evaluatePolynomial(pixel, mLatCoefficients, mLonCoefficients, mOrder);
+   LocationType geocoord;
+   pixelsToGeo(&pixel, &geocoord, 1, false, pAccurate);
+   return geocoord;
+}
+
+void GcpGeoreference::pixelsToGeo(const LocationType* pPixels, LocationType* pGeocoords, size_t count,
+                                  bool quick, bool* pAccurate) const
+{
+   evaluatePolynomial(pPixels, pGeocoords, count, mLatCoefficients, mLonCoefficients, mOrder, true, pAccurate);
+}
+
+void GcpGeoreference::geosToPixels(const LocationType* pGeocoords, LocationType* pPixels, size_t count,
+                                   bool quick, bool* pAccurate) const
+{
+   evaluatePolynomial(pGeocoords, pPixels, count, mXCoefficients, mYCoefficients, mReverseOrder, false, pAccurate);
 }
 
 bool GcpGeoreference::canHandleRasterElement(RasterElement *pRaster) const
@@ -410,29 +594,46 @@ bool GcpGeoreference::canHandleRasterElement(RasterElement *pRaster) const
    return true;
 }
 
-LocationType GcpGeoreference::evaluatePolynomial(LocationType position,
-                                                 const double pXCoeffs[],
-                                                 const double pYCoeffs[],
-                                                 int order) const
+void GcpGeoreference::evaluatePolynomial(const LocationType* pPositions, LocationType* pTransformed, size_t count,
+                                         const double pXCoeffs[], const double pYCoeffs[], int order,
+                                         bool checkInput, bool* pAccurate) const
 {
-   double yValue;
-   double xyValue;
-   LocationType transformedPosition(0.0, 0.0);
+   if (count <= POLYNOMIAL_BLOCK_POINTS)
+   {
+      evaluatePolynomialRange(pPositions, pTransformed, count, pXCoeffs, pYCoeffs, order, checkInput,
+         static_cast<double>(mNumRows), static_cast<double>(mNumColumns), pAccurate);
+      return;
+   }
+
+   PolynomialInput input;
+   input.mpPositions = pPositions;
+   input.mpTransformed = pTransformed;
+   input.mCount = count;
+   input.mpXCoeffs = pXCoeffs;
+   input.mpYCoeffs = pYCoeffs;
+   input.mOrder = order;
+   input.mCheckAccuracy = (pAccurate != NULL);
+   input.mCheckInput = checkInput;
+   input.mNumRows = static_cast<double>(mNumRows);
+   input.mNumColumns = static_cast<double>(mNumColumns);
+
+   PolynomialOutput output;
+   unsigned int numBlocks = static_cast<unsigned int>((count + POLYNOMIAL_BLOCK_POINTS - 1) / POLYNOMIAL_BLOCK_POINTS);
+   mta::MultiThreadedAlgorithm<PolynomialInput, PolynomialOutput, PolynomialThread>
+      alg(mta::getNumRequiredThreads(numBlocks), input, output, NULL);
+   if (alg.run() != mta::SUCCESS)
+   {
+      // the threads can not fail, but fall back to converting in this thread rather than leave
+      // the output unset if the algorithm could not be run
+      evaluatePolynomialRange(pPositions, pTransformed, count, pXCoeffs, pYCoeffs, order, checkInput,
+         static_cast<double>(mNumRows), static_cast<double>(mNumColumns), pAccurate);
+      return;
+   }
 
-   int count = 0;
-   for (int i = 0; i <= order; ++i)          // y power
+   if (pAccurate != NULL)
    {
-      yValue = pow(position.mY, i);
-      for (int j = 0; j <= order - i; ++j)   // x power
-      {
-         xyValue = pow(position.mX, j) * yValue;
-         transformedPosition.mX += pXCoeffs[count] * xyValue;
-         transformedPosition.mY += pYCoeffs[count] * xyValue;
-         count++;
-      }
+      *pAccurate = output.mAccurate;
    }
-
-   return transformedPosition;
 }
 
 QWidget *GcpGeoreference::getGui(RasterElement *pRaster)
@@ -37,6 +37,10 @@ public:
 
    LocationType pixelToGeo(LocationType pixel, bool* pAccurate = NULL) const;
    LocationType geoToPixel(LocationType geocoord, bool* pAccurate = NULL) const;
+   void pixelsToGeo(const LocationType* pPixels, LocationType* pGeocoords, size_t count,
+      bool quick = false, bool* pAccurate = NULL) const;
+   void geosToPixels(const LocationType* pGeocoords, LocationType* pPixels, size_t count,
+      bool quick = false, bool* pAccurate = NULL) const;
    bool canHandleRasterElement(RasterElement *pRaster) const;
    QWidget *getGui(RasterElement *pRaster);
    bool validateGuiInput() const;
@@ -45,8 +49,8 @@ public:
    bool deserialize(SessionItemDeserializer &deserializer);
 
 protected:
-   LocationType evaluatePolynomial(LocationType position, const double pXCoeffs[], 
-      const double pYCoeffs[], int order) const;
+   void evaluatePolynomial(const LocationType* pPositions, LocationType* pTransformed, size_t count,
+      const double pXCoeffs[], const double pYCoeffs[], int order, bool checkInput, bool* pAccurate) const;
 
    void computeAnchor(int corner);
    void setCubeSize(unsigned int numRows, unsigned int numColumns);
@@ -9,18 +9,20 @@
 
 #include "AppVersion.h"
 #include "AppVerify.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
 #include "DesktopServices.h"
 #include "DynamicObject.h"
 #include "IgmGeoreference.h"
 #include "IgmGui.h"
 #include "Importer.h"
-#include "GcpList.h"
 #include "GeoPoint.h"
 #include "Layer.h"
 #include "LayerList.h"
-#include "MatrixFunctions.h"
 #include "MessageLogResource.h"
 #include "ModelServices.h"
+#include "ObjectResource.h"
 #include "PlugInArg.h"
 #include "PlugInArgList.h"
 #include "PlugInRegistration.h"
@@ -34,6 +36,7 @@
 #include "SessionItemDeserializer.h"
 #include "SessionItemSerializer.h"
 #include "Statistics.h"
+#include "switchOnEncoding.h"
 #include "XercesIncludes.h"
 #include "xmlreader.h"
 #include "xmlwriter.h"
@@ -46,10 +49,23 @@ XERCES_CPP_NAMESPACE_USE
 
 REGISTER_PLUGIN_BASIC(OpticksGeoreference, IgmGeoreference);
 
+namespace
+{
+   // The first two bands of the IGM are either longitude/latitude or easting/northing.  The values are
+   // stored as (latitude, longitude) or (northing, easting).
+   template<typename T>
+   void readIgmRow(const T* pData, LocationType* pGeocoords, unsigned int numColumns, unsigned int numBands)
+   {
+      for (unsigned int column = 0; column < numColumns; ++column, pData += numBands)
+      {
+         pGeocoords[column] = LocationType(static_cast<double>(pData[1]), static_cast<double>(pData[0]));
+      }
+   }
+}
+
 IgmGeoreference::IgmGeoreference() :
    mpGui(NULL),
    mpRaster(NULL),
-   mpGcpPlugIn(NULL),
    mpIgmRaster(NULL)
 {
    setName("IGM Georeference");
@@ -123,9 +139,6 @@ bool IgmGeoreference::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgL
 
    RasterDataDescriptor* pMainDesc = dynamic_cast<RasterDataDescriptor*>(mpRaster->getDataDescriptor());
    VERIFY(pMainDesc != NULL);
-   mLoadedRows = pMainDesc->getRows();
-   mLoadedColumns = pMainDesc->getColumns();
-   mLoadedBands = pMainDesc->getBands();
 
    if (mpGui == NULL || (mpGui != NULL && mpGui->getFilename().length() != 0))
    {
@@ -155,6 +168,12 @@ bool IgmGeoreference::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgL
       return false;
    }
 
+   if (pLatLonDesc->getBandCount() < 2)
+   {
+      progress.report("IGM must have at least two bands", 0, ERRORS, true);
+      return false;
+   }
+
    const DynamicObject* pMetadata = mpIgmRaster->getMetadata();
    mZone = 100; // Sentinel value for not valid
    if (pMetadata != NULL)
@@ -168,61 +187,48 @@ bool IgmGeoreference::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgL
          mZone = sZone.fromStdString(stdZone).toInt();
       }
    }
-   std::string gcpListName = "Corner Coordinates";
-   ModelResource<GcpList> pGcpList(dynamic_cast<GcpList*>(Service<ModelServices>()->createElement(gcpListName,
-      TypeConverter::toString<GcpList>(), mpIgmRaster.get())));
 
-   if (pGcpList.get() == NULL)
+   // Read the geocoordinate of every pixel and index the cells they form so that geoToPixel()
+   // can invert the IGM exactly
+   const unsigned int numRows = pLatLonDesc->getRowCount();
+   const unsigned int numColumns = pLatLonDesc->getColumnCount();
+   const unsigned int numBands = pLatLonDesc->getBandCount();
+   std::vector<LocationType> geocoords(static_cast<size_t>(numRows) * numColumns);
+
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setInterleaveFormat(BIP);
+   DataAccessor igmAccessor = mpIgmRaster->getDataAccessor(pRequest.release());
+   for (unsigned int row = 0; row < numRows; ++row)
    {
-      progress.report("Unable to create GCP List", 0, ERRORS, true);
-      return false;
-   }
-   std::list<GcpPoint> gcpList;
-   const unsigned int maxX = mLoadedColumns.size() - 1;
-   const unsigned int maxY = mLoadedRows.size() - 1;
-   unsigned int skipX = maxX / 4;   // Appropriate skip factor for a well determined 2 order system.
-   unsigned int skipY = maxY / 4;   // Appropriate skip factor for a well determined 2 order system.
-   for (unsigned int row = 0; row <= maxY; row += skipY)
-   {
-      // Read one row at a time.
-      for (unsigned int col = 0; col <= maxX; col += skipX)
+      if (igmAccessor.isValid() == false)
       {
-         // Note that the location of the pixel coordinates and geocoordinates has been reversed.
-         // This is to ensure that when the reverse method, IgmGeoreference::geoToPixel(),
-         // is called that GcpGeoreference::pixelToGeo() returns the appropriate results.
-         GcpPoint pt;
-         bool geoOk = false;
-
-         pt.mCoordinate = LocationType(col, row);
-         pt.mPixel  = pixelToGeo(pt.mCoordinate, &geoOk);
-         gcpList.push_back(pt);
+         progress.report("Unable to read the IGM", 0, ERRORS, true);
+         return false;
       }
-   }
 
-   pGcpList->addPoints(gcpList);
+      LocationType* pGeocoords = &geocoords[static_cast<size_t>(row) * numColumns];
+      switchOnEncoding(latLonType, readIgmRow, igmAccessor->getRow(), pGeocoords, numColumns, numBands);
+      if (mZone != 100)
+      {
+         for (unsigned int column = 0; column < numColumns; ++column)
+         {
+            UtmPoint uPoint(pGeocoords[column].mY, pGeocoords[column].mX, mZone, 'N');
+            pGeocoords[column] = LocationType(uPoint.getLatLonCoordinates().getLatitude().getValue(),
+               uPoint.getLatLonCoordinates().getLongitude().getValue());
+         }
+      }
 
-   // Reset the GCP Georeference plug-in, and execute GCP Georeference on mpIgmRaster.
-   // If the operation succeeds, keep a pointer to the GCP Georeference plug-in for use later.
-   ExecutableResource pGeoreference = ExecutableResource("GCP Georeference", "", progress.getCurrentProgress());
-   if (pGeoreference.get() == NULL)
-   {
-      progress.report("Unable to create GCP Georeference plug-in", 0, ERRORS, true);
-      return false;
+      igmAccessor->nextRow();
+      progress.report("Reading IGM", row * 90 / numRows, NORMAL);
    }
 
-   int order = 2;
-   PlugInArgList& gcpArgs = pGeoreference->getInArgList();
-   bool bConditionsForExecution =
-      (gcpArgs.setPlugInArgValue<RasterElement>(Executable::DataElementArg(), mpIgmRaster.get()) == false ||
-      gcpArgs.setPlugInArgValue<GcpList>("GCP List", pGcpList.get()) == false ||  gcpArgs.setPlugInArgValue<int>("Order", &order) == false);
-
-   if (bConditionsForExecution || pGeoreference->execute() == false)
+   progress.report("Indexing IGM", 90, NORMAL);
+   if (mIndex.initialize(geocoords, numRows, numColumns) == false)
    {
-      progress.report("Unable to execute GCP Georeference plug-in", 0, ERRORS, true);
+      progress.report("Unable to index the IGM", 0, ERRORS, true);
       return false;
    }
 
-   mpGcpPlugIn = dynamic_cast<Georeference*>(pGeoreference->getPlugIn());
    mpRaster->setGeoreferencePlugin(this);
 
    progress.report("Georeference finished", 100, NORMAL);
@@ -268,12 +274,18 @@ bool IgmGeoreference::deserialize(SessionItemDeserializer &deserializer)
 
 LocationType IgmGeoreference::pixelToGeoQuick(LocationType pixel, bool* pAccurate) const
 {
-   LocationType geo = pixelToGeo(pixel, pAccurate);
-   return geo;
+   if (pAccurate != NULL)
+   {
+      *pAccurate = mIndex.isValid();
+   }
+
+   return mIndex.pixelToGeoQuick(pixel);
 }
 
 void IgmGeoreference::elementDeleted(Subject& subject, const std::string& signal, const boost::any& data)
 {
+   mIndex.clear();
+
    Service<DesktopServices> pDesktop;
    SpatialDataWindow* pWindow = dynamic_cast<SpatialDataWindow*>(pDesktop->getCurrentWorkspaceWindow());
    SpatialDataView* pView = (pWindow == NULL) ? NULL : pWindow->getSpatialDataView();
@@ -295,55 +307,37 @@ void IgmGeoreference::elementDeleted(Subject& subject, const std::string& signal
 
 LocationType IgmGeoreference::pixelToGeo(LocationType pixel, bool* pAccurate) const
 {
-   if (pAccurate)
+   if (pAccurate != NULL)
    {
-      *pAccurate = false;
+      *pAccurate = mIndex.isValid();
    }
 
-   if (mpIgmRaster.get() == NULL)
-   {
-      return LocationType();
-   }
-
-   // Input pixel is in Active Numbers: enforce input to be within bounds.
-   pixel.clampMinimum(LocationType(0, 0));
-   pixel.clampMaximum(LocationType(mLoadedColumns.size() - 1, mLoadedRows.size() - 1));
-
-   const DimensionDescriptor& column = mLoadedColumns[static_cast<unsigned int>(pixel.mX)];
-   const DimensionDescriptor& row = mLoadedRows[static_cast<unsigned int>(pixel.mY)];
-   // first/second is either northing/easting or longitude/latitude
-   const DimensionDescriptor& firstBand = mLoadedBands[static_cast<unsigned int>(0)];
-   const DimensionDescriptor& secondBand = mLoadedBands[static_cast<unsigned int>(1)];
-   if (column.isValid() == false || row.isValid() == false || firstBand.isValid() == false || secondBand.isValid() == false)
-   {
-      return LocationType();
-   }
-
-   if (pAccurate)
-   {
-      *pAccurate = true;
-   }
-
-   if (mZone == 100) // no zone...assume we are lat/lon instead of UTM
-   {
-      return LocationType(mpIgmRaster->getPixelValue(column, row, secondBand),
-         mpIgmRaster->getPixelValue(column, row, firstBand));
-   }
-   UtmPoint uPoint(mpIgmRaster->getPixelValue(column, row, firstBand),
-      mpIgmRaster->getPixelValue(column, row, secondBand), mZone, 'N');
-   return LocationType(uPoint.getLatLonCoordinates().getLatitude().getValue(),
-      uPoint.getLatLonCoordinates().getLongitude().getValue());
+   // Input pixel is in Active Numbers: locations outside the IGM are clamped to its edges.
+   return mIndex.pixelToGeo(pixel);
 }
 
 LocationType IgmGeoreference::geoToPixel(LocationType geo, bool* pAccurate) const
 {
-   // Since GCP Georeference values are stored in reverse order, perform the reverse operation here.
-   if (mpGcpPlugIn == NULL || mpIgmGeo.get() == NULL)
+   LocationType pixel;
+   geosToPixels(&geo, &pixel, 1, false, pAccurate);
+   return pixel;
+}
+
+void IgmGeoreference::geosToPixels(const LocationType* pGeocoords, LocationType* pPixels, size_t count,
+                                   bool quick, bool* pAccurate) const
+{
+   // Consecutive points are usually close together, so start each search with the cell found for the previous point
+   bool allAccurate = true;
+   unsigned int hintCell = IgmSpatialIndex::INVALID_CELL;
+   for (size_t i = 0; i < count; ++i)
    {
-      return LocationType();
+      bool accurate = false;
+      pPixels[i] = mIndex.geoToPixel(pGeocoords[i], accurate, hintCell);
+      allAccurate = allAccurate && accurate;
    }
-   else
+
+   if (pAccurate != NULL)
    {
-      return mpGcpPlugIn->pixelToGeo(geo, pAccurate);
+      *pAccurate = allAccurate;
    }
 }
@@ -13,8 +13,8 @@
 
 #include "ApplicationServices.h"
 #include "AttachmentPtr.h"
-#include "DimensionDescriptor.h"
 #include "GeoreferenceShell.h"
+#include "IgmSpatialIndex.h"
 #include "ModelServices.h"
 #include "PlugInResource.h"
 #include "UtilityServices.h"
@@ -34,6 +34,8 @@ public:
    virtual bool setInteractive();
 
    virtual LocationType geoToPixel(LocationType geo, bool* pAccurate) const;
+   virtual void geosToPixels(const LocationType* pGeocoords, LocationType* pPixels, size_t count,
+      bool quick = false, bool* pAccurate = NULL) const;
 
    virtual LocationType pixelToGeo(LocationType pixel, bool* pAccurate) const;
    virtual LocationType pixelToGeoQuick(LocationType pixel, bool* pAccurate) const;
@@ -49,13 +51,10 @@ private:
    IgmGui* mpGui;
 
    RasterElement* mpRaster;
-   Georeference* mpGcpPlugIn;
    AttachmentPtr<DataElement> mpIgmGeo;
    AttachmentPtr<RasterElement> mpIgmRaster;
-   std::vector<DimensionDescriptor> mLoadedColumns;
-   std::vector<DimensionDescriptor> mLoadedRows;
-   std::vector<DimensionDescriptor> mLoadedBands;
    unsigned int mZone;
+   IgmSpatialIndex mIndex;
 };
 
 #endif // IGMGEOREFERENCE_H
@@ -0,0 +1,451 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "IgmSpatialIndex.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+using namespace std;
+
+const unsigned int IgmSpatialIndex::INVALID_CELL = numeric_limits<unsigned int>::max();
+
+namespace
+{
+   // Cells covering more buckets than this, which are usually caused by fill values in the IGM,
+   // are kept in a separate list instead of being added to every bucket they cover
+   const unsigned int MAX_BUCKETS_PER_CELL = 256;
+
+   // Cells are accepted when the solution is within this distance of the unit square so that
+   // points on the shared edge of two cells are not missed because of rounding
+   const double CELL_TOLERANCE = 1e-9;
+
+   const int MAX_NEWTON_ITERATIONS = 10;
+
+   bool isFinite(double value)
+   {
+      return (value - value) == 0.0;
+   }
+
+   double distanceOutside(double u, double v)
+   {
+      double du = max(0.0, max(-u, u - 1.0));
+      double dv = max(0.0, max(-v, v - 1.0));
+      return du + dv;
+   }
+
+   unsigned int toBucket(double value, double minValue, double bucketSize, unsigned int bucketCount)
+   {
+      double bucket = floor((value - minValue) / bucketSize);
+      if (bucket <= 0.0)
+      {
+         return 0;
+      }
+      if (bucket >= static_cast<double>(bucketCount - 1))
+      {
+         return bucketCount - 1;
+      }
+      return static_cast<unsigned int>(bucket);
+   }
+}
+
+IgmSpatialIndex::IgmSpatialIndex() :
+   mRows(0),
+   mColumns(0),
+   mBucketRows(0),
+   mBucketColumns(0),
+   mBucketWidth(1.0),
+   mBucketHeight(1.0)
+{
+}
+
+bool IgmSpatialIndex::initialize(vector<LocationType>& geocoords, unsigned int rows, unsigned int columns)
+{
+   clear();
+   if (rows == 0 || columns == 0 || geocoords.size() != static_cast<size_t>(rows) * columns)
+   {
+      return false;
+   }
+
+   mRows = rows;
+   mColumns = columns;
+   mGeocoords.swap(geocoords);
+   if (mRows < 2 || mColumns < 2)
+   {
+      return true;
+   }
+
+   const unsigned int cellColumns = mColumns - 1;
+   const unsigned int cellCount = getCellCount();
+
+   // Find the bounding box of each usable cell and of the whole IGM
+   vector<LocationType> cellMin(cellCount);
+   vector<LocationType> cellMax(cellCount);
+   vector<bool> cellUsable(cellCount, false);
+   LocationType minGeo(numeric_limits<double>::max(), numeric_limits<double>::max());
+   LocationType maxGeo(-numeric_limits<double>::max(), -numeric_limits<double>::max());
+   for (unsigned int cell = 0; cell < cellCount; ++cell)
+   {
+      unsigned int column = cell % cellColumns;
+      unsigned int row = cell / cellColumns;
+      const LocationType* pCorners[4] = { &getGeocoord(column, row), &getGeocoord(column + 1, row),
+         &getGeocoord(column, row + 1), &getGeocoord(column + 1, row + 1) };
+
+      bool usable = true;
+      LocationType lower = *pCorners[0];
+      LocationType upper = *pCorners[0];
+      for (int corner = 0; corner < 4; ++corner)
+      {
+         usable = usable && isFinite(pCorners[corner]->mX) && isFinite(pCorners[corner]->mY);
+         lower.clampMaximum(*pCorners[corner]);
+         upper.clampMinimum(*pCorners[corner]);
+      }
+      if (usable)
+      {
+         cellUsable[cell] = true;
+         cellMin[cell] = lower;
+         cellMax[cell] = upper;
+         minGeo.clampMaximum(lower);
+         maxGeo.clampMinimum(upper);
+      }
+   }
+
+   if (find(cellUsable.begin(), cellUsable.end(), true) == cellUsable.end())
+   {
+      return true;
+   }
+
+   // Size the bucket grid to have about one cell per bucket with roughly square buckets
+   const double width = maxGeo.mX - minGeo.mX;
+   const double height = maxGeo.mY - minGeo.mY;
+   const double targetBuckets = static_cast<double>(cellCount);
+   mBucketColumns = 1;
+   mBucketRows = 1;
+   if (width > 0.0 && height > 0.0)
+   {
+      mBucketColumns = static_cast<unsigned int>(min(targetBuckets, ceil(sqrt(targetBuckets * width / height))));
+      mBucketColumns = max(mBucketColumns, 1U);
+      mBucketRows = max(static_cast<unsigned int>(ceil(targetBuckets / mBucketColumns)), 1U);
+   }
+   else if (width > 0.0)
+   {
+      mBucketColumns = cellCount;
+   }
+   else if (height > 0.0)
+   {
+      mBucketRows = cellCount;
+   }
+   mMinGeo = minGeo;
+   mBucketWidth = (width > 0.0 ? width / mBucketColumns : 1.0);
+   mBucketHeight = (height > 0.0 ? height / mBucketRows : 1.0);
+
+   // Count the cells in each bucket, then fill the buckets in a second pass
+   const size_t bucketCount = static_cast<size_t>(mBucketRows) * mBucketColumns;
+   vector<unsigned int> bucketCounts(bucketCount + 1, 0);
+   for (int pass = 0; pass < 2; ++pass)
+   {
+      for (unsigned int cell = 0; cell < cellCount; ++cell)
+      {
+         if (cellUsable[cell] == false)
+         {
+            continue;
+         }
+
+         unsigned int firstColumn = toBucket(cellMin[cell].mX, mMinGeo.mX, mBucketWidth, mBucketColumns);
+         unsigned int lastColumn = toBucket(cellMax[cell].mX, mMinGeo.mX, mBucketWidth, mBucketColumns);
+         unsigned int firstRow = toBucket(cellMin[cell].mY, mMinGeo.mY, mBucketHeight, mBucketRows);
+         unsigned int lastRow = toBucket(cellMax[cell].mY, mMinGeo.mY, mBucketHeight, mBucketRows);
+         double coveredBuckets = static_cast<double>(lastColumn - firstColumn + 1) * (lastRow - firstRow + 1);
+         if (coveredBuckets > MAX_BUCKETS_PER_CELL)
+         {
+            if (pass == 0)
+            {
+               mLargeCells.push_back(cell);
+            }
+            continue;
+         }
+
+         for (unsigned int bucketRow = firstRow; bucketRow <= lastRow; ++bucketRow)
+         {
+            for (unsigned int bucketColumn = firstColumn; bucketColumn <= lastColumn; ++bucketColumn)
+            {
+               size_t bucket = static_cast<size_t>(bucketRow) * mBucketColumns + bucketColumn;
+               if (pass == 0)
+               {
+                  ++bucketCounts[bucket + 1];
+               }
+               else
+               {
+                  mBucketCells[bucketCounts[bucket]++] = cell;
+               }
+            }
+         }
+      }
+
+      if (pass == 0)
+      {
+         for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+         {
+            bucketCounts[bucket + 1] += bucketCounts[bucket];
+         }
+         mBucketStarts = bucketCounts;
+         mBucketCells.resize(bucketCounts.back());
+      }
+   }
+
+   return true;
+}
+
+void IgmSpatialIndex::clear()
+{
+   mRows = 0;
+   mColumns = 0;
+   mBucketRows = 0;
+   mBucketColumns = 0;
+   vector<LocationType>().swap(mGeocoords);
+   vector<unsigned int>().swap(mBucketStarts);
+   vector<unsigned int>().swap(mBucketCells);
+   vector<unsigned int>().swap(mLargeCells);
+}
+
+bool IgmSpatialIndex::isValid() const
+{
+   return mGeocoords.empty() == false;
+}
+
+LocationType IgmSpatialIndex::pixelToGeo(LocationType pixel) const
+{
+   if (isValid() == false)
+   {
+      return LocationType();
+   }
+
+   pixel.clampMinimum(LocationType(0, 0));
+   pixel.clampMaximum(LocationType(mColumns - 1, mRows - 1));
+
+   unsigned int column = min(static_cast<unsigned int>(pixel.mX), max(mColumns, 2U) - 2);
+   unsigned int row = min(static_cast<unsigned int>(pixel.mY), max(mRows, 2U) - 2);
+   double u = pixel.mX - column;
+   double v = pixel.mY - row;
+
+   unsigned int nextColumn = min(column + 1, mColumns - 1);
+   unsigned int nextRow = min(row + 1, mRows - 1);
+   const LocationType& p00 = getGeocoord(column, row);
+   const LocationType& p10 = getGeocoord(nextColumn, row);
+   const LocationType& p01 = getGeocoord(column, nextRow);
+   const LocationType& p11 = getGeocoord(nextColumn, nextRow);
+   return (p00 * (1.0 - u) + p10 * u) * (1.0 - v) + (p01 * (1.0 - u) + p11 * u) * v;
+}
+
+LocationType IgmSpatialIndex::pixelToGeoQuick(LocationType pixel) const
+{
+   if (isValid() == false)
+   {
+      return LocationType();
+   }
+
+   pixel.clampMinimum(LocationType(0, 0));
+   pixel.clampMaximum(LocationType(mColumns - 1, mRows - 1));
+   return getGeocoord(static_cast<unsigned int>(pixel.mX), static_cast<unsigned int>(pixel.mY));
+}
+
+LocationType IgmSpatialIndex::geoToPixel(LocationType geo, bool& accurate, unsigned int& hintCell) const
+{
+   accurate = false;
+   if (mBucketStarts.empty() && mLargeCells.empty())
+   {
+      return LocationType();
+   }
+
+   double u = 0.0;
+   double v = 0.0;
+   if (hintCell < getCellCount() && containsPoint(hintCell, geo, u, v))
+   {
+      accurate = true;
+      return cellToPixel(hintCell, u, v);
+   }
+
+   const double bucketColumn = floor((geo.mX - mMinGeo.mX) / mBucketWidth);
+   const double bucketRow = floor((geo.mY - mMinGeo.mY) / mBucketHeight);
+   const bool inGrid = (mBucketStarts.empty() == false && bucketColumn >= 0.0 && bucketRow >= 0.0 &&
+      bucketColumn < mBucketColumns && bucketRow < mBucketRows);
+   if (inGrid)
+   {
+      size_t bucket = static_cast<size_t>(bucketRow) * mBucketColumns + static_cast<size_t>(bucketColumn);
+      for (unsigned int i = mBucketStarts[bucket]; i < mBucketStarts[bucket + 1]; ++i)
+      {
+         if (containsPoint(mBucketCells[i], geo, u, v))
+         {
+            hintCell = mBucketCells[i];
+            accurate = true;
+            return cellToPixel(hintCell, u, v);
+         }
+      }
+   }
+
+   for (vector<unsigned int>::const_iterator iter = mLargeCells.begin(); iter != mLargeCells.end(); ++iter)
+   {
+      if (containsPoint(*iter, geo, u, v))
+      {
+         hintCell = *iter;
+         accurate = true;
+         return cellToPixel(hintCell, u, v);
+      }
+   }
+
+   // The point is outside the IGM, so extrapolate from the nearest cell, searching rings of buckets
+   // outward from the nearest bucket until one contains a cell
+   unsigned int bestCell = INVALID_CELL;
+   double bestDistance = numeric_limits<double>::max();
+   LocationType bestPixel;
+   if (mBucketStarts.empty() == false)
+   {
+      const int centerColumn = static_cast<int>(toBucket(geo.mX, mMinGeo.mX, mBucketWidth, mBucketColumns));
+      const int centerRow = static_cast<int>(toBucket(geo.mY, mMinGeo.mY, mBucketHeight, mBucketRows));
+      const int maxRadius = static_cast<int>(max(mBucketColumns, mBucketRows));
+      for (int radius = 0; radius <= maxRadius && bestCell == INVALID_CELL; ++radius)
+      {
+         for (int row = centerRow - radius; row <= centerRow + radius; ++row)
+         {
+            if (row < 0 || row >= static_cast<int>(mBucketRows))
+            {
+               continue;
+            }
+
+            bool edgeRow = (row == centerRow - radius || row == centerRow + radius);
+            int step = (edgeRow ? 1 : 2 * radius);
+            for (int column = centerColumn - radius; column <= centerColumn + radius; column += max(step, 1))
+            {
+               if (column < 0 || column >= static_cast<int>(mBucketColumns))
+               {
+                  continue;
+               }
+
+               size_t bucket = static_cast<size_t>(row) * mBucketColumns + column;
+               for (unsigned int i = mBucketStarts[bucket]; i < mBucketStarts[bucket + 1]; ++i)
+               {
+                  extrapolate(mBucketCells[i], geo, bestCell, bestDistance, bestPixel);
+               }
+            }
+         }
+      }
+   }
+
+   for (vector<unsigned int>::const_iterator iter = mLargeCells.begin(); iter != mLargeCells.end(); ++iter)
+   {
+      extrapolate(*iter, geo, bestCell, bestDistance, bestPixel);
+   }
+
+   return bestPixel;
+}
+
+unsigned int IgmSpatialIndex::getCellCount() const
+{
+   return (mRows < 2 || mColumns < 2) ? 0 : (mRows - 1) * (mColumns - 1);
+}
+
+const LocationType& IgmSpatialIndex::getGeocoord(unsigned int column, unsigned int row) const
+{
+   return mGeocoords[static_cast<size_t>(row) * mColumns + column];
+}
+
+bool IgmSpatialIndex::solveCell(unsigned int cell, const LocationType& geo, double& u, double& v) const
+{
+   unsigned int column = cell % (mColumns - 1);
+   unsigned int row = cell / (mColumns - 1);
+   const LocationType& p00 = getGeocoord(column, row);
+   const LocationType& p10 = getGeocoord(column + 1, row);
+   const LocationType& p01 = getGeocoord(column, row + 1);
+   const LocationType& p11 = getGeocoord(column + 1, row + 1);
+
+   // Solve geo = p00 + u * e + v * f + u * v * g with Newton's method
+   const LocationType e = p10 - p00;
+   const LocationType f = p01 - p00;
+   const LocationType g = p00 - p10 - p01 + p11;
+   const LocationType h = geo - p00;
+   const double scale = max(max(fabs(e.mX), fabs(e.mY)), max(fabs(f.mX), fabs(f.mY)));
+   if (scale == 0.0)
+   {
+      return false;
+   }
+
+   u = 0.5;
+   v = 0.5;
+   for (int iteration = 0; iteration < MAX_NEWTON_ITERATIONS; ++iteration)
+   {
+      const double residualX = u * e.mX + v * f.mX + u * v * g.mX - h.mX;
+      const double residualY = u * e.mY + v * f.mY + u * v * g.mY - h.mY;
+      const double dxdu = e.mX + v * g.mX;
+      const double dydu = e.mY + v * g.mY;
+      const double dxdv = f.mX + u * g.mX;
+      const double dydv = f.mY + u * g.mY;
+      const double determinant = dxdu * dydv - dxdv * dydu;
+      if (fabs(determinant) <= numeric_limits<double>::epsilon() * scale * scale)
+      {
+         return false;
+      }
+
+      const double du = (residualX * dydv - residualY * dxdv) / determinant;
+      const double dv = (residualY * dxdu - residualX * dydu) / determinant;
+      u -= du;
+      v -= dv;
+      if (fabs(du) + fabs(dv) < 1e-12)
+      {
+         break;
+      }
+   }
+
+   return isFinite(u) && isFinite(v);
+}
+
+bool IgmSpatialIndex::containsPoint(unsigned int cell, const LocationType& geo, double& u, double& v) const
+{
+   unsigned int column = cell % (mColumns - 1);
+   unsigned int row = cell / (mColumns - 1);
+   const LocationType& p00 = getGeocoord(column, row);
+   const LocationType& p10 = getGeocoord(column + 1, row);
+   const LocationType& p01 = getGeocoord(column, row + 1);
+   const LocationType& p11 = getGeocoord(column + 1, row + 1);
+
+   // Reject points outside the bounding box of the cell before solving for the location in the cell
+   if (geo.mX < min(min(p00.mX, p10.mX), min(p01.mX, p11.mX)) ||
+      geo.mX > max(max(p00.mX, p10.mX), max(p01.mX, p11.mX)) ||
+      geo.mY < min(min(p00.mY, p10.mY), min(p01.mY, p11.mY)) ||
+      geo.mY > max(max(p00.mY, p10.mY), max(p01.mY, p11.mY)))
+   {
+      return false;
+   }
+
+   return solveCell(cell, geo, u, v) && distanceOutside(u, v) <= CELL_TOLERANCE;
+}
+
+void IgmSpatialIndex::extrapolate(unsigned int cell, const LocationType& geo, unsigned int& bestCell,
+                                  double& bestDistance, LocationType& bestPixel) const
+{
+   double u = 0.0;
+   double v = 0.0;
+   if (solveCell(cell, geo, u, v))
+   {
+      double distance = distanceOutside(u, v);
+      if (distance < bestDistance)
+      {
+         bestCell = cell;
+         bestDistance = distance;
+         bestPixel = cellToPixel(cell, u, v);
+      }
+   }
+}
+
+LocationType IgmSpatialIndex::cellToPixel(unsigned int cell, double u, double v) const
+{
+   unsigned int column = cell % (mColumns - 1);
+   unsigned int row = cell / (mColumns - 1);
+   return LocationType(column + u, row + v);
+}
@@ -0,0 +1,109 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef IGMSPATIALINDEX_H
+#define IGMSPATIALINDEX_H
+
+#include "LocationType.h"
+
+#include <vector>
+
+/**
+ * Stores the geocoordinates of every pixel of an IGM and inverts the pixel to geocoordinate mapping exactly.
+ *
+ * Each cell of the index is the quadrilateral formed by the geocoordinates of four adjacent pixels.  The
+ * cells are bucketed into a regular grid covering their bounding boxes, so inverting a geocoordinate only
+ * has to test the few cells in its bucket.  The pixel location within the containing cell is found by
+ * solving the bilinear mapping of the cell.
+ *
+ * Pixel (column, row) maps to the geocoordinate stored for that pixel, and locations between pixels are
+ * bilinearly interpolated.  Once initialized, the index is read-only and may be queried from several
+ * threads at once.
+ */
+class IgmSpatialIndex
+{
+public:
+   IgmSpatialIndex();
+
+   /**
+    * Builds the index.
+    *
+    * @param geocoords
+    *        The geocoordinates of each pixel, in row-major order.  The contents of this vector are
+    *        taken by the index, leaving it empty.
+    * @param rows
+    *        The number of rows of pixels.
+    * @param columns
+    *        The number of columns of pixels.
+    *
+    * @return \c True if the index was built, \c false if the size of \c geocoords does not match.
+    */
+   bool initialize(std::vector<LocationType>& geocoords, unsigned int rows, unsigned int columns);
+
+   /**
+    * Releases all memory used by the index.
+    */
+   void clear();
+
+   bool isValid() const;
+
+   /**
+    * Gets the bilinearly interpolated geocoordinate of a pixel location.  Locations outside the
+    * IGM are clamped to its edges.
+    */
+   LocationType pixelToGeo(LocationType pixel) const;
+
+   /**
+    * Gets the geocoordinate stored for the pixel containing a pixel location.  Locations outside the
+    * IGM are clamped to its edges.
+    */
+   LocationType pixelToGeoQuick(LocationType pixel) const;
+
+   /**
+    * Gets the pixel location of a geocoordinate.
+    *
+    * @param geo
+    *        The geocoordinate to convert.
+    * @param accurate
+    *        Set to \c false if the geocoordinate is not inside any cell, in which case the returned
+    *        location is extrapolated from the nearest cell found.
+    * @param hintCell
+    *        A cell which is tested before searching the index, updated to the cell containing \c geo.
+    *        Passing the value from the previous call speeds up the conversion of nearby points.
+    *
+    * @return The pixel location of \c geo.
+    */
+   LocationType geoToPixel(LocationType geo, bool& accurate, unsigned int& hintCell) const;
+
+   static const unsigned int INVALID_CELL;
+
+private:
+   unsigned int getCellCount() const;
+   const LocationType& getGeocoord(unsigned int column, unsigned int row) const;
+   bool solveCell(unsigned int cell, const LocationType& geo, double& u, double& v) const;
+   bool containsPoint(unsigned int cell, const LocationType& geo, double& u, double& v) const;
+   void extrapolate(unsigned int cell, const LocationType& geo, unsigned int& bestCell, double& bestDistance,
+      LocationType& bestPixel) const;
+   LocationType cellToPixel(unsigned int cell, double u, double v) const;
+
+   unsigned int mRows;
+   unsigned int mColumns;
+   std::vector<LocationType> mGeocoords;
+
+   LocationType mMinGeo;
+   unsigned int mBucketRows;
+   unsigned int mBucketColumns;
+   double mBucketWidth;
+   double mBucketHeight;
+   std::vector<unsigned int> mBucketStarts;
+   std::vector<unsigned int> mBucketCells;
+   std::vector<unsigned int> mLargeCells;
+};
+
+#endif
@@ -0,0 +1,271 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "IceChunkWriter.h"
+#include "IceUtilities.h"
+#include "MultiThreadedAlgorithm.h"
+
+#include <algorithm>
+#include <string.h>
+#include <string>
+#include <zlib.h>
+
+using namespace std;
+
+// H5Dwrite_chunk() was added in HDF5 1.10.3
+#if H5_VERS_MAJOR > 1 || (H5_VERS_MAJOR == 1 && (H5_VERS_MINOR > 10 || \
+   (H5_VERS_MINOR == 10 && H5_VERS_RELEASE >= 3)))
+#define ICE_DIRECT_CHUNK_WRITE
+#endif
+
+namespace
+{
+   /**
+    * Applies the shuffle and deflate filters to a chunk the same way HDF5 does.  The data is
+    * padded to a full chunk with zeros, since HDF5 always filters whole chunks.
+    */
+   bool filterChunk(IceChunkWriter::Chunk& chunk, const IceChunkWriter::FilterSettings& settings)
+   {
+      const hsize_t* pChunkDims = settings.mChunkDims;
+      size_t elementSize = settings.mElementSize;
+      size_t numElements = static_cast<size_t>(pChunkDims[0] * pChunkDims[1] * pChunkDims[2]);
+      size_t chunkBytes = numElements * elementSize;
+
+      char* pData = &chunk.mData.front();
+      if (chunk.mCounts[0] != pChunkDims[0] || chunk.mCounts[1] != pChunkDims[1] ||
+         chunk.mCounts[2] != pChunkDims[2])
+      {
+         chunk.mScratch.assign(chunkBytes, 0);
+         size_t lineBytes = static_cast<size_t>(chunk.mCounts[2]) * elementSize;
+         for (hsize_t i0 = 0; i0 < chunk.mCounts[0]; ++i0)
+         {
+            for (hsize_t i1 = 0; i1 < chunk.mCounts[1]; ++i1)
+            {
+               size_t source = static_cast<size_t>(i0 * chunk.mCounts[1] + i1) * lineBytes;
+               size_t destination = static_cast<size_t>((i0 * pChunkDims[1] + i1) * pChunkDims[2]) * elementSize;
+               memcpy(&chunk.mScratch[destination], pData + source, lineBytes);
+            }
+         }
+         chunk.mData.swap(chunk.mScratch);
+         pData = &chunk.mData.front();
+      }
+
+      // The shuffle filter stores the first byte of every element, then the second byte, and so on
+      if (settings.mShuffle && elementSize > 1 && numElements > 1)
+      {
+         chunk.mScratch.resize(chunkBytes);
+         char* pShuffled = &chunk.mScratch.front();
+         for (size_t byte = 0; byte < elementSize; ++byte)
+         {
+            const char* pSource = pData + byte;
+            char* pDestination = pShuffled + byte * numElements;
+            for (size_t element = 0; element < numElements; ++element)
+            {
+               pDestination[element] = *pSource;
+               pSource += elementSize;
+            }
+         }
+         pData = pShuffled;
+      }
+
+      uLongf compressedSize = compressBound(static_cast<uLong>(chunkBytes));
+      chunk.mFiltered.resize(compressedSize);
+      if (compress2(reinterpret_cast<Bytef*>(&chunk.mFiltered.front()), &compressedSize,
+         reinterpret_cast<const Bytef*>(pData), static_cast<uLong>(chunkBytes), settings.mDeflateLevel) != Z_OK)
+      {
+         return false;
+      }
+
+      chunk.mFilteredSize = compressedSize;
+      return true;
+   }
+
+   struct FilterInput
+   {
+      vector<IceChunkWriter::Chunk>* mpChunks;
+      unsigned int mNumChunks;
+      const IceChunkWriter::FilterSettings* mpSettings;
+   };
+
+   class FilterThread : public mta::AlgorithmThread
+   {
+   public:
+      FilterThread(const FilterInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter) :
+         mta::AlgorithmThread(threadIndex, reporter),
+         mInput(input),
+         mChunkRange(getThreadRange(threadCount, static_cast<int>(input.mNumChunks))),
+         mSuccess(true)
+      {
+      }
+
+      void run()
+      {
+         for (int chunk = mChunkRange.mFirst; chunk <= mChunkRange.mLast && mSuccess; ++chunk)
+         {
+            mSuccess = filterChunk((*mInput.mpChunks)[chunk], *mInput.mpSettings);
+         }
+      }
+
+      bool isSuccessful() const
+      {
+         return mSuccess;
+      }
+
+   private:
+      const FilterInput& mInput;
+      Range mChunkRange;
+      bool mSuccess;
+   };
+
+   struct FilterOutput
+   {
+      bool compileOverallResults(const vector<FilterThread*>& threads)
+      {
+         for (vector<FilterThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+         {
+            if ((*iter)->isSuccessful() == false)
+            {
+               return false;
+            }
+         }
+         return true;
+      }
+   };
+}
+
+IceChunkWriter::IceChunkWriter(hid_t dataSet, hid_t memoryType) :
+   mDataSet(dataSet),
+   mMemoryType(memoryType),
+   mFileSpace(H5Dget_space(dataSet)),
+   mFilterChunks(false),
+   mPendingChunks(0)
+{
+   ICEVERIFY(*mFileSpace >= 0);
+
+   Hdf5TypeResource fileType(H5Dget_type(dataSet));
+   ICEVERIFY(*fileType >= 0);
+   mSettings.mElementSize = H5Tget_size(*fileType);
+   mSettings.mShuffle = false;
+   mSettings.mDeflateLevel = -1;
+
+   hid_t createProperties = H5Dget_create_plist(dataSet);
+   ICEVERIFY(createProperties >= 0);
+   int chunkRank = H5Pget_chunk(createProperties, 3, mSettings.mChunkDims);
+
+#if defined(ICE_DIRECT_CHUNK_WRITE)
+   // Chunks can only be filtered here if they are stored without type conversion and the data set
+   // uses no filters other than shuffle and deflate
+   bool canFilter = H5Tequal(*fileType, memoryType) > 0;
+   int numFilters = H5Pget_nfilters(createProperties);
+   for (int i = 0; i < numFilters && canFilter; ++i)
+   {
+      unsigned int flags = 0;
+      size_t numValues = 1;
+      unsigned int values[1] = {0};
+      H5Z_filter_t filter = H5Pget_filter2(createProperties, static_cast<unsigned int>(i), &flags, &numValues,
+         values, 0, NULL, NULL);
+      if (filter == H5Z_FILTER_SHUFFLE && mSettings.mDeflateLevel < 0)
+      {
+         mSettings.mShuffle = true;
+      }
+      else if (filter == H5Z_FILTER_DEFLATE && mSettings.mDeflateLevel < 0 && numValues >= 1)
+      {
+         mSettings.mDeflateLevel = static_cast<int>(values[0]);
+      }
+      else
+      {
+         canFilter = false;
+      }
+   }
+   mFilterChunks = canFilter && mSettings.mDeflateLevel >= 0;
+#endif
+
+   H5Pclose(createProperties);
+   ICEVERIFY(chunkRank == 3);
+
+   unsigned int numBuffers = 1;
+   if (mFilterChunks)
+   {
+      // Two chunks per worker keeps every worker busy while bounding the memory used by the batch
+      numBuffers = max(2U, 2 * mta::getWorkerCount());
+   }
+
+   size_t chunkBytes = static_cast<size_t>(mSettings.mChunkDims[0] * mSettings.mChunkDims[1] *
+      mSettings.mChunkDims[2]) * mSettings.mElementSize;
+   mChunks.resize(numBuffers);
+   for (vector<Chunk>::iterator iter = mChunks.begin(); iter != mChunks.end(); ++iter)
+   {
+      iter->mData.resize(chunkBytes, 0);
+      iter->mFilteredSize = 0;
+   }
+}
+
+char* IceChunkWriter::getBuffer()
+{
+   return &mChunks[mPendingChunks].mData.front();
+}
+
+void IceChunkWriter::writeChunk(const hsize_t offset[3], const hsize_t counts[3])
+{
+   Chunk& chunk = mChunks[mPendingChunks];
+   if (mFilterChunks == false)
+   {
+      Hdf5DataSpaceResource memorySpace(H5Screate_simple(3, counts, NULL));
+      ICEVERIFY(*memorySpace >= 0);
+
+      herr_t status = H5Sselect_hyperslab(*mFileSpace, H5S_SELECT_SET, offset, NULL, counts, NULL);
+      ICEVERIFY(status >= 0);
+
+      status = H5Dwrite(mDataSet, mMemoryType, *memorySpace, *mFileSpace, H5P_DEFAULT, &chunk.mData.front());
+      ICEVERIFY(status >= 0);
+      return;
+   }
+
+   for (int i = 0; i < 3; ++i)
+   {
+      chunk.mOffset[i] = offset[i];
+      chunk.mCounts[i] = counts[i];
+   }
+
+   if (++mPendingChunks == mChunks.size())
+   {
+      flush();
+   }
+}
+
+void IceChunkWriter::flush()
+{
+   if (mPendingChunks == 0)
+   {
+      return;
+   }
+
+#if defined(ICE_DIRECT_CHUNK_WRITE)
+   FilterInput input;
+   input.mpChunks = &mChunks;
+   input.mNumChunks = mPendingChunks;
+   input.mpSettings = &mSettings;
+
+   FilterOutput output;
+   mta::MultiThreadedAlgorithm<FilterInput, FilterOutput, FilterThread>
+      alg(mta::getNumRequiredThreads(mPendingChunks), input, output, NULL);
+   ICEVERIFY_MSG(alg.run() == mta::SUCCESS, "Unable to compress the cube data.");
+
+   // HDF5 is not thread safe, so the compressed chunks are written from this thread in order
+   for (unsigned int i = 0; i < mPendingChunks; ++i)
+   {
+      Chunk& chunk = mChunks[i];
+      herr_t status = H5Dwrite_chunk(mDataSet, H5P_DEFAULT, 0, chunk.mOffset, chunk.mFilteredSize,
+         &chunk.mFiltered.front());
+      ICEVERIFY(status >= 0);
+   }
+#endif
+
+   mPendingChunks = 0;
+}
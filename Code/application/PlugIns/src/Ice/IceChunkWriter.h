@@ -0,0 +1,100 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2011 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef ICECHUNKWRITER_H
+#define ICECHUNKWRITER_H
+
+#include "Hdf5Resource.h"
+
+#include <hdf5.h>
+#include <vector>
+
+/**
+ * Writes a three dimensional chunked data set one chunk at a time.
+ *
+ * The caller fills the buffer returned by getBuffer() and passes the location of the data to writeChunk().
+ * When the data set is compressed with only the shuffle and deflate filters and the HDF5 library supports
+ * direct chunk writes, chunks are collected into batches which are filtered on several threads and written
+ * to the file already compressed.  The filters are applied exactly as HDF5 applies them, so the file has
+ * the same layout and filters as one written with H5Dwrite().  Otherwise each chunk is written with
+ * H5Dwrite() as it is passed to writeChunk().
+ */
+class IceChunkWriter
+{
+public:
+   /**
+    * Creates a writer for a data set.
+    *
+    * @param dataSet
+    *        The data set to write.  It must be chunked and have three dimensions.
+    * @param memoryType
+    *        The type of the data in the chunk buffers.
+    */
+   IceChunkWriter(hid_t dataSet, hid_t memoryType);
+
+   /**
+    * Gets the buffer for the next chunk.
+    *
+    * The buffer is large enough for a full chunk.  Data is packed in the order of the data set's
+    * dimensions using the counts which will be passed to writeChunk().
+    *
+    * @return The buffer for the next chunk.
+    */
+   char* getBuffer();
+
+   /**
+    * Writes the data in the buffer returned by getBuffer().
+    *
+    * The data may be held until the rest of its batch is available, so the buffer must not be
+    * used after this is called.
+    *
+    * @param offset
+    *        The location of the chunk in the data set, which must be a multiple of the chunk size.
+    * @param counts
+    *        The size of the data in the buffer, which is only less than the chunk size at the edges of the data set.
+    */
+   void writeChunk(const hsize_t offset[3], const hsize_t counts[3]);
+
+   /**
+    * Writes any chunks which have not been written.  This must be called after the last chunk is written.
+    */
+   void flush();
+
+   struct Chunk
+   {
+      hsize_t mOffset[3];
+      hsize_t mCounts[3];
+      std::vector<char> mData;
+      std::vector<char> mScratch;
+      std::vector<char> mFiltered;
+      size_t mFilteredSize;
+   };
+
+   struct FilterSettings
+   {
+      hsize_t mChunkDims[3];
+      size_t mElementSize;
+      bool mShuffle;
+      int mDeflateLevel;
+   };
+
+private:
+   IceChunkWriter(const IceChunkWriter& rhs);
+   IceChunkWriter& operator=(const IceChunkWriter& rhs);
+
+   hid_t mDataSet;
+   hid_t mMemoryType;
+   Hdf5DataSpaceResource mFileSpace;
+   bool mFilterChunks;
+   FilterSettings mSettings;
+   std::vector<Chunk> mChunks;
+   unsigned int mPendingChunks;
+};
+
+#endif
@@ -10,13 +10,11 @@
 #include "AppVersion.h"
 #include "Classification.h"
 #include "ColorType.h"
-#include "DataAccessor.h"
-#include "DataAccessorImpl.h"
-#include "DataRequest.h"
 #include "DimensionDescriptor.h"
 #include "DynamicObject.h"
 #include "Hdf5IncrementalWriter.h"
 #include "Hdf5Utilities.h"
+#include "IceChunkWriter.h"
 #include "IceWriter.h"
 #include "Layer.h"
 #include "ObjectResource.h"
@@ -25,6 +23,7 @@
 #include "RasterDataDescriptor.h"
 #include "RasterElement.h"
 #include "RasterFileDescriptor.h"
+#include "RasterSubsetReader.h"
 #include "RasterUtilities.h"
 #include "SpecialMetadata.h"
 #include "Statistics.h"
@@ -558,10 +557,6 @@ void IceWriter::writeBilCubeData(const std::string& hdfPath,
    const vector<DimensionDescriptor>& rows = pOutputFileDescriptor->getRows();
    const vector<DimensionDescriptor>& cols = pOutputFileDescriptor->getColumns();
 
-   const vector<DimensionDescriptor>& cubeBands = pDescriptor->getBands();
-   const vector<DimensionDescriptor>& cubeRows = pDescriptor->getRows();
-   const vector<DimensionDescriptor>& cubeCols = pDescriptor->getColumns();
-
    unsigned int bpe = pDescriptor->getBytesPerElement();
 
    ICEVERIFY_MSG(!rows.empty() && !cols.empty() && !bands.empty(), "No data selected for export.")
@@ -592,28 +587,15 @@ void IceWriter::writeBilCubeData(const std::string& hdfPath,
    compSpace[0] = rowsInChunk;
 
    createDatasetForCube(dimSpace, compSpace, pDescriptor->getDataType(), mFileHandle, hdfPath, dataId);
-   Hdf5DataSpaceResource dspaceId(H5Dget_space(*dataId));
-   ICEVERIFY(*dspaceId >= 0);
    Hdf5TypeResource hdfEncoding(H5Dget_type(*dataId));
    ICEVERIFY(*hdfEncoding >= 0);
 
-   FactoryResource<DataRequest> pRequest;
-   pRequest->setInterleaveFormat(BIL);
-   pRequest->setRows(rows.front(), rows.back());
-   DataAccessor da = pCube->getDataAccessor(pRequest.release());
-   ICEVERIFY(da.isValid());
-
-   bool bEntireRow = (cubeCols.size() == cols.size()) && (cubeBands.size() == bands.size());
-
-   vector<char> pWriteBufferRes(rowsInChunk*rowSize, 0);
-   char* pWriteBuffer = &pWriteBufferRes.front();
+   RasterSubsetReader reader(pCube, rows, cols, bands, BIL);
+   IceChunkWriter chunkWriter(*dataId, *hdfEncoding);
 
    counts[0] = rowsInChunk;
    counts[1] = bands.size();
    counts[2] = cols.size();
-
-   Hdf5DataSpaceResource mspaceId(H5Screate_simple(3, counts, NULL));
-   ICEVERIFY(*mspaceId >= 0);
    offset[1] = offset[2] = 0; // reset to beginning of rows and bands
 
    unsigned int numChunks = rows.size() / rowsInChunk;
@@ -624,108 +606,30 @@ void IceWriter::writeBilCubeData(const std::string& hdfPath,
 
    abortIfNecessary();
 
-   int rowIndex = 0;
-   if (bEntireRow)
+   for (unsigned int chunkNumber = 0; chunkNumber < numChunks; ++chunkNumber)
    {
-      for (unsigned int chunkNumber = 0; chunkNumber < numChunks; ++chunkNumber)
+      unsigned int startChunkRow = chunkNumber * rowsInChunk;
+      unsigned int endChunkRow = (chunkNumber + 1) * rowsInChunk;
+      if (endChunkRow > rows.size())
       {
-         unsigned int startChunkRow = chunkNumber * rowsInChunk;
-         unsigned int endChunkRow = (chunkNumber + 1) * rowsInChunk;
-         if (endChunkRow > rows.size())
-         {
-            endChunkRow = rows.size();
-         }
-
-         char* pBuffer = pWriteBuffer;
-         for (unsigned int rowCount = startChunkRow; rowCount < endChunkRow; ++rowCount)
-         {
-            if (pProgress != NULL)
-            {
-               pProgress->updateProgress("Exporting cube...",
-                  (rowIndex++ * 100) / rows.size(), NORMAL);
-            }
-
-            unsigned int rowActiveNum = rows[rowCount].getActiveNumber();
-            da->toPixel(rowActiveNum, 0);
-            ICEVERIFY(da.isValid());
-            memcpy(pBuffer, da->getRow(), rowSize);
-            pBuffer += rowSize;
-
-            abortIfNecessary();
-         }
-
-         offset[0] = startChunkRow;
-
-         if (chunkNumber + 1 == numChunks)
-         {
-            counts[0] = endChunkRow - startChunkRow;
-            mspaceId = Hdf5DataSpaceResource(H5Screate_simple(3, counts, NULL));
-            ICEVERIFY(*mspaceId >= 0);
-         }
-
-         herr_t status = H5Sselect_hyperslab(*dspaceId, H5S_SELECT_SET, offset, NULL, counts, NULL);
-         ICEVERIFY(status >= 0);
-
-         status = H5Dwrite(*dataId, *hdfEncoding, *mspaceId, *dspaceId, H5P_DEFAULT, pWriteBuffer);
-         ICEVERIFY(status >= 0);
+         endChunkRow = rows.size();
       }
-   }
-   else
-   {
-      unsigned int totalColumns = cubeCols.size();
-      for (unsigned int chunkNumber = 0; chunkNumber < numChunks; ++chunkNumber)
-      {
-         unsigned int startChunkRow = chunkNumber * rowsInChunk;
-         unsigned int endChunkRow = (chunkNumber + 1) * rowsInChunk;
-         if (endChunkRow > rows.size())
-         {
-            endChunkRow = rows.size();
-         }
 
-         char* pBuffer = pWriteBuffer;
-         for (unsigned int rowCount = startChunkRow; rowCount < endChunkRow; ++rowCount)
-         {
-            if (pProgress != NULL)
-            {
-               pProgress->updateProgress("Exporting cube...",
-                  (rowIndex++ * 100) / rows.size(), NORMAL);
-            }
-
-            unsigned int rowActiveNum = rows[rowCount].getActiveNumber();
-            da->toPixel(rowActiveNum, 0);
-            ICEVERIFY(da.isValid());
-            
-            for (unsigned int bandCount = 0; bandCount < bands.size(); ++bandCount)
-            {
-               unsigned int bandActiveNum = bands[bandCount].getActiveNumber();
-               for (unsigned int colCount = 0; colCount < cols.size(); ++colCount)
-               {
-                  unsigned int colActiveNum = cols[colCount].getActiveNumber();
-                  memcpy(pBuffer, static_cast<char*>(da->getColumn()) +
-                     (bandActiveNum * totalColumns * bpe) + (colActiveNum * bpe), bpe);
-                  pBuffer += bpe;
-               }
-            }
-
-            abortIfNecessary();
-         }
+      if (pProgress != NULL)
+      {
+         pProgress->updateProgress("Exporting cube...", (startChunkRow * 100) / rows.size(), NORMAL);
+      }
 
-         offset[0] = startChunkRow;
+      ICEVERIFY(reader.read(startChunkRow, endChunkRow - startChunkRow, chunkWriter.getBuffer()));
 
-         if (chunkNumber + 1 == numChunks)
-         {
-            counts[0] = endChunkRow - startChunkRow;
-            mspaceId = Hdf5DataSpaceResource(H5Screate_simple(3, counts, NULL));
-            ICEVERIFY(*mspaceId >= 0);
-         }
+      offset[0] = startChunkRow;
+      counts[0] = endChunkRow - startChunkRow;
+      chunkWriter.writeChunk(offset, counts);
 
-         herr_t status = H5Sselect_hyperslab(*dspaceId, H5S_SELECT_SET, offset, NULL, counts, NULL);
-         ICEVERIFY(status >= 0);
-
-         status = H5Dwrite(*dataId, *hdfEncoding, *mspaceId, *dspaceId, H5P_DEFAULT, pWriteBuffer);
-         ICEVERIFY(status >= 0);
-      }
+      abortIfNecessary();
    }
+
+   chunkWriter.flush();
 }
 
 void IceWriter::writeBipCubeData(const string& hdfPath,
@@ -740,10 +644,6 @@ void IceWriter::writeBipCubeData(const string& hdfPath,
    const vector<DimensionDescriptor>& rows = pOutputFileDescriptor->getRows();
    const vector<DimensionDescriptor>& cols = pOutputFileDescriptor->getColumns();
 
-   const vector<DimensionDescriptor>& cubeBands = pDescriptor->getBands();
-   const vector<DimensionDescriptor>& cubeRows = pDescriptor->getRows();
-   const vector<DimensionDescriptor>& cubeCols = pDescriptor->getColumns();
-
    unsigned int bpe = pDescriptor->getBytesPerElement();
 
    ICEVERIFY_MSG(!rows.empty() && !cols.empty() && !bands.empty(), "No data selected for export.")
@@ -776,28 +676,15 @@ void IceWriter::writeBipCubeData(const string& hdfPath,
    compSpace[0] = rowsInChunk;
 
    createDatasetForCube(dimSpace, compSpace, pDescriptor->getDataType(), mFileHandle, hdfPath, dataId );
-   Hdf5DataSpaceResource dspaceId(H5Dget_space(*dataId));
-   ICEVERIFY(*dspaceId >= 0);
    Hdf5TypeResource hdfEncoding(H5Dget_type(*dataId));
    ICEVERIFY(*hdfEncoding >= 0);
 
-   FactoryResource<DataRequest> pRequest;
-   pRequest->setInterleaveFormat(BIP);
-   pRequest->setRows(rows.front(), rows.back());
-   DataAccessor da = pCube->getDataAccessor(pRequest.release());
-   ICEVERIFY(da.isValid());
-
-   bool bEntireRow = (cubeCols.size() == cols.size()) && (cubeBands.size() == bands.size());
-
-   vector<char> pWriteBufferRes(rowsInChunk*rowSize, 0);
-   char* pWriteBuffer = &pWriteBufferRes.front();
+   RasterSubsetReader reader(pCube, rows, cols, bands, BIP);
+   IceChunkWriter chunkWriter(*dataId, *hdfEncoding);
 
    counts[0] = rowsInChunk;
    counts[1] = cols.size();
    counts[2] = bands.size();
-
-   Hdf5DataSpaceResource mspaceId(H5Screate_simple(3, counts, NULL));
-   ICEVERIFY(*mspaceId >= 0);
    offset[1] = 0;
    offset[2] = 0; // reset to beginning of rows and bands
 
@@ -809,109 +696,30 @@ void IceWriter::writeBipCubeData(const string& hdfPath,
 
    abortIfNecessary();
 
-   int rowIndex = 0;
-   if (bEntireRow)
+   for (unsigned int chunkNumber = 0; chunkNumber < numChunks; ++chunkNumber)
    {
-      for (unsigned int chunkNumber = 0; chunkNumber < numChunks; ++chunkNumber)
+      unsigned int startChunkRow = chunkNumber * rowsInChunk;
+      unsigned int endChunkRow = (chunkNumber + 1) * rowsInChunk;
+      if (endChunkRow > rows.size())
       {
-         unsigned int startChunkRow = chunkNumber * rowsInChunk;
-         unsigned int endChunkRow = (chunkNumber + 1) * rowsInChunk;
-         if (endChunkRow > rows.size())
-         {
-            endChunkRow = rows.size();
-         }
-
-         char* pBuffer = pWriteBuffer;
-         for (unsigned int rowCount = startChunkRow; rowCount < endChunkRow; ++rowCount)
-         {
-            if (pProgress != NULL)
-            {
-               pProgress->updateProgress("Exporting cube...",
-                  (rowIndex++ * 100) / rows.size(), NORMAL);
-            }
-
-            unsigned int rowActiveNum = rows[rowCount].getActiveNumber();
-            da->toPixel( rowActiveNum, 0 );
-            ICEVERIFY(da.isValid());
-            memcpy(pBuffer, da->getRow(), rowSize);
-            pBuffer += rowSize;
-            
-            abortIfNecessary();
-         }
-
-         offset[0] = startChunkRow;
-
-         if (chunkNumber + 1 == numChunks)
-         {
-            counts[0] = endChunkRow - startChunkRow;
-            mspaceId = Hdf5DataSpaceResource(H5Screate_simple(3, counts, NULL));
-            ICEVERIFY(*mspaceId >= 0);
-         }
-
-         herr_t status = H5Sselect_hyperslab(*dspaceId, H5S_SELECT_SET, offset, NULL, counts, NULL);
-         ICEVERIFY(status >= 0);
-
-         status = H5Dwrite(*dataId, *hdfEncoding, *mspaceId, *dspaceId, H5P_DEFAULT, pWriteBuffer);
-         ICEVERIFY(status >= 0);
-
-
+         endChunkRow = rows.size();
       }
-   }
-   else
-   {
-      for (unsigned int chunkNumber = 0; chunkNumber < numChunks; ++chunkNumber)
-      {
-         unsigned int startChunkRow = chunkNumber * rowsInChunk;
-         unsigned int endChunkRow = (chunkNumber + 1) * rowsInChunk;
-         if (endChunkRow > rows.size())
-         {
-            endChunkRow = rows.size();
-         }
-
-         char* pBuffer = pWriteBuffer;
-         for (unsigned int rowCount = startChunkRow; rowCount < endChunkRow; ++rowCount)
-         {
-            if (pProgress != NULL)
-            {
-               pProgress->updateProgress("Exporting cube...",
-                  (rowIndex++ * 100) / rows.size(), NORMAL);
-            }
 
-            for (unsigned int colCount = 0; colCount < cols.size(); ++colCount)
-            {
-               unsigned int rowActiveNum = rows[rowCount].getActiveNumber();
-               unsigned int colActiveNum = cols[colCount].getActiveNumber();
-               da->toPixel( rowActiveNum, colActiveNum );
-               ICEVERIFY(da.isValid());
-
-               for (unsigned int bandCount = 0; bandCount < bands.size(); ++bandCount)
-               {
-                  unsigned int bandActiveNum = bands[bandCount].getActiveNumber();
-                  memcpy(pBuffer,
-                     static_cast<char*>(da->getColumn())+(bandActiveNum*bpe), bpe);
-                  pBuffer += bpe;
-               }
-            }
-
-            abortIfNecessary();
-         }
-
-         offset[0] = startChunkRow;
+      if (pProgress != NULL)
+      {
+         pProgress->updateProgress("Exporting cube...", (startChunkRow * 100) / rows.size(), NORMAL);
+      }
 
-         if (chunkNumber + 1 == numChunks)
-         {
-            counts[0] = endChunkRow - startChunkRow;
-            mspaceId = Hdf5DataSpaceResource(H5Screate_simple(3, counts, NULL));
-            ICEVERIFY(*mspaceId >= 0);
-         }
+      ICEVERIFY(reader.read(startChunkRow, endChunkRow - startChunkRow, chunkWriter.getBuffer()));
 
-         herr_t status = H5Sselect_hyperslab(*dspaceId, H5S_SELECT_SET, offset, NULL, counts, NULL);
-         ICEVERIFY(status >= 0);
+      offset[0] = startChunkRow;
+      counts[0] = endChunkRow - startChunkRow;
+      chunkWriter.writeChunk(offset, counts);
 
-         status = H5Dwrite(*dataId, *hdfEncoding, *mspaceId, *dspaceId, H5P_DEFAULT, pWriteBuffer);
-         ICEVERIFY(status >= 0);
-      }
+      abortIfNecessary();
    }
+
+   chunkWriter.flush();
 }
 
 void IceWriter::writeBsqCubeData(const string& hdfPath,
@@ -926,10 +734,6 @@ void IceWriter::writeBsqCubeData(const string& hdfPath,
    const vector<DimensionDescriptor>& rows = pOutputFileDescriptor->getRows();
    const vector<DimensionDescriptor>& cols = pOutputFileDescriptor->getColumns();
 
-   const vector<DimensionDescriptor>& cubeBands = pDescriptor->getBands();
-   const vector<DimensionDescriptor>& cubeRows = pDescriptor->getRows();
-   const vector<DimensionDescriptor>& cubeCols = pDescriptor->getColumns();
-
    unsigned int bpe = pDescriptor->getBytesPerElement();
 
    ICEVERIFY_MSG(!rows.empty() && !cols.empty() && !bands.empty(), "No data selected for export.")
@@ -965,42 +769,24 @@ void IceWriter::writeBsqCubeData(const string& hdfPath,
    counts[1] = rowsInChunk;
 
    createDatasetForCube(dimSpace, compSpace, pDescriptor->getDataType(), mFileHandle, hdfPath, dataId);
-   Hdf5DataSpaceResource dSpaceId(H5Dget_space(*dataId));
-   ICEVERIFY(*dSpaceId >= 0);
    Hdf5TypeResource hdfEncoding(H5Dget_type(*dataId));
    ICEVERIFY(*hdfEncoding >= 0);
 
-   bool bEntireRow = (cubeCols.size() == cols.size());
-
-   vector<char> pWriteBufferRes(rowsInChunk*rowSize, 0);
-   char* pWriteBuffer = &pWriteBufferRes.front();
-
-   Hdf5DataSpaceResource mspaceId(H5Screate_simple(3, counts, NULL));
-   ICEVERIFY(*mspaceId >= 0);
+   RasterSubsetReader reader(pCube, rows, cols, bands, BSQ);
+   IceChunkWriter chunkWriter(*dataId, *hdfEncoding);
 
    unsigned int numChunks = rows.size() / rowsInChunk;
    if (rows.size() % rowsInChunk != 0)
    {
       numChunks++;
-      counts[1] = (rows.size() % rowsInChunk);
    }
-   Hdf5DataSpaceResource lastChunkWriteId(H5Screate_simple(3, counts, NULL));
 
    abortIfNecessary();
 
    offset[2] = 0; //always write out a whole row
-   int rowIndex = 0;
    for (unsigned int bandCount = 0; bandCount < bands.size(); ++bandCount)
    {
       offset[0] = bandCount;
-
-      // BSQ the slow way
-      FactoryResource<DataRequest> pRequest;
-      pRequest->setInterleaveFormat(BSQ);
-      pRequest->setBands(bands[bandCount], bands[bandCount]);
-      DataAccessor da = pCube->getDataAccessor(pRequest.release());
-      ICEVERIFY(da.isValid());
-
       for (unsigned int chunkNumber = 0; chunkNumber < numChunks; ++chunkNumber)
       {
          unsigned int startChunkRow = chunkNumber * rowsInChunk;
@@ -1010,45 +796,23 @@ void IceWriter::writeBsqCubeData(const string& hdfPath,
             endChunkRow = rows.size();
          }
 
-         char* pBuffer = pWriteBuffer;
-         for (unsigned int rowCount = startChunkRow; rowCount < endChunkRow; ++rowCount)
+         if (pProgress != NULL)
          {
-            if (pProgress != NULL)
-            {
-               pProgress->updateProgress("Exporting cube...",
-                  (rowIndex++ * 100) / (bands.size() * rows.size()), NORMAL);
-            }
-
-            unsigned int rowActiveNum = rows[rowCount].getActiveNumber();
-            for (unsigned int colCount = 0; colCount < cols.size(); ++colCount)
-            {
-               unsigned int colActiveNum = cols[colCount].getActiveNumber();
-               da->toPixel(rowActiveNum, colActiveNum);
-               ICEVERIFY(da.isValid());
-
-               memcpy(pBuffer, da->getColumn(), bpe);
-               pBuffer += bpe;
-            }
-
-            abortIfNecessary();
+            pProgress->updateProgress("Exporting cube...",
+               ((bandCount * rows.size() + startChunkRow) * 100) / (bands.size() * rows.size()), NORMAL);
          }
 
+         ICEVERIFY(reader.read(startChunkRow, endChunkRow - startChunkRow, bandCount, 1, chunkWriter.getBuffer()));
+
          offset[1] = startChunkRow;
          counts[1] = endChunkRow - startChunkRow;
+         chunkWriter.writeChunk(offset, counts);
 
-         hid_t memorySpace = *mspaceId;
-         if (chunkNumber + 1 == numChunks)
-         {
-            memorySpace = *lastChunkWriteId;
-         }
-
-         herr_t status = H5Sselect_hyperslab(*dSpaceId, H5S_SELECT_SET, offset, NULL, counts, NULL);
-         ICEVERIFY(status >= 0);
-
-         status = H5Dwrite(*dataId, *hdfEncoding, memorySpace, *dSpaceId, H5P_DEFAULT, pWriteBuffer);
-         ICEVERIFY(status >= 0);
+         abortIfNecessary();
       }
    }
+
+   chunkWriter.flush();
 }
 
 void IceWriter::createDatasetForCube(hsize_t dimSpace[3],
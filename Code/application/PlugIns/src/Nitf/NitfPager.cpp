@@ -44,7 +44,9 @@ Nitf::Pager::Pager() :
 }
 
 Nitf::Pager::~Pager()
-{}
+{
+   stopReadAhead();
+}
 
 bool Nitf::Pager::getInputSpecification(PlugInArgList*& pArgList)
 {
@@ -58,6 +60,11 @@ bool Nitf::Pager::parseInputArgs(PlugInArgList* pInputArgList)
       pInputArgList != NULL && pInputArgList->getPlugInArgValue<int>("Segment Number", mSegment));
 }
 
+unsigned int Nitf::Pager::getReadAheadDepth() const
+{
+   return CachedPager::getSettingReadAheadDepth();
+}
+
 bool Nitf::Pager::openFile(const string& filename)
 {
    mpImageHandler = Nitf::OssimImageHandlerResource(filename);
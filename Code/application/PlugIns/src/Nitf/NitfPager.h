@@ -30,6 +30,9 @@ namespace Nitf
 
       bool parseInputArgs(PlugInArgList* pInputArgList);
 
+   protected:
+      unsigned int getReadAheadDepth() const;
+
    private:
       /**
        *  This method should be implemented to open the file and store a file handle to be
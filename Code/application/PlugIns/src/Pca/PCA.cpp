@@ -25,6 +25,7 @@
 #include "FileResource.h"
 #include "MatrixFunctions.h"
 #include "MessageLogResource.h"
+#include "MultiThreadedAlgorithm.h"
 #include "ObjectResource.h"
 #include "PCA.h"
 #include "PcaDlg.h"
@@ -42,6 +43,7 @@
 #include "switchOnEncoding.h"
 #include "Undo.h"
 
+#include <algorithm>
 #include <fstream>
 #include <limits>
 #include <math.h>
@@ -49,418 +51,395 @@
 using namespace std;
 
 template<class T>
-T *GetPixelPtr(T *raw, int numCols, int numBands, int row, int col)
+void ComputePcaValue(T *pData, double* pPcaValue, double *pCoefficients, unsigned int numBands)
 {
-   return raw + numBands * (row *numCols + col);
-}
+   T* pInput = pData;
+   double* pCoef = pCoefficients;
+   *pPcaValue = 0.0;
 
-template<class T>
-void ComputeFactoredCov(T *pData, RasterElement* pRaster, double **pMatrix,
-                        Progress *pProgress, const bool *pAbortFlag,
-                        int rowFactor, int columnFactor)
-{
-   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(pRaster->getDataDescriptor());
-   if (pDescriptor == NULL)
+   for (unsigned int i = 0; i < numBands; ++i)
    {
-      return;
+      *pPcaValue += static_cast<double>(*pInput) * (*pCoef);
+      ++pInput;
+      ++pCoef;
    }
+}
 
-   unsigned int numRows = pDescriptor->getRowCount();
-   unsigned int numCols = pDescriptor->getColumnCount();
-   unsigned int numBands = pDescriptor->getBandCount();
-   unsigned int row, col;
-   unsigned int band1, band2;
-   unsigned int lCount = 0;
-   T *pPixel = NULL;
-   vector<double> averages(numBands, 0);
-   double* pAverage = &averages.front();
-
-   if (rowFactor < 1)
-   {
-      rowFactor = 1;
-   }
-   if (columnFactor < 1)
+template <class T>
+void ConvertPcaPixels(T* pData, double* pPixels, unsigned int numValues)
+{
+   for (unsigned int i = 0; i < numValues; ++i)
    {
-      columnFactor = 1;
+      pPixels[i] = static_cast<double>(pData[i]);
    }
+}
 
-   // calculate average spectrum
-   float progScale = 100.0f * static_cast<float>(rowFactor)/static_cast<float>(numRows);
-   FactoryResource<DataRequest> pRequest;
-   pRequest->setInterleaveFormat(BIP);
-   DataAccessor accessor = pRaster->getDataAccessor(pRequest.release());
-   for (row = 0; row < numRows; row += rowFactor)
+// Intended for use with integer data types -- adds 0.5 for rounding.
+template <class T>
+void StorePcaRow(T* pPcaData, const double* pCompValues, unsigned int numCols, unsigned int numComponents,
+   const double* pMinValues, const double* pScaleFactors, int minOutputVal)
+{
+   for (unsigned int col = 0; col < numCols; ++col)
    {
-      VERIFYNRV(accessor.isValid());
-      if (pProgress != NULL)
+      for (unsigned int comp = 0; comp < numComponents; ++comp)
       {
-         if ((pAbortFlag == NULL) || !(*pAbortFlag))
-         {
-            pProgress->updateProgress ("Computing Average Signature...", int(progScale*row), NORMAL);
-         }
-         else
-         {
-            break;
-         }
+         *pPcaData = static_cast<T>(static_cast<int64_t>((*pCompValues - pMinValues[comp]) * pScaleFactors[comp] + 0.5)
+            + minOutputVal);
+         ++pCompValues;
+         ++pPcaData;
       }
-      for (col = 0; col < numCols; col += columnFactor)
-      {
-         ++lCount;
-         pPixel = reinterpret_cast<T*>(accessor->getColumn());
+   }
+}
 
-         for (band1 = 0; band1 < numBands; ++band1)
-         {
-            pAverage[band1] += *pPixel;
-            ++pPixel;
-         }
-         accessor->nextColumn();
+template <>
+void StorePcaRow<float>(float* pPcaData, const double* pCompValues, unsigned int numCols, unsigned int numComponents,
+   const double* pMinValues, const double* pScaleFactors, int minOutputVal)
+{
+   for (unsigned int col = 0; col < numCols; ++col)
+   {
+      for (unsigned int comp = 0; comp < numComponents; ++comp)
+      {
+         *pPcaData = static_cast<float>((*pCompValues - pMinValues[comp]) * pScaleFactors[comp] + minOutputVal);
+         ++pCompValues;
+         ++pPcaData;
       }
-      accessor->nextRow();
    }
+}
 
-   // check if aborted
-   if ((pAbortFlag == NULL) || !(*pAbortFlag))
+template <>
+void StorePcaRow<double>(double* pPcaData, const double* pCompValues, unsigned int numCols,
+   unsigned int numComponents, const double* pMinValues, const double* pScaleFactors, int minOutputVal)
+{
+   for (unsigned int col = 0; col < numCols; ++col)
    {
-      for (band1 = 0; band1 < numBands; ++band1)
+      for (unsigned int comp = 0; comp < numComponents; ++comp)
       {
-         pAverage[band1] /= lCount;
+         *pPcaData = (*pCompValues - pMinValues[comp]) * pScaleFactors[comp] + minOutputVal;
+         ++pCompValues;
+         ++pPcaData;
       }
+   }
+}
 
-      // compute the covariance
-      FactoryResource<DataRequest> pRequest2;
-      pRequest2->setInterleaveFormat(BIP);
-      accessor = pRaster->getDataAccessor(pRequest2.release());
+// Intended for use with integer data types -- adds 0.5 for rounding.
+template <class T>
+void StorePcaValue(T* pPcaData, double* pValue, double* pMinVal, double* pScaleFactor, int* pMinOutputVal)
+{
+   *pPcaData = static_cast<T>(static_cast<int64_t>((*pValue - *pMinVal) * (*pScaleFactor) + 0.5) + *pMinOutputVal);
+}
 
-      for (row = 0; row < numRows; row += rowFactor)
-      {
-         VERIFYNRV(accessor.isValid());
-         if (pProgress != NULL)
-         {
-            if ((pAbortFlag == NULL) || !(*pAbortFlag))
-            {
-               pProgress->updateProgress("Computing Covariance Matrix...", int(progScale * row), NORMAL);
-            }
-            else
-            {
-               break;
-            }
-         }
-         for (col = 0; col < numCols; col += columnFactor)
-         {
-            pPixel = reinterpret_cast<T*>(accessor->getColumn());
+template <>
+void StorePcaValue<float>(float* pPcaData, double* pValue, double* pMinVal, double* pScaleFactor, int* pMinOutputVal)
+{
+   *pPcaData = static_cast<float>((*pValue - *pMinVal) * (*pScaleFactor) + *pMinOutputVal);
+}
 
-            for (band2 = 0; band2 < numBands; ++band2)
+template <>
+void StorePcaValue<double>(double* pPcaData, double* pValue, double* pMinVal, double* pScaleFactor, int* pMinOutputVal)
+{
+   *pPcaData = static_cast<double>((*pValue - *pMinVal) * (*pScaleFactor) + *pMinOutputVal);
+}
+
+namespace
+{
+   // Pixels are converted to double and projected in blocks of this many pixels
+   const unsigned int PCA_BLOCK_PIXELS = 64;
+
+   // The projection walks the coefficients this many bands at a time so they stay in the cache for a block
+   const unsigned int PCA_BAND_TILE = 64;
+
+   /**
+    * Projects a block of pixels onto the components.
+    *
+    * This is the matrix product of the numPixels x numBands block and the numBands x numComponents
+    * coefficients.  The innermost loop runs over the components of one pixel, so it can be vectorized.
+    */
+   void ProjectPcaBlock(const double* pPixels, const double* pCoefficients, double* pPcaData,
+      unsigned int numPixels, unsigned int numBands, unsigned int numComponents)
+   {
+      fill(pPcaData, pPcaData + numPixels * numComponents, 0.0);
+      for (unsigned int bandTile = 0; bandTile < numBands; bandTile += PCA_BAND_TILE)
+      {
+         const unsigned int bandEnd = min(bandTile + PCA_BAND_TILE, numBands);
+         for (unsigned int pixel = 0; pixel < numPixels; ++pixel)
+         {
+            const double* pPixel = pPixels + pixel * numBands;
+            double* pValues = pPcaData + pixel * numComponents;
+            for (unsigned int band = bandTile; band < bandEnd; ++band)
             {
-               pData = pPixel;
-               for (band1 = band2; band1 < numBands; ++band1)
+               const double value = pPixel[band];
+               const double* pCoef = pCoefficients + band * numComponents;
+               for (unsigned int comp = 0; comp < numComponents; ++comp)
                {
-                  pMatrix[band2][band1] += (*pData - pAverage[band1]) * (*pPixel - pAverage[band2]);
-                  ++pData;
+                  pValues[comp] += value * pCoef[comp];
                }
-               ++pPixel;
             }
-            accessor->nextColumn();
          }
-         accessor->nextRow();
       }
    }
 
-   // check if aborted
-   if ((pAbortFlag == NULL) || !(*pAbortFlag))
+   struct PcaInput
    {
-      for (band2 = 0; band2 < numBands; ++band2)
-      {
-         for (band1 = band2; band1 < numBands; ++band1)
-         {
-            pMatrix[band2][band1] /= lCount;
-         }
-      }
+      RasterElement* mpRaster;
+      RasterElement* mpPcaRaster;
+      EncodingType mDataType;
+      unsigned int mBytesPerElement;
+      unsigned int mNumRows;
+      unsigned int mNumColumns;
+      unsigned int mNumBands;
+      unsigned int mNumComponents;
+      const double* mpCoefficients;
+      EncodingType mOutputDataType;
+      unsigned int mOutputBytesPerElement;
+      const double* mpMinValues;
+      const double* mpScaleFactors;
+      int mMinOutputValue;
+      const bool* mpAbortFlag;
+   };
 
-      for (band2 = 0; band2 < numBands; ++band2)
-      {
-         for (band1 = band2 + 1; band1 < numBands; ++band1)
-         {
-            pMatrix[band1][band2] = pMatrix[band2][band1];
-         }
-      }
-   }
-
-   if (pProgress != NULL)
+   /**
+    * Finds the range of every component for a contiguous block of rows, reading each source row once.
+    * The component values are not kept, so PcaScaleThread projects the rows again.
+    */
+   class PcaProjectionThread : public mta::AlgorithmThread
    {
-      if ((pAbortFlag == NULL) || !(*pAbortFlag))
-      {
-         pProgress->updateProgress("Covariance Matrix Complete", 100, NORMAL);
-      }
-      else
-      {
-         pProgress->updateProgress("Aborted computing Covariance Matrix", 0, ABORT);
-      }
-   }
-}
+   public:
+      PcaProjectionThread(const PcaInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter);
+      void run();
 
-struct MaskInput
-{
-   RasterElement* mpRaster;
-   double** mpMatrix;
-   Progress* mpProgress;
-   const bool* mpAbortFlag;
-   const BitMask* mpMask;
-};
+      const vector<double>& getMinValues() const;
+      const vector<double>& getMaxValues() const;
 
-template<class T>
-void ComputeMaskedCov(T* pData, MaskInput* pInput)
-{
-   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>
-      (pInput->mpRaster->getDataDescriptor());
-   if (pDescriptor == NULL)
-   {
-      return;
-   }
+   private:
+      const PcaInput& mInput;
+      mta::AlgorithmThread::Range mRowRange;
+      vector<double> mMinValues;
+      vector<double> mMaxValues;
+   };
 
-   unsigned int numBands = pDescriptor->getBandCount();
-   unsigned int band1, band2;
-   unsigned int lCount = 0;
-   vector<double> averages(numBands, 0);
-   double* pAverage = &averages.front();
-   T *pPixel = NULL;
+   struct PcaProjectionOutput
+   {
+      bool compileOverallResults(const vector<PcaProjectionThread*>& threads);
 
-   // calculate average spectrum
-   FactoryResource<DataRequest> pRequest;
-   pRequest->setInterleaveFormat(BIP);
+      vector<double> mMinValues;
+      vector<double> mMaxValues;
+   };
 
-   DataAccessor accessor = pInput->mpRaster->getDataAccessor(pRequest->copy());
-   BitMaskIterator it(pInput->mpMask, pInput->mpRaster);
-   int numPixels = it.getCount();
-   float progScale = 100.0f / numPixels;
-   LocationType loc;
-   pPixel = reinterpret_cast<T*>(accessor->getColumn());
-   int mask = 0;
-   int progSave = 0;
-   if (it == it.end())
+   /**
+    * Projects a contiguous block of rows again and scales the component values into the PCA cube,
+    * all components at once.
+    */
+   class PcaScaleThread : public mta::AlgorithmThread
    {
-      pInput->mpProgress->updateProgress("No pixels Selected", 0, ERRORS);
-   }
+   public:
+      PcaScaleThread(const PcaInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter);
+      void run();
+
+   private:
+      const PcaInput& mInput;
+      mta::AlgorithmThread::Range mRowRange;
+   };
 
-   while (it != it.end())
+   struct PcaScaleOutput
    {
-      if (pInput->mpProgress != NULL &&
-          progSave != static_cast<int>(progScale * mask))
+      bool compileOverallResults(const vector<PcaScaleThread*>&)
       {
-         if ((pInput->mpAbortFlag == NULL) || !(*pInput->mpAbortFlag))
-         {
-            progSave = static_cast<int>(progScale * mask);
-            pInput->mpProgress->updateProgress("Computing Average Signature...",
-               progSave , NORMAL);
-         }
-         else
-         {
-            break;
-         }
+         return true;
       }
-      it.getPixelLocation(loc);
-      accessor->toPixel(loc.mY, loc.mX);
-      VERIFYNRV(accessor.isValid());
-      pPixel = reinterpret_cast<T*>(accessor->getColumn());
-      ++lCount;
-      for (band1 = 0; band1 < numBands; ++band1)
-      {
-         pAverage[band1] += *pPixel;
-         ++pPixel;
-      }
-      ++it;
-      ++mask;
-   }
+   };
 
-   // check if aborted
-   if ((pInput->mpAbortFlag == NULL) || !(*pInput->mpAbortFlag))
+   PcaProjectionThread::PcaProjectionThread(const PcaInput& input, int threadCount, int threadIndex,
+                                            mta::ThreadReporter& reporter) :
+      mta::AlgorithmThread(threadIndex, reporter),
+      mInput(input),
+      mRowRange(getThreadRange(threadCount, input.mNumRows)),
+      mMinValues(input.mNumComponents, numeric_limits<double>::max()),
+      mMaxValues(input.mNumComponents, -numeric_limits<double>::max())
+   {}
+
+   void PcaProjectionThread::run()
    {
-      for (band1 = 0; band1 < numBands; ++band1)
+      if (mRowRange.mFirst > mRowRange.mLast)
       {
-         pAverage[band1] /= lCount;
+         return;
       }
 
-      // calculate covariance matrix
-      accessor = pInput->mpRaster->getDataAccessor(pRequest->copy());
-      it.firstPixel();
-      mask = 0;
-      unsigned int numPixels = it.getCount();
-      float progScale = 100.0f / numPixels;
-      LocationType loc;
-      progSave = 0;
-      while (it != it.end())
+      const RasterDataDescriptor* pDescriptor =
+         static_cast<const RasterDataDescriptor*>(mInput.mpRaster->getDataDescriptor());
+      FactoryResource<DataRequest> pRequest;
+      pRequest->setInterleaveFormat(BIP);
+      pRequest->setRows(pDescriptor->getActiveRow(mRowRange.mFirst), pDescriptor->getActiveRow(mRowRange.mLast));
+      DataAccessor origAccessor = mInput.mpRaster->getDataAccessor(pRequest.release());
+
+      const unsigned int numBands = mInput.mNumBands;
+      const unsigned int numComponents = mInput.mNumComponents;
+      const unsigned int pixelSize = numBands * mInput.mBytesPerElement;
+      vector<double> pixels(PCA_BLOCK_PIXELS * numBands);
+      vector<double> values(PCA_BLOCK_PIXELS * numComponents);
+      double* pPixels = &pixels.front();
+      double* pValues = &values.front();
+      double* pMinValues = &mMinValues.front();
+      double* pMaxValues = &mMaxValues.front();
+
+      int oldPercentDone = -1;
+      for (int row = mRowRange.mFirst; row <= mRowRange.mLast; ++row)
       {
-         if (pInput->mpProgress != NULL &&
-             progSave != static_cast<int>(progScale * mask))
+         if (*mInput.mpAbortFlag)
          {
-            if ((pInput->mpAbortFlag == NULL) || !(*pInput->mpAbortFlag))
-            {
-               progSave = static_cast<int>(progScale * mask);
-               pInput->mpProgress->updateProgress("Computing Covariance Matrix...",
-                  progSave, NORMAL);
-            }
-            else
-            {
-               break;
-            }
+            return;
          }
-         it.getPixelLocation(loc);
-         accessor->toPixel(loc.mY, loc.mX);
-         VERIFYNRV(accessor.isValid());
-         pPixel = reinterpret_cast<T*>(accessor->getColumn());
-         for (band2 = 0; band2 < numBands; ++band2)
+
+         int percentDone = mRowRange.computePercent(row);
+         if (percentDone > oldPercentDone)
+         {
+            oldPercentDone = percentDone;
+            getReporter().reportProgress(getThreadIndex(), percentDone);
+         }
+
+         if (!origAccessor.isValid())
          {
-            pData = pPixel;
-            for (band1 = band2; band1 < numBands; ++band1)
+            getReporter().reportError("Could not get the pixels in the original cube!");
+            return;
+         }
+
+         char* pOrigRow = reinterpret_cast<char*>(origAccessor->getRow());
+         for (unsigned int startColumn = 0; startColumn < mInput.mNumColumns; startColumn += PCA_BLOCK_PIXELS)
+         {
+            unsigned int count = min(PCA_BLOCK_PIXELS, mInput.mNumColumns - startColumn);
+            void* pOrigData = pOrigRow + startColumn * pixelSize;
+            switchOnEncoding(mInput.mDataType, ConvertPcaPixels, pOrigData, pPixels, count * numBands);
+
+            ProjectPcaBlock(pPixels, mInput.mpCoefficients, pValues, count, numBands, numComponents);
+            const double* pBlockValues = pValues;
+            for (unsigned int pixel = 0; pixel < count; ++pixel)
             {
-               pInput->mpMatrix[band2][band1] += (*pPixel-pAverage[band2]) * (*pData-pAverage[band1]);
-               ++pData;
+               for (unsigned int comp = 0; comp < numComponents; ++comp)
+               {
+                  double value = *pBlockValues++;
+                  pMinValues[comp] = min(pMinValues[comp], value);
+                  pMaxValues[comp] = max(pMaxValues[comp], value);
+               }
             }
-            ++pPixel;
          }
-         ++mask;
-         ++it;
+
+         origAccessor->nextRow();
       }
    }
 
-   // check if aborted
-   if ((pInput->mpAbortFlag == NULL) || !(*pInput->mpAbortFlag))
+   const vector<double>& PcaProjectionThread::getMinValues() const
+   {
+      return mMinValues;
+   }
+
+   const vector<double>& PcaProjectionThread::getMaxValues() const
    {
-      for (band2 = 0; band2 < numBands; ++band2)
+      return mMaxValues;
+   }
+
+   bool PcaProjectionOutput::compileOverallResults(const vector<PcaProjectionThread*>& threads)
+   {
+      for (vector<PcaProjectionThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
       {
-         for (band1 = band2; band1 < numBands; ++band1)
+         const vector<double>& minValues = (*iter)->getMinValues();
+         const vector<double>& maxValues = (*iter)->getMaxValues();
+         if (mMinValues.empty())
          {
-            pInput->mpMatrix[band2][band1] /= lCount;
+            mMinValues = minValues;
+            mMaxValues = maxValues;
+            continue;
          }
-      }
 
-      for (band2 = 0; band2 < numBands; ++band2)
-      {
-         for (band1 = band2; band1 < numBands; ++band1)
+         for (vector<double>::size_type comp = 0; comp < mMinValues.size(); ++comp)
          {
-            pInput->mpMatrix[band1][band2] = pInput->mpMatrix[band2][band1];
+            mMinValues[comp] = min(mMinValues[comp], minValues[comp]);
+            mMaxValues[comp] = max(mMaxValues[comp], maxValues[comp]);
          }
       }
+
+      return true;
    }
 
-   if (pInput->mpProgress != NULL)
+   PcaScaleThread::PcaScaleThread(const PcaInput& input, int threadCount, int threadIndex,
+                                  mta::ThreadReporter& reporter) :
+      mta::AlgorithmThread(threadIndex, reporter),
+      mInput(input),
+      mRowRange(getThreadRange(threadCount, input.mNumRows))
+   {}
+
+   void PcaScaleThread::run()
    {
-      if ((pInput->mpAbortFlag == NULL) || !(*pInput->mpAbortFlag))
+      if (mRowRange.mFirst > mRowRange.mLast)
       {
-         pInput->mpProgress->updateProgress("Covariance Matrix Complete", 100, NORMAL);
+         return;
       }
-      else
-      {
-         pInput->mpProgress->updateProgress("Aborted computing Covariance Matrix", 0, ABORT);
-      }
-   }
-}
 
-template<class T>
-void ComputePcaValue(T *pData, double* pPcaValue, double *pCoefficients, unsigned int numBands)
-{
-   T* pInput = pData;
-   double* pCoef = pCoefficients;
-   *pPcaValue = 0.0;
+      const RasterDataDescriptor* pDescriptor =
+         static_cast<const RasterDataDescriptor*>(mInput.mpRaster->getDataDescriptor());
+      FactoryResource<DataRequest> pRequest;
+      pRequest->setInterleaveFormat(BIP);
+      pRequest->setRows(pDescriptor->getActiveRow(mRowRange.mFirst), pDescriptor->getActiveRow(mRowRange.mLast));
+      DataAccessor origAccessor = mInput.mpRaster->getDataAccessor(pRequest.release());
 
-   for (unsigned int i = 0; i < numBands; ++i)
-   {
-      *pPcaValue += static_cast<double>(*pInput) * (*pCoef);
-      ++pInput;
-      ++pCoef;
-   }
-}
+      const RasterDataDescriptor* pPcaDescriptor =
+         static_cast<const RasterDataDescriptor*>(mInput.mpPcaRaster->getDataDescriptor());
+      FactoryResource<DataRequest> pPcaRequest;
+      pPcaRequest->setInterleaveFormat(BIP);
+      pPcaRequest->setRows(pPcaDescriptor->getActiveRow(mRowRange.mFirst),
+         pPcaDescriptor->getActiveRow(mRowRange.mLast));
+      pPcaRequest->setWritable(true);
+      DataAccessor pcaAccessor = mInput.mpPcaRaster->getDataAccessor(pPcaRequest.release());
 
-template <class T>
-void ComputePcaRow(T* pData, double* pPcaData,  double* pCoefficients, unsigned int numCols, unsigned int numBands,
-                   double* pMinValue, double* pMaxValue)
-{
-   T* pColumn = pData;
-   T* pInput = NULL;
-   double* pValue = pPcaData;
-   double* pCoef = NULL;
+      const unsigned int numBands = mInput.mNumBands;
+      const unsigned int numComponents = mInput.mNumComponents;
+      const unsigned int pixelSize = numBands * mInput.mBytesPerElement;
+      const unsigned int pcaPixelSize = numComponents * mInput.mOutputBytesPerElement;
+      vector<double> pixels(PCA_BLOCK_PIXELS * numBands);
+      vector<double> values(PCA_BLOCK_PIXELS * numComponents);
+      double* pPixels = &pixels.front();
+      double* pValues = &values.front();
 
-   for (unsigned int col = 0; col < numCols; ++col)
-   {
-      *pValue = 0.0;
-      pInput = pColumn;
-      pCoef = pCoefficients;
-      for (unsigned int band = 0; band < numBands; ++band)
+      int oldPercentDone = -1;
+      for (int row = mRowRange.mFirst; row <= mRowRange.mLast; ++row)
       {
-         *pValue += (*pCoef * static_cast<double>(*pInput));
-         ++pCoef;
-         ++pInput;
-      }
-      if (*pValue > *pMaxValue)
-      {
-         *pMaxValue = *pValue;
-      }
+         if (*mInput.mpAbortFlag)
+         {
+            return;
+         }
 
-      if (*pValue < *pMinValue)
-      {
-         *pMinValue = *pValue;
-      }
+         int percentDone = mRowRange.computePercent(row);
+         if (percentDone > oldPercentDone)
+         {
+            oldPercentDone = percentDone;
+            getReporter().reportProgress(getThreadIndex(), percentDone);
+         }
 
-      ++pValue;
-      pColumn += numBands;
-   }
-}
+         if (!pcaAccessor.isValid() || !origAccessor.isValid())
+         {
+            getReporter().reportError("Could not get the pixels in the PCA cube!");
+            return;
+         }
 
-// Intended for use with integer data types -- adds 0.5 for rounding.
-template <class T>
-void StorePcaRow(T* pPcaData, double* pCompValues, unsigned int numCols, unsigned int numComponents,
-   double minVal, double scaleFactor, int minOutputVal)
-{
-   for (unsigned int col = 0; col < numCols; ++col)
-   {
-      *pPcaData = static_cast<T>(static_cast<int64_t>((*pCompValues - minVal) * scaleFactor + 0.5) + minOutputVal);
-      ++pCompValues;
-      pPcaData += numComponents;
-   }
-}
+         // the projection is identical to PcaProjectionThread, so the values are within the ranges it found
+         char* pOrigRow = reinterpret_cast<char*>(origAccessor->getRow());
+         char* pPcaRow = reinterpret_cast<char*>(pcaAccessor->getRow());
+         for (unsigned int startColumn = 0; startColumn < mInput.mNumColumns; startColumn += PCA_BLOCK_PIXELS)
+         {
+            unsigned int count = min(PCA_BLOCK_PIXELS, mInput.mNumColumns - startColumn);
+            void* pOrigData = pOrigRow + startColumn * pixelSize;
+            switchOnEncoding(mInput.mDataType, ConvertPcaPixels, pOrigData, pPixels, count * numBands);
+            ProjectPcaBlock(pPixels, mInput.mpCoefficients, pValues, count, numBands, numComponents);
 
-template <>
-void StorePcaRow<float>(float* pPcaData, double* pCompValues, unsigned int numCols, unsigned int numComponents,
-   double minVal, double scaleFactor, int minOutputVal)
-{
-   for (unsigned int col = 0; col < numCols; ++col)
-   {
-      *pPcaData = static_cast<float>((*pCompValues - minVal) * scaleFactor + minOutputVal);
-      ++pCompValues;
-      pPcaData += numComponents;
-   }
-}
+            void* pPcaData = pPcaRow + startColumn * pcaPixelSize;
+            switchOnEncoding(mInput.mOutputDataType, StorePcaRow, pPcaData, pValues, count, numComponents,
+               mInput.mpMinValues, mInput.mpScaleFactors, mInput.mMinOutputValue);
+         }
 
-template <>
-void StorePcaRow<double>(double* pPcaData, double* pCompValues, unsigned int numCols, unsigned int numComponents,
-   double minVal, double scaleFactor, int minOutputVal)
-{
-   for (unsigned int col = 0; col < numCols; ++col)
-   {
-      *pPcaData = static_cast<double>((*pCompValues - minVal) * scaleFactor + minOutputVal);
-      ++pCompValues;
-      pPcaData += numComponents;
+         pcaAccessor->nextRow();
+         origAccessor->nextRow();
+      }
    }
 }
 
-// Intended for use with integer data types -- adds 0.5 for rounding.
-template <class T>
-void StorePcaValue(T* pPcaData, double* pValue, double* pMinVal, double* pScaleFactor, int* pMinOutputVal)
-{
-   *pPcaData = static_cast<T>(static_cast<int64_t>((*pValue - *pMinVal) * (*pScaleFactor) + 0.5) + *pMinOutputVal);
-}
-
-template <>
-void StorePcaValue<float>(float* pPcaData, double* pValue, double* pMinVal, double* pScaleFactor, int* pMinOutputVal)
-{
-   *pPcaData = static_cast<float>((*pValue - *pMinVal) * (*pScaleFactor) + *pMinOutputVal);
-}
-
-template <>
-void StorePcaValue<double>(double* pPcaData, double* pValue, double* pMinVal, double* pScaleFactor, int* pMinOutputVal)
-{
-   *pPcaData = static_cast<double>((*pValue - *pMinVal) * (*pScaleFactor) + *pMinOutputVal);
-}
-
 REGISTER_PLUGIN_BASIC(OpticksPCA, PCA);
 
 PCA::PCA() :
@@ -1227,7 +1206,6 @@ bool PCA::computePCAwhole()
    QString message;
 
    const RasterDataDescriptor* pPcaDesc = dynamic_cast<RasterDataDescriptor*>(mpPCARaster->getDataDescriptor());
-   EncodingType pcaDataType = pPcaDesc->getDataType();
    unsigned int pcaNumRows = pPcaDesc->getRowCount();
    unsigned int pcaNumCols = pPcaDesc->getColumnCount();
    unsigned int pcaNumBands = pPcaDesc->getBandCount();
@@ -1243,19 +1221,21 @@ bool PCA::computePCAwhole()
       return false;
    }
 
-   FactoryResource<DataRequest> pBipRequest;
-   pBipRequest->setInterleaveFormat(BIP);
-   DataAccessor pcaAccessor = mpPCARaster->getDataAccessor(pBipRequest->copy());
-   if (!pcaAccessor.isValid())
-   {
-      mMessage = "PCA could not obtain an accessor the PCA RasterElement";
-      if (mpProgress != NULL)
+   { // scope the accessor
+      FactoryResource<DataRequest> pBipRequest;
+      pBipRequest->setInterleaveFormat(BIP);
+      DataAccessor pcaAccessor = mpPCARaster->getDataAccessor(pBipRequest.release());
+      if (!pcaAccessor.isValid())
       {
-         mpProgress->updateProgress(mMessage, 0, ERRORS);
-      }
+         mMessage = "PCA could not obtain an accessor the PCA RasterElement";
+         if (mpProgress != NULL)
+         {
+            mpProgress->updateProgress(mMessage, 0, ERRORS);
+         }
 
-      mpStep->finalize(Message::Failure, mMessage);
-      return false;
+         mpStep->finalize(Message::Failure, mMessage);
+         return false;
+      }
    }
 
    const RasterDataDescriptor* pOrigDescriptor = dynamic_cast<const RasterDataDescriptor*>
@@ -1285,142 +1265,91 @@ bool PCA::computePCAwhole()
       return false;
    }
 
-   // Initialize progress bar variables
-   int currentProgress = 0;
-   int count = 0;
+   // The component values are not stored.  The first pass over the original cube finds their ranges
+   // and the second projects the pixels again to scale them into the PCA cube.
+   vector<double> coefficients(mNumBands * mNumComponentsToUse);
+   for (unsigned int band = 0; band < mNumBands; ++band)
+   {
+      for (unsigned int comp = 0; comp < mNumComponentsToUse; ++comp)
+      {
+         coefficients[band * mNumComponentsToUse + comp] = mpMatrixValues[band][comp];
+      }
+   }
 
-   void* pPCAData = NULL;
-   void* pOrigData = NULL;
+   PcaInput input;
+   input.mpRaster = mpRaster;
+   input.mpPcaRaster = mpPCARaster;
+   input.mDataType = eDataType;
+   input.mBytesPerElement = pOrigDescriptor->getBytesPerElement();
+   input.mNumRows = mNumRows;
+   input.mNumColumns = mNumColumns;
+   input.mNumBands = mNumBands;
+   input.mNumComponents = mNumComponentsToUse;
+   input.mpCoefficients = &coefficients.front();
+   input.mOutputDataType = mOutputDataType;
+   input.mOutputBytesPerElement = static_cast<unsigned int>(RasterUtilities::bytesInEncoding(mOutputDataType));
+   input.mpMinValues = NULL;
+   input.mpScaleFactors = NULL;
+   input.mMinOutputValue = mMinScaleValue;
+   input.mpAbortFlag = &mAborted;
 
-   DataAccessor origAccessor = mpRaster->getDataAccessor(pBipRequest->copy());
-   if (!origAccessor.isValid())
+   PcaProjectionOutput projectionOutput;
+   mta::ProgressObjectReporter projectionReporter("Computing PCA component values...", mpProgress);
+   mta::MultiThreadedAlgorithm<PcaInput, PcaProjectionOutput, PcaProjectionThread>
+      projectionAlg(mta::getNumRequiredThreads(mNumRows), input, projectionOutput, &projectionReporter);
+   mta::Result result = projectionAlg.run();
+
+   vector<double> scaleFactors(mNumComponentsToUse);
+   if (result == mta::SUCCESS && !isAborted())
    {
-      mMessage = "Could not get the pixels in the original cube!";
-      if (mpProgress != NULL)
+      // scale component values and save in pPCACube -- need the int64_t cast to prevent overflow/underflow
+      for (unsigned int comp = 0; comp < mNumComponentsToUse; ++comp)
       {
-         mpProgress->updateProgress(mMessage, currentProgress, ERRORS);
+         scaleFactors[comp] = static_cast<double>(static_cast<int64_t>(mMaxScaleValue) - mMinScaleValue) /
+            (projectionOutput.mMaxValues[comp] - projectionOutput.mMinValues[comp]);
       }
 
-      mpStep->finalize(Message::Failure, mMessage);
-      return false;
-   }
+      input.mpMinValues = &projectionOutput.mMinValues.front();
+      input.mpScaleFactors = &scaleFactors.front();
 
-   // Set the PCA cube data values
-   double min = 0.0;
-   double max = 0.0;
-   double scalefactor = 0.0;
-   int memsize = mNumRows * mNumColumns * sizeof(float);
-   string compValuesName = "PcaComponentValues";
-   RasterElement* pOldComponentValues = dynamic_cast<RasterElement*>(
-      Service<ModelServices>()->getElement(compValuesName, TypeConverter::toString<RasterElement>(), mpRaster));
-   if (pOldComponentValues != NULL)
+      PcaScaleOutput scaleOutput;
+      mta::ProgressObjectReporter scaleReporter("Generating scaled PCA data cube...", mpProgress);
+      mta::MultiThreadedAlgorithm<PcaInput, PcaScaleOutput, PcaScaleThread>
+         scaleAlg(mta::getNumRequiredThreads(mNumRows), input, scaleOutput, &scaleReporter);
+      result = scaleAlg.run();
+      if (result != mta::SUCCESS)
+      {
+         mMessage = scaleAlg.getErrorText();
+      }
+   }
+   else if (result != mta::SUCCESS)
    {
-      VERIFY(Service<ModelServices>()->destroyElement(pOldComponentValues));
+      mMessage = projectionAlg.getErrorText();
    }
 
-   ModelResource<RasterElement> pComponentValues(RasterUtilities::createRasterElement(compValuesName,
-      mNumRows, mNumColumns, FLT8BYTES, true, mpRaster));
-   if (pComponentValues.get() == NULL)
+   if (isAborted())
    {
-      mMessage = "Out of memory";
-      if (mpProgress != NULL)
-      {
-         mpProgress->updateProgress(mMessage, 0, ERRORS);
-      }
-
-      mpStep->finalize(Message::Failure, mMessage);
+      mpProgress->updateProgress("PCA aborted!", 0, ABORT);
+      mpStep->finalize(Message::Abort);
       return false;
    }
 
-   FactoryResource<DataRequest> pBipWritableRequest;
-   pBipWritableRequest->setWritable(true);
-   pBipWritableRequest->setInterleaveFormat(BIP);
-
-   unsigned int comp = 0;
-   unsigned int row = 0;
-   unsigned int band = 0;
-   double* pValues = NULL;
-   vector<double> coefficients(mNumBands, 0);
-   double* pCoefficients = &coefficients.front();
-   int progSave = 0;
-   for (comp = 0; comp < mNumComponentsToUse; ++comp)
+   if (result != mta::SUCCESS)
    {
-      origAccessor = mpRaster->getDataAccessor(pBipRequest->copy());
-
-      DataAccessor compValAccessor = pComponentValues->getDataAccessor(pBipWritableRequest->copy());
-      for (band = 0; band < mNumBands; ++band)
+      if (mMessage.empty())
       {
-         pCoefficients[band] = mpMatrixValues[band][comp];
-      }
-      min = numeric_limits<double>::max();
-      max = numeric_limits<double>::min();
-      for (row = 0; row < mNumRows; ++row)
-      {
-         VERIFY(origAccessor.isValid());
-         pOrigData = origAccessor->getRow();
-         VERIFY(compValAccessor.isValid());
-         pValues = reinterpret_cast<double*>(compValAccessor->getRow());
-         switchOnEncoding(eDataType, ComputePcaRow, pOrigData, pValues,
-            pCoefficients, mNumColumns, mNumBands, &min, &max);
-         origAccessor->nextRow();
-         compValAccessor->nextRow();
+         mMessage = "Could not compute the PCA cube!";
       }
 
-      // check if aborted
-      if (!isAborted())
+      if (mpProgress != NULL)
       {
-         // scale component values and save in pPCACube -- need the int64_t cast to prevent overflow/underflow
-         scalefactor = static_cast<double>(static_cast<int64_t>(mMaxScaleValue) - mMinScaleValue) / (max - min);
-
-         FactoryResource<DataRequest> pPcaRequest;
-         pPcaRequest->setBands(pPcaDesc->getActiveBand(comp), pPcaDesc->getActiveBand(comp));
-         pPcaRequest->setWritable(true);
-         DataAccessor pcaAccessor = mpPCARaster->getDataAccessor(pPcaRequest.release());
-         if (!pcaAccessor.isValid())
-         {
-            mMessage = "Could not get the pixels in the PCA cube!";
-            if (mpProgress != NULL)
-            {
-               mpProgress->updateProgress(mMessage, currentProgress, ERRORS);
-            }
-
-            mpStep->finalize(Message::Failure, mMessage);
-            return false;
-         }
-
-         compValAccessor = pComponentValues->getDataAccessor(pBipRequest->copy());
-         for (row = 0; row < mNumRows; ++row)
-         {
-            VERIFY(pcaAccessor.isValid());
-            pPCAData = pcaAccessor->getRow();
-            VERIFY(compValAccessor.isValid());
-            pValues = reinterpret_cast<double*>(compValAccessor->getRow());
-            switchOnEncoding(mOutputDataType, StorePcaRow, pPCAData, pValues, pcaNumCols, pcaNumBands,
-               min, scalefactor, mMinScaleValue);
-            pcaAccessor->nextRow();
-            compValAccessor->nextRow();
-
-            if (isAborted())
-            {
-               break;
-            }
-         }
-
-         currentProgress = 100 * (comp + 1) / mNumComponentsToUse;
-         if (mpProgress != NULL && currentProgress != progSave)
-         {
-            progSave = currentProgress;
-            mpProgress->updateProgress("Generating scaled PCA data cube...", currentProgress, NORMAL);
-         }
+         mpProgress->updateProgress(mMessage, 0, ERRORS);
       }
-   }
 
-   if (isAborted())
-   {
-      mpProgress->updateProgress("PCA aborted!", currentProgress, ABORT);
-      mpStep->finalize(Message::Abort);
+      mpStep->finalize(Message::Failure, mMessage);
       return false;
    }
+
    if (mpProgress != NULL)
    {
       mpProgress->updateProgress("PCA computations complete!", 100, NORMAL);
@@ -2180,26 +2109,16 @@ bool PCA::computeCovarianceMatrix(QString aoiName, int rowSkip, int colSkip)
       return false;
    }
 
-   void* pData = NULL;
-
+   const BitMask* pMask = NULL;
    if (aoiName.isEmpty())
    {
       if ((rowSkip < 1) || (colSkip < 1))
       {
          return false;
       }
-
-      switchOnEncoding(pDescriptor->getDataType(), ComputeFactoredCov,
-                        pData, mpRaster, mpMatrixValues, mpProgress,
-                        &mAborted, rowSkip, colSkip);
    }
    else  // compute over AOI
    {
-      MaskInput input;
-      input.mpMatrix = mpMatrixValues;
-      input.mpRaster = mpRaster;
-      input.mpProgress = mpProgress;
-      input.mpAbortFlag = &mAborted;
       AoiElement* pAoi = getAoiElement(aoiName.toStdString());
       if (pAoi == NULL)
       {
@@ -2212,8 +2131,8 @@ bool PCA::computeCovarianceMatrix(QString aoiName, int rowSkip, int colSkip)
          mpStep->finalize(Message::Failure, mMessage);
          return false;
       }
-      input.mpMask = pAoi->getSelectedPoints();
-      BitMaskIterator it(input.mpMask, mpRaster);
+      pMask = pAoi->getSelectedPoints();
+      BitMaskIterator it(pMask, mpRaster);
 
       // check if AOI has any points selected
       if (it.getCount() < 2)
@@ -2232,9 +2151,11 @@ bool PCA::computeCovarianceMatrix(QString aoiName, int rowSkip, int colSkip)
          }
          return false;
       }
-      switchOnEncoding(pDescriptor->getDataType(), ComputeMaskedCov, pData, &input);
    }
 
+   bool success = MatrixFunctions::computeCovarianceMatrix(mpMatrixValues[0], mpRaster, pMask, rowSkip, colSkip,
+      mpProgress, &mAborted);
+
    if (isAborted())
    {
       if (mpProgress != NULL)
@@ -2246,6 +2167,23 @@ bool PCA::computeCovarianceMatrix(QString aoiName, int rowSkip, int colSkip)
       return false;
    }
 
+   if (success == false)
+   {
+      mMessage = "Unable to compute the Covariance matrix";
+      if (mpProgress != NULL)
+      {
+         mpProgress->updateProgress(mMessage, 0, ERRORS);
+      }
+
+      mpStep->finalize(Message::Failure, mMessage);
+      return false;
+   }
+
+   if (mpProgress != NULL)
+   {
+      mpProgress->updateProgress("Covariance Matrix Complete", 100, NORMAL);
+   }
+
    return true;
 }
 
@@ -29,7 +29,6 @@
 #include "RasterUtilities.h"
 #include "SecondMoment.h"
 #include "SecondMomentGui.h"
-#include "switchOnEncoding.h"
 #include "TypeConverter.h"
 
 #include <algorithm>
@@ -38,242 +37,6 @@
 using namespace std;
 
 const string SecondMomentAlgorithm::mExpectedFileHeader = "Second Moment Matrix File v1.1\n";
-static bool** CopySelectedPixels(const bool** pSelectedPixels, int xsize, int ysize);
-static void DeleteSelectedPixels(bool** pSelectedPixels);
-
-template<class T>
-T* GetRowPtr(T* raw, int numCols, int numBands, int row, int col)
-{
-   return raw + numBands * (row *numCols + col);
-}
-
-template<class T>
-void ComputeFactoredSmm(T* pData, RasterElement* pRaster, double* pMatrix,
-                        Progress* pProgress, const bool* pAbortFlag,
-                        int rowFactor, int columnFactor)
-{
-   if (pRaster == NULL)
-   {
-      return;
-   }
-
-   unsigned int row, col, band;
-   unsigned int i, j;
-   unsigned int lCount = 0;
-
-   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(pRaster->getDataDescriptor());
-   if (pDescriptor == NULL)
-   {
-      return;
-   }
-
-   unsigned int numRows = pDescriptor->getRowCount();
-   unsigned int numCols = pDescriptor->getColumnCount();
-   unsigned int numBands = pDescriptor->getBandCount();
-
-   if (rowFactor < 1)
-   {
-      rowFactor = 1;
-   }
-   if (columnFactor < 1)
-   {
-      columnFactor = 1;
-   }
-
-   memset(pMatrix, 0, sizeof(double) * numBands * numBands);
-
-   FactoryResource<DataRequest> pRequest;
-   pRequest->setInterleaveFormat(BIP);
-
-   DataAccessor accessor = pRaster->getDataAccessor(pRequest.release());
-   T* pDataColumn(NULL);
-   for (row = 0; row < numRows; )
-   {
-      if (pProgress != NULL)
-      {
-         if ((pAbortFlag == NULL) || !(*pAbortFlag))
-         {
-            int iPercent = (100 * row) / numRows;
-            if (iPercent == 100)
-            {
-               iPercent = 99;
-            }
-
-            pProgress->updateProgress("Computing Second Moment Matrix...", iPercent, NORMAL);
-         }
-         else
-         {
-            break;
-         }
-      }
-      VERIFYNRV(accessor.isValid());
-      pData = static_cast<T*>(accessor->getRow());
-      for (col = 0; col < numCols; col += columnFactor)
-      {
-         ++lCount;
-         pDataColumn = pData + col * numBands;
-         double* pMatrixRow = pMatrix;
-         double* pMatrixColumn = NULL;
-         T* pRowIndexBand = pDataColumn;
-         T* pColIndexBand = pDataColumn;
-         double* pStop = NULL;
-         for (band = 0; band < numBands; ++band,
-                                        ++pRowIndexBand,
-                                        pColIndexBand = pRowIndexBand,
-                                        pMatrixRow += (numBands + 1))
-         {
-            pMatrixColumn = pMatrixRow;
-            pStop = &pMatrixColumn[numBands-band];
-            while (pMatrixColumn != pStop)
-            {
-               *pMatrixColumn += (*pRowIndexBand) * (*pColIndexBand);
-               ++pMatrixColumn;
-               ++pColIndexBand;
-            }
-         }
-      }
-      for (i = 0; i< static_cast<unsigned int>(rowFactor); ++i)
-      {
-         ++row;
-         if (row < numRows)
-         {
-            accessor->nextRow();
-         }
-      }
-   }
-
-   for (i = 0; i < numBands; ++i)
-   {
-      int index = i * numBands + i;
-      for (j = i; j < numBands; ++j, ++index)
-      {
-         pMatrix[index] /= lCount;
-      }
-   }
-
-   for (i = 0; i < numBands; ++i)
-   {
-      for (j = i; j < numBands; ++j)
-      {
-         pMatrix[j * numBands + i] = pMatrix[i * numBands + j];
-      }
-   }
-
-   if (pProgress != NULL)
-   {
-      if ((pAbortFlag == NULL) || !(*pAbortFlag))
-      {
-         pProgress->updateProgress("Second Moment Matrix Complete", 99, NORMAL);
-      }
-      else
-      {
-         pProgress->updateProgress("Aborted computing Second Moment Matrix", 0, ABORT);
-      }
-   }
-}
-
-struct MaskInput
-{
-   double* pMatrix;
-   int numRows;
-   int numCols;
-   int numBands;
-   Progress* pProgress;
-   const bool* pAbortFlag;
-   const bool** pSelectedPixels;
-   int boundingBoxX1;
-   int boundingBoxY1;
-   int boundingBoxX2;
-   int boundingBoxY2;
-   const BitMask* mpMask;
-};
-
-template<class T>
-void ComputeMaskedSmm(T* pData, MaskInput* pInput, RasterElement* pRaster)
-{
-   if (pRaster == NULL)
-   {
-      return;
-   }
-
-   int lRow = 0, lColumn = 0;
-   int lCount = 0;
-   T* pBand1 = NULL;
-   T* pBand2 = NULL;
-   memset(pInput->pMatrix, 0, sizeof(double) * pInput->numBands * pInput->numBands);
-   FactoryResource<DataRequest> pRequest;
-   pRequest->setInterleaveFormat(BIP);
-   DataAccessor accessor = pRaster->getDataAccessor(pRequest.release());
-   BitMaskIterator it(pInput->mpMask, pRaster);
-   int numPixels = it.getCount();
-   LocationType loc;
-   float progScale = 100.0f / numPixels;
-   int progSave = 0;
-   while (it != it.end())
-   {
-      it.getPixelLocation(loc);
-      accessor->toPixel(loc.mY, loc.mX);
-      VERIFYNRV(accessor.isValid());
-      if (pInput->pProgress != NULL && 
-          progSave != static_cast<int>(progScale * lCount))
-      {
-         if ((pInput->pAbortFlag == NULL) || !(*pInput->pAbortFlag))
-         {
-            progSave = static_cast<int>(progScale * lCount);
-            pInput->pProgress->updateProgress("Computing Second Moment Matrix...",
-               progSave, NORMAL);
-         }
-         else
-         {
-            break;
-         }
-      }
-      ++lCount;
-      ++it;
-      pData = static_cast<T*>(accessor->getColumn());
-      pBand2 = pData;
-      for (lRow = 0; lRow < pInput->numBands; ++lRow)
-      {
-         pBand1 = pBand2;
-         int index = lRow * pInput->numBands + lRow;
-         for (lColumn = lRow; lColumn < pInput->numBands; ++lColumn, ++index)
-         {
-            pInput->pMatrix[index] += (*pBand1) * (*pBand2);
-            ++pBand1;
-         }
-         ++pBand2;
-      }
-   }
-
-   for (int i = 0; i < pInput->numBands; ++i)
-   {
-      int index = i * pInput->numBands + i;
-      for (int j = i; j < pInput->numBands; ++j, ++index)
-      {
-         pInput->pMatrix[index] /= lCount;
-      }
-   }
-
-   for (int i = 0; i < pInput->numBands; ++i)
-   {
-      for (int j = i; j < pInput->numBands; ++j)
-      {
-         pInput->pMatrix[j * pInput->numBands + i] = pInput->pMatrix[i * pInput->numBands + j];
-      }
-   }
-
-   if (pInput->pProgress != NULL)
-   {
-      if ((pInput->pAbortFlag == NULL) || !(*pInput->pAbortFlag))
-      {
-         pInput->pProgress->updateProgress("Second Moment Matrix Complete", 99, NORMAL);
-      }
-      else
-      {
-         pInput->pProgress->updateProgress("Aborted computing Second Moment Matrix", 0, ABORT);
-      }
-   }
-}
 
 REGISTER_PLUGIN_BASIC(OpticksSecondMoment, SecondMoment);
 
@@ -512,11 +275,7 @@ bool SecondMomentAlgorithm::processAll()
 
    const RasterDataDescriptor* pDescriptor = NULL;
    const char* pCubeName = NULL;
-   void* pData = NULL;
-   unsigned int numRows(0);
-   unsigned int numColumns(0);
    unsigned int numBands(0);
-   EncodingType eType;
 
    RasterElement* pRasterElement = getRasterElement();
    if (pRasterElement == NULL)
@@ -538,8 +297,6 @@ bool SecondMomentAlgorithm::processAll()
       return false;
    }
 
-   numRows = pDescriptor->getRowCount();
-   numColumns = pDescriptor->getColumnCount();
    numBands = pDescriptor->getBandCount();
 
    { // scope the accessor
@@ -586,66 +343,41 @@ bool SecondMomentAlgorithm::processAll()
 
       if (loadedFromFile == false)                        // need to compute smm
       {
-         eType = pDescriptor->getDataType();
-
          // check that entire data block of element is in memory
          VERIFY(pSmmElement->getRawData() != NULL);
-         if (mInput.mpAoi == NULL)
-         {
-            switchOnEncoding(eType, ComputeFactoredSmm, pData, pRasterElement, 
-               static_cast<double*>(pSmmElement->getRawData()), getProgress(), 
-               &mAbortFlag, mInput.mRowFactor, mInput.mColumnFactor);
-         }
-         else
+         const BitMask* pMask = NULL;
+         if (mInput.mpAoi != NULL)
          {
-            const BitMask* pMask = mInput.mpAoi->getSelectedPoints();
+            pMask = mInput.mpAoi->getSelectedPoints();
             if (pMask == NULL)
             {
                reportProgress(ERRORS, 0, "Error getting mask from AOI");
                return false;
             }
-            else // pMask != NULL
+
+            BitMaskIterator it(pMask, pRasterElement);
+            if (it.getCount() == 0)
             {
-               BitMaskIterator it(pMask, pRasterElement);
-
-               if (it.getCount() == 0)
-               {
-                  reportProgress(ERRORS, 0, "Error getting selected pixels from AOI");
-                  return false;
-               }
-               else
-               {
-                  int x1 = 0;
-                  int y1 = 0;
-                  int x2 = 0;
-                  int y2 = 0;
-                  pMask->getBoundingBox(x1, y1, x2, y2);
-                  const bool** pSelectedPixels = const_cast<BitMask*>(pMask)->getRegion(x1, y1, x2, y2);
-                  MaskInput input;
-                  input.pMatrix = static_cast<double*>(pSmmElement->getRawData());
-                  input.numRows = numRows;
-                  input.numCols = numColumns;
-                  input.numBands = numBands;
-                  input.pProgress = getProgress();
-                  input.pAbortFlag = &mAbortFlag;
-                  input.pSelectedPixels = pSelectedPixels;
-                  input.mpMask = pMask;
-                  input.boundingBoxX1 = x1;
-                  input.boundingBoxX2 = x2;
-                  input.boundingBoxY1 = y1;
-                  input.boundingBoxY2 = y2;
-
-                  switchOnEncoding(eType, ComputeMaskedSmm, pData, &input, pRasterElement);
-               }
+               reportProgress(ERRORS, 0, "Error getting selected pixels from AOI");
+               return false;
             }
          }
 
+         bool success = MatrixFunctions::computeSecondMomentMatrix(static_cast<double*>(pSmmElement->getRawData()),
+            pRasterElement, pMask, mInput.mRowFactor, mInput.mColumnFactor, getProgress(), &mAbortFlag);
          if (mAbortFlag)
          {
             reportProgress(ABORT, 0, "Aborted creation of Second Moment Matrix");
             return false;
          }
 
+         if (success == false)
+         {
+            reportProgress(ERRORS, 0, "Error computing Second Moment Matrix.");
+            return false;
+         }
+
+         reportProgress(NORMAL, 100, "Second Moment Matrix Complete");
          writeMatrixToDisk(mSmmFile, pSmmElement.get());
       }
    }
@@ -250,10 +250,10 @@ vector<Feature*> ShapeFile::addFeatures(DataElement* pElement, RasterElement* pG
                   pFeature->setFieldValue("Name", elementName);
                }
 
-               for (vector<LocationType>::const_iterator iter = vertices.begin(); iter != vertices.end(); ++iter)
+               const vector<LocationType> geocoords = pGeoref->convertPixelsToGeocoords(vertices);
+               for (vector<LocationType>::const_iterator iter = geocoords.begin(); iter != geocoords.end(); ++iter)
                {
-                  LocationType geo = pGeoref->convertPixelToGeocoord(*iter);
-                  pFeature->addVertex(geo.mY, geo.mX);
+                  pFeature->addVertex(iter->mY, iter->mX);
                }
             }
          }
@@ -296,10 +296,10 @@ vector<Feature*> ShapeFile::addFeatures(DataElement* pElement, RasterElement* pG
                   pFeature->setFieldValue("Name", elementName);
                }
 
-               for (vector<LocationType>::const_iterator iter = vertices.begin(); iter != vertices.end(); ++iter)
+               const vector<LocationType> geocoords = pGeoref->convertPixelsToGeocoords(vertices);
+               for (vector<LocationType>::const_iterator iter = geocoords.begin(); iter != geocoords.end(); ++iter)
                {
-                  LocationType geo = pGeoref->convertPixelToGeocoord(*iter);
-                  pFeature->addVertex(geo.mY, geo.mX);
+                  pFeature->addVertex(iter->mY, iter->mX);
                }
             }
          }
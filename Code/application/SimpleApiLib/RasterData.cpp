@@ -183,6 +183,46 @@ namespace
          }
       }
    }
+
+   bool copyCube(const char* pData, RasterElement* pElement)
+   {
+      const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(pElement->getDataDescriptor());
+      if (pDesc == NULL)
+      {
+         return false;
+      }
+
+      // Each row of a BIP or BIL cube holds every band, while BSQ rows are copied one band at a time
+      bool bsq = (pDesc->getInterleaveFormat() == BSQ);
+      unsigned int passes = bsq ? pDesc->getBandCount() : 1;
+      size_t rowBytes = static_cast<size_t>(pDesc->getColumnCount()) * pDesc->getBytesPerElement();
+      if (!bsq)
+      {
+         rowBytes *= pDesc->getBandCount();
+      }
+
+      for (unsigned int pass = 0; pass < passes; ++pass)
+      {
+         FactoryResource<DataRequest> pRequest;
+         pRequest->setWritable(true);
+         if (bsq)
+         {
+            pRequest->setBands(pDesc->getActiveBand(pass), pDesc->getActiveBand(pass), 1);
+         }
+         DataAccessor daImage = pElement->getDataAccessor(pRequest.release());
+         for (unsigned int row = 0; row < pDesc->getRowCount(); ++row)
+         {
+            if (!daImage.isValid())
+            {
+               return false;
+            }
+            memcpy(daImage->getRow(), pData, rowBytes);
+            pData += rowBytes;
+            daImage->nextRow();
+         }
+      }
+      return true;
+   }
 }
 
 extern "C"
@@ -322,12 +362,18 @@ extern "C"
          setLastError(SIMPLE_BAD_PARAMS);
          return NULL;
       }
-      void* pRawData = pRaster->getRawData();
-      if (pArgs == NULL && pRawData != NULL)
+      // The whole cube is returned as a writable alias of the original data, so the writable cube pointer is
+      // only requested in that case
+      void* pRawData = NULL;
+      if (pArgs == NULL)
       {
-         *pOwn = 0;
-         setLastError(SIMPLE_NO_ERROR);
-         return pRawData;
+         pRawData = pRaster->getRawData();
+         if (pRawData != NULL)
+         {
+            *pOwn = 0;
+            setLastError(SIMPLE_NO_ERROR);
+            return pRawData;
+         }
       }
       *pOwn = 1;
       const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(pRaster->getDataDescriptor());
@@ -390,36 +436,18 @@ extern "C"
          return 1;
       }
       const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(pRaster->getDataDescriptor());
-      void* pRawData = pRaster->getRawData();
-      if (pArgs == NULL && pRawData != NULL)
+      if (pArgs == NULL)
       {
-         size_t len = pDesc->getRowCount() * pDesc->getColumnCount() * pDesc->getBandCount()
-                    * pDesc->getBytesPerElement();
-         memcpy(pRawData, pData, len);
+         // The whole cube is replaced a row at a time through writable accessors, which do not
+         // hand out the writable cube pointer
+         if (!copyCube(reinterpret_cast<const char*>(pData), pRaster))
+         {
+            setLastError(SIMPLE_OTHER_FAILURE);
+            return 1;
+         }
          setLastError(SIMPLE_NO_ERROR);
          return 0;
       }
-      DataPointerArgs args = {
-         0, pDesc->getRowCount() - 1,
-         0, pDesc->getColumnCount() - 1,
-         0, pDesc->getBandCount() - 1,
-         0 };
-      switch (pDesc->getInterleaveFormat())
-      {
-      case BSQ:
-         args.interleaveFormat = 0;
-         break;
-      case BIP:
-         args.interleaveFormat = 1;
-         break;
-      case BIL:
-         args.interleaveFormat = 2;
-         break;
-      }
-      if (pArgs == NULL)
-      {
-         pArgs = &args;
-      }
       bool success = true;
       switchOnComplexEncoding(pDesc->getDataType(), copySubcube, pData, pRaster,
          pArgs->rowStart, pArgs->rowEnd,
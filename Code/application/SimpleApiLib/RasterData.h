@@ -170,9 +170,8 @@ extern "C"
     * @param pArgs
     *        The structure containing information to process the request.
     *        This specifies the parameters for the DataAccessor which will
-    *        be used to write to the RasterElement. If this is \c NULL and
-    *        RasterElement::getRawData() returns a valid pointer, a single
-    *        memcpy() will be used to replace the contents of the RasterElement.
+    *        be used to write to the RasterElement. If this is \c NULL, the
+    *        entire contents of the RasterElement are replaced one row at a time.
     * @param pData
     *        A pointer to a three-dimensional matrix containing raster data.
     *        The format of this data must match the information in pArgs or the RasterElement
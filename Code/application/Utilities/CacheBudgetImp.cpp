@@ -0,0 +1,170 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "CacheBudgetImp.h"
+
+using namespace std;
+
+CacheBudgetImp::CacheBudgetImp() :
+   mMaxSize(256 * 1024 * 1024),
+   mTotalSize(0)
+{
+}
+
+CacheBudgetImp::~CacheBudgetImp()
+{
+}
+
+void CacheBudgetImp::setMaximumSize(size_t maxSize)
+{
+   // entries are released after the lock, so large buffers are not freed while holding it
+   vector<EntryPtr> released;
+   mta::MutexLock lock(mMutex);
+   mMaxSize = maxSize;
+   enforce(NULL, released);
+}
+
+size_t CacheBudgetImp::getMaximumSize() const
+{
+   mta::MutexLock lock(mMutex);
+   return mMaxSize;
+}
+
+size_t CacheBudgetImp::getTotalSize() const
+{
+   mta::MutexLock lock(mMutex);
+   return mTotalSize;
+}
+
+void CacheBudgetImp::setOwnerMaximumSize(const void* pOwner, size_t maxSize)
+{
+   vector<EntryPtr> released;
+   mta::MutexLock lock(mMutex);
+   mOwners[pOwner].mMaxSize = maxSize;
+   enforce(pOwner, released);
+}
+
+void CacheBudgetImp::insert(const void* pOwner, EntryPtr pEntry)
+{
+   if (pEntry.get() == NULL)
+   {
+      return;
+   }
+
+   vector<EntryPtr> released;
+   mta::MutexLock lock(mMutex);
+   if (mPositions.find(pEntry.get()) != mPositions.end())
+   {
+      return;
+   }
+
+   size_t size = pEntry->getSize();
+   mItems.push_back(Item(pOwner, pEntry));
+   mPositions[pEntry.get()] = --mItems.end();
+   mTotalSize += size;
+   mOwners[pOwner].mSize += size;
+   enforce(pOwner, released);
+}
+
+bool CacheBudgetImp::touch(const Entry* pEntry)
+{
+   mta::MutexLock lock(mMutex);
+   PositionMap::iterator pPosition = mPositions.find(pEntry);
+   if (pPosition == mPositions.end())
+   {
+      return false;
+   }
+
+   mItems.splice(mItems.end(), mItems, pPosition->second);
+   return true;
+}
+
+void CacheBudgetImp::remove(const Entry* pEntry)
+{
+   vector<EntryPtr> released;
+   mta::MutexLock lock(mMutex);
+   PositionMap::iterator pPosition = mPositions.find(pEntry);
+   if (pPosition != mPositions.end())
+   {
+      erase(pPosition->second, released);
+   }
+}
+
+void CacheBudgetImp::removeOwner(const void* pOwner)
+{
+   vector<EntryPtr> released;
+   mta::MutexLock lock(mMutex);
+   for (ItemList::iterator pItem = mItems.begin(); pItem != mItems.end();)
+   {
+      if (pItem->mpOwner == pOwner)
+      {
+         pItem = erase(pItem, released);
+      }
+      else
+      {
+         ++pItem;
+      }
+   }
+
+   mOwners.erase(pOwner);
+}
+
+CacheBudgetImp::ItemList::iterator CacheBudgetImp::erase(ItemList::iterator pItem, vector<EntryPtr>& released)
+{
+   size_t size = pItem->mpEntry->getSize();
+   mTotalSize -= size;
+
+   OwnerMap::iterator pOwner = mOwners.find(pItem->mpOwner);
+   if (pOwner != mOwners.end())
+   {
+      pOwner->second.mSize -= size;
+      if (pOwner->second.mSize == 0 && pOwner->second.mMaxSize == 0)
+      {
+         mOwners.erase(pOwner);
+      }
+   }
+
+   released.push_back(pItem->mpEntry);
+   mPositions.erase(pItem->mpEntry.get());
+   return mItems.erase(pItem);
+}
+
+void CacheBudgetImp::enforce(const void* pOwner, vector<EntryPtr>& released)
+{
+   // the owner's limit is checked first, so a limited cache releases its own entries before
+   // those of other caches
+   OwnerMap::iterator pLimit = mOwners.find(pOwner);
+   if (pOwner != NULL && pLimit != mOwners.end() && pLimit->second.mMaxSize > 0)
+   {
+      Owner& owner = pLimit->second;
+      ItemList::iterator pItem = mItems.begin();
+      while (owner.mSize > owner.mMaxSize && pItem != mItems.end())
+      {
+         // always keep the owner's most recently used entry so that an oversized entry is still cached
+         if (pItem->mpOwner != pOwner)
+         {
+            ++pItem;
+         }
+         else if (pItem->mpEntry->getSize() >= owner.mSize)
+         {
+            break;
+         }
+         else
+         {
+            pItem = erase(pItem, released);
+         }
+      }
+   }
+
+   // always keep the most recently used entry so that an oversized entry is still cached
+   while (mTotalSize > mMaxSize && mItems.size() > 1)
+   {
+      erase(mItems.begin(), released);
+   }
+}
@@ -0,0 +1,83 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef CACHEBUDGETIMP_H
+#define CACHEBUDGETIMP_H
+
+#include "CacheBudget.h"
+#include "DMutex.h"
+
+#include <list>
+#include <map>
+#include <vector>
+
+/**
+ * The application-wide LRU list of cache entries.
+ *
+ * The list owns the entries.  The most recently used entry is at the back of the list.
+ */
+class CacheBudgetImp : public CacheBudget
+{
+public:
+   CacheBudgetImp();
+   ~CacheBudgetImp();
+
+   void setMaximumSize(size_t maxSize);
+   size_t getMaximumSize() const;
+   size_t getTotalSize() const;
+   void setOwnerMaximumSize(const void* pOwner, size_t maxSize);
+   void insert(const void* pOwner, EntryPtr pEntry);
+   bool touch(const Entry* pEntry);
+   void remove(const Entry* pEntry);
+   void removeOwner(const void* pOwner);
+
+private:
+   CacheBudgetImp(const CacheBudgetImp& rhs);
+   CacheBudgetImp& operator=(const CacheBudgetImp& rhs);
+
+   struct Item
+   {
+      Item(const void* pOwner, EntryPtr pEntry) :
+         mpOwner(pOwner),
+         mpEntry(pEntry)
+      {
+      }
+
+      const void* mpOwner;
+      EntryPtr mpEntry;
+   };
+
+   struct Owner
+   {
+      Owner() :
+         mSize(0),
+         mMaxSize(0)
+      {
+      }
+
+      size_t mSize;
+      size_t mMaxSize;
+   };
+
+   typedef std::list<Item> ItemList;
+   typedef std::map<const Entry*, ItemList::iterator> PositionMap;
+   typedef std::map<const void*, Owner> OwnerMap;
+
+   ItemList::iterator erase(ItemList::iterator pItem, std::vector<EntryPtr>& released);
+   void enforce(const void* pOwner, std::vector<EntryPtr>& released);
+
+   mutable mta::DMutex mMutex;
+   size_t mMaxSize;
+   size_t mTotalSize;
+   ItemList mItems;
+   PositionMap mPositions;
+   OwnerMap mOwners;
+};
+
+#endif
@@ -10,6 +10,9 @@
 #include "SessionItemDeserializerImp.h"
 #include "xmlreader.h"
 
+#include <QtCore/QFileInfo>
+#include <QtCore/QString>
+
 #include <sstream>
 using namespace std;
 XERCES_CPP_NAMESPACE_USE
@@ -113,3 +116,9 @@ int SessionItemDeserializerImp::getCurrentBlock() const
 {
    return mCurrentBlock;
 }
+
+string SessionItemDeserializerImp::getSharedBlockFilename(const string& name) const
+{
+   // Shared blocks are stored next to the session item files
+   return QFileInfo(QString::fromStdString(mBaseFilename)).absolutePath().toStdString() + "/" + name;
+}
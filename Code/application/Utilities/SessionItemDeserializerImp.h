@@ -29,6 +29,7 @@ public:
    void nextBlock();
    std::vector<int64_t> getBlockSizes() const;
    int getCurrentBlock() const;
+   std::string getSharedBlockFilename(const std::string& name) const;
 
 private:
    void ensureFileIsClosed();
@@ -7,18 +7,221 @@
  * http://www.gnu.org/licenses/lgpl.html
  */
 
+#include "MultiThreadedAlgorithm.h"
+#include "Progress.h"
 #include "SessionItem.h"
 #include "SessionItemSerializerImp.h"
+#include "XercesIncludes.h"
 #include "xmlwriter.h"
 
+#include <QtCore/QByteArray>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QString>
+
+#include <algorithm>
+#include <set>
+
 using namespace std;
+XERCES_CPP_NAMESPACE_USE
+
+namespace
+{
+   const char* const SHARED_BLOCK_SUFFIX = ".sessionBlock";
+
+   // QCryptographicHash takes an int length, so large blocks are hashed in pieces
+   const int64_t HASH_CHUNK_SIZE = 64 * 1024 * 1024;
+
+   // Streamed XML is collected into pieces of this size before it is written to the file
+   const size_t XML_BUFFER_SIZE = 1024 * 1024;
+
+   /**
+    * Writes the XML of a session item to its file as the XML is generated.
+    */
+   class SessionFileFormatTarget : public XMLFormatTarget
+   {
+   public:
+      SessionFileFormatTarget(LargeFileResource& file) :
+         mFile(file),
+         mBytesWritten(0),
+         mSuccess(true)
+      {
+         mBuffer.reserve(XML_BUFFER_SIZE);
+      }
+
+      void writeChars(const XMLByte* const pToWrite, const XMLSize_t count, XMLFormatter* const pFormatter)
+      {
+         mBuffer.insert(mBuffer.end(), pToWrite, pToWrite + count);
+         if (mBuffer.size() >= XML_BUFFER_SIZE)
+         {
+            flush();
+         }
+      }
+
+      void flush()
+      {
+         if (mSuccess && mBuffer.empty() == false)
+         {
+            int64_t size = static_cast<int64_t>(mBuffer.size());
+            mSuccess = mFile.write(&mBuffer.front(), size) == size;
+            mBytesWritten += size;
+         }
+
+         mBuffer.clear();
+      }
+
+      int64_t getBytesWritten() const
+      {
+         return mBytesWritten;
+      }
+
+      bool isSuccessful() const
+      {
+         return mSuccess;
+      }
+
+   private:
+      LargeFileResource& mFile;
+      vector<char> mBuffer;
+      int64_t mBytesWritten;
+      bool mSuccess;
+   };
+
+   string hashSharedBlock(const void* pData, int64_t size)
+   {
+      // The size is part of the name so that a block can be checked without reading it
+      QCryptographicHash hash(QCryptographicHash::Sha1);
+      const char* pBytes = reinterpret_cast<const char*>(pData);
+      for (int64_t offset = 0; offset < size; offset += HASH_CHUNK_SIZE)
+      {
+         hash.addData(pBytes + offset, static_cast<int>(min(HASH_CHUNK_SIZE, size - offset)));
+      }
+
+      stringstream buf;
+      buf << QString(hash.result().toHex()).toStdString() << "-" << size << SHARED_BLOCK_SUFFIX;
+      return buf.str();
+   }
+
+   bool writeSharedBlock(const string& directory, const string& name, const void* pData, int64_t size)
+   {
+      // Write to a temporary file first so that an interrupted save never leaves a partial block
+      // under a valid name
+      string filename = directory + "/" + name;
+      string tempFilename = filename + ".tmp";
+      {
+         LargeFileResource file;
+         if (!file.open(tempFilename, O_WRONLY | O_CREAT | O_BINARY | O_TRUNC, S_IREAD | S_IWRITE))
+         {
+            return false;
+         }
+
+         if (size > 0 && file.write(pData, size) != size)
+         {
+            file.close();
+            remove(tempFilename.c_str());
+            return false;
+         }
+      }
+
+      // A file which was not referenced is incomplete, so it is replaced
+      QDir sessionDir(QString::fromStdString(directory));
+      sessionDir.remove(QString::fromStdString(name));
+      if (!sessionDir.rename(QString::fromStdString(tempFilename), QString::fromStdString(filename)))
+      {
+         remove(tempFilename.c_str());
+         return false;
+      }
+
+      return true;
+   }
+
+   struct SharedBlockInput
+   {
+      vector<SessionItemSerializerImp::SharedBlock>* mpBlocks;
+      vector<unsigned int> mIndices;
+      string mDirectory;
+      bool mWrite;   // false to name the blocks, true to write them
+   };
+
+   class SharedBlockThread : public mta::AlgorithmThread
+   {
+   public:
+      SharedBlockThread(const SharedBlockInput& input, int threadCount, int threadIndex,
+         mta::ThreadReporter& reporter) :
+         mta::AlgorithmThread(threadIndex, reporter),
+         mInput(input),
+         mBlockRange(getThreadRange(threadCount, static_cast<int>(input.mIndices.size()))),
+         mSuccess(true)
+      {
+      }
+
+      void run()
+      {
+         for (int i = mBlockRange.mFirst; i <= mBlockRange.mLast && mSuccess; ++i)
+         {
+            SessionItemSerializerImp::SharedBlock& block = (*mInput.mpBlocks)[mInput.mIndices[i]];
+            if (mInput.mWrite)
+            {
+               mSuccess = writeSharedBlock(mInput.mDirectory, block.mName, block.mpData, block.mSize);
+            }
+            else
+            {
+               block.mName = hashSharedBlock(block.mpData, block.mSize);
+            }
+         }
+      }
+
+      bool isSuccessful() const
+      {
+         return mSuccess;
+      }
+
+   private:
+      const SharedBlockInput& mInput;
+      Range mBlockRange;
+      bool mSuccess;
+   };
+
+   struct SharedBlockOutput
+   {
+      bool compileOverallResults(const vector<SharedBlockThread*>& threads)
+      {
+         for (vector<SharedBlockThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+         {
+            if ((*iter)->isSuccessful() == false)
+            {
+               return false;
+            }
+         }
+         return true;
+      }
+   };
+
+   bool processSharedBlocks(const SharedBlockInput& input)
+   {
+      if (input.mIndices.empty())
+      {
+         return true;
+      }
+
+      SharedBlockOutput output;
+      mta::MultiThreadedAlgorithm<SharedBlockInput, SharedBlockOutput, SharedBlockThread>
+         alg(mta::getNumRequiredThreads(static_cast<unsigned int>(input.mIndices.size())), input, output, NULL);
+      return alg.run() == mta::SUCCESS;
+   }
+}
 
 SessionItemSerializerImp::SessionItemSerializerImp(string filename) :
    mBaseFilename(filename),
    mFilename(filename),
    mTotalBlocks(1),
    mBytesReserved(0),
-   mBytesWritten(0)
+   mBytesWritten(0),
+   mDirectory(QFileInfo(QString::fromStdString(filename)).absolutePath().toStdString()),
+   mpProgress(NULL),
+   mStartPercent(0),
+   mStopPercent(0)
 {
 }
 
@@ -85,8 +288,31 @@ bool SessionItemSerializerImp::serialize(const void *pData, int64_t size)
 
 bool SessionItemSerializerImp::serialize(XMLWriter &writer)
 {
-   string text = writer.writeToString();
-   return serialize(text.c_str(), text.length());
+   // A block reserved by the caller must hold exactly the reserved size, so its text is checked first
+   if (mBytesReserved != 0)
+   {
+      string text = writer.writeToString();
+      return serialize(text.c_str(), text.length());
+   }
+
+   // Otherwise the XML is streamed to the file and the size of the block is recorded afterwards,
+   // so the text of a large item is never held in memory
+   if (!mFile.validHandle())
+   {
+      if (!mFile.open(mFilename, O_WRONLY | O_CREAT | O_BINARY | O_TRUNC, S_IREAD | S_IWRITE))
+      {
+         return false;
+      }
+   }
+
+   SessionFileFormatTarget target(mFile);
+   bool success = writer.writeToTarget(target);
+   target.flush();
+
+   mBytesWritten = target.getBytesWritten();
+   mBytesReserved = mBytesWritten;
+   mBlockSizes.push_back(mBytesWritten);
+   return success && target.isSuccessful();
 }
 
 void SessionItemSerializerImp::endBlock()
@@ -106,3 +332,102 @@ unsigned int SessionItemSerializerImp::getBlockCount() const
 {
    return mTotalBlocks;
 }
+
+bool SessionItemSerializerImp::serializeSharedBlock(const void* pData, int64_t size, string& name)
+{
+   vector<SharedBlock> blocks(1);
+   blocks.front().mpData = pData;
+   blocks.front().mSize = size;
+   if (serializeSharedBlocks(blocks) == false)
+   {
+      return false;
+   }
+
+   name = blocks.front().mName;
+   return true;
+}
+
+bool SessionItemSerializerImp::serializeSharedBlocks(vector<SharedBlock>& blocks)
+{
+   SharedBlockInput input;
+   input.mpBlocks = &blocks;
+   input.mDirectory = mDirectory;
+   input.mWrite = false;
+   for (unsigned int i = 0; i < blocks.size(); ++i)
+   {
+      if (blocks[i].mpData == NULL && blocks[i].mSize > 0)
+      {
+         return false;
+      }
+
+      input.mIndices.push_back(i);
+   }
+
+   if (processSharedBlocks(input) == false)
+   {
+      return false;
+   }
+
+   // Blocks already in the session directory are referenced, and identical blocks in the batch are
+   // written once, which also keeps two threads from writing the same file
+   set<string> pendingBlocks;
+   input.mIndices.clear();
+   input.mWrite = true;
+   for (unsigned int i = 0; i < blocks.size(); ++i)
+   {
+      const string& name = blocks[i].mName;
+      if (pendingBlocks.find(name) == pendingBlocks.end() && referenceSharedBlock(name, blocks[i].mSize) == false)
+      {
+         pendingBlocks.insert(name);
+         input.mIndices.push_back(i);
+      }
+   }
+
+   if (processSharedBlocks(input) == false)
+   {
+      return false;
+   }
+
+   mSharedBlocks.insert(mSharedBlocks.end(), pendingBlocks.begin(), pendingBlocks.end());
+   return true;
+}
+
+bool SessionItemSerializerImp::referenceSharedBlock(const string& name, int64_t size)
+{
+   QFileInfo info(QString::fromStdString(mDirectory + "/" + name));
+   if (!isSharedBlockFilename(name) || !info.isFile() || info.size() != size)
+   {
+      return false;
+   }
+
+   mSharedBlocks.push_back(name);
+   return true;
+}
+
+const vector<string>& SessionItemSerializerImp::getSharedBlocks() const
+{
+   return mSharedBlocks;
+}
+
+bool SessionItemSerializerImp::isSharedBlockFilename(const string& filename)
+{
+   return QString::fromStdString(filename).endsWith(SHARED_BLOCK_SUFFIX);
+}
+
+void SessionItemSerializerImp::setProgress(Progress* pProgress, const string& message, int startPercent,
+                                           int stopPercent)
+{
+   mpProgress = pProgress;
+   mProgressMessage = message;
+   mStartPercent = startPercent;
+   mStopPercent = stopPercent;
+}
+
+void SessionItemSerializerImp::updateProgress(int64_t completed, int64_t total)
+{
+   if (mpProgress != NULL && total > 0)
+   {
+      int percent = mStartPercent + static_cast<int>((mStopPercent - mStartPercent) * completed / total);
+      mpProgress->updateProgress(mProgressMessage, percent, NORMAL);
+   }
+}
@@ -18,6 +18,8 @@
 #include <string>
 #include <vector>
 
+class Progress;
+
 class SessionItemSerializerImp : public SessionItemSerializer
 {
 public:
@@ -32,6 +34,27 @@ public:
    void endBlock();
    unsigned int getBlockCount() const;
 
+   // Shared blocks are stored in the session directory under a name derived from their contents,
+   // so identical data is written once and unchanged data can be referenced by later saves
+   bool serializeSharedBlock(const void* pData, int64_t size, std::string& name);
+
+   // The blocks of a batch are hashed and written concurrently, and each name is set once the
+   // batch has been stored
+   struct SharedBlock
+   {
+      const void* mpData;
+      int64_t mSize;
+      std::string mName;
+   };
+   bool serializeSharedBlocks(std::vector<SharedBlock>& blocks);
+   bool referenceSharedBlock(const std::string& name, int64_t size);
+   const std::vector<std::string>& getSharedBlocks() const;
+   static bool isSharedBlockFilename(const std::string& filename);
+
+   // Progress within the item is reported as a range of the progress of the whole save
+   void setProgress(Progress* pProgress, const std::string& message, int startPercent, int stopPercent);
+   void updateProgress(int64_t completed, int64_t total);
+
 private:
    std::string mBaseFilename;
    std::string mFilename;
@@ -40,6 +63,12 @@ private:
    int64_t mBytesReserved;
    int64_t mBytesWritten;
    std::vector<int64_t> mBlockSizes;
+   std::string mDirectory;
+   std::vector<std::string> mSharedBlocks;
+   Progress* mpProgress;
+   std::string mProgressMessage;
+   int mStartPercent;
+   int mStopPercent;
 };
 
 #endif
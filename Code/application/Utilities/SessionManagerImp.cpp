@@ -14,6 +14,7 @@
 #include "AnimationServicesImp.h"
 #include "AnnotationLayer.h"
 #include "AnnotationLayerAdapter.h"
+#include "Any.h"
 #include "AoiLayerAdapter.h"
 #include "ApplicationWindow.h"
 #include "AppVersion.h"
@@ -33,6 +34,7 @@
 #include "MessageLogMgrImp.h"
 #include "ModelServicesImp.h"
 #include "ModuleDescriptor.h"
+#include "MultiThreadedAlgorithm.h"
 #include "ObjectResource.h"
 #include "PlotSet.h"
 #include "PlotView.h"
@@ -51,6 +53,8 @@
 #include "PseudocolorLayerAdapter.h"
 #include "RasterLayerAdapter.h"
 #include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterElementImp.h"
 #include "ScriptingWindow.h"
 #include "SessionItem.h"
 #include "SessionItemDeserializerImp.h"
@@ -107,6 +111,113 @@ struct ItemFilename
    }
 };
 
+namespace
+{
+   // Progress through a save is divided among the items by the amount of data that each one may write
+   int64_t getSaveWeight(SessionItem* pItem)
+   {
+      int64_t weight = 1;
+      RasterElement* pRaster = dynamic_cast<RasterElement*>(pItem);
+      if (pRaster != NULL)
+      {
+         const RasterDataDescriptor* pDescriptor =
+            dynamic_cast<const RasterDataDescriptor*>(pRaster->getDataDescriptor());
+         if (pDescriptor != NULL)
+         {
+            weight += static_cast<int64_t>(pDescriptor->getRowCount()) * pDescriptor->getColumnCount() *
+               pDescriptor->getBandCount() * pDescriptor->getBytesPerElement() / (1024 * 1024);
+         }
+      }
+
+      return weight;
+   }
+
+   // Data elements do not refer to each other or to the views and layers which display them, so they are saved
+   // concurrently before the other items.  Any elements are excluded since their data is defined by plug-ins.
+   bool isConcurrentSaveItem(SessionItem* pItem)
+   {
+      return dynamic_cast<DataElement*>(pItem) != NULL && dynamic_cast<Any*>(pItem) == NULL &&
+         pItem->isValidSessionSaveItem();
+   }
+
+   struct ItemSaveInput
+   {
+      vector<SessionItem*> mItems;
+      vector<string> mFilePaths;
+   };
+
+   struct ItemSaveResult
+   {
+      ItemSaveResult() :
+         mSuccess(false)
+      {
+      }
+
+      bool mSuccess;
+      vector<int64_t> mBlockSizes;
+      vector<string> mSharedBlocks;
+   };
+
+   class ItemSaveThread : public mta::AlgorithmThread
+   {
+   public:
+      ItemSaveThread(const ItemSaveInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter) :
+         mta::AlgorithmThread(threadIndex, reporter),
+         mInput(input),
+         mItemRange(getThreadRange(threadCount, static_cast<int>(input.mItems.size())))
+      {
+      }
+
+      void run()
+      {
+         for (int i = mItemRange.mFirst; i <= mItemRange.mLast; ++i)
+         {
+            SessionItemSerializerImp serializer(mInput.mFilePaths[i]);
+            mResults.push_back(ItemSaveResult());
+            ItemSaveResult& result = mResults.back();
+            result.mSuccess = mInput.mItems[i]->serialize(serializer);
+            if (result.mSuccess)
+            {
+               result.mBlockSizes = serializer.getBlockSizes();
+               result.mSharedBlocks = serializer.getSharedBlocks();
+            }
+
+            getReporter().reportProgress(getThreadIndex(), mItemRange.computePercent(i + 1));
+         }
+      }
+
+      int getFirstItem() const
+      {
+         return mItemRange.mFirst;
+      }
+
+      const vector<ItemSaveResult>& getResults() const
+      {
+         return mResults;
+      }
+
+   private:
+      const ItemSaveInput& mInput;
+      Range mItemRange;
+      vector<ItemSaveResult> mResults;
+   };
+
+   struct ItemSaveOutput
+   {
+      bool compileOverallResults(const vector<ItemSaveThread*>& threads)
+      {
+         for (vector<ItemSaveThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+         {
+            const vector<ItemSaveResult>& results = (*iter)->getResults();
+            copy(results.begin(), results.end(), mResults.begin() + (*iter)->getFirstItem());
+         }
+         return true;
+      }
+
+      vector<ItemSaveResult> mResults;
+   };
+}
+
 SessionManagerImp* SessionManagerImp::spInstance = NULL;
 bool SessionManagerImp::mDestroyed = false;
 
@@ -623,7 +734,33 @@ void SessionManagerImp::deleteObsoleteFiles(const string &dir, const vector<Inde
 
    for (pFilename = obsoleteFiles.begin(); pFilename != obsoleteFiles.end(); ++pFilename)
    {
-      dirList.remove(QString::fromStdString(*pFilename));
+      // shared blocks from the previous save may be referenced again, so they are kept until the save is done
+      if (SessionItemSerializerImp::isSharedBlockFilename(*pFilename) == false)
+      {
+         dirList.remove(QString::fromStdString(*pFilename));
+      }
+   }
+}
+
+void SessionManagerImp::deleteUnreferencedBlocks(const string &dir, vector<string> referencedBlocks) const
+{
+   QDir dirList(QString::fromStdString(dir));
+   QStringList files = dirList.entryList(QDir::Files, QDir::Name);
+
+   vector<string> dirFilenames;
+   transform(files.begin(), files.end(), back_inserter(dirFilenames), boost::bind(&QString::toStdString, _1));
+   sort(referencedBlocks.begin(), referencedBlocks.end());
+
+   vector<string> obsoleteFiles;
+   set_difference(dirFilenames.begin(), dirFilenames.end(), referencedBlocks.begin(), referencedBlocks.end(),
+      back_inserter(obsoleteFiles));
+
+   for (vector<string>::iterator pFilename = obsoleteFiles.begin(); pFilename != obsoleteFiles.end(); ++pFilename)
+   {
+      if (SessionItemSerializerImp::isSharedBlockFilename(*pFilename))
+      {
+         dirList.remove(QString::fromStdString(*pFilename));
+      }
    }
 }
 
@@ -1253,6 +1390,7 @@ SessionManagerImp::serialize(const string& filename, Progress* pProgress)
 
    vector<pair<SessionItem*, string> > failedItems;
    vector<IndexFileItem> successItems;
+   vector<string> sharedBlocks;
    QFileInfo fileInfo(filename.c_str());
    string sessionDirPath = fileInfo.absoluteDir().absolutePath().toStdString() + "/" +
       fileInfo.completeBaseName().toStdString() + ".sessionDir";
@@ -1279,12 +1417,81 @@ SessionManagerImp::serialize(const string& filename, Progress* pProgress)
 
    if (status != FAILURE)
    {
-      int count = items.size();
+      vector<int64_t> weights;
+      int64_t totalWeight = 0;
+      for (vector<IndexFileItem>::iterator ppItem = items.begin(); ppItem != items.end(); ++ppItem)
+      {
+         weights.push_back(getSaveWeight(ppItem->getSessionItem()));
+         totalWeight += weights.back();
+      }
+
+      // The concurrent items are saved first, which is the only ordering the items need since views and layers
+      // refer to the elements they display
+      ItemSaveInput concurrentInput;
+      vector<int> concurrentIndices(items.size(), -1);
+      int64_t concurrentWeight = 0;
+      for (vector<IndexFileItem>::size_type index = 0; index < items.size(); ++index)
+      {
+         SessionItem* pItem = items[index].getSessionItem();
+         if (pItem != NULL && isConcurrentSaveItem(pItem))
+         {
+            concurrentIndices[index] = static_cast<int>(concurrentInput.mItems.size());
+            concurrentInput.mItems.push_back(pItem);
+            concurrentInput.mFilePaths.push_back(getPathForItem(sessionDirPath, items[index]));
+            concurrentWeight += weights[index];
+         }
+      }
+
+      ItemSaveOutput concurrentOutput;
+      concurrentOutput.mResults.resize(concurrentInput.mItems.size());
+      if (concurrentInput.mItems.empty() == false)
+      {
+         vector<int> phaseWeights;
+         phaseWeights.push_back(static_cast<int>(100 * concurrentWeight / totalWeight));
+         phaseWeights.push_back(100 - phaseWeights.front());
+         mta::ProgressObjectReporter progressReporter("Saving session items...", pProgress);
+         mta::MultiPhaseProgressReporter phaseReporter(progressReporter, phaseWeights);
+
+         mta::MultiThreadedAlgorithm<ItemSaveInput, ItemSaveOutput, ItemSaveThread> alg(
+            mta::getNumRequiredThreads(static_cast<unsigned int>(concurrentInput.mItems.size())),
+            concurrentInput, concurrentOutput, &phaseReporter);
+         alg.run();
+      }
+
+      int64_t completedWeight = concurrentWeight;
       int i = 0;
       for (vector<IndexFileItem>::iterator ppItem = items.begin();
          ppItem != items.end();
          ++ppItem, ++i)
       {
+         if (concurrentIndices[i] >= 0)
+         {
+            const ItemSaveResult& result = concurrentOutput.mResults[concurrentIndices[i]];
+            if (result.mSuccess == false)
+            {
+               status = PARTIAL_SUCCESS;
+               failedItems.push_back(make_pair(ppItem->getSessionItem(), ppItem->mType));
+               if (pProgress)
+               {
+                  string message = "Error saving:\n  " + ppItem->mType + "\n";
+                  message += "Named:\n  " + ppItem->mName;
+                  pProgress->updateProgress(message, static_cast<int>(100 * completedWeight / totalWeight), WARNING);
+               }
+            }
+            else
+            {
+               ppItem->mBlockSizes = result.mBlockSizes;
+               successItems.push_back(*ppItem);
+               sharedBlocks.insert(sharedBlocks.end(), result.mSharedBlocks.begin(), result.mSharedBlocks.end());
+            }
+
+            continue;
+         }
+
+         int startPercent = static_cast<int>(100 * completedWeight / totalWeight);
+         completedWeight += weights[i];
+         int stopPercent = static_cast<int>(100 * completedWeight / totalWeight);
+
          SessionItem* pItem = ppItem->getSessionItem();
          LOG_IF(pItem == NULL, continue);
 
@@ -1298,9 +1505,10 @@ SessionManagerImp::serialize(const string& filename, Progress* pProgress)
          string filePath = getPathForItem(sessionDirPath, *ppItem);
          if (pProgress)
          {
-            pProgress->updateProgress("Saving session items...", 100*i/count, NORMAL);
+            pProgress->updateProgress("Saving session items...", startPercent, NORMAL);
          }
          SessionItemSerializerImp itemSerializer(filePath);
+         itemSerializer.setProgress(pProgress, "Saving session items...", startPercent, stopPercent);
          bool itemSuccess = pItem->serialize(itemSerializer);
          if (!itemSuccess)
          {
@@ -1310,13 +1518,15 @@ SessionManagerImp::serialize(const string& filename, Progress* pProgress)
             {
                string message = "Error saving:\n  " + ppItem->mType + "\n";
                message += "Named:\n  " + ppItem->mName;
-               pProgress->updateProgress(message, 100 * i / count, WARNING);
+               pProgress->updateProgress(message, stopPercent, WARNING);
             }
          }
          else
          {
             ppItem->mBlockSizes = itemSerializer.getBlockSizes();
             successItems.push_back(*ppItem);
+            const vector<string>& itemBlocks = itemSerializer.getSharedBlocks();
+            sharedBlocks.insert(sharedBlocks.end(), itemBlocks.begin(), itemBlocks.end());
          }
       }
 
@@ -1325,6 +1535,32 @@ SessionManagerImp::serialize(const string& filename, Progress* pProgress)
          failedItems.clear();
          status = FAILURE;
       }
+      else if (status == SUCCESS)
+      {
+         // Items which failed to save may still need their blocks from the previous save, so blocks are only
+         // pruned after a complete save.  Blocks which restored elements still read from are kept as well.
+         for (vector<IndexFileItem>::iterator ppItem = items.begin(); ppItem != items.end(); ++ppItem)
+         {
+            RasterElementImp* pRaster = dynamic_cast<RasterElementImp*>(ppItem->getSessionItem());
+            if (pRaster == NULL)
+            {
+               continue;
+            }
+
+            vector<string> mappedBlocks;
+            pRaster->getMappedSessionBlocks(mappedBlocks);
+            for (vector<string>::const_iterator pBlock = mappedBlocks.begin(); pBlock != mappedBlocks.end(); ++pBlock)
+            {
+               QFileInfo blockInfo(QString::fromStdString(*pBlock));
+               if (blockInfo.absoluteDir() == sessionDir)
+               {
+                  sharedBlocks.push_back(blockInfo.fileName().toStdString());
+               }
+            }
+         }
+
+         deleteUnreferencedBlocks(sessionDirPath, sharedBlocks);
+      }
       if (pProgress)
       {
          pProgress->updateProgress("Done.", 100, status == FAILURE ? ERRORS : NORMAL);
@@ -1333,11 +1569,18 @@ SessionManagerImp::serialize(const string& filename, Progress* pProgress)
 
    if (status == FAILURE)
    {
+      // Raster elements restored from this session may still read their data from its block files
+      bool restoredSession = mRestoreSessionPath.empty() == false &&
+         QDir(QString::fromStdString(mRestoreSessionPath)).absolutePath() == sessionDir.absolutePath();
+
       remove(filename.c_str());
       QStringList files(sessionDir.entryList());
       foreach(QString file, files)
       {
-         sessionDir.remove(file);
+         if (restoredSession == false || SessionItemSerializerImp::isSharedBlockFilename(file.toStdString()) == false)
+         {
+            sessionDir.remove(file);
+         }
       }
 
       sessionDir.rmdir(sessionDir.absolutePath());
@@ -135,6 +135,7 @@ private:
 
    void createSessionItems(std::vector<IndexFileItem> &items, Progress *pProgress);
    void deleteObsoleteFiles(const std::string &dir, const std::vector<IndexFileItem> &itemsToKeep) const;
+   void deleteUnreferencedBlocks(const std::string &dir, std::vector<std::string> referencedBlocks) const;
    void destroyFailedSessionItem(const std::string &type, SessionItem* pItem);
    std::vector<IndexFileItem> getAllIndexFileItems();
    std::string getPathForItem(const std::string &dir, const IndexFileItem &item) const;
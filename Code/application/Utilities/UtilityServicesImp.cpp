@@ -18,6 +18,7 @@
 #include "ProgressAdapter.h"
 #include "SessionManager.h"
 #include "StringUtilities.h"
+#include "ThreadPool.h"
 #include "ThreadSafeProgressAdapter.h"
 #include "UtilityServicesImp.h"
 #include "xmlreader.h"
@@ -42,6 +43,16 @@ struct SecurityFieldValue
 UtilityServicesImp* UtilityServicesImp::spInstance = NULL;
 bool UtilityServicesImp::mDestroyed = false;
 
+UtilityServicesImp::UtilityServicesImp() :
+   mpThreadPool(NULL)
+{
+}
+
+UtilityServicesImp::~UtilityServicesImp()
+{
+   delete mpThreadPool;
+}
+
 UtilityServicesImp* UtilityServicesImp::instance()
 {
    if (spInstance == NULL)
@@ -501,3 +512,29 @@ uint64_t UtilityServicesImp::getAvailableDiskSpace(string path)
 {
    return 0;
 }
+
+CacheBudget* UtilityServicesImp::getCacheBudget()
+{
+   return &mCacheBudget;
+}
+
+mta::ThreadPool* UtilityServicesImp::getThreadPool()
+{
+   return mpThreadPool;
+}
+
+void UtilityServicesImp::startThreadPool(unsigned int threadCount)
+{
+   if (mpThreadPool == NULL)
+   {
+      mpThreadPool = new mta::ThreadPool(threadCount);
+   }
+}
+
+void UtilityServicesImp::stopThreadPool()
+{
+   if (mpThreadPool != NULL)
+   {
+      mpThreadPool->stop();
+   }
+}
@@ -10,6 +10,7 @@
 #ifndef _UTILITYSERVICESIMP_H
 #define _UTILITYSERVICESIMP_H
 
+#include "CacheBudgetImp.h"
 #include "UtilityServices.h"
 #include "TypesFile.h"
 
@@ -53,6 +54,22 @@ public:
    size_t getTotalPhysicalMemory();
    size_t getAvailableVirtualMemory();
    uint64_t getAvailableDiskSpace( std::string path = "" );
+   CacheBudget* getCacheBudget();
+   mta::ThreadPool* getThreadPool();
+
+   /**
+    * Creates the thread pool returned by getThreadPool().
+    *
+    * @param threadCount
+    *        The number of threads in the pool.
+    */
+   void startThreadPool(unsigned int threadCount);
+
+   /**
+    * Stops the thread pool.  The pool is destroyed with this object, so
+    * modules may still cancel tasks after it has been stopped.
+    */
+   void stopThreadPool();
 
    /**
     * Overrides the default classification with the given value.
@@ -67,8 +84,8 @@ public:
    void overrideDefaultClassification(const std::string& newClassification);
 
 protected:
-   virtual ~UtilityServicesImp() {};
-   UtilityServicesImp() {};
+   virtual ~UtilityServicesImp();
+   UtilityServicesImp();
 
 private:
    std::map<DateTime*, DateTimeImp*> mDts;
@@ -88,6 +105,8 @@ private:
    static UtilityServicesImp* spInstance;
    static bool mDestroyed;
    std::string mClassificationOverride;
+   CacheBudgetImp mCacheBudget;
+   mta::ThreadPool* mpThreadPool;
 };
 
 #endif